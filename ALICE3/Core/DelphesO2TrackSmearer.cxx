@@ -0,0 +1,221 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   DelphesO2TrackSmearer.cxx
+/// \brief  Implementation of the parametrized track smearing with the DelphesO2 lookup tables
+///
+
+#include "ALICE3/Core/DelphesO2TrackSmearer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "TRandom.h"
+
+#include "Framework/Logger.h"
+
+namespace o2::delphes
+{
+
+float LUTMap::coordinate(float val) const
+{
+  if (log) {
+    if (val <= 0.f) {
+      return 0.f;
+    }
+    val = std::log10(val);
+  }
+  const float c = (val - min) / (max - min) * nbins - 0.5f;
+  return std::clamp(c, 0.f, static_cast<float>(nbins - 1));
+}
+
+LUTFile::~LUTFile()
+{
+  if (mData != nullptr) {
+    munmap(mData, mSize);
+  }
+}
+
+void LUTFile::open(const std::string& path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(fatal) << "Cannot open LUT file " << path;
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(LUTHeader)) {
+    ::close(fd);
+    LOG(fatal) << "LUT file " << path << " is too short for the header";
+    return;
+  }
+  mSize = st.st_size;
+  // MAP_SHARED read-only: the pages stay in the page cache and are shared by all processes mapping the file
+  mData = mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mData == MAP_FAILED) {
+    mData = nullptr;
+    LOG(fatal) << "Cannot map LUT file " << path;
+    return;
+  }
+
+  auto header = static_cast<const LUTHeader*>(mData);
+  const size_t nEntries = static_cast<size_t>(header->nchmap.nbins) * header->radmap.nbins * header->etamap.nbins * header->ptmap.nbins;
+  if (header->nchmap.nbins <= 0 || header->radmap.nbins <= 0 || header->etamap.nbins <= 0 || header->ptmap.nbins <= 0 ||
+      mSize != sizeof(LUTHeader) + nEntries * sizeof(LUTEntry)) {
+    LOG(fatal) << "LUT file " << path << " has " << mSize << " bytes, inconsistent with its binning";
+    return;
+  }
+  mHeader = header;
+  mEntries = reinterpret_cast<const LUTEntry*>(static_cast<const char*>(mData) + sizeof(LUTHeader));
+  LOG(info) << "Mapped LUT " << path << " for PDG " << mHeader->pdg << " (version " << mHeader->version << ", field " << mHeader->field << " T, "
+            << mHeader->nchmap.nbins << "x" << mHeader->etamap.nbins << "x" << mHeader->ptmap.nbins << " nch x eta x pt bins)";
+}
+
+TrackSmearer::Species TrackSmearer::getSpecies(int pdg)
+{
+  switch (std::abs(pdg)) {
+    case 11:
+      return kElectron;
+    case 13:
+      return kMuon;
+    case 211:
+      return kPion;
+    case 321:
+      return kKaon;
+    case 2212:
+      return kProton;
+    default:
+      return kNSpecies;
+  }
+}
+
+LUTPoint TrackSmearer::interpolate(Species species, float nch, float eta, float pt) const
+{
+  LUTPoint point;
+  auto const& lut = mLUTs[species];
+  auto const& header = lut.header();
+
+  // lower corner and weight of the upper corner in each dimension
+  int bins[3][2];
+  float weights[3];
+  const LUTMap* maps[3] = {&header.nchmap, &header.etamap, &header.ptmap};
+  const float values[3] = {nch, eta, pt};
+  for (int d = 0; d < 3; d++) {
+    const float c = maps[d]->coordinate(values[d]);
+    bins[d][0] = static_cast<int>(c);
+    bins[d][1] = std::min(bins[d][0] + 1, maps[d]->nbins - 1);
+    weights[d] = c - bins[d][0];
+  }
+
+  // corners with invalid entries are dropped and the remaining weights renormalised
+  float sumWeights = 0.f;
+  for (int corner = 0; corner < 8; corner++) {
+    float w = 1.f;
+    int idx[3];
+    for (int d = 0; d < 3; d++) {
+      const int upper = (corner >> d) & 1;
+      idx[d] = bins[d][upper];
+      w *= upper ? weights[d] : 1.f - weights[d];
+    }
+    if (w <= 0.f) {
+      continue;
+    }
+    auto const& entry = lut.entry(idx[0], 0, idx[1], idx[2]);
+    if (!entry.valid) {
+      continue;
+    }
+    sumWeights += w;
+    point.eff += w * entry.eff;
+    for (int i = 0; i < 15; i++) {
+      point.covm[i] += w * entry.covm[i];
+    }
+  }
+  if (sumWeights <= 0.f) {
+    return point;
+  }
+  point.valid = true;
+  point.eff /= sumWeights;
+  for (auto& c : point.covm) {
+    c /= sumWeights;
+  }
+  return point;
+}
+
+bool TrackSmearer::smearTrack(o2::track::TrackParCov& track, int pdg, float nch, TRandom& random) const
+{
+  const Species species = getSpecies(pdg);
+  if (species == kNSpecies || !hasTable(species)) {
+    return false;
+  }
+  const LUTPoint point = interpolate(species, nch, track.getEta(), track.getPt());
+  if (!point.valid || random.Uniform() > point.eff) {
+    return false;
+  }
+
+  // Cholesky factor L of the covariance (lower triangle, same packing as the TrackParCov covariance)
+  // so that L * (standard normal) has the covariance of the LUT
+  double l[5][5] = {{0.}};
+  bool positive = true;
+  for (int i = 0; i < 5 && positive; i++) {
+    for (int j = 0; j <= i; j++) {
+      double sum = point.covm[i * (i + 1) / 2 + j];
+      for (int k = 0; k < j; k++) {
+        sum -= l[i][k] * l[j][k];
+      }
+      if (i == j) {
+        if (sum <= 0.) {
+          positive = false;
+          break;
+        }
+        l[i][i] = std::sqrt(sum);
+      } else {
+        l[i][j] = sum / l[j][j];
+      }
+    }
+  }
+  if (!positive) {
+    // degenerate matrix, smear with the diagonal only
+    for (int i = 0; i < 5; i++) {
+      for (int j = 0; j < 5; j++) {
+        l[i][j] = 0.;
+      }
+      l[i][i] = std::sqrt(std::max(point.covm[i * (i + 1) / 2 + i], 0.f));
+    }
+  }
+
+  double gaus[5];
+  for (auto& g : gaus) {
+    g = random.Gaus();
+  }
+  for (int i = 0; i < 5; i++) {
+    double delta = 0.;
+    for (int j = 0; j <= i; j++) {
+      delta += l[i][j] * gaus[j];
+    }
+    track.setParam(track.getParam(i) + delta, i);
+  }
+  if (std::fabs(track.getSnp()) >= 1.f) {
+    return false;
+  }
+  for (int i = 0; i < 15; i++) {
+    track.setCov(point.covm[i], i);
+  }
+  return true;
+}
+
+} // namespace o2::delphes
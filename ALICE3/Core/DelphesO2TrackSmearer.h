@@ -0,0 +1,143 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file   DelphesO2TrackSmearer.h
+/// \brief  Parametrized track smearing with the DelphesO2 covariance lookup tables
+///
+/// The lookup tables (LUTs) are the binary lutCovm files written by DelphesO2: a header with the
+/// binning in multiplicity, radius, eta and pT, followed by one entry per bin with the efficiency
+/// and the covariance matrix of the track parameters. The files are memory mapped read-only, so
+/// that all workers on a node share the same physical pages.
+///
+/// Efficiency and covariance are interpolated trilinearly in (multiplicity, eta, pT) between the
+/// bin centers, and the track parameters are smeared with the Cholesky factor of the covariance.
+///
+
+#ifndef O2_ANALYSIS_ALICE3_DELPHESO2TRACKSMEARER_H_
+#define O2_ANALYSIS_ALICE3_DELPHESO2TRACKSMEARER_H_
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+#include "ReconstructionDataFormats/Track.h"
+
+class TRandom;
+
+namespace o2::delphes
+{
+
+/// Binning of one LUT dimension, as in DelphesO2 lutCovm.hh
+struct LUTMap {
+  int nbins = 1;
+  float min = 0.;
+  float max = 1.e6;
+  bool log = false;
+
+  /// \return continuous bin coordinate of val, bin centers are at integer values
+  float coordinate(float val) const;
+};
+
+/// LUT file header, as in DelphesO2 lutCovm.hh
+struct LUTHeader {
+  int version = 0;
+  int pdg = 0;
+  float mass = 0.;
+  float field = 0.;
+  LUTMap nchmap;
+  LUTMap radmap;
+  LUTMap etamap;
+  LUTMap ptmap;
+};
+
+/// LUT entry of one bin, as in DelphesO2 lutCovm.hh
+struct LUTEntry {
+  float nch = 0.;
+  float eta = 0.;
+  float pt = 0.;
+  bool valid = false;
+  float eff = 0.;
+  float eff2 = 0.;
+  float itof = 0.;
+  float otof = 0.;
+  float covm[15] = {0.};
+  float eigval[5] = {0.};
+  float eigvec[5][5] = {{0.}};
+  float eiginv[5][5] = {{0.}};
+};
+
+/// Read-only memory mapped LUT file of one particle species
+class LUTFile
+{
+ public:
+  LUTFile() = default;
+  ~LUTFile();
+  LUTFile(const LUTFile&) = delete;
+  LUTFile& operator=(const LUTFile&) = delete;
+
+  /// maps the file, fatal if the file is missing or inconsistent
+  void open(const std::string& path);
+  bool isOpen() const { return mHeader != nullptr; }
+
+  const LUTHeader& header() const { return *mHeader; }
+  const LUTEntry& entry(int inch, int irad, int ieta, int ipt) const
+  {
+    return mEntries[((static_cast<size_t>(inch) * mHeader->radmap.nbins + irad) * mHeader->etamap.nbins + ieta) * mHeader->ptmap.nbins + ipt];
+  }
+
+ private:
+  void* mData = nullptr;
+  size_t mSize = 0;
+  const LUTHeader* mHeader = nullptr;
+  const LUTEntry* mEntries = nullptr;
+};
+
+/// Efficiency and covariance interpolated at one (nch, eta, pt) point
+struct LUTPoint {
+  bool valid = false;
+  float eff = 0.;
+  std::array<float, 15> covm{};
+};
+
+class TrackSmearer
+{
+ public:
+  enum Species { kElectron = 0,
+                 kMuon,
+                 kPion,
+                 kKaon,
+                 kProton,
+                 kNSpecies };
+
+  /// maps the LUT file of a species
+  void loadTable(Species species, const std::string& path) { mLUTs[species].open(path); }
+  bool hasTable(Species species) const { return mLUTs[species].isOpen(); }
+  /// header of the LUT of a species, which must be loaded
+  const LUTHeader& header(Species species) const { return mLUTs[species].header(); }
+
+  /// \return species for the PDG code, kNSpecies if there is no LUT for it
+  static Species getSpecies(int pdg);
+
+  /// trilinear interpolation of efficiency and covariance, the lowest radius bin is used
+  LUTPoint interpolate(Species species, float nch, float eta, float pt) const;
+
+  /// draws the efficiency and smears the track parameters in place
+  /// \return false if the track is not reconstructed (efficiency, invalid LUT bins, unknown species)
+  bool smearTrack(o2::track::TrackParCov& track, int pdg, float nch, TRandom& random) const;
+
+ private:
+  std::array<LUTFile, kNSpecies> mLUTs;
+};
+
+} // namespace o2::delphes
+
+#endif // O2_ANALYSIS_ALICE3_DELPHESO2TRACKSMEARER_H_
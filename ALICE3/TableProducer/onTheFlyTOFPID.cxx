@@ -34,6 +34,9 @@
 #include "CommonConstants/PhysicsConstants.h"
 #include "TRandom3.h"
 
+#include <algorithm>
+#include <vector>
+
 /// \file onTheFlyTOFPID.cxx
 ///
 /// \brief This task goes straight from a combination of track table and mcParticles
@@ -92,6 +95,7 @@ struct OnTheFlyTOFPID {
   Configurable<float> outerTOFRadius{"outerTOFRadius", 80, "barrel outer TOF radius (cm)"};
   Configurable<float> innerTOFTimeReso{"innerTOFTimeReso", 20, "barrel inner TOF time error (ps)"};
   Configurable<float> outerTOFTimeReso{"outerTOFTimeReso", 20, "barrel outer TOF time error (ps)"};
+  Configurable<bool> useStepIntegrator{"useStepIntegrator", false, "calculate track lengths with the step integrator instead of the helix formula (validation)"};
   Configurable<int> nStepsLIntegrator{"nStepsLIntegrator", 200, "number of steps in length integrator"};
   Configurable<bool> doQAplots{"doQAplots", true, "do basic velocity plot qa"};
   Configurable<int> nBinsBeta{"nBinsBeta", 2200, "number of bins in beta"};
@@ -114,9 +118,43 @@ struct OnTheFlyTOFPID {
       const AxisSpec axisVelocity{static_cast<int>(nBinsBeta), 0.0f, +1.1f, "Measured #beta"};
       histos.add("h2dVelocityVsMomentumInner", "h2dVelocityVsMomentumInner", kTH2F, {axisMomentum, axisVelocity});
       histos.add("h2dVelocityVsMomentumOuter", "h2dVelocityVsMomentumOuter", kTH2F, {axisMomentum, axisVelocity});
+      if (useStepIntegrator) {
+        const AxisSpec axisLength{200, 0.0f, 400.0f, "Track length (cm)"};
+        const AxisSpec axisLengthDifference{200, -1.0f, +1.0f, "Helix - integrated track length (cm)"};
+        histos.add("h2dLengthDifference", "h2dLengthDifference", kTH2F, {axisLength, axisLengthDifference});
+      }
     }
   }
 
+  // per-event buffer of the track segments from the primary vertex to the TOF layers,
+  // whose lengths are calculated for all tracks of the event at once
+  enum Segment { kInnerTOF = 0,
+                 kOuterTOF,
+                 kRecoInnerTOF,
+                 kRecoOuterTOF,
+                 kNSegments };
+  struct SegmentBuffer {
+    std::vector<float> chord;     // transverse distance between start and end point (cm), < 0 if the layer is not reached
+    std::vector<float> curvature; // absolute curvature in the transverse plane (1/cm)
+    std::vector<float> tgl;       // tangent of the dip angle
+    std::vector<float> length;    // resulting path length (cm), -1 if the layer is not reached
+    void clear()
+    {
+      chord.clear();
+      curvature.clear();
+      tgl.clear();
+      length.clear();
+    }
+  } segments;
+
+  // per-track quantities needed after the length calculation
+  struct TrackInfo {
+    float momentum;
+    float recoMomentum;
+    float mass;
+  };
+  std::vector<TrackInfo> trackInfos;
+
   /// Function to convert a McParticle into a perfect Track
   /// \param particle the particle to convert (mcParticle)
   /// \param o2track the address of the resulting TrackParCov
@@ -166,6 +204,41 @@ struct OnTheFlyTOFPID {
     return length;
   }
 
+  /// adds the segment of the track between x0 and x1 to the segment buffer
+  /// \param valid false if the track does not reach x1, the length is then -1
+  void addSegment(o2::track::TrackParCov track, float x0, float x1, float magneticField, bool valid)
+  {
+    if (useStepIntegrator) {
+      segments.length.push_back(valid ? trackLength(track, x0, x1, magneticField) : -1.f);
+    }
+    std::array<float, 3> start;
+    std::array<float, 3> end;
+    float chord = -1.f;
+    if (valid) {
+      track.propagateTo(x0, magneticField);
+      track.getXYZGlo(start);
+      track.propagateTo(x1, magneticField);
+      track.getXYZGlo(end);
+      chord = std::hypot(end[0] - start[0], end[1] - start[1]);
+    }
+    segments.chord.push_back(chord);
+    segments.curvature.push_back(std::abs(track.getCurvature(magneticField)));
+    segments.tgl.push_back(track.getTgl());
+  }
+
+  /// exact path lengths along helices in a uniform solenoidal field: a segment with transverse
+  /// chord c and curvature k spans the arc 2/k asin(k c / 2) in the transverse plane
+  /// \param n number of segments
+  static void helixLengths(size_t n, const float* chord, const float* curvature, const float* tgl, float* length)
+  {
+    for (size_t i = 0; i < n; i++) {
+      const float halfChordCurvature = 0.5f * chord[i] * curvature[i];
+      // asin(h) / h -> 1 + h^2 / 6 for straight tracks
+      const float arcOverChord = halfChordCurvature < 1e-3f ? 1.f + halfChordCurvature * halfChordCurvature / 6.f : std::asin(std::min(halfChordCurvature, 1.f)) / halfChordCurvature;
+      length[i] = chord[i] < 0.f ? -1.f : chord[i] * arcOverChord * std::sqrt(1.f + tgl[i] * tgl[i]);
+    }
+  }
+
   /// returns velocity in centimeters per picoseconds
   /// \param momentum the momentum of the tarck
   /// \param mass the mass of the particle
@@ -190,6 +263,8 @@ struct OnTheFlyTOFPID {
       mcPvVtx.setZ(mcCollision.posZ());
     } // else remains untreated for now
 
+    segments.clear();
+    trackInfos.clear();
     for (const auto& track : tracks) {
       // first step: find precise arrival time (if any)
       // --- convert track into perfect track
@@ -200,33 +275,24 @@ struct OnTheFlyTOFPID {
       auto mcParticle = track.mcParticle();
       convertMCParticleToO2Track(mcParticle, o2track);
 
-      float xPv = -100, xInnerTOF = -100, xOuterTOF = -100, trackLengthInnerTOF = -1, trackLengthOuterTOF = -1;
-      if (o2track.propagateToDCA(mcPvVtx, dBz))
-        xPv = o2track.getX();
-      if (!o2track.getXatLabR(innerTOFRadius, xInnerTOF, dBz, o2::track::DirOutward))
-        xInnerTOF = -100;
-      if (!o2track.getXatLabR(outerTOFRadius, xOuterTOF, dBz, o2::track::DirOutward))
-        xOuterTOF = -100;
-      if (xPv > -99. && xInnerTOF > -99.)
-        trackLengthInnerTOF = trackLength(o2track, xPv, xInnerTOF, dBz);
-      if (xPv > -99. && xOuterTOF > -99.)
-        trackLengthOuterTOF = trackLength(o2track, xPv, xOuterTOF, dBz);
-
       // get mass to calculate velocity
       auto pdgInfo = pdg->GetParticle(mcParticle.pdgCode());
       if (pdgInfo == nullptr) {
         continue;
       }
-      float expectedTimeInnerTOF = trackLengthInnerTOF / velocity(o2track.getP(), pdgInfo->Mass());
-      float expectedTimeOuterTOF = trackLengthOuterTOF / velocity(o2track.getP(), pdgInfo->Mass());
 
-      // Smear with expected resolutions
-      float measuredTimeInnerTOF = pRandomNumberGenerator.Gaus(expectedTimeInnerTOF, innerTOFTimeReso);
-      float measuredTimeOuterTOF = pRandomNumberGenerator.Gaus(expectedTimeOuterTOF, innerTOFTimeReso);
+      float xPv = -100, xInnerTOF = -100, xOuterTOF = -100;
+      if (o2track.propagateToDCA(mcPvVtx, dBz))
+        xPv = o2track.getX();
+      if (!o2track.getXatLabR(innerTOFRadius, xInnerTOF, dBz, o2::track::DirOutward))
+        xInnerTOF = -100;
+      if (!o2track.getXatLabR(outerTOFRadius, xOuterTOF, dBz, o2::track::DirOutward))
+        xOuterTOF = -100;
+      addSegment(o2track, xPv, xInnerTOF, dBz, xPv > -99. && xInnerTOF > -99.);
+      addSegment(o2track, xPv, xOuterTOF, dBz, xPv > -99. && xOuterTOF > -99.);
 
       // Now we calculate the expected arrival time following certain mass hypotheses
       // and the (imperfect!) reconstructed track parametrizations
-      float trackLengthRecoInnerTOF = -1, trackLengthRecoOuterTOF = -1;
       auto recoTrack = getTrackParCov(track);
       if (recoTrack.propagateToDCA(pvVtx, dBz))
         xPv = recoTrack.getX();
@@ -234,10 +300,41 @@ struct OnTheFlyTOFPID {
         xInnerTOF = -100;
       if (!recoTrack.getXatLabR(outerTOFRadius, xOuterTOF, dBz, o2::track::DirOutward))
         xOuterTOF = -100;
-      if (xPv > -99. && xInnerTOF > -99.)
-        trackLengthRecoInnerTOF = trackLength(recoTrack, xPv, xInnerTOF, dBz);
-      if (xPv > -99. && xOuterTOF > -99.)
-        trackLengthRecoOuterTOF = trackLength(recoTrack, xPv, xOuterTOF, dBz);
+      addSegment(recoTrack, xPv, xInnerTOF, dBz, xPv > -99. && xInnerTOF > -99.);
+      addSegment(recoTrack, xPv, xOuterTOF, dBz, xPv > -99. && xOuterTOF > -99.);
+
+      trackInfos.push_back({o2track.getP(), recoTrack.getP(), static_cast<float>(pdgInfo->Mass())});
+    }
+
+    // track lengths of all segments of the event
+    const size_t nSegments = segments.chord.size();
+    if (useStepIntegrator) {
+      if (doQAplots) {
+        std::vector<float> helixLength(nSegments);
+        helixLengths(nSegments, segments.chord.data(), segments.curvature.data(), segments.tgl.data(), helixLength.data());
+        for (size_t i = 0; i < nSegments; i++) {
+          if (segments.length[i] > 0) {
+            histos.fill(HIST("h2dLengthDifference"), segments.length[i], helixLength[i] - segments.length[i]);
+          }
+        }
+      }
+    } else {
+      segments.length.resize(nSegments);
+      helixLengths(nSegments, segments.chord.data(), segments.curvature.data(), segments.tgl.data(), segments.length.data());
+    }
+
+    for (size_t iTrack = 0; iTrack < trackInfos.size(); iTrack++) {
+      const auto& info = trackInfos[iTrack];
+      const float* lengths = &segments.length[iTrack * kNSegments];
+      float trackLengthInnerTOF = lengths[kInnerTOF], trackLengthOuterTOF = lengths[kOuterTOF];
+      float trackLengthRecoInnerTOF = lengths[kRecoInnerTOF], trackLengthRecoOuterTOF = lengths[kRecoOuterTOF];
+
+      float expectedTimeInnerTOF = trackLengthInnerTOF / velocity(info.momentum, info.mass);
+      float expectedTimeOuterTOF = trackLengthOuterTOF / velocity(info.momentum, info.mass);
+
+      // Smear with expected resolutions
+      float measuredTimeInnerTOF = pRandomNumberGenerator.Gaus(expectedTimeInnerTOF, innerTOFTimeReso);
+      float measuredTimeOuterTOF = pRandomNumberGenerator.Gaus(expectedTimeOuterTOF, innerTOFTimeReso);
 
       // Straight to Nsigma
       float deltaTimeInnerTOF[5], nSigmaInnerTOF[5];
@@ -246,7 +343,7 @@ struct OnTheFlyTOFPID {
       float masses[5];
 
       if (doQAplots) {
-        float momentum = recoTrack.getP();
+        float momentum = info.recoMomentum;
         // unit conversion: length in cm, time in ps
         float innerBeta = 1e+3 * (trackLengthInnerTOF / measuredTimeInnerTOF) / o2::constants::physics::LightSpeedCm2NS;
         float outerBeta = 1e+3 * (trackLengthOuterTOF / measuredTimeOuterTOF) / o2::constants::physics::LightSpeedCm2NS;
@@ -262,8 +359,8 @@ struct OnTheFlyTOFPID {
 
         auto pdgInfoThis = pdg->GetParticle(lpdg_array[ii]);
         masses[ii] = pdgInfoThis->Mass();
-        deltaTimeInnerTOF[ii] = trackLengthRecoInnerTOF / velocity(recoTrack.getP(), masses[ii]) - measuredTimeInnerTOF;
-        deltaTimeOuterTOF[ii] = trackLengthRecoOuterTOF / velocity(recoTrack.getP(), masses[ii]) - measuredTimeOuterTOF;
+        deltaTimeInnerTOF[ii] = trackLengthRecoInnerTOF / velocity(info.recoMomentum, masses[ii]) - measuredTimeInnerTOF;
+        deltaTimeOuterTOF[ii] = trackLengthRecoOuterTOF / velocity(info.recoMomentum, masses[ii]) - measuredTimeOuterTOF;
 
         // Fixme: assumes dominant resolution effect is the TOF resolution
         // and not the tracking itself. It's *probably* a fair assumption
@@ -38,6 +38,8 @@
 #include "DataFormatsParameters/GRPMagField.h"
 #include "DataFormatsCalibration/MeanVertexObject.h"
 #include "CommonConstants/GeomConstants.h"
+#include "ALICE3/Core/DelphesO2TrackSmearer.h"
+#include "TRandom3.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -54,9 +56,24 @@ struct OnTheFlyTracker {
 
   Configurable<float> maxEta{"maxEta", 1.5, "maximum eta to consider viable"};
   Configurable<float> minPt{"minPt", 0.1, "minimum pt to consider viable"};
+  Configurable<bool> enableLUT{"enableLUT", false, "Enable track smearing with the DelphesO2 LUTs"};
+  Configurable<std::string> lutEl{"lutEl", "lutCovm.el.dat", "LUT for electrons"};
+  Configurable<std::string> lutMu{"lutMu", "lutCovm.mu.dat", "LUT for muons"};
+  Configurable<std::string> lutPi{"lutPi", "lutCovm.pi.dat", "LUT for pions"};
+  Configurable<std::string> lutKa{"lutKa", "lutCovm.ka.dat", "LUT for kaons"};
+  Configurable<std::string> lutPr{"lutPr", "lutCovm.pr.dat", "LUT for protons"};
+  Configurable<float> magneticField{"magneticField", 20.0f, "magnetic field (kG) for the propagation to the vertex"};
+  Configurable<int> seed{"seed", 0, "Seed of the random generator for the smearing (0: unique seed)"};
 
   bool fillTracksDCA = false;
 
+  o2::delphes::TrackSmearer smearer;
+  TRandom3 random;
+
+  // tracks of the current collision, kept across collisions to reuse the memory
+  std::vector<o2::track::TrackParCov> collisionTracks;
+  std::vector<int64_t> collisionLabels;
+
   // necessary for particle charges
   Service<O2DatabasePDG> pdg;
 
@@ -80,6 +97,25 @@ struct OnTheFlyTracker {
     // Basic QA
     const AxisSpec axisMomentum{static_cast<int>(100), 0.0f, +10.0f, "#it{p} (GeV/#it{c})"};
     histos.add("hPt", "hPt", kTH1F, {axisMomentum});
+
+    if (enableLUT) {
+      // the LUTs are memory mapped, workers on the same node share the pages of the files
+      smearer.loadTable(o2::delphes::TrackSmearer::kElectron, lutEl.value);
+      smearer.loadTable(o2::delphes::TrackSmearer::kMuon, lutMu.value);
+      smearer.loadTable(o2::delphes::TrackSmearer::kPion, lutPi.value);
+      smearer.loadTable(o2::delphes::TrackSmearer::kKaon, lutKa.value);
+      smearer.loadTable(o2::delphes::TrackSmearer::kProton, lutPr.value);
+      // the LUTs are only valid for the field they were produced with (in T in the LUT header)
+      for (int species = 0; species < o2::delphes::TrackSmearer::kNSpecies; species++) {
+        const float lutField = 10.f * smearer.header(static_cast<o2::delphes::TrackSmearer::Species>(species)).field;
+        if (std::abs(lutField - magneticField) > 1e-3f) {
+          LOG(fatal) << "LUT for species " << species << " was produced with a magnetic field of " << lutField << " kG, but magneticField is " << magneticField.value << " kG";
+        }
+      }
+      random.SetSeed(seed);
+      histos.add("hNch", "hNch", kTH1F, {{200, 0.0f, 2000.0f, "#it{N}_{ch} (|#eta| < 0.5)"}});
+      histos.add("hPtGenerated", "hPtGenerated", kTH1F, {axisMomentum});
+    }
   }
 
   /// Function to convert a McParticle into a perfect Track
@@ -121,9 +157,24 @@ struct OnTheFlyTracker {
 
   void process(aod::McCollision const& mcCollision, aod::McParticles const& mcParticles)
   {
-    o2::dataformats::DCA dcaInfoCov;
-    o2::dataformats::VertexBase vtx;
+    // multiplicity for the LUT lookup: charged physical primaries in |eta| < 0.5
+    float nch = 0.f;
+    if (enableLUT) {
+      for (const auto& mcParticle : mcParticles) {
+        if (!mcParticle.isPhysicalPrimary() || std::fabs(mcParticle.eta()) > 0.5f) {
+          continue;
+        }
+        auto pdgInfo = pdg->GetParticle(mcParticle.pdgCode());
+        if (pdgInfo != nullptr && pdgInfo->Charge() != 0) {
+          nch++;
+        }
+      }
+      histos.fill(HIST("hNch"), nch);
+    }
 
+    // convert and smear all tracks of the collision before filling the tables
+    collisionTracks.clear();
+    collisionLabels.clear();
     for (const auto& mcParticle : mcParticles) {
       auto pdg = std::abs(mcParticle.pdgCode());
       if (pdg != kElectron && pdg != kMuonMinus && pdg != kPiPlus && pdg != kKPlus && pdg != kProton)
@@ -136,16 +187,28 @@ struct OnTheFlyTracker {
       o2::track::TrackParCov trackParCov;
       convertMCParticleToO2Track(mcParticle, trackParCov);
 
-      // *+-+*+-+*+-+*+-+*+-+*+-+*+-+*+-+*+-+*+-+*+-+*+-+*+-+*
-      // do the smearing in a one-liner with TrackSmearer
-      // FIXME this has to be made available!
-      // if (!smearer.smearTrack(o2track, pdg, nch)) continue;
-      // *+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*
+      if (enableLUT) {
+        histos.fill(HIST("hPtGenerated"), trackParCov.getPt());
+        if (!smearer.smearTrack(trackParCov, mcParticle.pdgCode(), nch, random))
+          continue;
+      }
+      collisionTracks.push_back(trackParCov);
+      collisionLabels.push_back(mcParticle.globalIndex());
+    }
 
-      // *+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*
-      // Calculate primary vertex
-      // To be added once smeared tracks are in place
-      // *+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*+~+*
+    // vertex step: the vertex is placed at the generated position, with the smeared tracks as contributors,
+    // and the smeared tracks are propagated to their point of closest approach to it
+    o2::dataformats::DCA dcaInfoCov;
+    o2::dataformats::VertexBase vtx;
+    vtx.setXYZ(mcCollision.posX(), mcCollision.posY(), mcCollision.posZ());
+    vtx.setCov(1e-3, 0.0, 1e-3, 0.0, 0.0, 1e-3);
+
+    for (size_t iTrack = 0; iTrack < collisionTracks.size(); iTrack++) {
+      auto& trackParCov = collisionTracks[iTrack];
+      bool hasDCA = false;
+      if (enableLUT) {
+        hasDCA = trackParCov.propagateToDCA(vtx, magneticField, &dcaInfoCov);
+      }
 
       // Base QA
       histos.fill(HIST("hPt"), trackParCov.getPt());
@@ -154,7 +217,11 @@ struct OnTheFlyTracker {
       aod::track::TrackTypeEnum trackType = aod::track::Track;
       fillTracksPar(mcCollision, trackType, trackParCov);
       if (fillTracksDCA) {
-        tracksDCA(1e-3, 1e-3);
+        if (hasDCA) {
+          tracksDCA(dcaInfoCov.getY(), dcaInfoCov.getZ());
+        } else {
+          tracksDCA(1e-3, 1e-3);
+        }
       }
       // TODO do we keep the rho as 0? Also the sigma's are duplicated information
       tracksParCov(std::sqrt(trackParCov.getSigmaY2()), std::sqrt(trackParCov.getSigmaZ2()), std::sqrt(trackParCov.getSigmaSnp2()),
@@ -163,12 +230,12 @@ struct OnTheFlyTracker {
                             trackParCov.getSigmaSnpZ(), trackParCov.getSigmaSnp2(), trackParCov.getSigmaTglY(), trackParCov.getSigmaTglZ(), trackParCov.getSigmaTglSnp(),
                             trackParCov.getSigmaTgl2(), trackParCov.getSigma1PtY(), trackParCov.getSigma1PtZ(), trackParCov.getSigma1PtSnp(), trackParCov.getSigma1PtTgl(),
                             trackParCov.getSigma1Pt2());
-      tracksLabels(mcParticle.globalIndex(), 0);
+      tracksLabels(collisionLabels[iTrack], 0);
     }
     collisions(-1, // BC is irrelevant in synthetic MC tests for now, could be adjusted in future
-               mcCollision.posX(), mcCollision.posY(), mcCollision.posZ(),
-               1e-3, 0.0, 1e-3, 0.0, 0.0, 1e-3,
-               0, 1e-3, mcParticles.size(),
+               vtx.getX(), vtx.getY(), vtx.getZ(),
+               vtx.getSigmaX2(), vtx.getSigmaXY(), vtx.getSigmaY2(), vtx.getSigmaXZ(), vtx.getSigmaYZ(), vtx.getSigmaZ2(),
+               0, 1e-3, enableLUT ? collisionTracks.size() : mcParticles.size(),
                0, 0);
     collLabels(mcCollision.globalIndex(), 0);
   }
@@ -0,0 +1,270 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file EventMixingPool.h
+/// \brief Pool of compact event snapshots which survives across dataframes, for event mixing
+///
+/// The mixing helpers of the framework only combine collisions of the same dataframe, so that
+/// collisions at the start of a dataframe or in rarely populated bins are mixed with few or no
+/// partners. The pool keeps for each mixing bin the last N events as a structure of arrays of
+/// the few columns needed for the pairing. When a bin is full the oldest event is overwritten,
+/// so the content of the pool only depends on the order in which the events are added.
+///
+/// Usage: define the row type with named accessors on top of PoolRow
+///
+///   struct MyPooledTrack : eventmixing::PoolRow<float, float, float, int8_t> {
+///     using PoolRow::PoolRow;
+///     float pt() const { return get<0>(); }
+///     ...
+///   };
+///
+///   eventmixing::MixingPool<MyPooledTrack> pool;
+///   pool.init(depth, maxParticlesPerEvent);
+///   for (int i = 0; i < pool.size(bin); i++) {
+///     for (auto& track : pool.event(bin, i)) { ... }
+///   }
+///   pool.addEvent(bin, tracks, [](auto const& track) { return std::make_tuple(track.pt(), ...); });
+
+#ifndef ANALYSIS_CORE_EVENTMIXINGPOOL_H_
+#define ANALYSIS_CORE_EVENTMIXINGPOOL_H_
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace eventmixing
+{
+/// Particles of one pooled event, stored column-wise
+template <typename... Ts>
+class PoolEvent
+{
+ public:
+  using Columns = std::tuple<std::vector<Ts>...>;
+
+  size_t size() const { return mSize; }
+
+  template <size_t I>
+  auto const& column() const
+  {
+    return std::get<I>(mColumns);
+  }
+
+  /// Removes all particles, keeping the allocated memory for the next event
+  void clear()
+  {
+    std::apply([](auto&... columns) { (columns.clear(), ...); }, mColumns);
+    mSize = 0;
+  }
+
+  void reserve(size_t n)
+  {
+    std::apply([n](auto&... columns) { (columns.reserve(n), ...); }, mColumns);
+  }
+
+  void push_back(std::tuple<Ts...> const& row)
+  {
+    pushBack(row, std::index_sequence_for<Ts...>{});
+    mSize++;
+  }
+
+  /// \return memory held by the columns in bytes
+  size_t capacityBytes() const
+  {
+    return std::apply([](auto const&... columns) { return (size_t{0} + ... + (columns.capacity() * sizeof(typename std::decay_t<decltype(columns)>::value_type))); }, mColumns);
+  }
+
+ private:
+  template <size_t... Is>
+  void pushBack(std::tuple<Ts...> const& row, std::index_sequence<Is...>)
+  {
+    (std::get<Is>(mColumns).push_back(std::get<Is>(row)), ...);
+  }
+
+  Columns mColumns;
+  size_t mSize = 0;
+};
+
+/// Base of the row type handed to the user when iterating over a pooled event
+template <typename... Ts>
+class PoolRow
+{
+ public:
+  using Event = PoolEvent<Ts...>;
+  using Snapshot = std::tuple<Ts...>;
+
+  PoolRow(Event const* event, size_t index) : mEvent(event), mIndex(index) {}
+
+  template <size_t I>
+  auto get() const
+  {
+    return mEvent->template column<I>()[mIndex];
+  }
+
+  /// position of the particle in its event
+  size_t index() const { return mIndex; }
+  void moveToIndex(size_t index) { mIndex = index; }
+
+ protected:
+  Event const* mEvent;
+  size_t mIndex;
+};
+
+/// Iterable view of one pooled event
+template <typename TRow>
+class PoolEventView
+{
+ public:
+  using Event = typename TRow::Event;
+
+  class iterator
+  {
+   public:
+    iterator(Event const* event, size_t index) : mRow(event, index) {}
+    TRow const& operator*() const { return mRow; }
+    TRow const* operator->() const { return &mRow; }
+    iterator& operator++()
+    {
+      mRow.moveToIndex(mRow.index() + 1);
+      return *this;
+    }
+    bool operator!=(iterator const& other) const { return mRow.index() != other.mRow.index(); }
+    bool operator==(iterator const& other) const { return mRow.index() == other.mRow.index(); }
+
+   private:
+    TRow mRow;
+  };
+
+  explicit PoolEventView(Event const* event) : mEvent(event) {}
+
+  size_t size() const { return mEvent->size(); }
+  iterator begin() const { return iterator(mEvent, 0); }
+  iterator end() const { return iterator(mEvent, mEvent->size()); }
+  TRow iteratorAt(size_t i) const { return TRow(mEvent, i); }
+
+ private:
+  Event const* mEvent;
+};
+
+/// Bounded per-bin ring buffer of pooled events
+/// \tparam TRow Row type deriving from PoolRow<Ts...>, which defines the stored columns
+template <typename TRow>
+class MixingPool
+{
+ public:
+  using Event = typename TRow::Event;
+  using Snapshot = typename TRow::Snapshot;
+  using View = PoolEventView<TRow>;
+
+  /// \param depth Maximum number of events kept per bin
+  /// \param maxParticlesPerEvent Events with more particles are not stored (<= 0 for no limit)
+  void init(int depth, int maxParticlesPerEvent)
+  {
+    mDepth = depth > 0 ? depth : 1;
+    mMaxParticlesPerEvent = maxParticlesPerEvent;
+    mBins.clear();
+  }
+
+  /// Removes all stored events, e.g. at a change of run, keeping the allocated memory
+  void clear()
+  {
+    for (auto& poolBin : mBins) {
+      poolBin.next = 0;
+      poolBin.filled = 0;
+    }
+  }
+
+  /// \return number of events stored in this bin
+  int size(int bin) const
+  {
+    if (bin < 0 || bin >= static_cast<int>(mBins.size())) {
+      return 0;
+    }
+    return mBins[bin].filled;
+  }
+
+  /// \return stored event i of this bin, where 0 is the most recently added one
+  View event(int bin, int i) const
+  {
+    auto const& poolBin = mBins[bin];
+    int slot = poolBin.next - 1 - i;
+    if (slot < 0) {
+      slot += mDepth;
+    }
+    return View(&poolBin.events[slot]);
+  }
+
+  /// Stores the event, replacing the oldest one of the bin if the bin is full
+  /// \param snapshot callable returning the Snapshot tuple of a particle
+  /// \return false if the event was not stored (bin < 0 or too many particles)
+  template <typename TParticles, typename F>
+  bool addEvent(int bin, TParticles const& particles, F&& snapshot)
+  {
+    if (bin < 0) {
+      return false;
+    }
+    if (mMaxParticlesPerEvent > 0 && static_cast<int>(particles.size()) > mMaxParticlesPerEvent) {
+      mRejected++;
+      return false;
+    }
+    if (bin >= static_cast<int>(mBins.size())) {
+      mBins.resize(bin + 1);
+    }
+    auto& poolBin = mBins[bin];
+    if (poolBin.events.empty()) {
+      poolBin.events.resize(mDepth);
+    }
+
+    auto& event = poolBin.events[poolBin.next];
+    event.clear();
+    event.reserve(particles.size());
+    for (auto const& particle : particles) {
+      event.push_back(snapshot(particle));
+    }
+
+    poolBin.next = (poolBin.next + 1) % mDepth;
+    if (poolBin.filled < mDepth) {
+      poolBin.filled++;
+    }
+    return true;
+  }
+
+  /// \return number of events which were not stored because of the particle limit
+  long rejectedEvents() const { return mRejected; }
+
+  /// \return memory held by the pool in bytes
+  size_t memoryUsage() const
+  {
+    size_t bytes = 0;
+    for (auto const& poolBin : mBins) {
+      for (auto const& event : poolBin.events) {
+        bytes += event.capacityBytes();
+      }
+    }
+    return bytes;
+  }
+
+ private:
+  struct Bin {
+    std::vector<Event> events; // ring buffer of mDepth events
+    int next = 0;              // slot which is overwritten next
+    int filled = 0;            // number of stored events
+  };
+
+  std::vector<Bin> mBins;
+  int mDepth = 1;
+  int mMaxParticlesPerEvent = -1;
+  long mRejected = 0;
+};
+
+} // namespace eventmixing
+
+#endif // ANALYSIS_CORE_EVENTMIXINGPOOL_H_
@@ -137,6 +137,34 @@ class TOFResoParamsV2 : public o2::tof::Parameters<5>
   ~TOFResoParamsV2() = default;
 };
 
+/// \brief Track quantities entering the TOF separation, read once per track and shared by all mass hypotheses
+struct TrackInputs {
+  bool hasTOF = false;
+  float p = 0.f;
+  float tofSignal = 0.f;
+  float tofEvTime = 0.f;
+  float tofEvTimeErr = 0.f;
+  float length = 0.f;
+  float tofExpMom = 0.f; /// In the units of Run 3 tracks
+
+  template <typename TrackType>
+  static TrackInputs fromTrack(const TrackType& track)
+  {
+    TrackInputs inputs;
+    inputs.hasTOF = track.hasTOF();
+    if (!inputs.hasTOF) {
+      return inputs;
+    }
+    inputs.p = track.p();
+    inputs.tofSignal = track.tofSignal();
+    inputs.tofEvTime = track.tofEvTime();
+    inputs.tofEvTimeErr = track.tofEvTimeErr();
+    inputs.length = track.length();
+    inputs.tofExpMom = track.trackType() == o2::aod::track::Run2Track ? track.tofExpMom() / kCSPEED : track.tofExpMom();
+    return inputs;
+  }
+};
+
 /// \brief Class to handle the the TOF detector response for the expected time
 template <typename TrackType, o2::track::PID::ID id>
 class ExpTimes
@@ -163,6 +191,22 @@ class ExpTimes
     return ComputeExpectedTime(track.tofExpMom(), track.length());
   }
 
+  /// Computes the expected resolution of the t-texp-t0 from the track momentum
+  /// \param parameters Detector response parameters (TOFResoParams or TOFResoParamsV2)
+  /// \param mom Momentum of the track of interest
+  /// \param tofSignal TOF signal of the track of interest
+  /// \param collisionTimeRes Collision time resolution of the track of interest
+  template <typename ParamType>
+  static float ComputeExpectedSigma(const ParamType& parameters, const float mom, const float tofSignal, const float collisionTimeRes)
+  {
+    if (mom <= 0) {
+      return -999.f;
+    }
+    const float dpp = parameters[0] + parameters[1] * mom + parameters[2] * mMassZ / mom; // mean relative pt resolution;
+    const float sigma = dpp * tofSignal / (1. + mom * mom / (mMassZSqared));
+    return std::sqrt(sigma * sigma + parameters[3] * parameters[3] / mom / mom + parameters[4] * parameters[4] + collisionTimeRes * collisionTimeRes);
+  }
+
   /// Gets the expected resolution of the t-texp-t0
   /// Given a TOF signal and collision time resolutions
   /// \param response Detector response with parameters
@@ -186,16 +230,7 @@ class ExpTimes
   /// \param track Track of interest
   /// \param tofSignal TOF signal of the track of interest
   /// \param collisionTimeRes Collision time resolution of the track of interest
-  static float GetExpectedSigma(const TOFResoParams& parameters, const TrackType& track, const float tofSignal, const float collisionTimeRes)
-  {
-    const float mom = track.p();
-    if (mom <= 0) {
-      return -999.f;
-    }
-    const float dpp = parameters[0] + parameters[1] * mom + parameters[2] * mMassZ / mom; // mean relative pt resolution;
-    const float sigma = dpp * tofSignal / (1. + mom * mom / (mMassZSqared));
-    return std::sqrt(sigma * sigma + parameters[3] * parameters[3] / mom / mom + parameters[4] * parameters[4] + collisionTimeRes * collisionTimeRes);
-  }
+  static float GetExpectedSigma(const TOFResoParams& parameters, const TrackType& track, const float tofSignal, const float collisionTimeRes) { return ComputeExpectedSigma(parameters, track.p(), tofSignal, collisionTimeRes); }
 
   /// Gets the expected resolution of the t-texp-t0
   /// Given a TOF signal and collision time resolutions
@@ -203,16 +238,7 @@ class ExpTimes
   /// \param track Track of interest
   /// \param tofSignal TOF signal of the track of interest
   /// \param collisionTimeRes Collision time resolution of the track of interest
-  static float GetExpectedSigma(const TOFResoParamsV2& parameters, const TrackType& track, const float tofSignal, const float collisionTimeRes)
-  {
-    const float mom = track.p();
-    if (mom <= 0) {
-      return -999.f;
-    }
-    const float dpp = parameters[0] + parameters[1] * mom + parameters[2] * mMassZ / mom; // mean relative pt resolution;
-    const float sigma = dpp * tofSignal / (1. + mom * mom / (mMassZSqared));
-    return std::sqrt(sigma * sigma + parameters[3] * parameters[3] / mom / mom + parameters[4] * parameters[4] + collisionTimeRes * collisionTimeRes);
-  }
+  static float GetExpectedSigma(const TOFResoParamsV2& parameters, const TrackType& track, const float tofSignal, const float collisionTimeRes) { return ComputeExpectedSigma(parameters, track.p(), tofSignal, collisionTimeRes); }
 
   /// Gets the expected resolution of the t-texp-t0
   /// \param response Detector response with parameters
@@ -280,6 +306,20 @@ class ExpTimes
   /// \param track Track of interest
   static float GetSeparation(const TOFResoParamsV2& parameters, const TrackType& track) { return GetSeparation(parameters, track, track.tofEvTime(), track.tofEvTimeErr()); }
 
+  /// Gets the number of sigmas with respect the expected time from the track inputs shared by all mass hypotheses.
+  /// Same result as GetSeparation(parameters, track), without reading the track columns again for each hypothesis
+  /// \param parameters Detector response parameters (TOFResoParams or TOFResoParamsV2)
+  /// \param inputs Track inputs of the track of interest
+  template <typename ParamType>
+  static float GetSeparation(const ParamType& parameters, const TrackInputs& inputs)
+  {
+    if (!inputs.hasTOF) {
+      return defaultReturnValue;
+    }
+    const float delta = inputs.tofSignal - inputs.tofEvTime - ComputeExpectedTime(inputs.tofExpMom, inputs.length);
+    return delta / ComputeExpectedSigma(parameters, inputs.p, inputs.tofSignal, inputs.tofEvTimeErr);
+  }
+
   /// Gets the expected resolution of the measurement from the track time and from the collision time, explicitly passed as argument
   /// \param response Detector response with parameters
   /// \param track Track of interest
@@ -17,7 +17,9 @@
 #ifndef COMMON_CORE_PID_TPCPIDRESPONSE_H_
 #define COMMON_CORE_PID_TPCPIDRESPONSE_H_
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <vector>
 #include <cmath>
 #include "Framework/Logger.h"
@@ -29,6 +31,38 @@
 namespace o2::pid::tpc
 {
 
+/// \brief Track quantities entering the TPC response, read once per track and shared by all mass hypotheses
+struct TrackTerms {
+  bool hasTPC = false;
+  float tpcSignal = 0.f;
+  float tpcInnerParam = 0.f;
+  float tgl = 0.f;
+  float signed1Pt = 0.f;
+  float tpcNClsFound = 0.f;
+  float multTPC = 0.f;
+};
+
+/// \brief Immutable flat copy of the response parameters, together with the time interval in which they are valid.
+/// Producers keep the snapshots of the intervals seen so far and swap the parameters of the response only
+/// when the timestamp leaves the current interval, instead of querying the CCDB manager for every collision.
+struct ParameterSnapshot {
+  static constexpr int kMaxResolutionParams = 8;
+
+  int64_t validFrom = 0;  /// Start of validity (ms), inclusive
+  int64_t validUntil = 0; /// End of validity (ms), exclusive
+  std::array<float, 5> betheBlochParams = {0.f};
+  std::array<float, 2> resolutionParamsDefault = {0.f};
+  std::array<double, kMaxResolutionParams> resolutionParams = {0.};
+  int nResolutionParams = 0;
+  float mip = 0.f;
+  float chargeFactor = 0.f;
+  float multNormalization = 0.f;
+  float nClNorm = 0.f;
+  bool useDefaultResolutionParam = true;
+
+  bool isValid(const int64_t timestamp) const { return timestamp >= validFrom && timestamp < validUntil; }
+};
+
 /// \brief Class to handle the TPC PID response
 
 class Response
@@ -59,6 +93,38 @@ class Response
     mUseDefaultResolutionParam = response->GetUseDefaultResolutionParam();
   }
 
+  void SetParameters(const ParameterSnapshot& snapshot)
+  {
+    mBetheBlochParams = snapshot.betheBlochParams;
+    mResolutionParamsDefault = snapshot.resolutionParamsDefault;
+    mResolutionParams.assign(snapshot.resolutionParams.begin(), snapshot.resolutionParams.begin() + snapshot.nResolutionParams);
+    mMIP = snapshot.mip;
+    nClNorm = snapshot.nClNorm;
+    mChargeFactor = snapshot.chargeFactor;
+    mMultNormalization = snapshot.multNormalization;
+    mUseDefaultResolutionParam = snapshot.useDefaultResolutionParam;
+  }
+  /// Gets a flat copy of the parameters, valid in [validFrom, validUntil)
+  ParameterSnapshot GetParameterSnapshot(const int64_t validFrom, const int64_t validUntil) const
+  {
+    ParameterSnapshot snapshot;
+    if (static_cast<int>(mResolutionParams.size()) > ParameterSnapshot::kMaxResolutionParams) {
+      LOGP(fatal, "TPC PID response with {} resolution parameters, at most {} are supported", mResolutionParams.size(), ParameterSnapshot::kMaxResolutionParams);
+    }
+    snapshot.validFrom = validFrom;
+    snapshot.validUntil = validUntil;
+    snapshot.betheBlochParams = mBetheBlochParams;
+    snapshot.resolutionParamsDefault = mResolutionParamsDefault;
+    snapshot.nResolutionParams = mResolutionParams.size();
+    std::copy(mResolutionParams.begin(), mResolutionParams.end(), snapshot.resolutionParams.begin());
+    snapshot.mip = mMIP;
+    snapshot.chargeFactor = mChargeFactor;
+    snapshot.multNormalization = mMultNormalization;
+    snapshot.nClNorm = nClNorm;
+    snapshot.useDefaultResolutionParam = mUseDefaultResolutionParam;
+    return snapshot;
+  }
+
   const std::array<float, 5> GetBetheBlochParams() const { return mBetheBlochParams; }
   const std::array<float, 2> GetResolutionParamsDefault() const { return mResolutionParamsDefault; }
   const std::vector<double> GetResolutionParams() const { return mResolutionParams; }
@@ -83,6 +149,15 @@ class Response
   /// Gets relative dEdx resolution contribution due to relative pt resolution
   float GetRelativeResolutiondEdx(const float p, const float mass, const float charge, const float resol) const;
 
+  /// Reads the track quantities needed for all mass hypotheses
+  template <typename CollisionType, typename TrackType>
+  TrackTerms GetTrackTerms(const CollisionType& collision, const TrackType& trk) const;
+  /// Gets expected signal and resolution from the shared track terms, evaluating the Bethe-Bloch once for both.
+  /// The results are identical to GetExpectedSignal and GetExpectedSigma.
+  void GetExpectedSignalAndSigma(const TrackTerms& terms, const o2::track::PID::ID id, float& expSignal, float& expSigma) const;
+  /// Gets the number of sigmas from the expected signal and resolution, identical to GetNumberOfSigma
+  float GetNumberOfSigma(const TrackTerms& terms, const float expSignal, const float expSigma) const;
+
   void PrintAll() const;
 
  private:
@@ -179,6 +254,76 @@ inline float Response::GetRelativeResolutiondEdx(const float p, const float mass
   return deltaRel;
 }
 
+/// Reads the track quantities needed for all mass hypotheses
+template <typename CollisionType, typename TrackType>
+inline TrackTerms Response::GetTrackTerms(const CollisionType& collision, const TrackType& trk) const
+{
+  TrackTerms terms;
+  terms.hasTPC = trk.hasTPC();
+  terms.tpcSignal = trk.tpcSignal();
+  if (!terms.hasTPC) {
+    return terms;
+  }
+  terms.tpcInnerParam = trk.tpcInnerParam();
+  terms.tpcNClsFound = static_cast<float>(trk.tpcNClsFound());
+  if (!mUseDefaultResolutionParam) {
+    terms.tgl = trk.tgl();
+    terms.signed1Pt = trk.signed1Pt();
+    terms.multTPC = collision.multTPC();
+  }
+  return terms;
+}
+
+/// Gets expected signal and resolution from the shared track terms
+inline void Response::GetExpectedSignalAndSigma(const TrackTerms& terms, const o2::track::PID::ID id, float& expSignal, float& expSigma) const
+{
+  if (!terms.hasTPC) {
+    expSignal = -999.f;
+    expSigma = -999.f;
+    return;
+  }
+  const float mass = o2::track::pid_constants::sMasses[id];
+  const float charge = static_cast<float>(o2::track::pid_constants::sCharges[id]);
+  const float bb = o2::tpc::BetheBlochAleph(terms.tpcInnerParam / mass, mBetheBlochParams[0], mBetheBlochParams[1], mBetheBlochParams[2], mBetheBlochParams[3], mBetheBlochParams[4]);
+  const float chargeTerm = std::pow(charge, mChargeFactor);
+  const float bethe = mMIP * bb * chargeTerm;
+  expSignal = bethe >= 0.f ? bethe : -999.f;
+
+  if (mUseDefaultResolutionParam) {
+    const float reso = expSignal * mResolutionParamsDefault[0] * (terms.tpcNClsFound > 0 ? std::sqrt(1. + mResolutionParamsDefault[1] / terms.tpcNClsFound) : 1.f);
+    expSigma = reso >= 0.f ? reso : -999.f;
+    return;
+  }
+
+  const double ncl = nClNorm / terms.tpcNClsFound;
+  const double dEdx = bb * chargeTerm;
+  // relative resolution due to the pt resolution, as in GetRelativeResolutiondEdx but reusing the Bethe-Bloch above
+  const float dEdxF = bb * chargeTerm;
+  const float deltaP = static_cast<float>(mResolutionParams[3]) * std::sqrt(dEdxF);
+  const float bgDelta = terms.tpcInnerParam * (1 + deltaP) / mass;
+  const float dEdx2 = o2::tpc::BetheBlochAleph(bgDelta, mBetheBlochParams[0], mBetheBlochParams[1], mBetheBlochParams[2], mBetheBlochParams[3], mBetheBlochParams[4]) * chargeTerm;
+  const double relReso = std::abs(dEdx2 - dEdxF) / dEdxF;
+
+  const double invdEdx = 1.f / dEdx;
+  const double tgl = terms.tgl;
+  const double sqrtNcl = std::sqrt(ncl);
+  const double signed1Pt = terms.signed1Pt;
+  const double mult = terms.multTPC / mMultNormalization;
+  const double tglTerm = invdEdx / sqrt(1 + pow(tgl, 2));
+
+  const float reso = sqrt(pow(mResolutionParams[0], 2) * invdEdx + pow(mResolutionParams[1], 2) * (sqrtNcl * mResolutionParams[5]) * pow(tglTerm, mResolutionParams[2]) + sqrtNcl * pow(relReso, 2) + pow(mResolutionParams[4] * signed1Pt, 2) + pow(mult * mResolutionParams[6], 2) + pow(mult * tglTerm * mResolutionParams[7], 2)) * dEdx * mMIP;
+  expSigma = reso >= 0.f ? reso : -999.f;
+}
+
+/// Gets the number of sigmas from the expected signal and resolution
+inline float Response::GetNumberOfSigma(const TrackTerms& terms, const float expSignal, const float expSigma) const
+{
+  if (expSigma < 0. || expSignal < 0. || !terms.hasTPC) {
+    return -999.f;
+  }
+  return (terms.tpcSignal - expSignal) / expSigma;
+}
+
 inline void Response::PrintAll() const
 {
   LOGP(info, "==== TPC PID response parameters: ====");
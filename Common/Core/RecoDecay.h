@@ -17,6 +17,7 @@
 #ifndef COMMON_CORE_RECODECAY_H_
 #define COMMON_CORE_RECODECAY_H_
 
+#include <algorithm>
 #include <tuple>
 #include <vector>
 #include <array>
@@ -571,6 +572,65 @@ class RecoDecay
     return mass;
   }
 
+  /// Index of the MC particles of a time frame for the Monte Carlo matching
+  ///
+  /// Stores the PDG codes and the mother and daughter index ranges of all MC particles in flat arrays,
+  /// filled once per time frame by build(). The matching functions taking the index instead of the MC particle table
+  /// give the same results without creating table iterators nor allocating the lists of mothers and daughters
+  /// for each candidate (the work buffers are kept in the index and reused).
+  /// \note Mothers and daughters outside the indexed table are ignored.
+  /// \note The work buffers make the index not safe to be shared between threads.
+  class McIndex
+  {
+    friend class RecoDecay;
+
+   public:
+    /// Fills the index.
+    /// \param particlesMC  table with MC particles
+    template <typename T>
+    void build(const T& particlesMC)
+    {
+      mOffset = particlesMC.offset();
+      const auto nParticles = particlesMC.size();
+      mPdg.resize(nParticles);
+      mMothers.resize(nParticles);
+      mDaughters.resize(nParticles);
+      std::size_t iParticle = 0;
+      for (const auto& particle : particlesMC) {
+        mPdg[iParticle] = particle.pdgCode();
+        mMothers[iParticle] = particle.has_mothers() ? Range{particle.mothersIds().front(), particle.mothersIds().back()} : Range{};
+        mDaughters[iParticle] = particle.has_daughters() ? Range{particle.daughtersIds().front(), particle.daughtersIds().back()} : Range{};
+        ++iParticle;
+      }
+    }
+
+    /// \return number of indexed MC particles
+    std::size_t size() const { return mPdg.size(); }
+
+    /// \param index  global index of an MC particle
+    /// \return true if the particle is in the index
+    bool contains(int64_t index) const { return index >= mOffset && index - mOffset < static_cast<int64_t>(mPdg.size()); }
+
+    /// \param index  global index of an indexed MC particle
+    /// \return PDG code of the particle
+    int pdgCode(int64_t index) const { return mPdg[index - mOffset]; }
+
+   private:
+    /// index range of mothers or daughters, first = -1 if none
+    struct Range {
+      int64_t first = -1;
+      int64_t last = -1;
+    };
+
+    int64_t mOffset = 0;                     ///< global index of the first indexed particle
+    std::vector<int> mPdg;                   ///< PDG codes
+    std::vector<Range> mMothers;             ///< mother index ranges
+    std::vector<Range> mDaughters;           ///< daughter index ranges
+    mutable std::vector<int64_t> mStage;     ///< work buffer with the particles of the current mother tree level
+    mutable std::vector<int64_t> mNextStage; ///< work buffer with the particles of the next mother tree level
+    mutable std::vector<int> mListDaughters; ///< work buffer with the final-state daughters
+  };
+
   /// Finds the mother of an MC particle by looking for the expected PDG code in the mother chain.
   /// \param particlesMC  table with MC particles
   /// \param particle  MC particle
@@ -998,7 +1058,349 @@ class RecoDecay
     return OriginType::None;
   }
 
+  /// Finds the mother of an MC particle by looking for the expected PDG code in the mother chain.
+  /// Same as getMother(particlesMC, ...) using the index of the MC particles.
+  /// \param mcIndex  index of the MC particles
+  /// \param particle  MC particle
+  /// \param PDGMother  expected mother PDG code
+  /// \param acceptAntiParticles  switch to accept the antiparticle of the expected mother
+  /// \param sign  antiparticle indicator of the found mother w.r.t. PDGMother; 1 if particle, -1 if antiparticle, 0 if mother not found
+  /// \param depthMax  maximum decay tree level to check; Mothers up to this level will be considered. If -1, all levels are considered.
+  /// \return index of the mother particle if found, -1 otherwise
+  template <typename T>
+  static int getMother(const McIndex& mcIndex,
+                       const T& particle,
+                       int PDGMother,
+                       bool acceptAntiParticles = false,
+                       int8_t* sign = nullptr,
+                       int8_t depthMax = -1)
+  {
+    return getMotherIndexed(mcIndex, particle.globalIndex(), PDGMother, acceptAntiParticles, sign, depthMax);
+  }
+
+  /// Gets the complete list of indices of final-state daughters of an MC particle.
+  /// Same as getDaughters(particle, ...) using the index of the MC particles.
+  /// \param mcIndex  index of the MC particles
+  /// \param index  global index of the MC particle
+  /// \param list  vector where the indices of final-state daughters will be added
+  /// \param arrPDGFinal  array of PDG codes of particles to be considered final if found
+  /// \param depthMax  maximum decay tree level; Daughters at this level (or beyond) will be considered final. If -1, all levels are considered.
+  /// \param stage  decay tree level; If different from 0, the particle itself will be added in the list in case it has no daughters.
+  template <std::size_t N>
+  static void getDaughters(const McIndex& mcIndex,
+                           int64_t index,
+                           std::vector<int>* list,
+                           const array<int, N>& arrPDGFinal,
+                           int8_t depthMax = -1,
+                           int8_t stage = 0)
+  {
+    if (!list || !mcIndex.contains(index)) {
+      return;
+    }
+    const auto& daughters = mcIndex.mDaughters[index - mcIndex.mOffset];
+    bool isFinal = false;
+    if (depthMax > -1 && stage >= depthMax) { // Maximum depth has been reached (or exceeded).
+      isFinal = true;
+    }
+    if (!isFinal && daughters.first < 0) {
+      if (stage == 0) {
+        return;
+      }
+      isFinal = true;
+    }
+    if (!isFinal && stage > 0) {
+      auto PDGParticle = std::abs(mcIndex.pdgCode(index));
+      for (auto PDGi : arrPDGFinal) {
+        if (PDGParticle == std::abs(PDGi)) { // Accept antiparticles.
+          isFinal = true;
+          break;
+        }
+      }
+    }
+    if (isFinal) {
+      list->push_back(index);
+      return;
+    }
+    stage++;
+    for (auto iDaughter = daughters.first; iDaughter <= daughters.last; ++iDaughter) {
+      getDaughters(mcIndex, iDaughter, list, arrPDGFinal, depthMax, stage);
+    }
+  }
+
+  /// Checks whether the reconstructed decay candidate is the expected decay.
+  /// Same as getMatchedMCRec(particlesMC, ...) using the index of the MC particles.
+  /// \param mcIndex  index of the MC particles
+  /// \param arrDaughters  array of candidate daughters
+  /// \param PDGMother  expected mother PDG code
+  /// \param arrPDGDaughters  array of expected daughter PDG codes
+  /// \param acceptAntiParticles  switch to accept the antiparticle version of the expected decay
+  /// \param sign  antiparticle indicator of the found mother w.r.t. PDGMother; 1 if particle, -1 if antiparticle, 0 if mother not found
+  /// \param depthMax  maximum decay tree level to check; Daughters up to this level will be considered. If -1, all levels are considered.
+  /// \return index of the mother particle if the mother and daughters are correct, -1 otherwise
+  template <std::size_t N, typename U>
+  static int getMatchedMCRec(const McIndex& mcIndex,
+                             const array<U, N>& arrDaughters,
+                             int PDGMother,
+                             array<int, N> arrPDGDaughters,
+                             bool acceptAntiParticles = false,
+                             int8_t* sign = nullptr,
+                             int depthMax = 1)
+  {
+    int8_t sgn = 0;                                      // 1 if the expected mother is particle, -1 if antiparticle (w.r.t. PDGMother)
+    int indexMother = -1;                                // index of the mother particle
+    auto& arrAllDaughtersIndex = mcIndex.mListDaughters; // indices of all daughters of the mother of the first provided daughter
+    if (sign) {
+      *sign = sgn;
+    }
+    for (std::size_t iProng = 0; iProng < N; ++iProng) {
+      if (!arrDaughters[iProng].has_mcParticle()) {
+        return -1;
+      }
+      const int64_t indexDaughter = arrDaughters[iProng].mcParticleId(); // index of the ith daughter particle
+      if (!mcIndex.contains(indexDaughter)) {
+        return -1;
+      }
+      if (iProng == 0) {
+        // PDG code of the first daughter's mother determines whether the expected mother is a particle or antiparticle.
+        indexMother = getMotherIndexed(mcIndex, indexDaughter, PDGMother, acceptAntiParticles, &sgn, depthMax);
+        if (indexMother <= -1) {
+          return -1;
+        }
+        const auto& daughters = mcIndex.mDaughters[indexMother - mcIndex.mOffset];
+        if (daughters.first < 0) {
+          return -1;
+        }
+        // Check that the number of direct daughters is not larger than the number of expected final daughters.
+        if (daughters.last - daughters.first + 1 > static_cast<int>(N)) {
+          return -1;
+        }
+        arrAllDaughtersIndex.clear();
+        getDaughters(mcIndex, indexMother, &arrAllDaughtersIndex, arrPDGDaughters, depthMax);
+        if (arrAllDaughtersIndex.size() != N) {
+          return -1;
+        }
+      }
+      // Check that the daughter is in the list of final daughters (and not twice).
+      bool isDaughterFound = false;
+      for (std::size_t iD = 0; iD < arrAllDaughtersIndex.size(); ++iD) {
+        if (indexDaughter == arrAllDaughtersIndex[iD]) {
+          arrAllDaughtersIndex[iD] = -1;
+          isDaughterFound = true;
+          break;
+        }
+      }
+      if (!isDaughterFound) {
+        return -1;
+      }
+      // Check daughter's PDG code.
+      auto PDGParticleI = mcIndex.pdgCode(indexDaughter);
+      bool isPDGFound = false;
+      for (std::size_t iProngCp = 0; iProngCp < N; ++iProngCp) {
+        if (PDGParticleI == sgn * arrPDGDaughters[iProngCp]) {
+          arrPDGDaughters[iProngCp] = 0;
+          isPDGFound = true;
+          break;
+        }
+      }
+      if (!isPDGFound) {
+        return -1;
+      }
+    }
+    if (sign) {
+      *sign = sgn;
+    }
+    return indexMother;
+  }
+
+  /// Check whether the MC particle is the expected one and whether it decayed via the expected decay channel.
+  /// Same as isMatchedMCGen(particlesMC, ...) using the index of the MC particles.
+  /// \param mcIndex  index of the MC particles
+  /// \param candidate  candidate MC particle
+  /// \param PDGParticle  expected particle PDG code
+  /// \param arrPDGDaughters  array of expected PDG codes of daughters
+  /// \param acceptAntiParticles  switch to accept the antiparticle
+  /// \param sign  antiparticle indicator of the candidate w.r.t. PDGParticle; 1 if particle, -1 if antiparticle, 0 if not matched
+  /// \param depthMax  maximum decay tree level to check; Daughters up to this level will be considered. If -1, all levels are considered.
+  /// \param listIndexDaughters  vector of indices of found daughter
+  /// \return true if PDG codes of the particle and its daughters are correct, false otherwise
+  template <std::size_t N, typename U>
+  static bool isMatchedMCGen(const McIndex& mcIndex,
+                             const U& candidate,
+                             int PDGParticle,
+                             array<int, N> arrPDGDaughters,
+                             bool acceptAntiParticles = false,
+                             int8_t* sign = nullptr,
+                             int depthMax = 1,
+                             std::vector<int>* listIndexDaughters = nullptr)
+  {
+    int8_t sgn = 0; // 1 if the expected mother is particle, -1 if antiparticle (w.r.t. PDGParticle)
+    if (sign) {
+      *sign = sgn;
+    }
+    const int64_t indexCandidate = candidate.globalIndex();
+    if (!mcIndex.contains(indexCandidate)) {
+      return false;
+    }
+    auto PDGCandidate = mcIndex.pdgCode(indexCandidate);
+    if (PDGCandidate == PDGParticle) { // exact PDG match
+      sgn = 1;
+    } else if (acceptAntiParticles && PDGCandidate == -PDGParticle) { // antiparticle PDG match
+      sgn = -1;
+    } else {
+      return false;
+    }
+    if (N > 0) {
+      const auto& daughters = mcIndex.mDaughters[indexCandidate - mcIndex.mOffset];
+      if (daughters.first < 0) {
+        return false;
+      }
+      // Check that the number of direct daughters is not larger than the number of expected final daughters.
+      if (daughters.last - daughters.first + 1 > static_cast<int>(N)) {
+        return false;
+      }
+      auto& arrAllDaughtersIndex = mcIndex.mListDaughters;
+      arrAllDaughtersIndex.clear();
+      getDaughters(mcIndex, indexCandidate, &arrAllDaughtersIndex, arrPDGDaughters, depthMax);
+      if (arrAllDaughtersIndex.size() != N) {
+        return false;
+      }
+      for (auto indexDaughterI : arrAllDaughtersIndex) {
+        auto PDGCandidateDaughterI = mcIndex.pdgCode(indexDaughterI);
+        bool isPDGFound = false;
+        for (std::size_t iProngCp = 0; iProngCp < N; ++iProngCp) {
+          if (PDGCandidateDaughterI == sgn * arrPDGDaughters[iProngCp]) {
+            arrPDGDaughters[iProngCp] = 0;
+            isPDGFound = true;
+            break;
+          }
+        }
+        if (!isPDGFound) {
+          return false;
+        }
+      }
+      if (listIndexDaughters) {
+        *listIndexDaughters = arrAllDaughtersIndex;
+      }
+    }
+    if (sign) {
+      *sign = sgn;
+    }
+    return true;
+  }
+
+  /// Finds the origin (from charm hadronisation or beauty-hadron decay) of charm hadrons.
+  /// Same as getCharmHadronOrigin(particlesMC, ...) using the index of the MC particles.
+  /// \param mcIndex  index of the MC particles
+  /// \param particle  MC particle
+  /// \param searchUpToQuark if true tag origin based on charm/beauty quark otherwise on the presence of a b-hadron or c-hadron, with c-hadrons themselves marked as prompt
+  /// \return an integer corresponding to the origin (0: none, 1: prompt, 2: nonprompt) as in OriginType
+  template <typename T>
+  static int getCharmHadronOrigin(const McIndex& mcIndex,
+                                  const T& particle,
+                                  const bool searchUpToQuark = false)
+  {
+    const int64_t indexParticle = particle.globalIndex();
+    if (!mcIndex.contains(indexParticle)) {
+      return OriginType::None;
+    }
+    auto PDGParticle = std::abs(mcIndex.pdgCode(indexParticle));
+    bool couldBePrompt = false;
+    if (PDGParticle / 100 == 4 || PDGParticle / 1000 == 4) {
+      couldBePrompt = true;
+    }
+    auto& stage = mcIndex.mStage;
+    auto& nextStage = mcIndex.mNextStage;
+    stage.assign(1, indexParticle);
+    while (stage.size() > 0) {
+      nextStage.clear();
+      for (auto iPart : stage) { // check all the particles that were the mothers at the previous stage
+        const auto& mothers = mcIndex.mMothers[iPart - mcIndex.mOffset];
+        for (auto iMother = mothers.first; mothers.first >= 0 && iMother <= mothers.last; ++iMother) {
+          if (!mcIndex.contains(iMother) || std::find(nextStage.begin(), nextStage.end(), iMother) != nextStage.end()) {
+            continue;
+          }
+          auto PDGParticleIMother = std::abs(mcIndex.pdgCode(iMother));
+          if (searchUpToQuark) {
+            if (PDGParticleIMother == 5) { // b quark
+              return OriginType::NonPrompt;
+            }
+            if (PDGParticleIMother == 4) { // c quark
+              return OriginType::Prompt;
+            }
+          } else {
+            if (PDGParticleIMother / 100 == 5 || PDGParticleIMother / 1000 == 5) { // b hadrons
+              return OriginType::NonPrompt;
+            }
+            if (PDGParticleIMother / 100 == 4 || PDGParticleIMother / 1000 == 4) { // c hadrons
+              couldBePrompt = true;
+            }
+          }
+          nextStage.push_back(iMother);
+        }
+      }
+      stage.swap(nextStage);
+    }
+    if (!searchUpToQuark && couldBePrompt) {
+      return OriginType::Prompt;
+    }
+    return OriginType::None;
+  }
+
  private:
+  /// Finds the mother of an MC particle, see getMother(mcIndex, ...).
+  /// \param index  global index of the MC particle
+  static int getMotherIndexed(const McIndex& mcIndex,
+                              int64_t index,
+                              int PDGMother,
+                              bool acceptAntiParticles,
+                              int8_t* sign,
+                              int8_t depthMax)
+  {
+    int8_t sgn = 0;           // 1 if the expected mother is particle, -1 if antiparticle (w.r.t. PDGMother)
+    int indexMother = -1;     // index of the final matched mother, if found
+    int depth = 0;            // mother tree level
+    bool motherFound = false; // true when the desired mother particle is found in the kine tree
+    if (sign) {
+      *sign = sgn;
+    }
+    if (!mcIndex.contains(index)) {
+      return indexMother;
+    }
+    auto& stage = mcIndex.mStage;
+    auto& nextStage = mcIndex.mNextStage;
+    stage.assign(1, index);
+    while (!motherFound && stage.size() > 0 && (depthMax < 0 || depth < depthMax)) {
+      nextStage.clear();
+      for (auto iPart : stage) { // check all the particles that were the mothers at the previous stage
+        const auto& mothers = mcIndex.mMothers[iPart - mcIndex.mOffset];
+        for (auto iMother = mothers.first; mothers.first >= 0 && iMother <= mothers.last; ++iMother) {
+          if (!mcIndex.contains(iMother) || std::find(nextStage.begin(), nextStage.end(), iMother) != nextStage.end()) {
+            continue;
+          }
+          auto PDGParticleIMother = mcIndex.pdgCode(iMother);
+          if (PDGParticleIMother == PDGMother) { // exact PDG match
+            sgn = 1;
+            indexMother = iMother;
+            motherFound = true;
+            break;
+          } else if (acceptAntiParticles && PDGParticleIMother == -PDGMother) { // antiparticle PDG match
+            sgn = -1;
+            indexMother = iMother;
+            motherFound = true;
+            break;
+          }
+          nextStage.push_back(iMother);
+        }
+      }
+      stage.swap(nextStage);
+      depth++;
+    }
+    if (sign) {
+      *sign = sgn;
+    }
+    return indexMother;
+  }
+
   static std::vector<std::tuple<int, double>> mListMass; ///< list of particle masses in form (PDG code, mass)
 };
 
@@ -0,0 +1,142 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file WorkerPool.h
+/// \brief Fixed set of worker threads, started once and reused for each dataframe
+///
+/// Usage:
+///
+///   o2::analysis::WorkerPool pool;
+///   pool.init(nThreads); // in init(), clamped to the hardware concurrency
+///   pool.run([&](size_t slot) { ... }); // in process(), slot in [0, pool.size())
+///
+/// run() executes the callable once on each worker, slot 0 being the calling thread, and returns when
+/// all workers are done. The callable typically takes jobs from an atomic counter and uses per-slot state.
+
+#ifndef COMMON_CORE_WORKERPOOL_H_
+#define COMMON_CORE_WORKERPOOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace o2::analysis
+{
+class WorkerPool
+{
+ public:
+  /// Upper limit of the number of workers, on top of the hardware concurrency
+  static constexpr int kMaxWorkers = 64;
+
+  WorkerPool() = default;
+  WorkerPool(WorkerPool const&) = delete;
+  WorkerPool& operator=(WorkerPool const&) = delete;
+  ~WorkerPool() { stop(); }
+
+  /// \return number of workers for the requested number of threads, in [1, min(hardware concurrency, kMaxWorkers)]
+  static int clampWorkers(int nRequested)
+  {
+    const int nHardware = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    return std::clamp(nRequested, 1, std::min(nHardware, kMaxWorkers));
+  }
+
+  /// Starts the workers, the calling thread of run() counts as one of them
+  /// \param nRequested requested number of workers, clamped with clampWorkers()
+  /// \return number of workers
+  int init(int nRequested)
+  {
+    stop();
+    mStop = false;
+    mNWorkers = clampWorkers(nRequested);
+    for (int slot = 1; slot < mNWorkers; slot++) {
+      mThreads.emplace_back([this, slot, generation = mGeneration] { loop(slot, generation); });
+    }
+    return mNWorkers;
+  }
+
+  int size() const { return mNWorkers; }
+
+  /// Runs work(slot) on all workers and waits for them to finish
+  void run(std::function<void(size_t)> const& work)
+  {
+    if (mThreads.empty()) {
+      work(0);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mWork = &work;
+      mPending = mThreads.size();
+      mGeneration++;
+    }
+    mStart.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this] { return mPending == 0; });
+    mWork = nullptr;
+  }
+
+ private:
+  /// \param generation number of the last run() before the start of the worker
+  void loop(size_t slot, uint64_t generation)
+  {
+    while (true) {
+      std::function<void(size_t)> const* work = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mStart.wait(lock, [&] { return mStop || mGeneration != generation; });
+        if (mStop) {
+          return;
+        }
+        generation = mGeneration;
+        work = mWork;
+      }
+      (*work)(slot);
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mPending == 0) {
+          mDone.notify_one();
+        }
+      }
+    }
+  }
+
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mStart.notify_all();
+    for (auto& thread : mThreads) {
+      thread.join();
+    }
+    mThreads.clear();
+    mNWorkers = 1;
+  }
+
+  std::vector<std::thread> mThreads;
+  std::mutex mMutex;
+  std::condition_variable mStart;
+  std::condition_variable mDone;
+  std::function<void(size_t)> const* mWork = nullptr;
+  size_t mPending = 0;
+  uint64_t mGeneration = 0;
+  int mNWorkers = 1;
+  bool mStop = false;
+};
+} // namespace o2::analysis
+
+#endif // COMMON_CORE_WORKERPOOL_H_
@@ -227,15 +227,16 @@ struct tofPid {
 
       const auto& tracksInCollision = tracks.sliceBy(perCollision, lastCollisionId);
       for (auto const& trkInColl : tracksInCollision) { // Loop on tracks
-        // Check and fill enabled tables
-        auto makeTable = [&trkInColl, this](const Configurable<int>& flag, auto& table, const auto& responsePID) {
+        // Check and fill enabled tables, the track inputs are read once and shared by all hypotheses
+        const auto inputs = o2::pid::tof::TrackInputs::fromTrack(trkInColl);
+        auto makeTable = [&inputs, this](const Configurable<int>& flag, auto& table, const auto& responsePID) {
           if (flag.value != 1) {
             return;
           }
           if (useParamCollection) {
-            aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(mRespParamsV2, trkInColl), table);
+            aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(mRespParamsV2, inputs), table);
           } else {
-            aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(mRespParams, trkInColl), table);
+            aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(mRespParams, inputs), table);
           }
         };
 
@@ -326,15 +327,16 @@ struct tofPid {
         }
       }
 
-      // Check and fill enabled tables
-      auto makeTable = [&track, this](const Configurable<int>& flag, auto& table, const auto& responsePID) {
+      // Check and fill enabled tables, the track inputs are read once and shared by all hypotheses
+      const auto inputs = o2::pid::tof::TrackInputs::fromTrack(track);
+      auto makeTable = [&inputs, this](const Configurable<int>& flag, auto& table, const auto& responsePID) {
         if (flag.value != 1) {
           return;
         }
         if (useParamCollection) {
-          aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(mRespParamsV2, track), table);
+          aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(mRespParamsV2, inputs), table);
         } else {
-          aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(mRespParams, track), table);
+          aod::pidutils::packInTable<aod::pidtof_tiny::binning>(responsePID.GetSeparation(mRespParams, inputs), table);
         }
       };
 
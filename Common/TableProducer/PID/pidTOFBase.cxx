@@ -140,6 +140,17 @@ struct tofEventTime {
   Configurable<std::string> ccdbPath{"ccdbPath", "Analysis/PID/TOF", "Path of the TOF parametrization on the CCDB"};
   Configurable<int64_t> timestamp{"ccdb-timestamp", -1, "timestamp of the object"};
 
+  /// TOF event time of each track, after the removal of its own bias
+  struct TrackEvTime {
+    float evTime = 0.f;
+    float evTimeErr = 0.f;
+    int multiplicity = 0;
+    uint8_t flags = 0;
+    uint8_t usedForEvTime = 0;
+  };
+  std::vector<TrackEvTime> trackEvTimes; // indexed by track
+  std::vector<bool> collisionDone;
+
   void init(o2::framework::InitContext& initContext)
   {
     trackSampleMinMomentum = minMomentum;
@@ -231,8 +242,55 @@ struct tofEventTime {
   Preslice<TrksEvTime> perCollision = aod::track::collisionId;
   template <o2::track::PID::ID pid>
   using ResponseImplementationEvTime = o2::pid::tof::ExpTimes<TrksEvTime::iterator, pid>;
+
+  /// Computes the TOF event time for the tracks of one collision and stores it in trackEvTimes
+  /// \param invalidToDiamond if set, an invalid event time is replaced by the diamond for the following tracks
+  template <typename TTracks>
+  void computeTOFEvTime(const TTracks& tracksInCollision, const bool invalidToDiamond)
+  {
+    const auto evTimeTOF = evTimeMakerForTracks<TrksEvTime::iterator, filterForTOFEventTime, o2::pid::tof::ExpTimes>(tracksInCollision, response, diamond);
+    const float maxEvTime = maxEvTimeTOF;
+    int nGoodTracksForTOF = 0;
+    float et = evTimeTOF.mEventTime;
+    float erret = evTimeTOF.mEventTimeError;
+
+    for (auto const& trk : tracksInCollision) { // Loop on Tracks
+      if constexpr (removeTOFEvTimeBias) {
+        evTimeTOF.removeBias<TrksEvTime::iterator, filterForTOFEventTime>(trk, nGoodTracksForTOF, et, erret, 2);
+      }
+      auto& result = trackEvTimes[trk.globalIndex()];
+      result.flags = 0;
+      if (erret < errDiamond && (maxEvTime <= 0.f || abs(et) < maxEvTime)) {
+        result.flags |= o2::aod::pidflags::enums::PIDFlags::EvTimeTOF;
+      } else if (invalidToDiamond) {
+        et = 0.f;
+        erret = errDiamond;
+      }
+      result.evTime = et;
+      result.evTimeErr = erret;
+      result.multiplicity = evTimeTOF.mEventTimeMultiplicity;
+      result.usedForEvTime = filterForTOFEventTime(trk);
+    }
+  }
+
+  /// Computes the TOF event time of all collisions, the tracks of each collision are sliced once.
+  /// The results are written in trackEvTimes at the track index
+  template <typename TTracks, typename TCollisions>
+  void computeTOFEvTimes(TTracks const& tracks, TCollisions const& collisions, const bool invalidToDiamond)
+  {
+    collisionDone.assign(collisions.size(), false);
+    trackEvTimes.resize(tracks.size());
+    for (auto const& t : tracks) {
+      if (!t.has_collision() || collisionDone[t.collisionId()]) {
+        continue;
+      }
+      collisionDone[t.collisionId()] = true;
+      computeTOFEvTime(tracks.sliceBy(perCollision, t.collisionId()), invalidToDiamond);
+    }
+  }
+
   void processNoFT0(TrksEvTime const& tracks,
-                    aod::Collisions const&)
+                    aod::Collisions const& collisions)
   {
     if (!enableTable) {
       return;
@@ -244,8 +302,9 @@ struct tofEventTime {
       tableEvTimeTOFOnly.reserve(tracks.size());
     }
 
-    int lastCollisionId = -1;      // Last collision ID analysed
-    for (auto const& t : tracks) { // Loop on collisions
+    computeTOFEvTimes(tracks, collisions, true);
+
+    for (auto const& t : tracks) { // Loop on tracks, the tables are filled in track order
       if (!t.has_collision()) {    // Track was not assigned, cannot compute event time
         tableFlags(0);
         tableEvTime(0.f, 999.f);
@@ -254,36 +313,11 @@ struct tofEventTime {
         }
         continue;
       }
-      if (t.collisionId() == lastCollisionId) { // Event time from this collision is already in the table
-        continue;
-      }
-      /// Create new table for the tracks in a collision
-      lastCollisionId = t.collisionId(); /// Cache last collision ID
-
-      const auto& tracksInCollision = tracks.sliceBy(perCollision, lastCollisionId);
-
-      // First make table for event time
-      const auto evTimeTOF = evTimeMakerForTracks<TrksEvTime::iterator, filterForTOFEventTime, o2::pid::tof::ExpTimes>(tracksInCollision, response, diamond);
-      int nGoodTracksForTOF = 0;
-      float et = evTimeTOF.mEventTime;
-      float erret = evTimeTOF.mEventTimeError;
-
-      for (auto const& trk : tracksInCollision) { // Loop on Tracks
-        if constexpr (removeTOFEvTimeBias) {
-          evTimeTOF.removeBias<TrksEvTime::iterator, filterForTOFEventTime>(trk, nGoodTracksForTOF, et, erret, 2);
-        }
-        uint8_t flags = 0;
-        if (erret < errDiamond && (maxEvTimeTOF <= 0.f || abs(et) < maxEvTimeTOF)) {
-          flags |= o2::aod::pidflags::enums::PIDFlags::EvTimeTOF;
-        } else {
-          et = 0.f;
-          erret = errDiamond;
-        }
-        tableFlags(flags);
-        tableEvTime(et, erret);
-        if (enableTableTOFOnly) {
-          tableEvTimeTOFOnly((uint8_t)filterForTOFEventTime(trk), et, erret, evTimeTOF.mEventTimeMultiplicity);
-        }
+      const auto& evTime = trackEvTimes[t.globalIndex()];
+      tableFlags(evTime.flags);
+      tableEvTime(evTime.evTime, evTime.evTimeErr);
+      if (enableTableTOFOnly) {
+        tableEvTimeTOFOnly(evTime.usedForEvTime, evTime.evTime, evTime.evTimeErr, evTime.multiplicity);
       }
     }
   }
@@ -294,7 +328,7 @@ struct tofEventTime {
   using EvTimeCollisions = soa::Join<aod::Collisions, aod::EvSels, aod::FT0sCorrected>;
   void processFT0(TrksEvTime& tracks,
                   aod::FT0s const&,
-                  EvTimeCollisions const&)
+                  EvTimeCollisions const& collisions)
   {
     if (!enableTable) {
       return;
@@ -306,8 +340,13 @@ struct tofEventTime {
       tableEvTimeTOFOnly.reserve(tracks.size());
     }
 
-    int lastCollisionId = -1;      // Last collision ID analysed
-    for (auto const& t : tracks) { // Loop on collisions
+    computeTOFEvTimes(tracks, collisions, false);
+
+    int lastCollisionId = -1;     // Last collision ID analysed
+    float t0AC[2] = {.0f, 999.f}; // Value and error of T0A or T0C or T0AC
+    bool hasFT0 = false;
+    bool t0ACValid = false;
+    for (auto const& t : tracks) { // Loop on tracks, the tables are filled in track order
       if (!t.has_collision()) {    // Track was not assigned, cannot compute event time
         tableFlags(0);
         tableEvTime(0.f, 999.f);
@@ -316,70 +355,54 @@ struct tofEventTime {
         }
         continue;
       }
-      if (t.collisionId() == lastCollisionId) { // Event time from this collision is already in the table
-        continue;
+      if (t.collisionId() != lastCollisionId) {
+        lastCollisionId = t.collisionId(); /// Cache last collision ID
+        const auto& collision = t.collision_as<EvTimeCollisions>();
+        t0AC[0] = .0f;
+        t0AC[1] = 999.f;
+        hasFT0 = collision.has_foundFT0();
+        t0ACValid = hasFT0 && collision.t0ACValid();
+        if (t0ACValid) {
+          t0AC[0] = collision.t0AC() * 1000.f;
+          t0AC[1] = collision.t0resolution() * 1000.f;
+        }
       }
-      /// Create new table for the tracks in a collision
-      lastCollisionId = t.collisionId(); /// Cache last collision ID
-
-      const auto& tracksInCollision = tracks.sliceBy(perCollision, lastCollisionId);
-      const auto& collision = t.collision_as<EvTimeCollisions>();
-
-      // Compute the TOF event time
-      const auto evTimeTOF = evTimeMakerForTracks<TrksEvTime::iterator, filterForTOFEventTime, o2::pid::tof::ExpTimes>(tracksInCollision, response, diamond);
-
-      float t0AC[2] = {.0f, 999.f};                                                                                   // Value and error of T0A or T0C or T0AC
-      float t0TOF[2] = {static_cast<float_t>(evTimeTOF.mEventTime), static_cast<float_t>(evTimeTOF.mEventTimeError)}; // Value and error of TOF
 
+      const auto& evTimeTOF = trackEvTimes[t.globalIndex()];
+      const float t0TOF[2] = {evTimeTOF.evTime, evTimeTOF.evTimeErr}; // Value and error of TOF
       uint8_t flags = 0;
-      int nGoodTracksForTOF = 0;
       float eventTime = 0.f;
       float sumOfWeights = 0.f;
       float weight = 0.f;
 
-      for (auto const& trk : tracksInCollision) { // Loop on Tracks
-        // Reset the flag
-        flags = 0;
-        // Reset the event time
-        eventTime = 0.f;
-        sumOfWeights = 0.f;
-        weight = 0.f;
-        // Remove the bias on TOF ev. time
-        if constexpr (removeTOFEvTimeBias) {
-          evTimeTOF.removeBias<TrksEvTime::iterator, filterForTOFEventTime>(trk, nGoodTracksForTOF, t0TOF[0], t0TOF[1], 2);
-        }
-        if (t0TOF[1] < errDiamond && (maxEvTimeTOF <= 0 || abs(t0TOF[0]) < maxEvTimeTOF)) {
-          flags |= o2::aod::pidflags::enums::PIDFlags::EvTimeTOF;
+      if (evTimeTOF.flags & o2::aod::pidflags::enums::PIDFlags::EvTimeTOF) {
+        flags |= o2::aod::pidflags::enums::PIDFlags::EvTimeTOF;
 
-          weight = 1.f / (t0TOF[1] * t0TOF[1]);
-          eventTime += t0TOF[0] * weight;
-          sumOfWeights += weight;
-        }
+        weight = 1.f / (t0TOF[1] * t0TOF[1]);
+        eventTime += t0TOF[0] * weight;
+        sumOfWeights += weight;
+      }
 
-        if (collision.has_foundFT0()) { // T0 measurement is available
-          // const auto& ft0 = collision.foundFT0();
-          if (collision.t0ACValid()) {
-            t0AC[0] = collision.t0AC() * 1000.f;
-            t0AC[1] = collision.t0resolution() * 1000.f;
-            flags |= o2::aod::pidflags::enums::PIDFlags::EvTimeT0AC;
-          }
-
-          weight = 1.f / (t0AC[1] * t0AC[1]);
-          eventTime += t0AC[0] * weight;
-          sumOfWeights += weight;
+      if (hasFT0) { // T0 measurement is available
+        if (t0ACValid) {
+          flags |= o2::aod::pidflags::enums::PIDFlags::EvTimeT0AC;
         }
 
-        if (sumOfWeights < weightDiamond) { // avoiding sumOfWeights = 0 or worse that diamond
-          eventTime = 0;
-          sumOfWeights = weightDiamond;
-          tableFlags(0);
-        } else {
-          tableFlags(flags);
-        }
-        tableEvTime(eventTime / sumOfWeights, sqrt(1. / sumOfWeights));
-        if (enableTableTOFOnly) {
-          tableEvTimeTOFOnly((uint8_t)filterForTOFEventTime(trk), t0TOF[0], t0TOF[1], evTimeTOF.mEventTimeMultiplicity);
-        }
+        weight = 1.f / (t0AC[1] * t0AC[1]);
+        eventTime += t0AC[0] * weight;
+        sumOfWeights += weight;
+      }
+
+      if (sumOfWeights < weightDiamond) { // avoiding sumOfWeights = 0 or worse that diamond
+        eventTime = 0;
+        sumOfWeights = weightDiamond;
+        tableFlags(0);
+      } else {
+        tableFlags(flags);
+      }
+      tableEvTime(eventTime / sumOfWeights, sqrt(1. / sumOfWeights));
+      if (enableTableTOFOnly) {
+        tableEvTimeTOFOnly(evTimeTOF.usedForEvTime, t0TOF[0], t0TOF[1], evTimeTOF.multiplicity);
       }
     }
   }
@@ -19,6 +19,10 @@
 ///         QA histograms for the TPC PID can be produced by adding `--add-qa 1` to the workflow
 ///
 
+#include <map>
+#include <memory>
+#include <string>
+
 // ROOT includes
 #include "TFile.h"
 #include "TSystem.h"
@@ -104,6 +108,13 @@ struct tpcPid {
 
   // Paramatrization configuration
   bool useCCDBParam = false;
+  bool ccdbApiInitialized = false;
+  int64_t ccdbCreatedNotAfter = 0;
+  // Parameters loaded in the response, with their validity interval and the run they were loaded for
+  o2::pid::tpc::ParameterSnapshot currentParams;
+  bool hasCurrentParams = false;
+  bool currentParamsPerRun = false; // no validity interval in the CCDB headers, the parameters are kept for the whole run
+  int currentParamsRun = -1;
 
   void init(o2::framework::InitContext& initContext)
   {
@@ -140,13 +151,16 @@ struct tpcPid {
 
       ccdb->setCaching(true);
       ccdb->setLocalObjectValidityChecking();
-      ccdb->setCreatedNotAfter(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+      ccdbCreatedNotAfter = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+      ccdb->setCreatedNotAfter(ccdbCreatedNotAfter);
       if (time != 0) {
         LOGP(info, "Initialising TPC PID response for fixed timestamp {}:", time);
         ccdb->setTimestamp(time);
         response.SetParameters(ccdb->getForTimeStamp<o2::pid::tpc::Response>(path, time));
       } else {
         LOGP(info, "Initialising default TPC PID response:");
+        ccdbApi.init(url);
+        ccdbApiInitialized = true;
       }
       response.PrintAll();
     }
@@ -157,7 +171,10 @@ struct tpcPid {
       return;
     } else {
       /// CCDB and auto-fetching
-      ccdbApi.init(url);
+      if (!ccdbApiInitialized) {
+        ccdbApi.init(url);
+        ccdbApiInitialized = true;
+      }
       if (!autofetchNetworks) {
         if (ccdbTimestamp > 0) {
           /// Fetching network for specific timestamp
@@ -187,6 +204,36 @@ struct tpcPid {
     }
   }
 
+  /// Loads the parameters valid at the timestamp in the response.
+  /// The CCDB is queried only when the timestamp leaves the validity interval of the loaded parameters,
+  /// or when the run changes if the object has no validity interval.
+  void updateParameters(const int64_t timestamp, const int runNumber)
+  {
+    if (hasCurrentParams && (currentParamsPerRun ? runNumber == currentParamsRun : currentParams.isValid(timestamp))) {
+      return;
+    }
+    // Object and headers from the same query, with the same creation time limit as the CCDB manager
+    std::map<std::string, std::string> headers;
+    std::unique_ptr<o2::pid::tpc::Response> parameters(ccdbApi.retrieveFromTFileAny<o2::pid::tpc::Response>(ccdbPath.value, metadata, timestamp, &headers, "", std::to_string(ccdbCreatedNotAfter)));
+    if (!parameters) {
+      LOGP(fatal, "Could not retrieve the TPC PID response from {} for timestamp {}", ccdbPath.value, timestamp);
+    }
+    currentParamsPerRun = !(headers.count("Valid-From") && headers.count("Valid-Until"));
+    int64_t validFrom = timestamp;
+    int64_t validUntil = timestamp + 1;
+    if (!currentParamsPerRun) {
+      validFrom = strtoll(headers["Valid-From"].c_str(), NULL, 0);
+      validUntil = strtoll(headers["Valid-Until"].c_str(), NULL, 0);
+      LOGP(info, "Loading TPC PID response for timestamp {}, valid in [{}, {})", timestamp, validFrom, validUntil);
+    } else {
+      LOGP(info, "Loading TPC PID response for timestamp {}, no validity interval: keeping it for run {}", timestamp, runNumber);
+    }
+    currentParams = parameters->GetParameterSnapshot(validFrom, validUntil);
+    currentParamsRun = runNumber;
+    hasCurrentParams = true;
+    response.SetParameters(currentParams);
+  }
+
   void process(Coll const& collisions, Trks const& tracks,
                aod::BCsWithTimestamps const&)
   {
@@ -281,41 +328,48 @@ struct tpcPid {
 
     int lastCollisionId = -1; // Last collision ID analysed
     uint64_t count_tracks = 0;
+    o2::pid::tpc::TrackTerms terms;
+    float expSignal = 0.f;
+    float expSigma = 0.f;
+
+    // Check and fill enabled tables. The track terms are read once per track and the Bethe-Bloch
+    // is evaluated once per hypothesis, for both the expected signal and its resolution
+    auto makeTable = [&](const Configurable<int>& flag, auto& table, const o2::track::PID::ID pid) {
+      if (flag.value != 1) {
+        return;
+      }
+      response.GetExpectedSignalAndSigma(terms, pid, expSignal, expSigma);
+
+      if (useNetworkCorrection) {
+        const uint64_t iPrediction = count_tracks + tracks_size * pid;
+        // Here comes the application of the network. The output--dimensions of the network dtermine the application: 1: mean, 2: sigma, 3: sigma asymmetric
+        // For now only the option 2: sigma will be used. The other options are kept if there would be demand later on
+        if (network.getNumOutputNodes() == 1) {
+          aod::pidutils::packInTable<aod::pidtpc_tiny::binning>((terms.tpcSignal - network_prediction[iPrediction] * expSignal) / expSigma, table);
+        } else if (network.getNumOutputNodes() == 2) {
+          aod::pidutils::packInTable<aod::pidtpc_tiny::binning>((terms.tpcSignal / expSignal - network_prediction[2 * iPrediction]) / (network_prediction[2 * iPrediction + 1] - network_prediction[2 * iPrediction]), table);
+        } else if (network.getNumOutputNodes() == 3) {
+          if (terms.tpcSignal / expSignal >= network_prediction[3 * iPrediction]) {
+            aod::pidutils::packInTable<aod::pidtpc_tiny::binning>((terms.tpcSignal / expSignal - network_prediction[3 * iPrediction]) / (network_prediction[3 * iPrediction + 1] - network_prediction[3 * iPrediction]), table);
+          } else {
+            aod::pidutils::packInTable<aod::pidtpc_tiny::binning>((terms.tpcSignal / expSignal - network_prediction[3 * iPrediction]) / (network_prediction[3 * iPrediction] - network_prediction[3 * iPrediction + 2]), table);
+          }
+        } else {
+          LOGF(fatal, "Network output-dimensions incompatible!");
+        }
+      } else {
+        aod::pidutils::packInTable<aod::pidtpc_tiny::binning>(response.GetNumberOfSigma(terms, expSignal, expSigma), table);
+      }
+    };
 
     for (auto const& trk : tracks) {
       // Loop on Tracks
       if (useCCDBParam && ccdbTimestamp.value == 0 && trk.has_collision() && trk.collisionId() != lastCollisionId) { // Updating parametrization only if the initial timestamp is 0
         lastCollisionId = trk.collisionId();
         const auto& bc = collisions.iteratorAt(trk.collisionId()).bc_as<aod::BCsWithTimestamps>();
-        response.SetParameters(ccdb->getForTimeStamp<o2::pid::tpc::Response>(ccdbPath.value, bc.timestamp()));
+        updateParameters(bc.timestamp(), bc.runNumber());
       }
-      // Check and fill enabled tables
-      auto makeTable = [&trk, &collisions, &network_prediction, &count_tracks, &tracks_size, this](const Configurable<int>& flag, auto& table, const o2::track::PID::ID pid) {
-        if (flag.value != 1) {
-          return;
-        }
-
-        if (useNetworkCorrection) {
-
-          // Here comes the application of the network. The output--dimensions of the network dtermine the application: 1: mean, 2: sigma, 3: sigma asymmetric
-          // For now only the option 2: sigma will be used. The other options are kept if there would be demand later on
-          if (network.getNumOutputNodes() == 1) {
-            aod::pidutils::packInTable<aod::pidtpc_tiny::binning>((trk.tpcSignal() - network_prediction[count_tracks + tracks_size * pid] * response.GetExpectedSignal(trk, pid)) / response.GetExpectedSigma(collisions.iteratorAt(trk.collisionId()), trk, pid), table);
-          } else if (network.getNumOutputNodes() == 2) {
-            aod::pidutils::packInTable<aod::pidtpc_tiny::binning>((trk.tpcSignal() / response.GetExpectedSignal(trk, pid) - network_prediction[2 * (count_tracks + tracks_size * pid)]) / (network_prediction[2 * (count_tracks + tracks_size * pid) + 1] - network_prediction[2 * (count_tracks + tracks_size * pid)]), table);
-          } else if (network.getNumOutputNodes() == 3) {
-            if (trk.tpcSignal() / response.GetExpectedSignal(trk, pid) >= network_prediction[3 * (count_tracks + tracks_size * pid)]) {
-              aod::pidutils::packInTable<aod::pidtpc_tiny::binning>((trk.tpcSignal() / response.GetExpectedSignal(trk, pid) - network_prediction[3 * (count_tracks + tracks_size * pid)]) / (network_prediction[3 * (count_tracks + tracks_size * pid) + 1] - network_prediction[3 * (count_tracks + tracks_size * pid)]), table);
-            } else {
-              aod::pidutils::packInTable<aod::pidtpc_tiny::binning>((trk.tpcSignal() / response.GetExpectedSignal(trk, pid) - network_prediction[3 * (count_tracks + tracks_size * pid)]) / (network_prediction[3 * (count_tracks + tracks_size * pid)] - network_prediction[3 * (count_tracks + tracks_size * pid) + 2]), table);
-            }
-          } else {
-            LOGF(fatal, "Network output-dimensions incompatible!");
-          }
-        } else {
-          aod::pidutils::packInTable<aod::pidtpc_tiny::binning>(response.GetNumberOfSigma(collisions.iteratorAt(trk.collisionId()), trk, pid), table);
-        }
-      };
+      terms = response.GetTrackTerms(collisions.iteratorAt(trk.collisionId()), trk);
 
       makeTable(pidEl, tablePIDEl, o2::track::PID::Electron);
       makeTable(pidMu, tablePIDMu, o2::track::PID::Muon);
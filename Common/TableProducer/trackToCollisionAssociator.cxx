@@ -23,6 +23,9 @@
 #include "Framework/ASoAHelpers.h"
 #include "Framework/runDataProcessing.h"
 
+#include <algorithm>
+#include <vector>
+
 using namespace o2;
 using namespace o2::framework;
 using namespace o2::framework::expressions;
@@ -53,83 +56,106 @@ struct TrackToCollisionAssociation {
     }
   }
 
+  // Track quantities used by the time-based association
+  struct TrackTimeInfo {
+    uint64_t globalBC;
+    int64_t trackIdx;
+    float time;
+    float timeRes;
+    bool isPVAssoc;     // PV contributor with usePVAssociation, the collision time is used
+    bool timeResIsRange;
+  };
+  std::vector<TrackTimeInfo> trackTimeInfos; // sorted by global BC
+  std::vector<int64_t> firstAmbiguousRow;    // track index -> first row in AmbiguousTracks, -1 if none
+  std::vector<int64_t> compatibleTracks;
+
   void processAssocWithTime(Collisions const& collisions,
                             TracksWithSelFilter const& tracks,
                             AmbiguousTracks const& ambiguousTracks,
                             BCs const& bcs)
   {
-    // cache globalBC
-    std::vector<uint64_t> globalBC;
+    // direct track index -> ambiguous track row map, instead of a scan of the ambiguous tracks for each unassigned track
+    firstAmbiguousRow.clear();
+    for (const auto& ambTrack : ambiguousTracks) {
+      const auto trackId = ambTrack.trackId();
+      if (trackId >= static_cast<int64_t>(firstAmbiguousRow.size())) {
+        firstAmbiguousRow.resize(trackId + 1, -1);
+      }
+      if (firstAmbiguousRow[trackId] < 0) {
+        firstAmbiguousRow[trackId] = ambTrack.globalIndex();
+      }
+    }
+
+    // cache globalBC and time of the tracks
+    trackTimeInfos.clear();
+    trackTimeInfos.reserve(tracks.size());
     for (const auto& track : tracks) {
+      TrackTimeInfo info;
       if (track.has_collision()) {
-        globalBC.push_back(track.collision().bc().globalBC());
+        info.globalBC = track.collision().bc().globalBC();
       } else {
-        for (const auto& ambTrack : ambiguousTracks) {
-          if (ambTrack.trackId() == track.globalIndex()) {
-            globalBC.push_back(ambTrack.bc().begin().globalBC());
-            break;
-          }
+        if (!includeUnassigned) {
+          continue;
         }
+        const auto trackIdx = track.globalIndex();
+        if (trackIdx >= static_cast<int64_t>(firstAmbiguousRow.size()) || firstAmbiguousRow[trackIdx] < 0) {
+          continue; // no BC information for this track
+        }
+        info.globalBC = ambiguousTracks.iteratorAt(firstAmbiguousRow[trackIdx]).bc().begin().globalBC();
+      }
+      info.trackIdx = track.globalIndex();
+      info.isPVAssoc = usePVAssociation && track.isPVContributor();
+      if (info.isPVAssoc) {
+        info.time = track.collision().collisionTime();    // if PV contributor, we assume the time to be the one of the collision
+        info.timeRes = constants::lhc::LHCBunchSpacingNS; // 1 BC
+      } else {
+        info.time = track.trackTime();
+        info.timeRes = track.trackTimeRes();
       }
+      info.timeResIsRange = TESTBIT(track.flags(), o2::aod::track::TrackTimeResIsRange);
+      trackTimeInfos.push_back(info);
     }
+    // tracks are mostly sorted by BC already, but not the unassigned blocks and the tracks of merged DFs
+    std::stable_sort(trackTimeInfos.begin(), trackTimeInfos.end(), [](const TrackTimeInfo& a, const TrackTimeInfo& b) { return a.globalBC < b.globalBC; });
 
-    // loop over collisions to find time-compatible tracks
-    auto trackBegin = tracks.begin();
+    // for each collision only the tracks in the BC window around it are tested
     constexpr auto bOffsetMax = 241; // 6 mus (ITS)
     for (const auto& collision : collisions) {
       const float collTime = collision.collisionTime();
       const float collTimeRes2 = collision.collisionTimeRes() * collision.collisionTimeRes();
       uint64_t collBC = collision.bc().globalBC();
-      // bool iteratorMoved = false;
-      for (auto track = trackBegin; track != tracks.end(); ++track) {
-        if (!includeUnassigned && !track.has_collision()) {
-          continue;
-        }
-        const int64_t bcOffset = (int64_t)globalBC[track.filteredIndex()] - (int64_t)collBC;
-        if (std::abs(bcOffset) > bOffsetMax) {
-          continue;
-        }
+      const uint64_t minBC = collBC > bOffsetMax ? collBC - bOffsetMax : 0;
+      const uint64_t maxBC = collBC + bOffsetMax;
 
-        float trackTime{0.};
-        float trackTimeRes{0.};
-        if (usePVAssociation && track.isPVContributor()) {
-          trackTime = track.collision().collisionTime();    // if PV contributor, we assume the time to be the one of the collision
-          trackTimeRes = constants::lhc::LHCBunchSpacingNS; // 1 BC
-        } else {
-          trackTime = track.trackTime();
-          trackTimeRes = track.trackTimeRes();
-        }
-        const float deltaTime = trackTime - collTime + bcOffset * constants::lhc::LHCBunchSpacingNS;
-        float sigmaTimeRes2 = collTimeRes2 + trackTimeRes * trackTimeRes;
-        LOGP(debug, "collision time={}, collision time res={}, track time={}, track time res={}, bc collision={}, bc track={}, delta time={}", collTime, collision.collisionTimeRes(), track.trackTime(), track.trackTimeRes(), collBC, globalBC[track.filteredIndex()], deltaTime);
-
-        // optimization to avoid looping over the full track list each time. This assumes that tracks are sorted by BCs (which they should be because collisions are sorted by BCs)
-        // NOTE this does not work anymore if includeUnassigned is set as the unassigned blocks can be somewhere (and we can have merged DFs, too)
-        // if (!iteratorMoved && bcOffset > -bOffsetMax) {
-        //   trackBegin.setCursor(track.filteredIndex());
-        //   iteratorMoved = true;
-        //   LOGP(debug, "Moving iterator begin {}", track.globalIndex());
-        // } else if (bcOffset > bOffsetMax) {
-        //   LOGP(debug, "Stopping iterator {}", track.globalIndex());
-        //   break;
-        // }
+      compatibleTracks.clear();
+      auto first = std::lower_bound(trackTimeInfos.begin(), trackTimeInfos.end(), minBC, [](const TrackTimeInfo& info, uint64_t bc) { return info.globalBC < bc; });
+      for (auto info = first; info != trackTimeInfos.end() && info->globalBC <= maxBC; ++info) {
+        const int64_t bcOffset = (int64_t)info->globalBC - (int64_t)collBC;
+        const float deltaTime = info->time - collTime + bcOffset * constants::lhc::LHCBunchSpacingNS;
+        float sigmaTimeRes2 = collTimeRes2 + info->timeRes * info->timeRes;
+        LOGP(debug, "collision time={}, collision time res={}, track time={}, track time res={}, bc collision={}, bc track={}, delta time={}", collTime, collision.collisionTimeRes(), info->time, info->timeRes, collBC, info->globalBC, deltaTime);
 
         float thresholdTime = 0.;
-        if (usePVAssociation && track.isPVContributor()) {
-          thresholdTime = trackTimeRes;
-        } else if (TESTBIT(track.flags(), o2::aod::track::TrackTimeResIsRange)) {
+        if (info->isPVAssoc) {
+          thresholdTime = info->timeRes;
+        } else if (info->timeResIsRange) {
           thresholdTime = std::sqrt(sigmaTimeRes2) + timeMargin;
         } else {
           thresholdTime = nSigmaForTimeCompat * std::sqrt(sigmaTimeRes2) + timeMargin;
         }
 
         if (std::abs(deltaTime) < thresholdTime) {
-          const auto collIdx = collision.globalIndex();
-          const auto trackIdx = track.globalIndex();
-          LOGP(debug, "Filling track id {} for coll id {}", trackIdx, collIdx);
-          association(collIdx, trackIdx);
+          compatibleTracks.push_back(info->trackIdx);
         }
       }
+
+      // same order as a loop over the track table
+      std::sort(compatibleTracks.begin(), compatibleTracks.end());
+      const auto collIdx = collision.globalIndex();
+      for (const auto trackIdx : compatibleTracks) {
+        LOGP(debug, "Filling track id {} for coll id {}", trackIdx, collIdx);
+        association(collIdx, trackIdx);
+      }
     }
   }
 
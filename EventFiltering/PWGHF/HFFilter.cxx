@@ -35,6 +35,10 @@
 
 #include <CCDB/BasicCCDBManager.h>
 
+#include <cmath>
+#include <random>
+#include <vector>
+
 using namespace o2;
 using namespace o2::framework;
 using namespace o2::framework::expressions;
@@ -90,6 +94,7 @@ struct HfFilter { // Main struct for HF triggers
 
   // parameters for ML application with ONNX
   Configurable<bool> applyML{"applyML", false, "Flag to enable or disable ML application"};
+  Configurable<bool> useNativeTreeEnsemble{"useNativeTreeEnsemble", false, "Flag to evaluate tree-ensemble ONNX models (e.g. XGBoost) with the native evaluator instead of ONNX Runtime, the scores of both are compared at load time"};
   Configurable<std::vector<double>> pTBinsBDT{"pTBinsBDT", std::vector<double>{hf_cuts_bdt_multiclass::vecBinsPt}, "track pT bin limits for BDT cut"};
 
   Configurable<std::string> onnxFileD0ToKPiConf{"onnxFileD0ToKPiConf", "XGBoostModel.onnx", "ONNX file for ML model for D0 candidates"};
@@ -167,6 +172,7 @@ struct HfFilter { // Main struct for HF triggers
     Ort::Env{ORT_LOGGING_LEVEL_ERROR, "ml-model-xic-triggers"}};
   std::array<Ort::SessionOptions, kNCharmParticles> sessionOptions{Ort::SessionOptions(), Ort::SessionOptions(), Ort::SessionOptions(), Ort::SessionOptions(), Ort::SessionOptions()};
   std::array<int, kNCharmParticles> dataTypeML{};
+  std::array<o2::ml::TreeEnsemble, kNCharmParticles> treeEnsembleML{};
 
   // material correction for track propagation
   o2::base::Propagator::MatCorrType noMatCorr = o2::base::Propagator::MatCorrType::USEMatCorrNONE;
@@ -236,6 +242,7 @@ struct HfFilter { // Main struct for HF triggers
       for (auto iCharmPart{0}; iCharmPart < kNCharmParticles; ++iCharmPart) {
         if (onnxFiles[iCharmPart] != "") {
           sessionML[iCharmPart].reset(InitONNXSession(onnxFiles[iCharmPart], charmParticleNames[iCharmPart], envML[iCharmPart], sessionOptions[iCharmPart], inputShapesML[iCharmPart], dataTypeML[iCharmPart], loadModelsFromCCDB, ccdbApi, mlModelPathCCDB.value, timestampCCDB));
+          initTreeEnsemble(iCharmPart);
         }
       }
     }
@@ -245,6 +252,53 @@ struct HfFilter { // Main struct for HF triggers
     }
   }
 
+  /// Loads the model of a charm hadron in the native tree-ensemble evaluator, ONNX Runtime is used for models which are not supported
+  /// \param iCharmPart is the index of the charm hadron
+  void initTreeEnsemble(int iCharmPart)
+  {
+    treeEnsembleML[iCharmPart].clear();
+    if (!useNativeTreeEnsemble || !treeEnsembleML[iCharmPart].loadONNX(onnxFiles[iCharmPart])) {
+      return;
+    }
+    if (treeEnsembleML[iCharmPart].getNumOutputs() != 3 || treeEnsembleML[iCharmPart].getInputType() != dataTypeML[iCharmPart]) {
+      LOG(info) << "Model for " << charmParticleNames[iCharmPart].data() << " is not a multiclass model with " << dataTypeML[iCharmPart] << " input, using ONNX Runtime";
+      treeEnsembleML[iCharmPart].clear();
+      return;
+    }
+    if (dataTypeML[iCharmPart] == 1) {
+      checkTreeEnsemble<float>(iCharmPart);
+    } else {
+      checkTreeEnsemble<double>(iCharmPart);
+    }
+    LOG(info) << "Model for " << charmParticleNames[iCharmPart].data() << " evaluated with the native tree-ensemble evaluator";
+  }
+
+  /// Scores reference inputs with the native tree-ensemble evaluator and with ONNX Runtime, fatal if they differ
+  /// \param iCharmPart is the index of the charm hadron
+  template <typename T>
+  void checkTreeEnsemble(int iCharmPart)
+  {
+    constexpr int nReferenceInputs = 64;
+    constexpr double maxScoreDifference = 1.e-4;
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> uniform(-1., 1.);
+    const int64_t nFeaturesONNX = inputShapesML[iCharmPart].empty() || inputShapesML[iCharmPart][0].empty() ? -1 : inputShapesML[iCharmPart][0].back();
+    std::vector<T> inputFeatures(nFeaturesONNX > 0 ? nFeaturesONNX : treeEnsembleML[iCharmPart].getNumFeatures());
+    for (int iInput{0}; iInput < nReferenceInputs; ++iInput) {
+      // features over several orders of magnitude, to cover both DCAs and momenta
+      for (auto& feature : inputFeatures) {
+        feature = uniform(generator) * std::pow(10., 1.5 * uniform(generator) - 1.);
+      }
+      auto scoresNative = PredictTreeEnsemble(inputFeatures, treeEnsembleML[iCharmPart]);
+      auto scoresONNX = PredictONNX(inputFeatures, sessionML[iCharmPart], inputShapesML[iCharmPart]);
+      for (int iScore{0}; iScore < 3; ++iScore) {
+        if (std::abs(scoresNative[iScore] - scoresONNX[iScore]) > maxScoreDifference) {
+          LOG(fatal) << "Native tree-ensemble evaluator and ONNX Runtime disagree for the model of " << charmParticleNames[iCharmPart].data() << ": score " << iScore << " is " << scoresNative[iScore] << " instead of " << scoresONNX[iScore] << ", set useNativeTreeEnsemble to false";
+        }
+      }
+    }
+  }
+
   using BigTracksMCPID = soa::Join<aod::Tracks, aod::TracksExtra, aod::TracksDCA, aod::pidTPCFullPi, aod::pidTOFFullPi, aod::pidTPCFullKa, aod::pidTOFFullKa, aod::pidTPCFullPr, aod::pidTOFFullPr, aod::McTrackLabels>;
 
   Filter trackFilter = requireGlobalTrackWoDCAInFilter();
@@ -276,6 +330,7 @@ struct HfFilter { // Main struct for HF triggers
         for (auto iCharmPart{0}; iCharmPart < kNCharmParticles; ++iCharmPart) {
           if (onnxFiles[iCharmPart] != "") {
             sessionML[iCharmPart].reset(InitONNXSession(onnxFiles[iCharmPart], charmParticleNames[iCharmPart], envML[iCharmPart], sessionOptions[iCharmPart], inputShapesML[iCharmPart], dataTypeML[iCharmPart], loadModelsFromCCDB, ccdbApi, mlModelPathCCDB.value, bc.timestamp()));
+            initTreeEnsemble(iCharmPart);
           }
         }
       }
@@ -364,13 +419,13 @@ struct HfFilter { // Main struct for HF triggers
           std::vector<double> inputFeaturesDoD0{trackParPos.getPt(), dcaPos[0], dcaPos[1], trackParNeg.getPt(), dcaNeg[0], dcaNeg[1]};
 
           if (dataTypeML[kD0] == 1) {
-            auto scores = PredictONNX(inputFeaturesD0, sessionML[kD0], inputShapesML[kD0]);
+            auto scores = treeEnsembleML[kD0].isLoaded() ? PredictTreeEnsemble(inputFeaturesD0, treeEnsembleML[kD0]) : PredictONNX(inputFeaturesD0, sessionML[kD0], inputShapesML[kD0]);
             tagBDT = isBDTSelected(scores, thresholdBDTScores[kD0]);
             for (int iScore{0}; iScore < 3; ++iScore) {
               scoresToFill[iScore] = scores[iScore];
             }
           } else if (dataTypeML[kD0] == 11) {
-            auto scores = PredictONNX(inputFeaturesDoD0, sessionML[kD0], inputShapesML[kD0]);
+            auto scores = treeEnsembleML[kD0].isLoaded() ? PredictTreeEnsemble(inputFeaturesDoD0, treeEnsembleML[kD0]) : PredictONNX(inputFeaturesDoD0, sessionML[kD0], inputShapesML[kD0]);
             tagBDT = isBDTSelected(scores, thresholdBDTScores[kD0]);
             for (int iScore{0}; iScore < 3; ++iScore) {
               scoresToFill[iScore] = scores[iScore];
@@ -600,13 +655,13 @@ struct HfFilter { // Main struct for HF triggers
 
             int tagBDT = 0;
             if (dataTypeML[iCharmPart + 1] == 1) {
-              auto scores = PredictONNX(inputFeatures, sessionML[iCharmPart + 1], inputShapesML[iCharmPart + 1]);
+              auto scores = treeEnsembleML[iCharmPart + 1].isLoaded() ? PredictTreeEnsemble(inputFeatures, treeEnsembleML[iCharmPart + 1]) : PredictONNX(inputFeatures, sessionML[iCharmPart + 1], inputShapesML[iCharmPart + 1]);
               tagBDT = isBDTSelected(scores, thresholdBDTScores[iCharmPart + 1]);
               for (int iScore{0}; iScore < 3; ++iScore) {
                 scoresToFill[iCharmPart][iScore] = scores[iScore];
               }
             } else if (dataTypeML[iCharmPart + 1] == 11) {
-              auto scores = PredictONNX(inputFeaturesD, sessionML[iCharmPart + 1], inputShapesML[iCharmPart + 1]);
+              auto scores = treeEnsembleML[iCharmPart + 1].isLoaded() ? PredictTreeEnsemble(inputFeaturesD, treeEnsembleML[iCharmPart + 1]) : PredictONNX(inputFeaturesD, sessionML[iCharmPart + 1], inputShapesML[iCharmPart + 1]);
               tagBDT = isBDTSelected(scores, thresholdBDTScores[iCharmPart + 1]);
               for (int iScore{0}; iScore < 3; ++iScore) {
                 scoresToFill[iCharmPart][iScore] = scores[iScore];
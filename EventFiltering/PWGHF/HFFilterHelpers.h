@@ -32,6 +32,7 @@
 #include "DataFormatsTPC/BetheBlochAleph.h"
 #include "PWGHF/DataModel/CandidateReconstructionTables.h"
 #include "PWGHF/DataModel/CandidateSelectionTables.h"
+#include "Tools/ML/TreeEnsemble.h"
 
 #include <vector>
 #include <array>
@@ -863,6 +864,23 @@ std::array<T, 3> PredictONNX(std::vector<T>& inputFeatures, std::shared_ptr<Ort:
   return scores;
 }
 
+/// Prediction with the native evaluator of tree-ensemble models
+/// \param inputFeatures is the vector with input features
+/// \param model is the tree-ensemble model loaded from the ONNX file
+/// \return the array with the three output scores
+template <typename T>
+std::array<T, 3> PredictTreeEnsemble(std::vector<T>& inputFeatures, const o2::ml::TreeEnsemble& model)
+{
+  std::array<T, 3> scores{-1., 2., 2.};
+  if (model.getNumOutputs() != 3 || static_cast<int>(inputFeatures.size()) < model.getNumFeatures()) {
+    LOG(error) << "Error running model inference: the model expects " << model.getNumFeatures() << " features and " << model.getNumOutputs() << " output scores";
+    return scores;
+  }
+  model.predict(inputFeatures.data(), 1, inputFeatures.size(), scores.data());
+
+  return scores;
+}
+
 /// PID postcalibrations
 
 /// compute TPC postcalibrated nsigma based on calibration histograms from CCDB
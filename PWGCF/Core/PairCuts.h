@@ -13,6 +13,7 @@
 #define O2_ANALYSIS_PAIRCUTS_H
 
 #include <cmath>
+#include <vector>
 
 #include "Framework/Logger.h"
 #include "Framework/HistogramRegistry.h"
@@ -53,6 +54,13 @@ class PairCuts
     mTwoTrackDistance = distance;
     mTwoTrackRadius = radius;
 
+    // radii scanned by twoTrackCut, followed by the outer radius used for the boundary check
+    mTwoTrackRadii.clear();
+    for (Double_t rad = mTwoTrackRadius; rad < 2.51; rad += 0.01) {
+      mTwoTrackRadii.push_back(rad);
+    }
+    mTwoTrackRadii.push_back(2.5);
+
     if (histogramRegistry != nullptr && histogramRegistry->contains(HIST("TwoTrackDistancePt_0")) == false) {
       histogramRegistry->add("TwoTrackDistancePt_0", "", {HistType::kTH3F, {{100, -0.15, 0.15, "#Delta#eta"}, {100, -0.05, 0.05, "#Delta#varphi^{*}_{min}"}, {20, 0, 10, "#Delta p_{T}"}}});
       histogramRegistry->addClone("TwoTrackDistancePt_0", "TwoTrackDistancePt_1");
@@ -65,16 +73,55 @@ class PairCuts
   template <typename T>
   bool twoTrackCut(T const& track1, T const& track2, int magField);
 
+  // Per-event cache of the track quantities entering the pair cuts.
+  // The cached versions of conversionCuts and twoTrackCut take the position of the tracks in the cache.
+  enum DaughterMass { Electron = 0,
+                      Pion,
+                      Kaon,
+                      Proton,
+                      DaughterMassesLastEntry };
+
+  struct TrackCache {
+    int magField = 0;
+    std::vector<float> eta;
+    std::vector<float> pt;
+    std::vector<int> sign;
+    std::vector<float> phi;
+    std::vector<float> px;
+    std::vector<float> py;
+    std::vector<float> pz;
+    std::vector<float> energy[DaughterMassesLastEntry]; // energy for each daughter mass hypothesis
+    std::vector<float> phiStarShift;                    // sign * asin(0.015 * magField * radius / pt), stored per track for all radii of the two-track cut
+
+    size_t size() const { return pt.size(); }
+  };
+
+  template <typename T>
+  void fillTrackCache(TrackCache& cache, T const& tracks, int magField);
+
+  bool conversionCuts(TrackCache const& cache1, int index1, TrackCache const& cache2, int index2);
+
+  bool twoTrackCut(TrackCache const& cache1, int index1, TrackCache const& cache2, int index2);
+
  protected:
   float mCuts[ParticlesLastEntry] = {-1};
   float mTwoTrackDistance = -1; // distance below which the pair is flagged as to be removed
   float mTwoTrackRadius = 0.8f; // radius at which the two track cuts are applied
+  std::vector<float> mTwoTrackRadii; // radii at which the two track distance is evaluated
 
   HistogramRegistry* histogramRegistry = nullptr; // if set, control histograms are stored here
 
   template <typename T>
   bool conversionCut(T const& track1, T const& track2, Particle conv, double cut);
 
+  bool conversionCut(TrackCache const& cache1, int index1, TrackCache const& cache2, int index2, Particle conv, double cut);
+
+  static void getMasses(Particle conv, DaughterMass& daughter1, DaughterMass& daughter2, double& massM);
+
+  float getDPhiStar(TrackCache const& cache1, int index1, TrackCache const& cache2, int index2, int radiusIndex) const;
+
+  static constexpr double mDaughterMasses[DaughterMassesLastEntry] = {0.51e-3, 0.1396, 0.4937, 0.9383};
+
   template <typename T>
   double getInvMassSquared(T const& track1, double m0_1, T const& track2, double m0_2);
 
@@ -169,47 +216,153 @@ bool PairCuts::conversionCut(T const& track1, T const& track2, Particle conv, do
     return false;
   }
 
-  double massD1, massD2, massM;
+  DaughterMass daughter1 = Electron, daughter2 = Electron;
+  double massM = 0;
+  getMasses(conv, daughter1, daughter2, massM);
+  double massD1 = mDaughterMasses[daughter1];
+  double massD2 = mDaughterMasses[daughter2];
+
+  auto massC = getInvMassSquaredFast(track1, massD1, track2, massD2);
 
+  if (std::fabs(massC - massM * massM) > cut * 5) {
+    return false;
+  }
+
+  massC = getInvMassSquared(track1, massD1, track2, massD2);
+
+  if (histogramRegistry != nullptr) {
+    histogramRegistry->fill(HIST("ControlConvResonances"), static_cast<int>(conv), massC - massM * massM);
+  }
+
+  if (massC > (massM - cut) * (massM - cut) && massC < (massM + cut) * (massM + cut)) {
+    return true;
+  }
+
+  return false;
+}
+
+inline void PairCuts::getMasses(Particle conv, DaughterMass& daughter1, DaughterMass& daughter2, double& massM)
+{
   switch (conv) {
     case Photon:
-      massD1 = 0.51e-3;
-      massD2 = 0.51e-3;
+      daughter1 = Electron;
+      daughter2 = Electron;
       massM = 0;
       break;
     case K0:
-      massD1 = 0.1396;
-      massD2 = 0.1396;
+      daughter1 = Pion;
+      daughter2 = Pion;
       massM = 0.4976;
       break;
     case Lambda:
-      massD1 = 0.9383;
-      massD2 = 0.1396;
+      daughter1 = Proton;
+      daughter2 = Pion;
       massM = 1.115;
       break;
     case Phi:
-      massD1 = 0.4937;
-      massD2 = 0.4937;
+      daughter1 = Kaon;
+      daughter2 = Kaon;
       massM = 1.019;
       break;
     case Rho:
-      massD1 = 0.1396;
-      massD2 = 0.1396;
+      daughter1 = Pion;
+      daughter2 = Pion;
       massM = 0.770;
       break;
     default:
       LOGF(fatal, "Particle now known");
-      return false;
       break;
   }
+}
 
-  auto massC = getInvMassSquaredFast(track1, massD1, track2, massD2);
+template <typename T>
+void PairCuts::fillTrackCache(TrackCache& cache, T const& tracks, int magField)
+{
+  // fills the per-track quantities of all tracks, in the order of iteration over tracks
+
+  const size_t nTracks = tracks.size();
+  const size_t nRadii = mTwoTrackRadii.size();
+  cache.magField = magField;
+  cache.eta.resize(nTracks);
+  cache.pt.resize(nTracks);
+  cache.sign.resize(nTracks);
+  cache.phi.resize(nTracks);
+  cache.px.resize(nTracks);
+  cache.py.resize(nTracks);
+  cache.pz.resize(nTracks);
+  for (auto& energy : cache.energy) {
+    energy.resize(nTracks);
+  }
+  cache.phiStarShift.resize(nTracks * nRadii);
+
+  size_t i = 0;
+  for (auto& track : tracks) {
+    const float pt = track.pt();
+    const float eta = track.eta();
+    const float phi = track.phi();
+    cache.eta[i] = eta;
+    cache.pt[i] = pt;
+    cache.sign[i] = track.sign();
+    cache.phi[i] = phi;
+    cache.px[i] = pt * std::cos(phi);
+    cache.py[i] = pt * std::sin(phi);
+    cache.pz[i] = pt * std::sinh(eta);
+    const float p2 = cache.px[i] * cache.px[i] + cache.py[i] * cache.py[i] + cache.pz[i] * cache.pz[i];
+    for (int iMass = 0; iMass < DaughterMassesLastEntry; iMass++) {
+      cache.energy[iMass][i] = std::sqrt(p2 + mDaughterMasses[iMass] * mDaughterMasses[iMass]);
+    }
+    for (size_t iRadius = 0; iRadius < nRadii; iRadius++) {
+      cache.phiStarShift[i * nRadii + iRadius] = cache.sign[i] * std::asin(0.015 * magField * mTwoTrackRadii[iRadius] / pt);
+    }
+    i++;
+  }
+}
 
-  if (std::fabs(massC - massM * massM) > cut * 5) {
+inline bool PairCuts::conversionCuts(TrackCache const& cache1, int index1, TrackCache const& cache2, int index2)
+{
+  // same as conversionCuts above, using the cached track quantities
+
+  // skip if like sign
+  if (cache1.sign[index1] * cache2.sign[index2] > 0) {
     return false;
   }
 
-  massC = getInvMassSquared(track1, massD1, track2, massD2);
+  for (int i = 0; i < static_cast<int>(ParticlesLastEntry); i++) {
+    Particle particle = static_cast<Particle>(i);
+    if (mCuts[i] > 0) {
+      if (conversionCut(cache1, index1, cache2, index2, particle, mCuts[i])) {
+        return true;
+      }
+      if (particle == Lambda) {
+        if (conversionCut(cache2, index2, cache1, index1, particle, mCuts[i])) {
+          return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+inline bool PairCuts::conversionCut(TrackCache const& cache1, int index1, TrackCache const& cache2, int index2, Particle conv, double cut)
+{
+  if (cut < 0) {
+    return false;
+  }
+
+  DaughterMass daughter1 = Electron, daughter2 = Electron;
+  double massM = 0;
+  getMasses(conv, daughter1, daughter2, massM);
+  const double massD1 = mDaughterMasses[daughter1];
+  const double massD2 = mDaughterMasses[daughter2];
+
+  // exact invariant mass from the cached Cartesian momenta, so no approximate pre-selection is needed
+  const float scalarProduct = cache1.px[index1] * cache2.px[index2] + cache1.py[index1] * cache2.py[index2] + cache1.pz[index1] * cache2.pz[index2];
+  const double massC = massD1 * massD1 + massD2 * massD2 + 2 * (cache1.energy[daughter1][index1] * cache2.energy[daughter2][index2] - scalarProduct);
+
+  if (std::fabs(massC - massM * massM) > cut * 5) {
+    return false;
+  }
 
   if (histogramRegistry != nullptr) {
     histogramRegistry->fill(HIST("ControlConvResonances"), static_cast<int>(conv), massC - massM * massM);
@@ -222,6 +375,72 @@ bool PairCuts::conversionCut(T const& track1, T const& track2, Particle conv, do
   return false;
 }
 
+inline float PairCuts::getDPhiStar(TrackCache const& cache1, int index1, TrackCache const& cache2, int index2, int radiusIndex) const
+{
+  // same as getDPhiStar above, using the cached track quantities
+
+  const size_t nRadii = mTwoTrackRadii.size();
+  float dphistar = cache1.phi[index1] - cache2.phi[index2] - cache1.phiStarShift[index1 * nRadii + radiusIndex] + cache2.phiStarShift[index2 * nRadii + radiusIndex];
+
+  if (dphistar > PI) {
+    dphistar = TwoPI - dphistar;
+  }
+  if (dphistar < -PI) {
+    dphistar = -TwoPI - dphistar;
+  }
+  if (dphistar > PI) { // might look funny but is needed
+    dphistar = TwoPI - dphistar;
+  }
+
+  return dphistar;
+}
+
+inline bool PairCuts::twoTrackCut(TrackCache const& cache1, int index1, TrackCache const& cache2, int index2)
+{
+  // same as twoTrackCut above, using the cached track quantities
+
+  auto deta = cache1.eta[index1] - cache2.eta[index2];
+
+  // optimization
+  if (std::fabs(deta) < mTwoTrackDistance * 2.5 * 3) {
+    // check first boundaries to see if is worth to loop and find the minimum
+    const int nRadii = mTwoTrackRadii.size() - 1; // the last entry is the outer radius for the boundary check
+    float dphistar1 = getDPhiStar(cache1, index1, cache2, index2, 0);
+    float dphistar2 = getDPhiStar(cache1, index1, cache2, index2, nRadii);
+
+    const float kLimit = mTwoTrackDistance * 3;
+
+    if (std::fabs(dphistar1) < kLimit || std::fabs(dphistar2) < kLimit || dphistar1 * dphistar2 < 0) {
+      float dphistarminabs = 1e5;
+      float dphistarmin = 1e5;
+      for (int iRadius = 0; iRadius < nRadii; iRadius++) {
+        float dphistar = getDPhiStar(cache1, index1, cache2, index2, iRadius);
+
+        float dphistarabs = std::fabs(dphistar);
+
+        if (dphistarabs < dphistarminabs) {
+          dphistarmin = dphistar;
+          dphistarminabs = dphistarabs;
+        }
+      }
+
+      if (histogramRegistry != nullptr) {
+        histogramRegistry->fill(HIST("TwoTrackDistancePt_0"), deta, dphistarmin, std::fabs(cache1.pt[index1] - cache2.pt[index2]));
+      }
+
+      if (dphistarminabs < mTwoTrackDistance && std::fabs(deta) < mTwoTrackDistance) {
+        return true;
+      }
+
+      if (histogramRegistry != nullptr) {
+        histogramRegistry->fill(HIST("TwoTrackDistancePt_1"), deta, dphistarmin, std::fabs(cache1.pt[index1] - cache2.pt[index2]));
+      }
+    }
+  }
+
+  return false;
+}
+
 template <typename T>
 double PairCuts::getInvMassSquared(T const& track1, double m0_1, T const& track2, double m0_2)
 {
@@ -0,0 +1,131 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+//
+// Event-local dense accumulation of pairs for the pair histogram of CorrelationContainer
+//
+
+#include "PWGCF/Core/PairHistAccumulator.h"
+#include "Framework/StepTHn.h"
+#include "Framework/Logger.h"
+#include "TArray.h"
+#include "TAxis.h"
+
+bool PairHistAccumulator::init(StepTHn* pairHist)
+{
+  mPairHist = nullptr;
+  if (pairHist == nullptr || pairHist->getNVar() != kNPairAxes) {
+    LOGF(warning, "PairHistAccumulator: pair histogram layout not supported, pairs will be filled one by one");
+    return false;
+  }
+  for (int i = 0; i < kNPairAxes; i++) {
+    mAxes[i] = pairHist->GetAxis(i);
+    mNBins[i] = mAxes[i]->GetNbins();
+    mFixBins[i] = (mAxes[i]->GetXbins()->GetSize() == 0);
+  }
+  long nCells = static_cast<long>(mNBins[kDeltaEta]) * mNBins[kPtAssoc] * mNBins[kPtTrigger] * mNBins[kDeltaPhi];
+  mSumw.assign(nCells, 0);
+  mSumw2.assign(nCells, 0);
+  mTouchedCells.clear();
+  mTouchedCells.reserve(nCells);
+  mPairHist = pairHist;
+  LOGF(info, "PairHistAccumulator: using a local buffer of %ld cells", nCells);
+  return true;
+}
+
+int PairHistAccumulator::findBin(int axis, float value) const
+{
+  // same as TAxis::FindBin, which is used by StepTHn::Fill, but 0-based
+  int bin = 0;
+  if (mFixBins[axis]) {
+    if (!(value >= mAxes[axis]->GetXmin() && value < mAxes[axis]->GetXmax())) {
+      return -1;
+    }
+    bin = 1 + static_cast<int>(mNBins[axis] * (value - mAxes[axis]->GetXmin()) / (mAxes[axis]->GetXmax() - mAxes[axis]->GetXmin()));
+  } else {
+    bin = mAxes[axis]->FindBin(value);
+  }
+  if (bin < 1 || bin > mNBins[axis]) {
+    return -1;
+  }
+  return bin - 1;
+}
+
+bool PairHistAccumulator::beginEvent(int step, float multiplicity, float posZ)
+{
+  if (!mTouchedCells.empty()) {
+    flush();
+  }
+  mStep = step;
+  mMultiplicityBin = findBin(kMultiplicity, multiplicity);
+  mVertexBin = findBin(kVertex, posZ);
+  return mMultiplicityBin >= 0 && mVertexBin >= 0;
+}
+
+void PairHistAccumulator::prepareStep(bool needSumw2)
+{
+  // The arrays of StepTHn are created on the first fill of a step, and the sumw2 array on the first fill with weight != 1.
+  // A fill with the corresponding weight into the first bin is used to create them, and is removed afterwards.
+  if (mPairHist->getValues(mStep) != nullptr && (!needSumw2 || mPairHist->getSumw2(mStep) != nullptr)) {
+    return;
+  }
+  const double weight = needSumw2 ? 2. : 1.;
+  mPairHist->Fill(mStep, mAxes[0]->GetBinCenter(1), mAxes[1]->GetBinCenter(1), mAxes[2]->GetBinCenter(1),
+                  mAxes[3]->GetBinCenter(1), mAxes[4]->GetBinCenter(1), mAxes[5]->GetBinCenter(1), weight);
+  TArray* values = mPairHist->getValues(mStep);
+  values->AddAt(values->GetAt(0) - weight, 0);
+  TArray* sumw2 = mPairHist->getSumw2(mStep);
+  if (sumw2 != nullptr) {
+    sumw2->AddAt(sumw2->GetAt(0) - weight * weight, 0);
+  }
+}
+
+void PairHistAccumulator::flush()
+{
+  if (mTouchedCells.empty()) {
+    return;
+  }
+  if (mMultiplicityBin < 0 || mVertexBin < 0) {
+    // the event is outside of the histogram range
+    for (auto cell : mTouchedCells) {
+      mSumw[cell] = 0;
+      mSumw2[cell] = 0;
+    }
+    mTouchedCells.clear();
+    return;
+  }
+
+  prepareStep(!mUnitWeights);
+  TArray* values = mPairHist->getValues(mStep);
+  TArray* sumw2 = mPairHist->getSumw2(mStep);
+
+  // StepTHn stores the bins with the first axis running slowest
+  const int nPhiBins = mNBins[kDeltaPhi];
+  const int nVertexBins = mNBins[kVertex];
+  const int nPtBins = mNBins[kPtAssoc] * mNBins[kPtTrigger];
+  for (auto cell : mTouchedCells) {
+    const int phiBin = cell % nPhiBins;
+    const int etaPtBin = cell / nPhiBins; // (delta eta, pt assoc, pt trigger) in the order of the pair histogram
+    const int etaBin = etaPtBin / nPtBins;
+    const int ptBin = etaPtBin % nPtBins;
+    long bin = (static_cast<long>(etaBin) * nPtBins + ptBin) * mNBins[kMultiplicity] + mMultiplicityBin;
+    bin = (bin * nPhiBins + phiBin) * nVertexBins + mVertexBin;
+
+    values->AddAt(values->GetAt(bin) + mSumw[cell], bin);
+    if (sumw2 != nullptr) {
+      sumw2->AddAt(sumw2->GetAt(bin) + mSumw2[cell], bin);
+    }
+    mSumw[cell] = 0;
+    mSumw2[cell] = 0;
+  }
+  mTouchedCells.clear();
+  mUnitWeights = true;
+}
@@ -0,0 +1,93 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#ifndef PairHistAccumulator_H
+#define PairHistAccumulator_H
+
+// Event-local dense accumulation of pairs for the pair histogram of CorrelationContainer
+//
+// Within one event (or one pair of events for mixing) multiplicity and z-vertex are fixed.
+// The pairs are therefore accumulated into a dense local buffer over
+// (delta eta, pt assoc, pt trigger, delta phi), which is added once to the StepTHn at flush().
+// The track pT bins are determined once per track with ptBinTrigger() / ptBinAssociated().
+
+#include <vector>
+
+class StepTHn;
+class TAxis;
+
+class PairHistAccumulator
+{
+ public:
+  // Axes of the pair histogram, see CorrelationContainer
+  enum PairAxis { kDeltaEta = 0,
+                  kPtAssoc,
+                  kPtTrigger,
+                  kMultiplicity,
+                  kDeltaPhi,
+                  kVertex,
+                  kNPairAxes };
+
+  // Caches the binning of the pair histogram. Returns false if the histogram layout is not supported (e.g. additional user axes)
+  bool init(StepTHn* pairHist);
+  bool isInitialized() const { return mPairHist != nullptr; }
+
+  // Sets the event bins. Returns false if the event is outside of the histogram range (in which case StepTHn would not fill it either)
+  bool beginEvent(int step, float multiplicity, float posZ);
+
+  int ptBinTrigger(float pt) const { return findBin(kPtTrigger, pt); }
+  int ptBinAssociated(float pt) const { return findBin(kPtAssoc, pt); }
+
+  // Adds one pair. ptBinAssoc and ptBinTrig are the values returned by ptBinAssociated() and ptBinTrigger()
+  void fill(int ptBinAssoc, int ptBinTrig, float deltaEta, float deltaPhi, float weight)
+  {
+    if (ptBinAssoc < 0 || ptBinTrig < 0) {
+      return;
+    }
+    int etaBin = findBin(kDeltaEta, deltaEta);
+    int phiBin = findBin(kDeltaPhi, deltaPhi);
+    if (etaBin < 0 || phiBin < 0) {
+      return;
+    }
+    int cell = ((etaBin * mNBins[kPtAssoc] + ptBinAssoc) * mNBins[kPtTrigger] + ptBinTrig) * mNBins[kDeltaPhi] + phiBin;
+    if (mSumw2[cell] == 0) {
+      mTouchedCells.push_back(cell);
+    }
+    mSumw[cell] += weight;
+    mSumw2[cell] += static_cast<double>(weight) * weight;
+    if (weight != 1.f) {
+      mUnitWeights = false;
+    }
+  }
+
+  // Adds the accumulated pairs to the pair histogram and resets the buffer
+  void flush();
+
+ private:
+  // returns the 0-based bin on the given axis, or -1 for under- and overflow
+  int findBin(int axis, float value) const;
+  void prepareStep(bool needSumw2);
+
+  StepTHn* mPairHist = nullptr; //! target histogram
+  TAxis* mAxes[kNPairAxes];     //! axes of the target histogram
+  int mNBins[kNPairAxes];       //  number of bins per axis
+  bool mFixBins[kNPairAxes];    //  axis with fixed bin width
+  int mStep = -1;               //  step of the current event
+  int mMultiplicityBin = -1;    //  multiplicity bin of the current event
+  int mVertexBin = -1;          //  z-vertex bin of the current event
+  bool mUnitWeights = true;     //  all pairs filled since the last flush had weight 1
+
+  std::vector<double> mSumw;      //  accumulated weights per cell
+  std::vector<double> mSumw2;     //  accumulated squared weights per cell
+  std::vector<int> mTouchedCells; //  cells filled since the last flush
+};
+
+#endif
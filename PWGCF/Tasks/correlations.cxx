@@ -24,11 +24,14 @@
 #include "PWGCF/DataModel/CorrelationsDerived.h"
 #include "PWGCF/Core/CorrelationContainer.h"
 #include "PWGCF/Core/PairCuts.h"
+#include "PWGCF/Core/PairHistAccumulator.h"
+#include "Common/Core/EventMixingPool.h"
 #include "DataFormatsParameters/GRPObject.h"
 #include "DataFormatsParameters/GRPMagField.h"
 
 #include <TH1F.h>
 #include <cmath>
+#include <type_traits>
 #include <TDirectory.h>
 #include <THn.h>
 
@@ -37,6 +40,15 @@ using namespace o2::framework;
 using namespace o2::framework::expressions;
 using namespace constants::math;
 
+// Track snapshot stored in the mixing pool, which keeps events across dataframes
+struct CFPooledTrack : eventmixing::PoolRow<float, float, float, int8_t> {
+  using PoolRow::PoolRow;
+  float eta() const { return get<0>(); }
+  float pt() const { return get<1>(); }
+  float phi() const { return get<2>(); }
+  int8_t sign() const { return get<3>(); }
+};
+
 #define O2_DEFINE_CONFIGURABLE(NAME, TYPE, DEFAULT, HELP) Configurable<TYPE> NAME{#NAME, DEFAULT, HELP};
 
 // NOTE This is a nice idea but will again make it impossible to use subwagon configurations...
@@ -75,8 +87,10 @@ struct CorrelationTask {
   O2_DEFINE_CONFIGURABLE(cfgEfficiencyAssociated, std::string, "", "CCDB path to efficiency object for associated particles")
 
   O2_DEFINE_CONFIGURABLE(cfgNoMixedEvents, int, 5, "Number of mixed events per event")
+  O2_DEFINE_CONFIGURABLE(cfgMixingPoolMaxTracks, int, 5000, "Mixing pool: events with more tracks are not stored (<= 0 = no limit)")
 
   O2_DEFINE_CONFIGURABLE(cfgVerbosity, int, 1, "Verbosity level (0 = major, 1 = per collision)")
+  O2_DEFINE_CONFIGURABLE(cfgDensePairFill, bool, false, "Accumulate the pairs of each event in a dense local buffer which is added to the pair histogram once per event")
 
   ConfigurableAxis axisVertex{"axisVertex", {7, -7, 7}, "vertex axis for histograms"};
   ConfigurableAxis axisDeltaPhi{"axisDeltaPhi", {72, -PIHalf, PIHalf * 3}, "delta phi axis for histograms"};
@@ -115,6 +129,13 @@ struct CorrelationTask {
 
   HistogramRegistry registry{"registry"};
   PairCuts mPairCuts;
+  PairHistAccumulator mSameAccumulator;
+  PairHistAccumulator mMixedAccumulator;
+  std::vector<int> mAssociatedPtBins;
+  PairCuts::TrackCache mTrackCache1;
+  PairCuts::TrackCache mTrackCache2;
+  eventmixing::MixingPool<CFPooledTrack> mMixingPool;
+  int mMixingPoolRun = -1; // run of the events in the mixing pool
 
   Service<o2::ccdb::BasicCCDBManager> ccdb;
 
@@ -165,6 +186,15 @@ struct CorrelationTask {
     same->setTrackEtaCut(cfgCutEta);
     mixed->setTrackEtaCut(cfgCutEta);
 
+    if (cfgDensePairFill) {
+      mSameAccumulator.init(same->getPairHist());
+      mMixedAccumulator.init(mixed->getPairHist());
+    }
+
+    if (doprocessMixedDerivedPool) {
+      mMixingPool.init(cfgNoMixedEvents, cfgMixingPoolMaxTracks);
+    }
+
     // o2-ccdb-upload -p Users/jgrosseo/correlations/LHC15o -f /tmp/correction_2011_global.root -k correction
 
     ccdb->setURL("http://alice-ccdb.cern.ch");
@@ -229,8 +259,8 @@ struct CorrelationTask {
     return true;
   }
 
-  template <CorrelationContainer::CFStep step, typename TTarget, typename TTracks>
-  void fillCorrelations(TTarget target, TTracks& tracks1, TTracks& tracks2, float multiplicity, float posZ, int magField, float eventWeight)
+  template <CorrelationContainer::CFStep step, typename TTarget, typename TTracks1, typename TTracks2>
+  void fillCorrelations(TTarget target, TTracks1& tracks1, TTracks2& tracks2, float multiplicity, float posZ, int magField, float eventWeight)
   {
     // Cache efficiency for particles (too many FindBin lookups)
     float* efficiencyAssociated = nullptr;
@@ -244,7 +274,34 @@ struct CorrelationTask {
       }
     }
 
+    // With the dense pair filling, the pT bins are determined once per track and the pairs are added to the histogram once per event
+    auto& accumulator = (target->getPairHist() == mixed->getPairHist()) ? mMixedAccumulator : mSameAccumulator;
+    const bool densePairFill = accumulator.isInitialized();
+    bool eventInRange = true;
+    if (densePairFill) {
+      eventInRange = accumulator.beginEvent(step, multiplicity, posZ);
+      mAssociatedPtBins.clear();
+      for (auto& track : tracks2) {
+        mAssociatedPtBins.push_back(accumulator.ptBinAssociated(track.pt()));
+      }
+    }
+
+    // The per-track quantities entering the pair cuts are computed once per event
+    PairCuts::TrackCache* trackCache2 = &mTrackCache2;
+    if constexpr (step >= CorrelationContainer::kCFStepReconstructed) {
+      if (cfg.mPairCuts || cfgTwoTrackCut > 0) {
+        mPairCuts.fillTrackCache(mTrackCache1, tracks1, magField);
+        if (static_cast<const void*>(&tracks1) == static_cast<const void*>(&tracks2)) {
+          trackCache2 = &mTrackCache1;
+        } else {
+          mPairCuts.fillTrackCache(mTrackCache2, tracks2, magField);
+        }
+      }
+    }
+
+    int iTrack1 = -1;
     for (auto& track1 : tracks1) {
+      iTrack1++;
       // LOGF(info, "Track %f | %f | %f  %d %d", track1.eta(), track1.phi(), track1.pt(), track1.isGlobalTrack(), track1.isGlobalTrackSDD());
 
       if constexpr (step <= CorrelationContainer::kCFStepTracked) {
@@ -266,11 +323,24 @@ struct CorrelationTask {
 
       target->getTriggerHist()->Fill(step, track1.pt(), multiplicity, posZ, triggerWeight);
 
-      for (auto& track2 : tracks2) {
-        if (track1.globalIndex() == track2.globalIndex()) {
-          // LOGF(info, "Track identical: %f | %f | %f || %f | %f | %f", track1.eta(), track1.phi(), track1.pt(),  track2.eta(), track2.phi(), track2.pt());
+      int triggerPtBin = -1;
+      if (densePairFill) {
+        if (!eventInRange) {
           continue;
         }
+        triggerPtBin = accumulator.ptBinTrigger(track1.pt());
+      }
+
+      int iTrack2 = -1;
+      for (auto& track2 : tracks2) {
+        iTrack2++;
+        // tracks of different types (e.g. from the mixing pool) belong to different events
+        if constexpr (std::is_same_v<TTracks1, TTracks2>) {
+          if (track1.globalIndex() == track2.globalIndex()) {
+            // LOGF(info, "Track identical: %f | %f | %f || %f | %f | %f", track1.eta(), track1.phi(), track1.pt(),  track2.eta(), track2.phi(), track2.pt());
+            continue;
+          }
+        }
 
         if constexpr (step <= CorrelationContainer::kCFStepTracked) {
           if (!checkObject<step>(track2)) {
@@ -290,11 +360,11 @@ struct CorrelationTask {
         }
 
         if constexpr (step >= CorrelationContainer::kCFStepReconstructed) {
-          if (cfg.mPairCuts && mPairCuts.conversionCuts(track1, track2)) {
+          if (cfg.mPairCuts && mPairCuts.conversionCuts(mTrackCache1, iTrack1, *trackCache2, iTrack2)) {
             continue;
           }
 
-          if (cfgTwoTrackCut > 0 && mPairCuts.twoTrackCut(track1, track2, magField)) {
+          if (cfgTwoTrackCut > 0 && mPairCuts.twoTrackCut(mTrackCache1, iTrack1, *trackCache2, iTrack2)) {
             continue;
           }
         }
@@ -302,7 +372,7 @@ struct CorrelationTask {
         float associatedWeight = triggerWeight;
         if constexpr (step == CorrelationContainer::kCFStepCorrected) {
           if (cfg.mEfficiencyAssociated) {
-            associatedWeight *= efficiencyAssociated[track2.filteredIndex()];
+            associatedWeight *= efficiencyAssociated[iTrack2];
           }
         }
 
@@ -314,11 +384,19 @@ struct CorrelationTask {
           deltaPhi += TwoPI;
         }
 
-        target->getPairHist()->Fill(step,
-                                    track1.eta() - track2.eta(), track2.pt(), track1.pt(), multiplicity, deltaPhi, posZ, associatedWeight);
+        if (densePairFill) {
+          accumulator.fill(mAssociatedPtBins[iTrack2], triggerPtBin, track1.eta() - track2.eta(), deltaPhi, associatedWeight);
+        } else {
+          target->getPairHist()->Fill(step,
+                                      track1.eta() - track2.eta(), track2.pt(), track1.pt(), multiplicity, deltaPhi, posZ, associatedWeight);
+        }
       }
     }
 
+    if (densePairFill) {
+      accumulator.flush();
+    }
+
     delete[] efficiencyAssociated;
   }
 
@@ -490,6 +568,60 @@ struct CorrelationTask {
   }
   PROCESS_SWITCH(CorrelationTask, processMixedDerived, "Process mixed events on derived data", false);
 
+  // Mixing with the previous events of the same bin kept in the mixing pool, also across dataframes
+  // The pool is emptied at each change of run, so that only events with the same magnetic field are mixed
+  void processMixedDerivedPool(derivedCollisions const& collisions, derivedTracks const& tracks)
+  {
+    for (auto& collision1 : collisions) {
+      if (collision1.runNumber() != mMixingPoolRun) {
+        if (cfgVerbosity > 0) {
+          LOGF(info, "processMixedDerivedPool: new run %d, clearing the mixing pool of run %d", collision1.runNumber(), mMixingPoolRun);
+        }
+        mMixingPool.clear();
+        mMixingPoolRun = collision1.runNumber();
+      }
+
+      int bin = configurableBinningDerived.getBin({collision1.posZ(), collision1.multiplicity()});
+      if (bin < 0) {
+        continue;
+      }
+      auto tracks1 = tracks.sliceByCached(aod::cftrack::cfCollisionId, collision1.globalIndex(), cache);
+
+      const int nMixed = mMixingPool.size(bin);
+      if (nMixed > 0) {
+        float eventWeight = 1.0f / nMixed;
+        int field = 0;
+        if (cfgTwoTrackCut > 0) {
+          field = getMagneticField(collision1.timestamp());
+        }
+
+        if (cfgVerbosity > 0) {
+          LOGF(info, "processMixedDerivedPool: Mixed collisions bin: %d with %d pooled events, %d (%.3f, %.3f)", bin, nMixed, collision1.globalIndex(), collision1.posZ(), collision1.multiplicity());
+        }
+
+        loadEfficiency(collision1.timestamp());
+        mixed->fillEvent(collision1.multiplicity(), CorrelationContainer::kCFStepReconstructed);
+        if (cfg.mEfficiencyAssociated || cfg.mEfficiencyTrigger) {
+          mixed->fillEvent(collision1.multiplicity(), CorrelationContainer::kCFStepCorrected);
+        }
+
+        for (int i = 0; i < nMixed; i++) {
+          auto tracks2 = mMixingPool.event(bin, i);
+          registry.fill(HIST("eventcount_mixed"), bin);
+          fillCorrelations<CorrelationContainer::kCFStepReconstructed>(mixed, tracks1, tracks2, collision1.multiplicity(), collision1.posZ(), field, eventWeight);
+          if (cfg.mEfficiencyAssociated || cfg.mEfficiencyTrigger) {
+            fillCorrelations<CorrelationContainer::kCFStepCorrected>(mixed, tracks1, tracks2, collision1.multiplicity(), collision1.posZ(), field, eventWeight);
+          }
+        }
+      }
+
+      mMixingPool.addEvent(bin, tracks1, [](auto const& track) {
+        return CFPooledTrack::Snapshot{track.eta(), track.pt(), track.phi(), track.sign()};
+      });
+    }
+  }
+  PROCESS_SWITCH(CorrelationTask, processMixedDerivedPool, "Process mixed events on derived data with a mixing pool kept across dataframes", false);
+
   // Version with combinations
   /*void processWithCombinations(soa::Join<aod::Collisions, aod::CentRun2V0Ms>::iterator const& collision, aod::BCsWithTimestamps const&, soa::Filtered<aod::Tracks> const& tracks)
   {
@@ -88,6 +88,16 @@ class FilterAndAnalysisFramework : public TNamed
   {
     return fPIDFilter->Filter(track);
   }
+  template <typename TracksToFilter>
+  void FilterTracks(TracksToFilter const& tracks, std::vector<uint64_t>& masks)
+  {
+    fTrackFilter->FilterTracks(tracks, masks);
+  }
+  template <typename TracksToFilter>
+  void FilterTracksPID(TracksToFilter const& tracks, std::vector<uint64_t>& masks)
+  {
+    fPIDFilter->FilterTracks(tracks, masks);
+  }
   /// \brief get the event multiplicities
   std::vector<float> GetCollisionMultiplicities() { return fEventFilter->GetMultiplicities(); }
   /// \brief Gets the index of the active multiplicity value within the multiplicities array
@@ -113,6 +113,7 @@ PIDSelectionFilterAndAnalysis::PIDSelectionFilterAndAnalysis()
     mCloseNsigmasTOF(kNoOfSpecies, nullptr),
     mBayesProbability(kNoOfSpecies, nullptr)
 {
+  CompileBricks();
 }
 
 /// \brief Constructor from regular expression
@@ -308,6 +309,27 @@ void PIDSelectionFilterAndAnalysis::ConstructCutFromString(const TString& cutstr
     }
   }
   mMaskLength = CalculateMaskLength();
+  CompileBricks();
+}
+
+/// \brief Compiles the bricks into the program used for filtering
+/// The mask bits follow the order of CalculateMaskLength() and StoreArmedMask()
+void PIDSelectionFilterAndAnalysis::CompileBricks()
+{
+  mProgram.Clear();
+  int bit = 0;
+  auto compileBricks = [&](auto& bricklst, int firstvariable) {
+    for (int i = 0; i < kNoOfSpecies; ++i) {
+      if (bricklst[i] != nullptr) {
+        bricklst[i]->Compile(mProgram, firstvariable + i, bit);
+      }
+    }
+  };
+  compileBricks(mCloseNsigmasTPC, kTPCNSigmas);
+  compileBricks(mCloseNsigmasTOF, kTOFNSigmas);
+#ifdef INCORPORATEBAYESIANPID
+  compileBricks(mBayesProbability, kBayesProbabilities);
+#endif
 }
 
 void PIDSelectionFilterAndAnalysis::StoreArmedMask()
@@ -102,6 +102,8 @@ class PIDSelectionFilterAndAnalysis : public SelectionFilterAndAnalysis
 
   template <typename TrackToFilter>
   uint64_t Filter(TrackToFilter const& track);
+  template <typename TracksToFilter>
+  void FilterTracks(TracksToFilter const& tracks, std::vector<uint64_t>& masks);
 
   enum PIDSpecies {
     kElectron = 0, ///< electron
@@ -128,9 +130,21 @@ class PIDSelectionFilterAndAnalysis : public SelectionFilterAndAnalysis
   static const std::vector<std::string> mSpeciesNames;
 
  private:
+  /// \enum PIDVariables
+  /// \brief The first index of the per species PID variables the compiled bricks are evaluated on
+  enum PIDVariables {
+    kTPCNSigmas = 0,                        ///< the TPC nsigmas
+    kTOFNSigmas = kNoOfSpecies,             ///< the TOF nsigmas
+    kBayesProbabilities = 2 * kNoOfSpecies, ///< the Bayesian probabilities
+    kNPIDVariables = 3 * kNoOfSpecies       ///< the number of PID variables
+  };
+
   void ConstructCutFromString(const TString&);
   virtual int CalculateMaskLength() override;
   virtual void StoreArmedMask() override;
+  void CompileBricks();
+  template <typename TrackToFilter>
+  void GetPIDValues(TrackToFilter const& track, float* values, size_t stride);
 
   float mPTOF = 0.8f;           ///< the p threshold for cheking TOF information
   bool mRequireTOF = false;     ///< is TOF required
@@ -140,51 +154,74 @@ class PIDSelectionFilterAndAnalysis : public SelectionFilterAndAnalysis
   std::vector<CutBrick<float>*> mCloseNsigmasTPC;
   std::vector<CutBrick<float>*> mCloseNsigmasTOF;
   std::vector<CutBrick<float>*> mBayesProbability;
+  CutBrickProgram<float> mProgram; //! the compiled bricks
+  std::vector<float> mColumns;     //! the PID variables of the tracks to filter in batch
 
   ClassDef(PIDSelectionFilterAndAnalysis, 1);
 };
 
-/// \brief Fills the filter cuts mask
+/// \brief Gets the PID variables of a track
+/// \param values where to store the variables, the variable i goes to values[i * stride]
 template <typename TrackToFilter>
-inline uint64_t PIDSelectionFilterAndAnalysis::Filter(TrackToFilter const& track)
+inline void PIDSelectionFilterAndAnalysis::GetPIDValues(TrackToFilter const& track, float* values, size_t stride)
 {
-  uint64_t selectedMask = 0UL;
-  mSelectedMask = 0UL;
-  int bit = 0;
-
-  auto filterBrickValue = [&](auto brick, auto value) {
-    if (brick != nullptr) {
-      std::vector<bool> res = brick->Filter(value);
-      for (auto b : res) {
-        if (b) {
-          SETBIT(selectedMask, bit);
-        }
-        bit++;
-      }
-    }
-  };
-  filterBrickValue(mCloseNsigmasTPC[kElectron], track.tpcNSigmaEl());
-  filterBrickValue(mCloseNsigmasTPC[kMuon], track.tpcNSigmaMu());
-  filterBrickValue(mCloseNsigmasTPC[kPion], track.tpcNSigmaPi());
-  filterBrickValue(mCloseNsigmasTPC[kKaon], track.tpcNSigmaKa());
-  filterBrickValue(mCloseNsigmasTPC[kProton], track.tpcNSigmaPr());
-  filterBrickValue(mCloseNsigmasTOF[kElectron], track.tofNSigmaEl());
-  filterBrickValue(mCloseNsigmasTOF[kMuon], track.tofNSigmaMu());
-  filterBrickValue(mCloseNsigmasTOF[kPion], track.tofNSigmaPi());
-  filterBrickValue(mCloseNsigmasTOF[kKaon], track.tofNSigmaKa());
-  filterBrickValue(mCloseNsigmasTOF[kProton], track.tofNSigmaPr());
+  values[(kTPCNSigmas + kElectron) * stride] = track.tpcNSigmaEl();
+  values[(kTPCNSigmas + kMuon) * stride] = track.tpcNSigmaMu();
+  values[(kTPCNSigmas + kPion) * stride] = track.tpcNSigmaPi();
+  values[(kTPCNSigmas + kKaon) * stride] = track.tpcNSigmaKa();
+  values[(kTPCNSigmas + kProton) * stride] = track.tpcNSigmaPr();
+  values[(kTOFNSigmas + kElectron) * stride] = track.tofNSigmaEl();
+  values[(kTOFNSigmas + kMuon) * stride] = track.tofNSigmaMu();
+  values[(kTOFNSigmas + kPion) * stride] = track.tofNSigmaPi();
+  values[(kTOFNSigmas + kKaon) * stride] = track.tofNSigmaKa();
+  values[(kTOFNSigmas + kProton) * stride] = track.tofNSigmaPr();
 #ifdef INCORPORATEBAYESIANPID
-  filterBrickValue(mBayesProbability[kElectron], track.bayesEl());
-  filterBrickValue(mBayesProbability[kMuon], track.bayesMu());
-  filterBrickValue(mBayesProbability[kPion], track.bayesPi());
-  filterBrickValue(mBayesProbability[kKaon], track.bayesKa());
-  filterBrickValue(mBayesProbability[kProton], track.bayesPr());
+  values[(kBayesProbabilities + kElectron) * stride] = track.bayesEl();
+  values[(kBayesProbabilities + kMuon) * stride] = track.bayesMu();
+  values[(kBayesProbabilities + kPion) * stride] = track.bayesPi();
+  values[(kBayesProbabilities + kKaon) * stride] = track.bayesKa();
+  values[(kBayesProbabilities + kProton) * stride] = track.bayesPr();
+#else
+  for (int i = 0; i < kNoOfSpecies; ++i) {
+    values[(kBayesProbabilities + i) * stride] = 0.0f;
+  }
 #endif
+}
 
-  mSelectedMask = selectedMask;
+/// \brief Fills the filter cuts mask
+template <typename TrackToFilter>
+inline uint64_t PIDSelectionFilterAndAnalysis::Filter(TrackToFilter const& track)
+{
+  float values[kNPIDVariables];
+  GetPIDValues(track, values, 1);
+  mSelectedMask = mProgram.Filter(values);
   return mSelectedMask;
 }
 
+/// \brief Fills the filter cuts mask of a set of tracks
+/// \param tracks the tracks to filter
+/// \param masks the filter cuts mask of each track, in the tracks order
+template <typename TracksToFilter>
+inline void PIDSelectionFilterAndAnalysis::FilterTracks(TracksToFilter const& tracks, std::vector<uint64_t>& masks)
+{
+  const size_t ntracks = tracks.size();
+  mColumns.resize(kNPIDVariables * ntracks);
+  masks.assign(ntracks, 0UL);
+
+  size_t itrack = 0;
+  for (auto const& track : tracks) {
+    GetPIDValues(track, mColumns.data() + itrack, ntracks);
+    itrack++;
+  }
+
+  const float* columns[kNPIDVariables];
+  for (int i = 0; i < kNPIDVariables; ++i) {
+    columns[i] = mColumns.data() + i * ntracks;
+  }
+  mProgram.Filter(columns, ntracks, masks.data());
+  mSelectedMask = (ntracks > 0) ? masks[ntracks - 1] : 0UL;
+}
+
 } // namespace PWGCF
 } // namespace analysis
 } // namespace o2
@@ -32,6 +32,10 @@ namespace analysis
 {
 namespace PWGCF
 {
+/* forward declaration */
+template <typename TValueToFilter>
+class CutBrickProgram;
+
 /// \class CutBrick
 /// \brief Virtual class which implements the base component of the selection cuts
 ///
@@ -64,6 +68,12 @@ class CutBrick : public TNamed
   /// Virtual function. Return the index of the armed brick within this brick
   /// \returns The index of the armed brick within this brick. Default -1
   virtual int getArmedIndex() { return -1; }
+  /// Virtual function. Incorporates the brick into a compiled program
+  /// The default is to keep the brick as such, evaluated through its Filter() method
+  /// \param program the program to incorporate the brick to
+  /// \param variable the index of the variable the brick filters
+  /// \param bit the first mask bit of the brick, on return the first bit after the brick
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit);
 
   static CutBrick<TValueToFilter>* constructBrick(const char* name, const char* regex, const std::set<std::string>& allowed);
   static const char* mgImplementedbricks[];
@@ -114,6 +124,7 @@ class CutBrickLimit : public CutBrick<TValueToFilter>
   virtual std::vector<bool> IsArmed() override;
   virtual std::vector<bool> Filter(const TValueToFilter&) override;
   virtual int Length() override { return 1; }
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override;
 
  private:
   void ConstructCutFromString(const TString&);
@@ -160,6 +171,11 @@ class CutBrickFnLimit : public CutBrickLimit<TValueToFilter>
   {
     this->mLimit = TValueToFilter(mFunction.Eval(x));
   }
+  /// the limit depends on the independent variable, the brick is not compiled
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override
+  {
+    CutBrick<TValueToFilter>::Compile(program, variable, bit);
+  }
 
  private:
   void ConstructCutFromString(const TString&);
@@ -185,6 +201,7 @@ class CutBrickThreshold : public CutBrick<TValueToFilter>
   virtual std::vector<bool> IsArmed() override;
   virtual std::vector<bool> Filter(const TValueToFilter&) override;
   virtual int Length() override { return 1; }
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override;
 
  private:
   void ConstructCutFromString(const TString&);
@@ -231,6 +248,11 @@ class CutBrickFnThreshold : public CutBrickThreshold<TValueToFilter>
   {
     this->mThreshold = TValueToFilter(mFunction.Eval(x));
   }
+  /// the limit depends on the independent variable, the brick is not compiled
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override
+  {
+    CutBrick<TValueToFilter>::Compile(program, variable, bit);
+  }
 
  private:
   void ConstructCutFromString(const TString&);
@@ -256,6 +278,7 @@ class CutBrickRange : public CutBrick<TValueToFilter>
   virtual std::vector<bool> IsArmed() override;
   virtual std::vector<bool> Filter(const TValueToFilter&) override;
   virtual int Length() override { return 1; }
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override;
 
  private:
   void ConstructCutFromString(const TString&);
@@ -304,6 +327,11 @@ class CutBrickFnRange : public CutBrickRange<TValueToFilter>
     this->mLow = TValueToFilter(mLowFunction.Eval(x));
     this->mUp = TValueToFilter(mUpFunction.Eval(x));
   }
+  /// the limits depend on the independent variable, the brick is not compiled
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override
+  {
+    CutBrick<TValueToFilter>::Compile(program, variable, bit);
+  }
 
  private:
   void ConstructCutFromString(const TString&);
@@ -330,6 +358,7 @@ class CutBrickExtToRange : public CutBrick<TValueToFilter>
   virtual std::vector<bool> IsArmed() override;
   virtual std::vector<bool> Filter(const TValueToFilter&) override;
   virtual int Length() override { return 1; }
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override;
 
  private:
   void ConstructCutFromString(const TString&);
@@ -378,6 +407,11 @@ class CutBrickFnExtToRange : public CutBrickExtToRange<TValueToFilter>
     this->mLow = TValueToFilter(mLowFunction.Eval(x));
     this->mUp = TValueToFilter(mUpFunction.Eval(x));
   }
+  /// the limits depend on the independent variable, the brick is not compiled
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override
+  {
+    CutBrick<TValueToFilter>::Compile(program, variable, bit);
+  }
 
  private:
   void ConstructCutFromString(const TString&);
@@ -409,6 +443,7 @@ class CutBrickSelectorMultipleRanges : public CutBrick<TValueToFilter>
   /// The length is in brick units. The actual length is implementation dependent
   /// \returns Brick length in units of bricks
   virtual int Length() override { return mActive.size(); }
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override;
 
  private:
   void ConstructCutFromString(const TString&);
@@ -441,6 +476,7 @@ class CutWithVariations : public CutBrick<TValueToFilter>
   virtual std::vector<bool> Filter(const TValueToFilter&) override;
   virtual int Length() override;
   virtual int getArmedIndex() override;
+  virtual void Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit) override;
 
  private:
   void ConstructCutFromString(const TString&);
@@ -451,6 +487,173 @@ class CutWithVariations : public CutBrick<TValueToFilter>
   ClassDef(CutWithVariations, 1);
 };
 
+/// \class CutBrickProgram
+/// \brief Flat, compiled, form of a set of cut bricks
+/// Each brick component becomes one instruction comparing the value of a variable against
+/// its limits and setting its bit of the selection mask. The bricks are compiled once, when the
+/// selection is configured, and the mask is then obtained without going through the
+/// brick tree nor allocating the brick status vectors.
+/// Bricks whose limits change with an independent variable are kept as such and
+/// evaluated through their Filter() method.
+template <typename TValueToFilter>
+class CutBrickProgram
+{
+ public:
+  /// \enum Opcode
+  /// \brief The comparison performed by an instruction
+  enum Opcode {
+    kLIMIT,         ///< value < up
+    kTHRESHOLD,     ///< low < value
+    kRANGE,         ///< low < value < up
+    kEXTTORANGE,    ///< value < low or up < value
+    kSEMIOPENRANGE, ///< low <= value < up
+    kBRICK          ///< not compiled brick, evaluated through its Filter() method
+  };
+  struct Instruction {
+    Opcode mOpcode;
+    int mVariable;
+    int mBit;
+    TValueToFilter mLow;
+    TValueToFilter mUp;
+    CutBrick<TValueToFilter>* mBrick;
+  };
+
+  void Clear() { mInstructions.clear(); }
+  bool Empty() const { return mInstructions.empty(); }
+  void AddInstruction(Opcode opcode, int variable, int bit, TValueToFilter low, TValueToFilter up)
+  {
+    mInstructions.push_back({opcode, variable, bit, low, up, nullptr});
+  }
+  void AddBrick(CutBrick<TValueToFilter>* brick, int variable, int bit)
+  {
+    mInstructions.push_back({kBRICK, variable, bit, TValueToFilter(0), TValueToFilter(0), brick});
+  }
+
+  /// \brief Evaluates the program
+  /// \param values the values of the variables, indexed by variable
+  /// \return the mask with the bits of the components passed by the values
+  uint64_t Filter(const TValueToFilter* values) const
+  {
+    uint64_t mask = 0UL;
+    for (auto const& instruction : mInstructions) {
+      if (instruction.mOpcode == kBRICK) {
+        mask |= FilterBrick(instruction, values[instruction.mVariable]);
+      } else if (Passes(instruction, values[instruction.mVariable])) {
+        SETBIT(mask, instruction.mBit);
+      }
+    }
+    return mask;
+  }
+
+  /// \brief Evaluates the program over a set of entries stored as columns
+  /// \param columns the column of each variable, indexed by variable
+  /// \param n the number of entries
+  /// \param masks the masks of the entries, the bits of the passed components are added to them
+  void Filter(const TValueToFilter* const* columns, size_t n, uint64_t* masks) const
+  {
+    for (auto const& instruction : mInstructions) {
+      const TValueToFilter* column = columns[instruction.mVariable];
+      if (instruction.mOpcode == kBRICK) {
+        for (size_t i = 0; i < n; ++i) {
+          masks[i] |= FilterBrick(instruction, column[i]);
+        }
+      } else {
+        const uint64_t bit = uint64_t(1) << instruction.mBit;
+        for (size_t i = 0; i < n; ++i) {
+          masks[i] |= Passes(instruction, column[i]) ? bit : 0UL;
+        }
+      }
+    }
+  }
+
+ private:
+  static bool Passes(const Instruction& instruction, TValueToFilter value)
+  {
+    switch (instruction.mOpcode) {
+      case kLIMIT:
+        return value < instruction.mUp;
+      case kTHRESHOLD:
+        return instruction.mLow < value;
+      case kRANGE:
+        return (instruction.mLow < value) and (value < instruction.mUp);
+      case kEXTTORANGE:
+        return (value < instruction.mLow) or (instruction.mUp < value);
+      case kSEMIOPENRANGE:
+        return (instruction.mLow <= value) and (value < instruction.mUp);
+      default:
+        return false;
+    }
+  }
+  static uint64_t FilterBrick(const Instruction& instruction, TValueToFilter value)
+  {
+    uint64_t mask = 0UL;
+    int bit = instruction.mBit;
+    for (auto b : instruction.mBrick->Filter(value)) {
+      if (b) {
+        SETBIT(mask, bit);
+      }
+      bit++;
+    }
+    return mask;
+  }
+
+  std::vector<Instruction> mInstructions; ///< the compiled bricks
+};
+
+/// \brief Keeps the brick as such in the program
+template <typename TValueToFilter>
+inline void CutBrick<TValueToFilter>::Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit)
+{
+  program.AddBrick(this, variable, bit);
+  bit += Length();
+}
+
+template <typename TValueToFilter>
+inline void CutBrickLimit<TValueToFilter>::Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit)
+{
+  program.AddInstruction(CutBrickProgram<TValueToFilter>::kLIMIT, variable, bit++, mLimit, mLimit);
+}
+
+template <typename TValueToFilter>
+inline void CutBrickThreshold<TValueToFilter>::Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit)
+{
+  program.AddInstruction(CutBrickProgram<TValueToFilter>::kTHRESHOLD, variable, bit++, mThreshold, mThreshold);
+}
+
+template <typename TValueToFilter>
+inline void CutBrickRange<TValueToFilter>::Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit)
+{
+  program.AddInstruction(CutBrickProgram<TValueToFilter>::kRANGE, variable, bit++, mLow, mUp);
+}
+
+template <typename TValueToFilter>
+inline void CutBrickExtToRange<TValueToFilter>::Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit)
+{
+  program.AddInstruction(CutBrickProgram<TValueToFilter>::kEXTTORANGE, variable, bit++, mLow, mUp);
+}
+
+/// \brief One semi-open range per component, the edges are increasing
+/// so that at most the component which Filter() would activate passes
+template <typename TValueToFilter>
+inline void CutBrickSelectorMultipleRanges<TValueToFilter>::Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit)
+{
+  for (unsigned int i = 0; i < mActive.size(); ++i) {
+    program.AddInstruction(CutBrickProgram<TValueToFilter>::kSEMIOPENRANGE, variable, bit++, mEdges[i], mEdges[i + 1]);
+  }
+}
+
+/// \brief The default and the variation bricks are compiled in sequence
+template <typename TValueToFilter>
+inline void CutWithVariations<TValueToFilter>::Compile(CutBrickProgram<TValueToFilter>& program, int variable, int& bit)
+{
+  for (int i = 0; i < mDefaultBricks.GetEntries(); ++i) {
+    ((CutBrick<TValueToFilter>*)mDefaultBricks.At(i))->Compile(program, variable, bit);
+  }
+  for (int i = 0; i < mVariationBricks.GetEntries(); ++i) {
+    ((CutBrick<TValueToFilter>*)mVariationBricks.At(i))->Compile(program, variable, bit);
+  }
+}
+
 /// \class SpecialCutBrick
 /// \brief Virtual class which implements the base component of the special selection cuts
 /// Special selection cuts are needed because the tables access seems cannot be
@@ -119,6 +119,7 @@ TrackSelectionFilterAndAnalysis::TrackSelectionFilterAndAnalysis()
   /* at least we initialize by default pT and eta cuts */
   mPtRange = CutBrick<float>::constructBrick("pT", "rg{0.2,10}", std::set<std::string>{"rg"});
   mEtaRange = CutBrick<float>::constructBrick("eta", "rg{-0.8,0.8}", std::set<std::string>{"rg"});
+  CompileBricks();
 }
 
 /// \brief Constructor from regular expression
@@ -251,6 +252,58 @@ int TrackSelectionFilterAndAnalysis::CalculateMaskLength()
   return length;
 }
 
+/// \brief Compiles the bricks into the programs used for filtering
+/// The mask bits follow the order of CalculateMaskLength() and StoreArmedMask()
+void TrackSelectionFilterAndAnalysis::CompileBricks()
+{
+  mFloatProgram.Clear();
+  mIntProgram.Clear();
+  mKinematicProgram.Clear();
+
+  int bit = 0;
+  for (int i = 0; i < mTrackSign.GetEntries(); ++i) {
+    ((CutBrick<float>*)mTrackSign.At(i))->Compile(mFloatProgram, kSign, bit);
+  }
+  mTrackTypesFirstBit = bit;
+  for (int i = 0; i < mTrackTypes.GetEntries(); ++i) {
+    bit += ((SpecialCutBrick*)mTrackTypes.At(i))->Length();
+  }
+  auto compileBrick = [&bit](auto brick, auto& program, int variable) {
+    if (brick != nullptr) {
+      brick->Compile(program, variable, bit);
+    }
+  };
+  compileBrick(mNClustersTPC, mIntProgram, kNClsTPC);
+  compileBrick(mNCrossedRowsTPC, mIntProgram, kNXRTPC);
+  compileBrick(mNClustersITS, mIntProgram, kNClsITS);
+  compileBrick(mMaxChi2PerClusterTPC, mFloatProgram, kChi2TPC);
+  compileBrick(mMaxChi2PerClusterITS, mFloatProgram, kChi2ITS);
+  compileBrick(mMinNCrossedRowsOverFindableClustersTPC, mFloatProgram, kXRoFCTPC);
+  compileBrick(mMaxDcaXY, mFloatProgram, kDcaXY);
+  compileBrick(mMaxDcaZ, mFloatProgram, kDcaZ);
+
+  /* the pT and eta bricks dont go to the mask, they have their own bits */
+  auto bitsMask = [](int first, int last) {
+    uint64_t mask = 0UL;
+    for (int b = first; b < last; ++b) {
+      SETBIT(mask, b);
+    }
+    return mask;
+  };
+  int kinematicBit = 0;
+  mPtMask = 0UL;
+  if (mPtRange != nullptr) {
+    mPtRange->Compile(mKinematicProgram, kPt, kinematicBit);
+    mPtMask = bitsMask(0, kinematicBit);
+  }
+  mEtaMask = 0UL;
+  if (mEtaRange != nullptr) {
+    int firstEtaBit = kinematicBit;
+    mEtaRange->Compile(mKinematicProgram, kEta, kinematicBit);
+    mEtaMask = bitsMask(firstEtaBit, kinematicBit);
+  }
+}
+
 void TrackSelectionFilterAndAnalysis::SetPtRange(const TString& regex)
 {
   if (mPtRange != nullptr) {
@@ -258,6 +311,7 @@ void TrackSelectionFilterAndAnalysis::SetPtRange(const TString& regex)
   }
   mPtRange = CutBrick<float>::constructBrick("pT", regex.Data(), std::set<std::string>{"rg", "th", "lim", "xrg"});
   mMaskLength = CalculateMaskLength();
+  CompileBricks();
 }
 
 void TrackSelectionFilterAndAnalysis::SetEtaRange(const TString& regex)
@@ -267,6 +321,7 @@ void TrackSelectionFilterAndAnalysis::SetEtaRange(const TString& regex)
   }
   mEtaRange = CutBrick<float>::constructBrick("eta", regex.Data(), std::set<std::string>{"rg", "th", "lim", "xrg"});
   mMaskLength = CalculateMaskLength();
+  CompileBricks();
 }
 
 void TrackSelectionFilterAndAnalysis::ConstructCutFromString(const TString& cutstr)
@@ -391,6 +446,7 @@ void TrackSelectionFilterAndAnalysis::ConstructCutFromString(const TString& cuts
     }
   }
   mMaskLength = CalculateMaskLength();
+  CompileBricks();
 }
 
 /// \brief Fills the filter cuts mask
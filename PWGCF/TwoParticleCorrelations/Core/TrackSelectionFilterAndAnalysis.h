@@ -102,11 +102,40 @@ class TrackSelectionFilterAndAnalysis : public SelectionFilterAndAnalysis
 
   template <typename TrackToFilter>
   uint64_t Filter(TrackToFilter const& track);
+  template <typename TracksToFilter>
+  void FilterTracks(TracksToFilter const& tracks, std::vector<uint64_t>& masks);
 
  private:
+  /// \enum FloatVariables
+  /// \brief The float track variables the compiled bricks are evaluated on
+  enum FloatVariables {
+    kSign = 0, ///< the track charge sign
+    kChi2TPC,  ///< the Chi2 per TPC cluster
+    kChi2ITS,  ///< the Chi2 per ITS cluster
+    kXRoFCTPC, ///< the ratio of TPC crossed rows over findable clusters
+    kDcaXY,    ///< the DCAxy
+    kDcaZ,     ///< the DCAz
+    kPt,       ///< the transverse momentum
+    kEta,      ///< the pseudorapidity
+    kNFloatVariables
+  };
+  /// \enum IntVariables
+  /// \brief The integer track variables the compiled bricks are evaluated on
+  enum IntVariables {
+    kNClsTPC = 0, ///< the number of TPC clusters
+    kNXRTPC,      ///< the number of TPC crossed rows
+    kNClsITS,     ///< the number of ITS clusters
+    kNIntVariables
+  };
+
   void ConstructCutFromString(const TString&);
   int CalculateMaskLength();
+  void CompileBricks();
   void StoreArmedMask();
+  bool PassesKinematics(uint64_t kinematicMask) const
+  {
+    return ((mPtMask == 0UL) or ((kinematicMask & mPtMask) != 0UL)) and ((mEtaMask == 0UL) or ((kinematicMask & mEtaMask) != 0UL));
+  }
 
   TList mTrackSign;                                         /// the track charge sign list
   TList mTrackTypes;                                        /// the track types to select list
@@ -121,84 +150,114 @@ class TrackSelectionFilterAndAnalysis : public SelectionFilterAndAnalysis
   CutBrick<float>* mPtRange;                                //! the pT range cuts
   CutBrick<float>* mEtaRange;                               //! the eta range cuts
 
+  CutBrickProgram<float> mFloatProgram;               //! the compiled float bricks which go to the mask
+  CutBrickProgram<int> mIntProgram;                   //! the compiled integer bricks which go to the mask
+  CutBrickProgram<float> mKinematicProgram;           //! the compiled pT and eta bricks, they do not go to the mask
+  uint64_t mPtMask = 0UL;                             //! the pT bits within the kinematic program mask
+  uint64_t mEtaMask = 0UL;                            //! the eta bits within the kinematic program mask
+  int mTrackTypesFirstBit = 0;                        //! the first mask bit of the track types
+  std::vector<float> mFloatColumns[kNFloatVariables]; //! the float variables of the tracks to filter in batch
+  std::vector<int> mIntColumns[kNIntVariables];       //! the integer variables of the tracks to filter in batch
+  std::vector<uint64_t> mKinematicMasks;              //! the kinematic masks of the tracks to filter in batch
+
   ClassDef(TrackSelectionFilterAndAnalysis, 1)
 };
 
 /// \brief Fills the filter cuts mask
+/// The bricks are evaluated through their compiled programs, only the track types
+/// are evaluated on the track itself
 template <typename TrackToFilter>
 uint64_t TrackSelectionFilterAndAnalysis::Filter(TrackToFilter const& track)
 {
-  uint64_t selectedMask = 0UL;
-  int bit = 0;
+  const float floatValues[kNFloatVariables] = {
+    float(track.sign()),
+    track.tpcChi2NCl(),
+    track.itsChi2NCl(),
+    track.tpcCrossedRowsOverFindableCls(),
+    track.dcaXY(),
+    track.dcaZ(),
+    track.pt(),
+    track.eta()};
+
+  /* pT and eta are not part of the mask but reject the track */
+  if (not PassesKinematics(mKinematicProgram.Filter(floatValues))) {
+    return mSelectedMask = 0UL;
+  }
+
+  const int intValues[kNIntVariables] = {
+    track.tpcNClsFound(),
+    track.tpcNClsCrossedRows(),
+    track.itsNCls()};
 
-  auto filterTrackType = [&](TrackSelectionBrick* ttype, auto trk) {
-    if (ttype->Filter(trk)) {
+  uint64_t selectedMask = mFloatProgram.Filter(floatValues) | mIntProgram.Filter(intValues);
+  int bit = mTrackTypesFirstBit;
+  for (int i = 0; i < mTrackTypes.GetEntries(); ++i) {
+    if (((TrackSelectionBrick*)mTrackTypes.UncheckedAt(i))->Filter(track)) {
       SETBIT(selectedMask, bit);
     }
     bit++;
-  };
+  }
+  return mSelectedMask = selectedMask;
+}
 
-  auto filterBrickValue = [&](auto brick, auto value) {
-    std::vector<bool> res = brick->Filter(value);
-    for (auto b : res) {
-      if (b) {
-        SETBIT(selectedMask, bit);
-      }
-      bit++;
-    }
-  };
+/// \brief Fills the filter cuts mask of a set of tracks
+/// The track variables are first gathered in columns and the compiled programs
+/// are then evaluated once over the whole set of tracks
+/// \param tracks the tracks to filter
+/// \param masks the filter cuts mask of each track, in the tracks order
+template <typename TracksToFilter>
+void TrackSelectionFilterAndAnalysis::FilterTracks(TracksToFilter const& tracks, std::vector<uint64_t>& masks)
+{
+  const size_t ntracks = tracks.size();
+  for (auto& column : mFloatColumns) {
+    column.resize(ntracks);
+  }
+  for (auto& column : mIntColumns) {
+    column.resize(ntracks);
+  }
+  masks.assign(ntracks, 0UL);
+  mKinematicMasks.assign(ntracks, 0UL);
 
-  auto filterBrickValueNoMask = [](auto brick, auto value) {
-    std::vector<bool> res = brick->Filter(value);
-    for (auto b : res) {
-      if (b) {
-        return true;
+  size_t itrack = 0;
+  for (auto const& track : tracks) {
+    mFloatColumns[kSign][itrack] = track.sign();
+    mFloatColumns[kChi2TPC][itrack] = track.tpcChi2NCl();
+    mFloatColumns[kChi2ITS][itrack] = track.itsChi2NCl();
+    mFloatColumns[kXRoFCTPC][itrack] = track.tpcCrossedRowsOverFindableCls();
+    mFloatColumns[kDcaXY][itrack] = track.dcaXY();
+    mFloatColumns[kDcaZ][itrack] = track.dcaZ();
+    mFloatColumns[kPt][itrack] = track.pt();
+    mFloatColumns[kEta][itrack] = track.eta();
+    mIntColumns[kNClsTPC][itrack] = track.tpcNClsFound();
+    mIntColumns[kNXRTPC][itrack] = track.tpcNClsCrossedRows();
+    mIntColumns[kNClsITS][itrack] = track.itsNCls();
+    int bit = mTrackTypesFirstBit;
+    for (int i = 0; i < mTrackTypes.GetEntries(); ++i) {
+      if (((TrackSelectionBrick*)mTrackTypes.UncheckedAt(i))->Filter(track)) {
+        SETBIT(masks[itrack], bit);
       }
+      bit++;
     }
-    return false;
-  };
-
-  for (int i = 0; i < mTrackSign.GetEntries(); ++i) {
-    filterBrickValue((CutBrick<float>*)mTrackSign.At(i), track.sign());
-  }
-  for (int i = 0; i < mTrackTypes.GetEntries(); ++i) {
-    filterTrackType((TrackSelectionBrick*)mTrackTypes.At(i), track);
-  }
-  if (mNClustersTPC != nullptr) {
-    filterBrickValue(mNClustersTPC, track.tpcNClsFound());
+    itrack++;
   }
-  if (mNCrossedRowsTPC != nullptr) {
-    filterBrickValue(mNCrossedRowsTPC, track.tpcNClsCrossedRows());
-  }
-  if (mNClustersITS != nullptr) {
-    filterBrickValue(mNClustersITS, track.itsNCls());
-  }
-  if (mMaxChi2PerClusterTPC != nullptr) {
-    filterBrickValue(mMaxChi2PerClusterTPC, track.tpcChi2NCl());
-  }
-  if (mMaxChi2PerClusterITS != nullptr) {
-    filterBrickValue(mMaxChi2PerClusterITS, track.itsChi2NCl());
-  }
-  if (mMinNCrossedRowsOverFindableClustersTPC != nullptr) {
-    filterBrickValue(mMinNCrossedRowsOverFindableClustersTPC, track.tpcCrossedRowsOverFindableCls());
-  }
-  if (mMaxDcaXY != nullptr) {
-    filterBrickValue(mMaxDcaXY, track.dcaXY());
-  }
-  if (mMaxDcaZ != nullptr) {
-    filterBrickValue(mMaxDcaZ, track.dcaZ());
+
+  const float* floatColumns[kNFloatVariables];
+  for (int i = 0; i < kNFloatVariables; ++i) {
+    floatColumns[i] = mFloatColumns[i].data();
   }
-  if (mPtRange != nullptr) {
-    if (not filterBrickValueNoMask(mPtRange, track.pt())) {
-      selectedMask = 0UL;
-    }
+  const int* intColumns[kNIntVariables];
+  for (int i = 0; i < kNIntVariables; ++i) {
+    intColumns[i] = mIntColumns[i].data();
   }
-  if (mEtaRange != nullptr) {
-    if (not filterBrickValueNoMask(mEtaRange, track.pt())) {
-      selectedMask = 0UL;
+  mFloatProgram.Filter(floatColumns, ntracks, masks.data());
+  mIntProgram.Filter(intColumns, ntracks, masks.data());
+  mKinematicProgram.Filter(floatColumns, ntracks, mKinematicMasks.data());
+  for (size_t i = 0; i < ntracks; ++i) {
+    if (not PassesKinematics(mKinematicMasks[i])) {
+      masks[i] = 0UL;
     }
   }
-  return mSelectedMask = selectedMask;
+  mSelectedMask = (ntracks > 0) ? masks[ntracks - 1] : 0UL;
 }
 
 } // namespace PWGCF
@@ -103,6 +103,8 @@ struct TwoParticleCorrelationsSkimming {
 #include "PWGCF/TwoParticleCorrelations/TableProducer/Productions/skimmingconf_20221115.cxx" // NOLINT
 
   int nReportedTracks;
+  std::vector<uint64_t> trkmasks; /// the track filter masks of the collision tracks
+  std::vector<uint64_t> pidmasks; /// the PID filter masks of the collision tracks
   int runNumber = 0;
   int bfield = 0;
   HistogramRegistry historeg;
@@ -225,9 +227,13 @@ struct TwoParticleCorrelationsSkimming {
       skimmedcollision(collision.posZ(), bc.runNumber(), bc.timestamp(), colmask, fFilterFramework->GetCollisionMultiplicities());
       int nFilteredTracks = 0;
       int nCollisionReportedTracks = 0;
+      fFilterFramework->FilterTracks(tracks, trkmasks);
+      fFilterFramework->FilterTracksPID(tracks, pidmasks);
+      int itrack = 0;
       for (auto const& track : tracks) {
-        auto trkmask = fFilterFramework->FilterTrack(track);
-        auto pidmask = fFilterFramework->FilterTrackPID(track);
+        auto trkmask = trkmasks[itrack];
+        auto pidmask = pidmasks[itrack];
+        itrack++;
         if (trkmask != 0UL) {
           skimmedtrack(skimmedcollision.lastIndex(), trkmask, track.pt(), track.eta(), track.phi());
           skimmtrackpid(pidmask);
@@ -262,9 +268,13 @@ struct TwoParticleCorrelationsSkimming {
       skimmedcollision(collision.posZ(), bc.runNumber(), bc.timestamp(), colmask, fFilterFramework->GetCollisionMultiplicities());
       int nFilteredTracks = 0;
       int nCollisionReportedTracks = 0;
+      fFilterFramework->FilterTracks(tracks, trkmasks);
+      fFilterFramework->FilterTracksPID(tracks, pidmasks);
+      int itrack = 0;
       for (auto const& track : tracks) {
-        auto trkmask = fFilterFramework->FilterTrack(track);
-        auto pidmask = fFilterFramework->FilterTrackPID(track);
+        auto trkmask = trkmasks[itrack];
+        auto pidmask = pidmasks[itrack];
+        itrack++;
         if (trkmask != 0UL) {
           skimmedtrack(skimmedcollision.lastIndex(), trkmask, track.pt(), track.eta(), track.phi());
           skimmtrackpid(pidmask);
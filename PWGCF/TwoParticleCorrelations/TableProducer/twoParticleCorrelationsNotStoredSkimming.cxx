@@ -231,6 +231,9 @@ struct TwoParticleCorrelationsTrackSkimming {
 
 #include "PWGCF/TwoParticleCorrelations/TableProducer/Productions/skimmingconf_20221115.cxx" // NOLINT
 
+  std::vector<uint64_t> trkmasks; /// the track filter masks of the time frame tracks
+  std::vector<uint64_t> pidmasks; /// the PID filter masks of the time frame tracks
+
   void init(InitContext const&)
   {
     using namespace cfskim;
@@ -266,21 +269,25 @@ struct TwoParticleCorrelationsTrackSkimming {
     trackmask.reserve(tracks.size());
     skimmtrackpid.reserve(tracks.size());
 
+    /* the whole table is filtered at once */
+    fFilterFramework->FilterTracks(tracks, trkmasks);
+    fFilterFramework->FilterTracksPID(tracks, pidmasks);
+
     int nfilteredtracks = 0;
+    int itrack = 0;
     for (auto const& track : tracks) {
       if (!track.has_collision()) {
         /* track not assigned to any collision */
         trackmask(0UL);
         skimmtrackpid(0UL);
       } else {
-        auto trkmask = fFilterFramework->FilterTrack(track);
-        auto pidmask = fFilterFramework->FilterTrackPID(track);
-        trackmask(trkmask);
-        skimmtrackpid(pidmask);
-        if (trkmask != 0UL) {
+        trackmask(trkmasks[itrack]);
+        skimmtrackpid(pidmasks[itrack]);
+        if (trkmasks[itrack] != 0UL) {
           nfilteredtracks++;
         }
       }
+      itrack++;
     }
     LOGF(info, "Filtered %d tracks out of %d", nfilteredtracks, tracks.size());
   }
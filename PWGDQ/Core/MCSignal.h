@@ -84,6 +84,14 @@ class MCSignal : public TNamed
   {
     return fProngs[0].fNGenerations;
   }
+  const MCProng& GetProng(int i) const
+  {
+    return fProngs[i];
+  }
+  short GetCommonAncestorIdx(int i) const
+  {
+    return (i < static_cast<int>(fCommonAncestorIdxs.size()) ? fCommonAncestorIdxs[i] : -1);
+  }
 
   template <typename U, typename... T>
   bool CheckSignal(bool checkSources, const U& mcStack, const T&... args)
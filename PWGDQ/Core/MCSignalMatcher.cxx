@@ -0,0 +1,200 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+#include "PWGDQ/Core/MCSignalMatcher.h"
+
+#include <algorithm>
+
+#include "Framework/Logger.h"
+
+//________________________________________________________________________________________________
+void MCSignalMatcher::Init(std::vector<MCSignal*> signals, bool checkSources)
+{
+  if (signals.size() > static_cast<size_t>(kMaxSignals)) {
+    LOG(warning) << "MCSignalMatcher: " << signals.size() << " signals requested, only the first " << kMaxSignals << " are checked";
+    signals.resize(kMaxSignals);
+  }
+  fCheckSources = checkSources;
+  fSignals.clear();
+  fProngs.clear();
+  fPDGTests.clear();
+  fPDGBitsCache.clear();
+  fMaxDepth = 1;
+
+  int nCompiled = 0;
+  for (auto* signal : signals) {
+    Signal sig{signal, signal->GetNProngs(), static_cast<int>(fProngs.size()), false};
+    sig.compiled = CompileSignal(sig);
+    nCompiled += sig.compiled;
+    fSignals.push_back(sig);
+  }
+  LOG(info) << "MCSignalMatcher: " << nCompiled << " out of " << fSignals.size() << " MC signals compiled, " << fPDGTests.size() << " PDG requirements, "
+            << fMaxDepth << " generations in the ancestry table";
+}
+
+//________________________________________________________________________________________________
+bool MCSignalMatcher::CompileSignal(Signal& sig)
+{
+  //
+  // translate the prongs of the signal into PDG test bits and source decision tables,
+  //   following the logic of MCSignal::CheckProng()
+  //
+  if (sig.nProngs < 1 || fProngs.size() + sig.nProngs > static_cast<size_t>(kMaxProngs)) {
+    return false;
+  }
+
+  std::vector<Prong> prongs;
+  for (int i = 0; i < sig.nProngs; i++) {
+    const MCProng& mcProng = sig.signal->GetProng(i);
+    if (mcProng.fCheckGenerationsInTime) {
+      return false;
+    }
+    Prong prong;
+    int sourceDepth = 0;
+    for (int j = 0; j < mcProng.fNGenerations; j++) {
+      Generation generation{AddPDGTest(mcProng, j), 0, 0xffff};
+      if (generation.pdgTest < 0) {
+        return false;
+      }
+      // NOTE: CheckProng() moves to the mother only after the generations with source requirements,
+      //       so the sources of generation j are tested on the ancestor given by the number of such generations before j
+      if (fCheckSources && mcProng.fSourceBits[j]) {
+        generation.sourceDepth = sourceDepth;
+        generation.sourceTable = SourceTable(mcProng.fSourceBits[j], mcProng.fExcludeSource[j], mcProng.fUseANDonSourceBitMap[j]);
+        sourceDepth++;
+      }
+      prong.generations.push_back(generation);
+    }
+    int depth = sig.signal->GetCommonAncestorIdx(i);
+    prong.commonAncestorDepth = (sig.nProngs > 1 && depth >= 0 && depth < mcProng.fNGenerations) ? depth : -1;
+    prongs.push_back(prong);
+  }
+
+  // the common ancestor of the other prongs is compared to the one of the first prong,
+  //   CheckSignal() would use the ancestor left over from a previous call if the first prong has none
+  if (prongs[0].commonAncestorDepth < 0) {
+    for (int i = 1; i < sig.nProngs; i++) {
+      if (prongs[i].commonAncestorDepth >= 0) {
+        return false;
+      }
+    }
+  }
+
+  for (auto& prong : prongs) {
+    fMaxDepth = std::max(fMaxDepth, static_cast<int>(prong.generations.size()));
+    fProngs.push_back(prong);
+  }
+  return true;
+}
+
+//________________________________________________________________________________________________
+int MCSignalMatcher::AddPDGTest(const MCProng& prong, int generation)
+{
+  const int pdg = prong.fPDGcodes[generation];
+  const bool checkBothCharges = prong.fCheckBothCharges[generation];
+  const bool exclude = prong.fExcludePDG[generation];
+  for (unsigned int i = 0; i < fPDGTests.size(); i++) {
+    if (fPDGTests[i].pdg == pdg && fPDGTests[i].checkBothCharges == checkBothCharges && fPDGTests[i].exclude == exclude) {
+      return i;
+    }
+  }
+  if (fPDGTests.size() >= static_cast<size_t>(kMaxPDGTests)) {
+    return -1;
+  }
+  fPDGTests.push_back({&prong, pdg, checkBothCharges, exclude});
+  return fPDGTests.size() - 1;
+}
+
+//________________________________________________________________________________________________
+uint16_t MCSignalMatcher::SourceTable(uint64_t sourceBits, uint64_t excludeSource, bool useANDonSourceBits)
+{
+  //
+  // evaluate the source requirement of one generation, as in MCSignal::CheckProng(), for all the combinations of source flags
+  //
+  uint16_t table = 0;
+  for (int flags = 0; flags < 16; flags++) {
+    uint64_t sourcesDecision = 0;
+    for (int source = 0; source < MCProng::kNSources; source++) {
+      if (!(sourceBits & (uint64_t(1) << source))) {
+        continue;
+      }
+      const bool flag = (flags >> source) & 1;
+      if ((excludeSource & (uint64_t(1) << source)) != static_cast<uint64_t>(flag)) {
+        sourcesDecision |= (uint64_t(1) << source);
+      }
+    }
+    if (!sourcesDecision || (useANDonSourceBits && sourcesDecision != sourceBits)) {
+      continue;
+    }
+    table |= (uint16_t(1) << flags);
+  }
+  return table;
+}
+
+//________________________________________________________________________________________________
+uint64_t MCSignalMatcher::GetPDGBits(int pdg)
+{
+  auto it = fPDGBitsCache.find(pdg);
+  if (it != fPDGBitsCache.end()) {
+    return it->second;
+  }
+  uint64_t bits = 0;
+  for (unsigned int i = 0; i < fPDGTests.size(); i++) {
+    const PDGTest& test = fPDGTests[i];
+    if (test.prong->ComparePDG(pdg, test.pdg, test.checkBothCharges, test.exclude)) {
+      bits |= (uint64_t(1) << i);
+    }
+  }
+  fPDGBitsCache[pdg] = bits;
+  return bits;
+}
+
+//________________________________________________________________________________________________
+void MCSignalMatcher::FillAncestors()
+{
+  const int64_t n = fNParticles;
+  fAncestors.resize(n * fMaxDepth);
+  fComplete.assign(n, 1);
+  for (int64_t i = 0; i < n; i++) {
+    fAncestors[i * fMaxDepth] = i;
+  }
+  for (int depth = 1; depth < fMaxDepth; depth++) {
+    for (int64_t i = 0; i < n; i++) {
+      const int64_t previous = fAncestors[i * fMaxDepth + depth - 1];
+      fAncestors[i * fMaxDepth + depth] = (previous < 0 ? previous : fMothers[previous]);
+    }
+  }
+  for (int64_t i = 0; i < n; i++) {
+    fComplete[i] = (fAncestors[i * fMaxDepth + fMaxDepth - 1] != kOutsideStack);
+  }
+
+  // decisions of all the compiled prongs for each particle
+  fProngBits.assign(n, 0);
+  for (unsigned int ip = 0; ip < fProngs.size(); ip++) {
+    const Prong& prong = fProngs[ip];
+    const uint64_t prongBit = uint64_t(1) << ip;
+    for (int64_t i = 0; i < n; i++) {
+      const int64_t* ancestors = &fAncestors[i * fMaxDepth];
+      bool decision = true;
+      for (unsigned int j = 0; j < prong.generations.size() && decision; j++) {
+        const int64_t particle = ancestors[j];
+        decision = (particle >= 0) && ((fPDGBits[particle] >> prong.generations[j].pdgTest) & uint64_t(1));
+      }
+      for (unsigned int j = 0; j < prong.generations.size() && decision; j++) {
+        const Generation& generation = prong.generations[j];
+        decision = (generation.sourceTable >> fSourceFlags[ancestors[generation.sourceDepth]]) & 1;
+      }
+      if (decision) {
+        fProngBits[i] |= prongBit;
+      }
+    }
+  }
+}
@@ -0,0 +1,225 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//
+// Contact: iarsene@cern.ch, i.c.arsene@fys.uio.no
+//
+/* Precompiled matching of a list of MC signals (see MCSignal.h)
+
+The MCSignal::CheckSignal() walks the mother chain of every prong, for every signal and every particle or tuple of particles.
+The matcher instead builds once per MC stack (time frame, or MC event slice) an ancestry table with the index of the ancestors of
+each particle up to the largest number of generations of the signals, together with a bit map of the PDG requirements fulfilled
+by each particle and its source bits. The prong requirements of all signals are then evaluated for all particles in one pass,
+and a signal is matched with a few bit tests and a comparison of the common ancestor indices.
+
+The decisions are the same as the ones of MCSignal::CheckSignal(). Signals which cannot be compiled (prongs with generations checked
+in time, a common ancestor specified only for prongs other than the first one, too many prongs or PDG requirements) and particles whose
+history leaves the stack used for the build are checked with MCSignal::CheckSignal().
+
+Example usage:
+
+  init() {
+    fMatcher.Init({&fSignals[0], &fSignals[1]}, true);
+  }
+  process(aod::McParticles const& mcTracks) {
+    fMatcher.Build(mcTracks);
+    for (auto& mctrack : mcTracks) {
+      uint64_t decisions = fMatcher.CheckSignals(mcTracks, mctrack); // bit i set if signal i is matched
+    }
+  }
+*/
+#ifndef MCSignalMatcher_H
+#define MCSignalMatcher_H
+
+#include "PWGDQ/Core/MCSignal.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class MCSignalMatcher
+{
+ public:
+  static constexpr int kMaxSignals = 64;
+  static constexpr int kMaxProngs = 64;   // total number of prongs of the compiled signals
+  static constexpr int kMaxPDGTests = 64; // number of distinct PDG requirements of the compiled signals
+
+  MCSignalMatcher() = default;
+  ~MCSignalMatcher() = default;
+
+  // the signals are not copied and must outlive the matcher; checkSources has the same meaning as in MCSignal::CheckSignal()
+  void Init(std::vector<MCSignal*> signals, bool checkSources);
+
+  int GetNSignals() const
+  {
+    return fSignals.size();
+  }
+  bool IsCompiled(int isig) const
+  {
+    return fSignals[isig].compiled;
+  }
+
+  // build the ancestry table for an MC stack (full table or a contiguous slice of it)
+  template <typename U>
+  void Build(const U& mcStack);
+
+  // returns a bit map with bit i set if the particles match the i-th signal
+  template <typename U, typename... T>
+  uint64_t CheckSignals(const U& mcStack, const T&... particles);
+
+ private:
+  static constexpr int64_t kNoMother = -1;
+  static constexpr int64_t kOutsideStack = -2;
+
+  // PDG requirement of one generation, shared by all the generations with the same code and options
+  struct PDGTest {
+    const MCProng* prong;
+    int pdg;
+    bool checkBothCharges;
+    bool exclude;
+  };
+  struct Generation {
+    int pdgTest;          // bit in the PDG bit map of the particles
+    int sourceDepth;      // generation whose sources are tested, see MCSignal::CheckProng()
+    uint16_t sourceTable; // decision for each of the 16 combinations of the source flags
+  };
+  struct Prong {
+    std::vector<Generation> generations;
+    int commonAncestorDepth;
+  };
+  struct Signal {
+    MCSignal* signal;
+    int nProngs;
+    int firstProng; // index of the first prong in fProngs
+    bool compiled;
+  };
+
+  bool CompileSignal(Signal& sig);
+  int AddPDGTest(const MCProng& prong, int generation);
+  static uint16_t SourceTable(uint64_t sourceBits, uint64_t excludeSource, bool useANDonSourceBits);
+  uint64_t GetPDGBits(int pdg);
+  void FillAncestors(); // fills the ancestors and the prong decisions once the particle columns are filled
+
+  template <typename T>
+  int64_t GetRow(const T& particle) const
+  {
+    int64_t row = particle.globalIndex() - fOffset;
+    if (row < 0 || row >= fNParticles || !fComplete[row]) {
+      return -1;
+    }
+    return row;
+  }
+
+  bool fCheckSources = false;
+  std::vector<Signal> fSignals;
+  std::vector<Prong> fProngs;
+  std::vector<PDGTest> fPDGTests;
+  int fMaxDepth = 1;
+  std::unordered_map<int, uint64_t> fPDGBitsCache;
+
+  // per particle columns, indexed by globalIndex() - fOffset
+  int64_t fOffset = 0;
+  int64_t fNParticles = 0;
+  std::vector<uint64_t> fPDGBits;
+  std::vector<uint8_t> fSourceFlags; // MCProng::Source bits fulfilled by the particle
+  std::vector<int64_t> fMothers;
+  std::vector<int64_t> fAncestors; // fMaxDepth entries per particle, the particle itself first
+  std::vector<uint8_t> fComplete;  // false if the history leaves the stack
+  std::vector<uint64_t> fProngBits;
+};
+
+//________________________________________________________________________________________________
+template <typename U>
+void MCSignalMatcher::Build(const U& mcStack)
+{
+  fNParticles = mcStack.size();
+  fOffset = 0;
+  fPDGBits.resize(fNParticles);
+  fSourceFlags.resize(fNParticles);
+  fMothers.resize(fNParticles);
+
+  int64_t row = 0;
+  for (auto& particle : mcStack) {
+    if (row == 0) {
+      fOffset = particle.globalIndex();
+    }
+    fPDGBits[row] = GetPDGBits(particle.pdgCode());
+    uint8_t flags = 0;
+    if (particle.isPhysicalPrimary()) {
+      flags |= (uint8_t(1) << MCProng::kPhysicalPrimary);
+    }
+    if (particle.producedByGenerator()) {
+      flags |= (uint8_t(1) << MCProng::kProducedByGenerator);
+    } else {
+      flags |= (uint8_t(1) << MCProng::kProducedInTransport);
+    }
+    if (particle.fromBackgroundEvent()) {
+      flags |= (uint8_t(1) << MCProng::kFromBackgroundEvent);
+    }
+    fSourceFlags[row] = flags;
+    // the mother indices are global indices, the first mother is the one followed by MCSignal::CheckProng()
+    fMothers[row] = particle.has_mothers() ? particle.mothersIds()[0] : kNoMother;
+    row++;
+  }
+  for (auto& mother : fMothers) {
+    if (mother != kNoMother) {
+      mother -= fOffset;
+      if (mother < 0 || mother >= fNParticles) {
+        mother = kOutsideStack;
+      }
+    }
+  }
+  FillAncestors();
+}
+
+//________________________________________________________________________________________________
+template <typename U, typename... T>
+uint64_t MCSignalMatcher::CheckSignals(const U& mcStack, const T&... particles)
+{
+  constexpr int nProngs = sizeof...(particles);
+  const int64_t rows[nProngs] = {GetRow(particles)...};
+  bool inStack = true;
+  for (int i = 0; i < nProngs; i++) {
+    inStack = inStack && (rows[i] >= 0);
+  }
+
+  uint64_t decisions = 0;
+  for (unsigned int isig = 0; isig < fSignals.size(); isig++) {
+    const Signal& sig = fSignals[isig];
+    if (sig.nProngs != nProngs) {
+      continue;
+    }
+    if (!sig.compiled || !inStack) {
+      if (sig.signal->CheckSignal(fCheckSources, mcStack, particles...)) {
+        decisions |= (uint64_t(1) << isig);
+      }
+      continue;
+    }
+    bool matched = true;
+    for (int i = 0; i < nProngs && matched; i++) {
+      matched = (fProngBits[rows[i]] >> (sig.firstProng + i)) & uint64_t(1);
+    }
+    // the common ancestor is defined by the first prong, the others must point to the same particle
+    const int ancestorDepth = fProngs[sig.firstProng].commonAncestorDepth;
+    if (matched && nProngs > 1 && ancestorDepth >= 0) {
+      const int64_t ancestor = fAncestors[rows[0] * fMaxDepth + ancestorDepth];
+      for (int i = 1; i < nProngs && matched; i++) {
+        const int depth = fProngs[sig.firstProng + i].commonAncestorDepth;
+        matched = (depth < 0 || fAncestors[rows[i] * fMaxDepth + depth] == ancestor);
+      }
+    }
+    if (matched) {
+      decisions |= (uint64_t(1) << isig);
+    }
+  }
+  return decisions;
+}
+
+#endif
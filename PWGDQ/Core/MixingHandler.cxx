@@ -12,6 +12,8 @@
 #include "PWGDQ/Core/MixingHandler.h"
 #include "PWGDQ/Core/VarManager.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 using namespace std;
@@ -63,6 +65,7 @@ void MixingHandler::AddMixingVariable(int var, int nBins, float* binLims)
   varBins.Set(nBins, binLims);
   fVariableLimits.push_back(varBins);
   VarManager::SetUseVariable(var);
+  fIsInitialized = kFALSE; // the lookup tables must be rebuilt
 }
 
 //_________________________________________________________________________
@@ -110,12 +113,28 @@ void MixingHandler::Init()
   //
   // Initialization of pools
   //       The correct event category will be retrieved using the function FindEventCategory()
+  //       The bin limits are copied into flat lookup tables, with the category strides of each variable
   //
-  int size = 1;
-  for (auto v : fVariableLimits) {
-    size *= (v.GetSize() - 1);
+  const int nVars = fVariableLimits.size();
+  fLimits.assign(nVars, {});
+  fBinWidths.assign(nVars, 0.0);
+  fStrides.assign(nVars, 1);
+  for (int iVar = 0; iVar < nVars; ++iVar) {
+    const TArrayF& limits = fVariableLimits[iVar];
+    fLimits[iVar].assign(limits.GetArray(), limits.GetArray() + limits.GetSize());
+    const int nBins = limits.GetSize() - 1;
+    if (nBins > 0) {
+      const float width = (limits[nBins] - limits[0]) / nBins;
+      bool equidistant = (width > 0.0);
+      for (int iBin = 0; iBin < nBins && equidistant; ++iBin) {
+        equidistant = std::abs(limits[iBin + 1] - limits[iBin] - width) < 1.0e-5 * width;
+      }
+      fBinWidths[iVar] = (equidistant ? width : 0.0);
+    }
+  }
+  for (int iVar = nVars - 2; iVar >= 0; --iVar) {
+    fStrides[iVar] = fStrides[iVar + 1] * (fVariableLimits[iVar + 1].GetSize() - 1);
   }
-  (void)size;
   fIsInitialized = kTRUE;
 }
 
@@ -132,31 +151,28 @@ int MixingHandler::FindEventCategory(float* values)
     Init();
   }
 
-  std::vector<int> bin;
-  int iVar = 0;
-  for (auto v = fVariableLimits.begin(); v != fVariableLimits.end(); v++, iVar++) {
-    int binValue = TMath::BinarySearch((*v).GetSize(), (*v).GetArray(), values[fVariables[iVar]]);
-    bin.push_back(binValue);
-    if (bin[iVar] == -1 || bin[iVar] == (*v).GetSize() - 1) {
+  int category = 0;
+  for (unsigned int iVar = 0; iVar < fVariables.size(); ++iVar) {
+    const std::vector<float>& limits = fLimits[iVar];
+    const float value = values[fVariables[iVar]];
+    if (!(value >= limits.front() && value < limits.back())) {
       return -1; // all variables must be inside limits
     }
-  }
-
-  int category = 0;
-  int tempCategory = 1;
-  int iv1 = 0;
-  int iv2 = 0;
-  for (auto v1 = fVariables.begin(); v1 != fVariables.end(); v1++, iv1++) {
-    tempCategory = 1;
-    iv2 = iv1;
-    for (auto v2 = v1; v2 != fVariables.end(); v2++, iv2++) {
-      if (iv2 == iv1) {
-        tempCategory *= bin[iv2];
-      } else {
-        tempCategory *= (fVariableLimits[iv2].GetSize() - 1);
+    const int nBins = limits.size() - 1;
+    int bin = 0;
+    if (fBinWidths[iVar] > 0.0) {
+      // equidistant limits: direct computation, corrected for the rounding at the bin edges
+      bin = std::clamp(static_cast<int>((value - limits[0]) / fBinWidths[iVar]), 0, nBins - 1);
+      while (bin > 0 && value < limits[bin]) {
+        bin--;
+      }
+      while (bin < nBins - 1 && value >= limits[bin + 1]) {
+        bin++;
       }
+    } else {
+      bin = std::upper_bound(limits.begin(), limits.end(), value) - limits.begin() - 1;
     }
-    category += tempCategory;
+    category += bin * fStrides[iVar];
   }
   return category;
 }
@@ -24,6 +24,8 @@
 #include <TList.h>
 #include <TString.h>
 
+#include <vector>
+
 #include "PWGDQ/Core/HistogramManager.h"
 #include "PWGDQ/Core/VarManager.h"
 
@@ -58,6 +60,11 @@ class MixingHandler : public TNamed
   std::vector<TArrayF> fVariableLimits;
   std::vector<int> fVariables;
 
+  // flat lookup tables, filled by Init()
+  std::vector<std::vector<float>> fLimits; //! bin limits of each variable
+  std::vector<float> fBinWidths;           //! bin width of the variables with equidistant limits, 0 otherwise
+  std::vector<int> fStrides;               //! category increment for one bin of each variable
+
   ClassDef(MixingHandler, 1);
 };
 
@@ -17,7 +17,13 @@
 // The skimming can optionally produce just the barrel, muon, or both barrel and muon tracks
 // The event filtering (filterPP), centrality, and V0Bits (from v0-selector) can be switched on/off by selecting one
 //  of the process functions
+#include <array>
+#include <atomic>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <vector>
+#include "TROOT.h"
 #include "Framework/AnalysisTask.h"
 #include "Framework/AnalysisDataModel.h"
 #include "Framework/ASoAHelpers.h"
@@ -30,6 +36,7 @@
 #include "Common/CCDB/TriggerAliases.h"
 #include "Common/DataModel/PIDResponse.h"
 #include "Common/DataModel/TrackSelectionTables.h"
+#include "Common/Core/WorkerPool.h"
 #include "PWGDQ/DataModel/ReducedInfoTables.h"
 #include "PWGDQ/Core/VarManager.h"
 #include "PWGDQ/Core/HistogramManager.h"
@@ -138,6 +145,7 @@ struct TableMaker {
   Configurable<bool> fConfigComputeTPCpostCalib{"cfgTPCpostCalib", false, "If true, compute TPC post-calibrated n-sigmas"};
   Configurable<std::string> fConfigRunPeriods{"cfgRunPeriods", "LHC22f", "run periods for used data"};
   Configurable<bool> fConfigIsOnlyforMaps{"cfgIsforMaps", false, "If true, run for postcalibration maps only"};
+  Configurable<int> fConfigNThreads{"cfgNThreads", 1, "Number of threads of the skimming in the process*Parallel functions (at most the number of hardware threads, a single thread if histograms are filled)"};
 
   Service<o2::ccdb::BasicCCDBManager> fCCDB;
 
@@ -145,6 +153,50 @@ struct TableMaker {
   std::vector<AnalysisCompositeCut> fTrackCuts; //! Barrel track cuts
   std::vector<AnalysisCompositeCut> fMuonCuts;  //! Muon track cuts
 
+  static constexpr int kNoMatch = std::numeric_limits<int>::min();
+
+  // Decisions of the skimming for one collision and for each of its tracks and muons,
+  // computed by skimCollision() and written to the tables by writeCollision()
+  struct SkimmedCollision {
+    bool selected = false;
+    uint64_t tag = 0;
+    uint32_t triggerAliases = 0;
+    float centVZERO = 0.f;
+  };
+  struct SkimmedTrack {
+    uint64_t filteringTag = 0; // 0 if the track is not written
+    int isAmbiguous = 0;
+    float tpcNSigmaEl = 0.f; // TPC n-sigmas as written in the tables, i.e. post-calibrated if requested
+    float tpcNSigmaPi = 0.f;
+    float tpcNSigmaPr = 0.f;
+  };
+  struct SkimmedMuon {
+    uint64_t filteringTag = 0; // 0 if the muon is not written
+    int isAmbiguous = 0;
+    int matchIndex = kNoMatch; // MCH-MFT match, relative to the first muon written for the collision
+  };
+  // Counters of the statistics histograms, added to the histograms by flushStats()
+  struct SkimStats {
+    std::array<std::array<int, kNaliases + 1>, 2> events{}; // before and after the event cut
+    std::vector<int> tracks;
+    std::vector<int> muons;
+  };
+  // Value buffer, cuts and statistics of one thread of the skimming; worker 0 is also used by the skimming per collision
+  struct SkimWorker {
+    std::vector<float> values;
+    AnalysisCompositeCut* eventCut = nullptr;
+    std::vector<AnalysisCompositeCut> trackCuts;
+    std::vector<AnalysisCompositeCut> muonCuts;
+    SkimStats stats;
+  };
+  std::vector<SkimWorker> fSkimWorkers;
+  o2::analysis::WorkerPool fSkimPool; // one thread per entry of fSkimWorkers, started in init()
+  std::vector<SkimmedCollision> fSkimmedCollisions;
+  std::vector<SkimmedTrack> fSkimmedTracks;
+  std::vector<SkimmedMuon> fSkimmedMuons;
+  std::vector<int64_t> fTrackOffsets; // first entry of each collision in fSkimmedTracks, for the parallel skimming
+  std::vector<int64_t> fMuonOffsets;  // first entry of each collision in fSkimmedMuons, for the parallel skimming
+
   Preslice<MyBarrelTracks> perCollisionTracks = aod::track::collisionId;
   Preslice<MyMuons> perCollisionMuons = aod::fwdtrack::collisionId;
 
@@ -185,14 +237,18 @@ struct TableMaker {
                                context.mOptions.get<bool>("processBarrelOnlyWithCov") || context.mOptions.get<bool>("processBarrelOnlyWithEventFilter") ||
                                context.mOptions.get<bool>("processBarrelOnlyWithCovAndEventFilter") ||
                                context.mOptions.get<bool>("processBarrelOnlyWithDalitzBits") || context.mOptions.get<bool>("processBarrelOnlyWithV0Bits") ||
-                               context.mOptions.get<bool>("processBarrelOnlyWithV0BitsAndMaps") || context.mOptions.get<bool>("processAmbiguousBarrelOnly"));
+                               context.mOptions.get<bool>("processBarrelOnlyWithV0BitsAndMaps") || context.mOptions.get<bool>("processAmbiguousBarrelOnly") ||
+                               context.mOptions.get<bool>("processFullParallel") || context.mOptions.get<bool>("processFullWithCovParallel") ||
+                               context.mOptions.get<bool>("processBarrelOnlyParallel") || context.mOptions.get<bool>("processBarrelOnlyWithCovParallel"));
     bool enableMuonHistos = (context.mOptions.get<bool>("processFull") || context.mOptions.get<bool>("processFullWithCov") ||
                              context.mOptions.get<bool>("processFullWithCent") || context.mOptions.get<bool>("processFullWithCovAndEventFilter") ||
                              context.mOptions.get<bool>("processMuonOnly") || context.mOptions.get<bool>("processMuonOnlyWithCent") ||
                              context.mOptions.get<bool>("processMuonOnlyWithMults") || context.mOptions.get<bool>("processMuonOnlyWithCentAndMults") ||
                              context.mOptions.get<bool>("processMuonOnlyWithCovAndCent") ||
                              context.mOptions.get<bool>("processMuonOnlyWithCov") || context.mOptions.get<bool>("processMuonOnlyWithFilter") ||
-                             context.mOptions.get<bool>("processAmbiguousMuonOnlyWithCov") || context.mOptions.get<bool>("processAmbiguousMuonOnly"));
+                             context.mOptions.get<bool>("processAmbiguousMuonOnlyWithCov") || context.mOptions.get<bool>("processAmbiguousMuonOnly") ||
+                             context.mOptions.get<bool>("processFullParallel") || context.mOptions.get<bool>("processFullWithCovParallel") ||
+                             context.mOptions.get<bool>("processMuonOnlyParallel") || context.mOptions.get<bool>("processMuonOnlyWithCovParallel"));
 
     if (enableBarrelHistos) {
       if (fDoDetailedQA) {
@@ -240,6 +296,19 @@ struct TableMaker {
     VarManager::SetUseVars(fHistMan->GetUsedVars()); // provide the list of required variables so that VarManager knows what to fill
     fOutputList.setObject(fHistMan->GetMainHistogramList());
 
+    // The histogram manager is not thread-safe: with histograms, the parallel skimming runs on a single thread
+    int nSkimWorkers = fConfigNThreads.value;
+    if (nSkimWorkers > 1 && !histClasses.IsNull()) {
+      LOG(warning) << "Histograms are filled, the skimming runs on a single thread";
+      nSkimWorkers = 1;
+    }
+    nSkimWorkers = fSkimPool.init(nSkimWorkers);
+    LOGF(info, "Skimming with %d thread(s) in the process*Parallel functions", nSkimWorkers);
+    if (nSkimWorkers > 1) {
+      ROOT::EnableThreadSafety();
+    }
+    DefineSkimWorkers(nSkimWorkers);
+
     // CCDB configuration
     if (fConfigComputeTPCpostCalib) {
       fCCDB->setURL(fConfigCcdbUrl.value);
@@ -251,18 +320,24 @@ struct TableMaker {
   }
 
   void DefineCuts()
+  {
+    AddCuts(fEventCut, fTrackCuts, fMuonCuts);
+    VarManager::SetUseVars(AnalysisCut::fgUsedVars); // provide the list of required variables so that VarManager knows what to fill
+  }
+
+  void AddCuts(AnalysisCompositeCut*& eventCut, std::vector<AnalysisCompositeCut>& trackCuts, std::vector<AnalysisCompositeCut>& muonCuts)
   {
     // Event cuts
-    fEventCut = new AnalysisCompositeCut(true);
+    eventCut = new AnalysisCompositeCut(true);
     TString eventCutStr = fConfigEventCuts.value;
-    fEventCut->AddCut(dqcuts::GetAnalysisCut(eventCutStr.Data()));
+    eventCut->AddCut(dqcuts::GetAnalysisCut(eventCutStr.Data()));
 
     // Barrel track cuts
     TString cutNamesStr = fConfigTrackCuts.value;
     if (!cutNamesStr.IsNull()) {
       std::unique_ptr<TObjArray> objArray(cutNamesStr.Tokenize(","));
       for (int icut = 0; icut < objArray->GetEntries(); ++icut) {
-        fTrackCuts.push_back(*dqcuts::GetCompositeCut(objArray->At(icut)->GetName()));
+        trackCuts.push_back(*dqcuts::GetCompositeCut(objArray->At(icut)->GetName()));
       }
     }
 
@@ -271,18 +346,34 @@ struct TableMaker {
     if (!cutNamesStr.IsNull()) {
       std::unique_ptr<TObjArray> objArray(cutNamesStr.Tokenize(","));
       for (int icut = 0; icut < objArray->GetEntries(); ++icut) {
-        fMuonCuts.push_back(*dqcuts::GetCompositeCut(objArray->At(icut)->GetName()));
+        muonCuts.push_back(*dqcuts::GetCompositeCut(objArray->At(icut)->GetName()));
       }
     }
+  }
 
-    VarManager::SetUseVars(AnalysisCut::fgUsedVars); // provide the list of required variables so that VarManager knows what to fill
+  // Creates the workers of the skimming. Each thread gets its own instances of the cuts from the cut library,
+  // as the cuts (and their TF1 limits) are not meant to be evaluated concurrently
+  void DefineSkimWorkers(int nWorkers)
+  {
+    fSkimWorkers.resize(nWorkers);
+    for (int iWorker = 0; iWorker < nWorkers; iWorker++) {
+      auto& worker = fSkimWorkers[iWorker];
+      if (iWorker == 0) {
+        worker.eventCut = fEventCut;
+        worker.trackCuts = fTrackCuts;
+        worker.muonCuts = fMuonCuts;
+      } else {
+        AddCuts(worker.eventCut, worker.trackCuts, worker.muonCuts);
+      }
+      worker.values.assign(VarManager::kNVars, 0.f);
+      worker.stats.tracks.assign(fTrackCuts.size() + 5, 0);
+      worker.stats.muons.assign(fMuonCuts.size(), 0);
+    }
   }
 
-  // Templated function instantianed for all of the process functions
-  template <uint32_t TEventFillMap, uint32_t TTrackFillMap, uint32_t TMuonFillMap, typename TEvent, typename TTracks, typename TMuons, typename TAmbiTracks, typename TAmbiMuons>
-  void fullSkimming(TEvent const& collision, aod::BCsWithTimestamps const&, TTracks const& tracksBarrel, TMuons const& tracksMuon, TAmbiTracks const& ambiTracksMid, TAmbiMuons const& ambiTracksFwd)
+  // Updates the TPC post-calibration maps of the VarManager when the run changes
+  void updateTPCPostCalib(aod::BCsWithTimestamps::iterator const& bc)
   {
-    auto bc = collision.template bc_as<aod::BCsWithTimestamps>();
     if (fConfigComputeTPCpostCalib && fCurrentRun != bc.runNumber()) {
       auto calibList = fCCDB->getForTimeStamp<TList>(fConfigCcdbPathTPC.value, bc.timestamp());
       VarManager::SetCalibrationObject(VarManager::kTPCElectronMean, calibList->FindObject("mean_map_electron"));
@@ -293,6 +384,41 @@ struct TableMaker {
       VarManager::SetCalibrationObject(VarManager::kTPCProtonSigma, calibList->FindObject("sigma_map_proton"));
       fCurrentRun = bc.runNumber();
     }
+  }
+
+  // Adds the counters of a worker to the statistics histograms and resets them
+  void flushStats(SkimStats& stats)
+  {
+    for (int iStep = 0; iStep < 2; iStep++) {
+      for (int i = 0; i <= kNaliases; i++) {
+        if (stats.events[iStep][i] > 0) {
+          (reinterpret_cast<TH2I*>(fStatsList->At(0)))->Fill(2.0 + iStep, static_cast<float>(i), stats.events[iStep][i]);
+          stats.events[iStep][i] = 0;
+        }
+      }
+    }
+    for (size_t i = 0; i < stats.tracks.size(); i++) {
+      if (stats.tracks[i] > 0) {
+        (reinterpret_cast<TH1I*>(fStatsList->At(1)))->Fill(static_cast<float>(i), stats.tracks[i]);
+        stats.tracks[i] = 0;
+      }
+    }
+    for (size_t i = 0; i < stats.muons.size(); i++) {
+      if (stats.muons[i] > 0) {
+        (reinterpret_cast<TH1I*>(fStatsList->At(2)))->Fill(static_cast<float>(i), stats.muons[i]);
+        stats.muons[i] = 0;
+      }
+    }
+  }
+
+  // Computes the event, track and muon selections of one collision with the value buffer and cuts of a worker.
+  // Only the decisions are stored (one entry per track and per muon of the collision), the tables are written by writeCollision()
+  template <uint32_t TEventFillMap, uint32_t TTrackFillMap, uint32_t TMuonFillMap, typename TEvent, typename TTracks, typename TMuons, typename TAmbiTracks, typename TAmbiMuons>
+  void skimCollision(TEvent const& collision, aod::BCsWithTimestamps::iterator const& bc, TTracks const& tracksBarrel, TMuons const& tracksMuon, TAmbiTracks const& ambiTracksMid, TAmbiMuons const& ambiTracksFwd,
+                     SkimWorker& worker, SkimmedCollision& skimmedCollision, SkimmedTrack* skimmedTracks, SkimmedMuon* skimmedMuons)
+  {
+    float* values = worker.values.data();
+    skimmedCollision = SkimmedCollision{};
 
     // get the trigger aliases
     uint32_t triggerAliases = 0;
@@ -313,73 +439,56 @@ struct TableMaker {
     }
     // TODO: Add the event level decisions from the filtering task into the tag
 
-    VarManager::ResetValues(0, VarManager::kNEventWiseVariables);
+    VarManager::ResetValues(0, VarManager::kNEventWiseVariables, values);
     // TODO: These variables cannot be filled in the VarManager for the moment as long as BCsWithTimestamps are used.
     //       So temporarily, we filled them here, in order to be available for eventual QA of the skimming
-    VarManager::fgValues[VarManager::kRunNo] = bc.runNumber();
-    VarManager::fgValues[VarManager::kBC] = bc.globalBC();
-    VarManager::fgValues[VarManager::kTimestamp] = bc.timestamp();
-    VarManager::fgValues[VarManager::kRunIndex] = VarManager::GetRunIndex(bc.runNumber());
-    VarManager::FillEvent<TEventFillMap>(collision); // extract event information and place it in the fValues array
+    values[VarManager::kRunNo] = bc.runNumber();
+    values[VarManager::kBC] = bc.globalBC();
+    values[VarManager::kTimestamp] = bc.timestamp();
+    values[VarManager::kRunIndex] = VarManager::GetRunIndex(bc.runNumber());
+    VarManager::FillEvent<TEventFillMap>(collision, values); // extract event information and place it in the values array
     if (fDoDetailedQA) {
-      fHistMan->FillHistClass("Event_BeforeCuts", VarManager::fgValues);
+      fHistMan->FillHistClass("Event_BeforeCuts", values);
     }
 
     // fill stats information, before selections
     for (int i = 0; i < kNaliases; i++) {
       if (triggerAliases & (uint32_t(1) << i)) {
-        (reinterpret_cast<TH2I*>(fStatsList->At(0)))->Fill(2.0, static_cast<float>(i));
+        worker.stats.events[0][i]++;
       }
     }
-    (reinterpret_cast<TH2I*>(fStatsList->At(0)))->Fill(2.0, static_cast<float>(kNaliases));
+    worker.stats.events[0][kNaliases]++;
 
-    if (!fEventCut->IsSelected(VarManager::fgValues)) {
+    if (!worker.eventCut->IsSelected(values)) {
       return;
     }
 
     // fill stats information, after selections
     for (int i = 0; i < kNaliases; i++) {
       if (triggerAliases & (uint32_t(1) << i)) {
-        (reinterpret_cast<TH2I*>(fStatsList->At(0)))->Fill(3.0, static_cast<float>(i));
+        worker.stats.events[1][i]++;
       }
     }
-    (reinterpret_cast<TH2I*>(fStatsList->At(0)))->Fill(3.0, static_cast<float>(kNaliases));
-
-    fHistMan->FillHistClass("Event_AfterCuts", VarManager::fgValues);
+    worker.stats.events[1][kNaliases]++;
 
-    // create the event tables
-    event(tag, bc.runNumber(), collision.posX(), collision.posY(), collision.posZ(), collision.numContrib(), collision.collisionTime(), collision.collisionTimeRes());
-    if constexpr ((TEventFillMap & VarManager::ObjTypes::CollisionMult) > 0 && (TEventFillMap & VarManager::ObjTypes::CollisionCent) > 0) {
-      eventExtended(bc.globalBC(), bc.triggerMask(), bc.timestamp(), triggerAliases, VarManager::fgValues[VarManager::kCentVZERO],
-                    collision.multTPC(), collision.multFV0A(), collision.multFV0C(), collision.multFT0A(), collision.multFT0C(),
-                    collision.multFDDA(), collision.multFDDC(), collision.multZNA(), collision.multZNC(), collision.multTracklets(), collision.multNTracksPV(),
-                    collision.centFT0C());
-    } else if constexpr ((TEventFillMap & VarManager::ObjTypes::CollisionMult) > 0) {
-      eventExtended(bc.globalBC(), bc.triggerMask(), bc.timestamp(), triggerAliases, VarManager::fgValues[VarManager::kCentVZERO],
-                    collision.multTPC(), collision.multFV0A(), collision.multFV0C(), collision.multFT0A(), collision.multFT0C(),
-                    collision.multFDDA(), collision.multFDDC(), collision.multZNA(), collision.multZNC(), collision.multTracklets(), collision.multNTracksPV(),
-                    -1);
-    } else if constexpr ((TEventFillMap & VarManager::ObjTypes::CollisionCent) > 0) {
-      eventExtended(bc.globalBC(), bc.triggerMask(), bc.timestamp(), triggerAliases, VarManager::fgValues[VarManager::kCentVZERO],
-                    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, collision.centFT0C());
-    } else {
-      eventExtended(bc.globalBC(), bc.triggerMask(), bc.timestamp(), triggerAliases, VarManager::fgValues[VarManager::kCentVZERO], -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    if (fConfigQA) {
+      fHistMan->FillHistClass("Event_AfterCuts", values);
     }
-    eventVtxCov(collision.covXX(), collision.covXY(), collision.covXZ(), collision.covYY(), collision.covYZ(), collision.covZZ(), collision.chi2());
+
+    skimmedCollision.selected = true;
+    skimmedCollision.tag = tag;
+    skimmedCollision.triggerAliases = triggerAliases;
+    skimmedCollision.centVZERO = values[VarManager::kCentVZERO];
 
     uint64_t trackFilteringTag = 0;
     uint8_t trackTempFilterMap = 0;
     int isAmbiguous = 0;
     if constexpr (static_cast<bool>(TTrackFillMap)) {
-      trackBasic.reserve(tracksBarrel.size());
-      trackBarrel.reserve(tracksBarrel.size());
-      if constexpr (static_cast<bool>(TTrackFillMap & VarManager::ObjTypes::TrackCov)) {
-        trackBarrelCov.reserve(tracksBarrel.size());
-      }
-      trackBarrelPID.reserve(tracksBarrel.size());
-
       // loop over tracks
+      int iTrack = 0;
       for (auto& track : tracksBarrel) {
+        auto& skimmedTrack = skimmedTracks[iTrack++];
+        skimmedTrack = SkimmedTrack{};
         if constexpr ((TTrackFillMap & VarManager::ObjTypes::AmbiTrack) > 0) {
           if (fIsAmbiguous) {
             isAmbiguous = 0;
@@ -394,26 +503,26 @@ struct TableMaker {
 
         trackFilteringTag = uint64_t(0);
         trackTempFilterMap = uint8_t(0);
-        VarManager::FillTrack<TTrackFillMap>(track);
+        VarManager::FillTrack<TTrackFillMap>(track, values);
         if (fDoDetailedQA) {
-          fHistMan->FillHistClass("TrackBarrel_BeforeCuts", VarManager::fgValues);
+          fHistMan->FillHistClass("TrackBarrel_BeforeCuts", values);
           if (fIsAmbiguous && isAmbiguous == 1) {
-            fHistMan->FillHistClass("Ambiguous_TrackBarrel_BeforeCuts", VarManager::fgValues);
+            fHistMan->FillHistClass("Ambiguous_TrackBarrel_BeforeCuts", values);
           }
         }
 
         // apply track cuts and fill stats histogram
         int i = 0;
-        for (auto cut = fTrackCuts.begin(); cut != fTrackCuts.end(); cut++, i++) {
-          if ((*cut).IsSelected(VarManager::fgValues)) {
+        for (auto cut = worker.trackCuts.begin(); cut != worker.trackCuts.end(); cut++, i++) {
+          if ((*cut).IsSelected(values)) {
             trackTempFilterMap |= (uint8_t(1) << i);
             if (fConfigQA) {
-              fHistMan->FillHistClass(Form("TrackBarrel_%s", (*cut).GetName()), VarManager::fgValues);
+              fHistMan->FillHistClass(Form("TrackBarrel_%s", (*cut).GetName()), values);
               if (fIsAmbiguous && isAmbiguous == 1) {
-                fHistMan->FillHistClass(Form("Ambiguous_TrackBarrel_%s", (*cut).GetName()), VarManager::fgValues);
+                fHistMan->FillHistClass(Form("Ambiguous_TrackBarrel_%s", (*cut).GetName()), values);
               }
             }
-            (reinterpret_cast<TH1I*>(fStatsList->At(1)))->Fill(static_cast<float>(i));
+            worker.stats.tracks[i]++;
           }
         }
         if (!trackTempFilterMap) {
@@ -431,21 +540,21 @@ struct TableMaker {
           trackFilteringTag |= (uint64_t(track.pidbit()) << 2);
           for (int iv0 = 0; iv0 < 5; iv0++) {
             if (track.pidbit() & (uint8_t(1) << iv0)) {
-              (reinterpret_cast<TH1I*>(fStatsList->At(1)))->Fill(fTrackCuts.size() + static_cast<float>(iv0));
+              worker.stats.tracks[worker.trackCuts.size() + iv0]++;
             }
           }
           if (fConfigIsOnlyforMaps) {
             if (trackFilteringTag & (uint64_t(1) << 2)) { // for electron
-              fHistMan->FillHistClass("TrackBarrel_PostCalibElectron", VarManager::fgValues);
+              fHistMan->FillHistClass("TrackBarrel_PostCalibElectron", values);
             }
             if (trackFilteringTag & (uint64_t(1) << 3)) { // for pion
-              fHistMan->FillHistClass("TrackBarrel_PostCalibPion", VarManager::fgValues);
+              fHistMan->FillHistClass("TrackBarrel_PostCalibPion", values);
             }
             if ((static_cast<bool>(trackFilteringTag & (uint64_t(1) << 4)) * (track.sign()) > 0)) { // for proton from Lambda
-              fHistMan->FillHistClass("TrackBarrel_PostCalibProton", VarManager::fgValues);
+              fHistMan->FillHistClass("TrackBarrel_PostCalibProton", values);
             }
             if ((static_cast<bool>(trackFilteringTag & (uint64_t(1) << 5)) * (track.sign()) < 0)) { // for proton from AntiLambda
-              fHistMan->FillHistClass("TrackBarrel_PostCalibProton", VarManager::fgValues);
+              fHistMan->FillHistClass("TrackBarrel_PostCalibProton", values);
             }
           }
         }
@@ -454,53 +563,27 @@ struct TableMaker {
         }
         trackFilteringTag |= (uint64_t(trackTempFilterMap) << 15); // BIT15-...:  user track filters
 
-        // create the track tables
-        trackBasic(event.lastIndex(), trackFilteringTag, track.pt(), track.eta(), track.phi(), track.sign(), isAmbiguous);
-        trackBarrel(track.tpcInnerParam(), track.flags(), track.itsClusterMap(), track.itsChi2NCl(),
-                    track.tpcNClsFindable(), track.tpcNClsFindableMinusFound(), track.tpcNClsFindableMinusCrossedRows(),
-                    track.tpcNClsShared(), track.tpcChi2NCl(),
-                    track.trdChi2(), track.trdPattern(), track.tofChi2(),
-                    track.length(), track.dcaXY(), track.dcaZ(),
-                    track.trackTime(), track.trackTimeRes(), track.tofExpMom(),
-                    track.detectorMap());
-        if constexpr (static_cast<bool>(TTrackFillMap & VarManager::ObjTypes::TrackCov)) {
-          trackBarrelCov(track.x(), track.alpha(), track.y(), track.z(), track.snp(), track.tgl(), track.signed1Pt(),
-                         track.cYY(), track.cZY(), track.cZZ(), track.cSnpY(), track.cSnpZ(),
-                         track.cSnpSnp(), track.cTglY(), track.cTglZ(), track.cTglSnp(), track.cTglTgl(),
-                         track.c1PtY(), track.c1PtZ(), track.c1PtSnp(), track.c1PtTgl(), track.c1Pt21Pt2());
-        }
+        skimmedTrack.filteringTag = trackFilteringTag;
+        skimmedTrack.isAmbiguous = isAmbiguous;
         // NOTE: If the TPC postcalibration is switched on, then we write the postcalibrated n-sigma values directly in the skimmed data
         if constexpr (static_cast<bool>(TTrackFillMap & VarManager::ObjTypes::TrackPID)) {
-          float nSigmaEl = (fConfigComputeTPCpostCalib ? VarManager::fgValues[VarManager::kTPCnSigmaEl_Corr] : track.tpcNSigmaEl());
-          float nSigmaPi = (fConfigComputeTPCpostCalib ? VarManager::fgValues[VarManager::kTPCnSigmaPi_Corr] : track.tpcNSigmaPi());
-          float nSigmaPr = (fConfigComputeTPCpostCalib ? VarManager::fgValues[VarManager::kTPCnSigmaPr_Corr] : track.tpcNSigmaPr());
-          trackBarrelPID(track.tpcSignal(),
-                         nSigmaEl, track.tpcNSigmaMu(), nSigmaPi, track.tpcNSigmaKa(), nSigmaPr,
-                         track.beta(),
-                         track.tofNSigmaEl(), track.tofNSigmaMu(), track.tofNSigmaPi(), track.tofNSigmaKa(), track.tofNSigmaPr(),
-                         track.trdSignal());
+          skimmedTrack.tpcNSigmaEl = (fConfigComputeTPCpostCalib ? values[VarManager::kTPCnSigmaEl_Corr] : track.tpcNSigmaEl());
+          skimmedTrack.tpcNSigmaPi = (fConfigComputeTPCpostCalib ? values[VarManager::kTPCnSigmaPi_Corr] : track.tpcNSigmaPi());
+          skimmedTrack.tpcNSigmaPr = (fConfigComputeTPCpostCalib ? values[VarManager::kTPCnSigmaPr_Corr] : track.tpcNSigmaPr());
         }
       }
     } // end if constexpr (TTrackFillMap)
 
     if constexpr (static_cast<bool>(TMuonFillMap)) {
-      // build the muon tables
-      muonBasic.reserve(tracksMuon.size());
-      muonExtra.reserve(tracksMuon.size());
-      if constexpr (static_cast<bool>(TMuonFillMap & VarManager::ObjTypes::MuonCov)) {
-        muonCov.reserve(tracksMuon.size());
-      }
-      // loop over muons
-
       // first we need to get the correct indices
       int nDel = 0;
       int idxPrev = -1;
       std::map<int, int> newEntryNb;
-      std::map<int, int> newMatchIndex;
+      std::map<int, int> newMatchIndex; // relative to the first muon written for this collision
 
       for (auto& muon : tracksMuon) {
         trackFilteringTag = uint64_t(0);
-        VarManager::FillTrack<TMuonFillMap>(muon);
+        VarManager::FillTrack<TMuonFillMap>(muon, values);
 
         if (muon.index() > idxPrev + 1) { // checks if some muons are filtered even before the skimming function
           nDel += muon.index() - (idxPrev + 1);
@@ -509,8 +592,8 @@ struct TableMaker {
 
         // check the cuts and filters
         int i = 0;
-        for (auto cut = fMuonCuts.begin(); cut != fMuonCuts.end(); cut++, i++) {
-          if ((*cut).IsSelected(VarManager::fgValues))
+        for (auto cut = worker.muonCuts.begin(); cut != worker.muonCuts.end(); cut++, i++) {
+          if ((*cut).IsSelected(values))
             trackTempFilterMap |= (uint8_t(1) << i);
         }
 
@@ -521,8 +604,12 @@ struct TableMaker {
         }
       }
 
-      // now let's save the muons with the correct indices and matches
+      // now let's decide which muons are saved, with the correct indices and matches
+      int nSavedMuons = 0;
+      int iMuon = 0;
       for (auto& muon : tracksMuon) {
+        auto& skimmedMuon = skimmedMuons[iMuon++];
+        skimmedMuon = SkimmedMuon{};
         if constexpr ((TMuonFillMap & VarManager::ObjTypes::AmbiMuon) > 0) {
           if (fIsAmbiguous) {
             isAmbiguous = 0;
@@ -537,25 +624,25 @@ struct TableMaker {
         trackFilteringTag = uint64_t(0);
         trackTempFilterMap = uint8_t(0);
 
-        VarManager::FillTrack<TMuonFillMap>(muon);
+        VarManager::FillTrack<TMuonFillMap>(muon, values);
         if (fDoDetailedQA) {
-          fHistMan->FillHistClass("Muons_BeforeCuts", VarManager::fgValues);
+          fHistMan->FillHistClass("Muons_BeforeCuts", values);
           if (fIsAmbiguous && isAmbiguous == 1) {
-            fHistMan->FillHistClass("Ambiguous_Muons_BeforeCuts", VarManager::fgValues);
+            fHistMan->FillHistClass("Ambiguous_Muons_BeforeCuts", values);
           }
         }
         // apply the muon selection cuts and fill the stats histogram
         int i = 0;
-        for (auto cut = fMuonCuts.begin(); cut != fMuonCuts.end(); cut++, i++) {
-          if ((*cut).IsSelected(VarManager::fgValues)) {
+        for (auto cut = worker.muonCuts.begin(); cut != worker.muonCuts.end(); cut++, i++) {
+          if ((*cut).IsSelected(values)) {
             trackTempFilterMap |= (uint8_t(1) << i);
             if (fConfigQA) {
-              fHistMan->FillHistClass(Form("Muons_%s", (*cut).GetName()), VarManager::fgValues);
+              fHistMan->FillHistClass(Form("Muons_%s", (*cut).GetName()), values);
               if (fIsAmbiguous && isAmbiguous == 1) {
-                fHistMan->FillHistClass(Form("Ambiguous_Muons_%s", (*cut).GetName()), VarManager::fgValues);
+                fHistMan->FillHistClass(Form("Ambiguous_Muons_%s", (*cut).GetName()), values);
               }
             }
-            (reinterpret_cast<TH1I*>(fStatsList->At(2)))->Fill(static_cast<float>(i));
+            worker.stats.muons[i]++;
           }
         }
         if (!trackTempFilterMap) {
@@ -567,27 +654,102 @@ struct TableMaker {
         // update the matching MCH/MFT index
         if (static_cast<int>(muon.trackType()) == 0 || static_cast<int>(muon.trackType()) == 2) { // MCH-MFT(2) or GLB(0) track
           int matchIdx = muon.matchMCHTrackId() - muon.offsets();
-          if (newEntryNb.count(matchIdx) > 0) {                                                  // if the key exists i.e the match will not get deleted
-            newMatchIndex[muon.index()] = newEntryNb[matchIdx];                                  // update the match for this muon to the updated entry of the match
-            newMatchIndex[muon.index()] += muonBasic.lastIndex() + 1 - newEntryNb[muon.index()]; // adding the offset of muons, muonBasic.lastIndex() start at -1
-            if (static_cast<int>(muon.trackType()) == 0) {                                       // for now only do this to global tracks
-              newMatchIndex[matchIdx] = newEntryNb[muon.index()];                                // add the  updated index of this muon as a match to mch track
-              newMatchIndex[matchIdx] += muonBasic.lastIndex() + 1 - newEntryNb[muon.index()];   // adding the offset, muonBasic.lastIndex() start at -1
+          if (newEntryNb.count(matchIdx) > 0) {                                              // if the key exists i.e the match will not get deleted
+            newMatchIndex[muon.index()] = newEntryNb[matchIdx];                              // update the match for this muon to the updated entry of the match
+            newMatchIndex[muon.index()] += nSavedMuons - newEntryNb[muon.index()];           // adding the offset of this muon among the saved ones
+            if (static_cast<int>(muon.trackType()) == 0) {                                   // for now only do this to global tracks
+              newMatchIndex[matchIdx] = newEntryNb[muon.index()];                            // add the  updated index of this muon as a match to mch track
+              newMatchIndex[matchIdx] += nSavedMuons - newEntryNb[muon.index()];             // adding the offset of this muon among the saved ones
             }
           } else {
-            newMatchIndex[muon.index()] = -1;
+            newMatchIndex[muon.index()] = kNoMatch;
           }
         } else if (static_cast<int>(muon.trackType() == 4)) { // an MCH track
           // in this case the matches should be filled from the other types but we need to check
           if (newMatchIndex.count(muon.index()) == 0) { // if an entry for this mch was not added it simply mean that non of the global tracks were matched to it
-            newMatchIndex[muon.index()] = -1;
+            newMatchIndex[muon.index()] = kNoMatch;
           }
         }
 
-        muonBasic(event.lastIndex(), trackFilteringTag, muon.pt(), muon.eta(), muon.phi(), muon.sign(), isAmbiguous);
+        skimmedMuon.filteringTag = trackFilteringTag;
+        skimmedMuon.isAmbiguous = isAmbiguous;
+        auto match = newMatchIndex.find(muon.index());
+        skimmedMuon.matchIndex = (match != newMatchIndex.end() ? match->second : kNoMatch);
+        nSavedMuons++;
+      }
+    } // end if constexpr (TMuonFillMap)
+  }
+
+  // Writes the table rows of a selected collision, with the decisions of skimCollision()
+  template <uint32_t TEventFillMap, uint32_t TTrackFillMap, uint32_t TMuonFillMap, typename TEvent, typename TTracks, typename TMuons>
+  void writeCollision(TEvent const& collision, aod::BCsWithTimestamps::iterator const& bc, TTracks const& tracksBarrel, TMuons const& tracksMuon,
+                      SkimmedCollision const& skimmedCollision, SkimmedTrack const* skimmedTracks, SkimmedMuon const* skimmedMuons)
+  {
+    // create the event tables
+    event(skimmedCollision.tag, bc.runNumber(), collision.posX(), collision.posY(), collision.posZ(), collision.numContrib(), collision.collisionTime(), collision.collisionTimeRes());
+    if constexpr ((TEventFillMap & VarManager::ObjTypes::CollisionMult) > 0 && (TEventFillMap & VarManager::ObjTypes::CollisionCent) > 0) {
+      eventExtended(bc.globalBC(), bc.triggerMask(), bc.timestamp(), skimmedCollision.triggerAliases, skimmedCollision.centVZERO,
+                    collision.multTPC(), collision.multFV0A(), collision.multFV0C(), collision.multFT0A(), collision.multFT0C(),
+                    collision.multFDDA(), collision.multFDDC(), collision.multZNA(), collision.multZNC(), collision.multTracklets(), collision.multNTracksPV(),
+                    collision.centFT0C());
+    } else if constexpr ((TEventFillMap & VarManager::ObjTypes::CollisionMult) > 0) {
+      eventExtended(bc.globalBC(), bc.triggerMask(), bc.timestamp(), skimmedCollision.triggerAliases, skimmedCollision.centVZERO,
+                    collision.multTPC(), collision.multFV0A(), collision.multFV0C(), collision.multFT0A(), collision.multFT0C(),
+                    collision.multFDDA(), collision.multFDDC(), collision.multZNA(), collision.multZNC(), collision.multTracklets(), collision.multNTracksPV(),
+                    -1);
+    } else if constexpr ((TEventFillMap & VarManager::ObjTypes::CollisionCent) > 0) {
+      eventExtended(bc.globalBC(), bc.triggerMask(), bc.timestamp(), skimmedCollision.triggerAliases, skimmedCollision.centVZERO,
+                    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, collision.centFT0C());
+    } else {
+      eventExtended(bc.globalBC(), bc.triggerMask(), bc.timestamp(), skimmedCollision.triggerAliases, skimmedCollision.centVZERO, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    }
+    eventVtxCov(collision.covXX(), collision.covXY(), collision.covXZ(), collision.covYY(), collision.covYZ(), collision.covZZ(), collision.chi2());
+
+    if constexpr (static_cast<bool>(TTrackFillMap)) {
+      int iTrack = 0;
+      for (auto& track : tracksBarrel) {
+        auto const& skimmedTrack = skimmedTracks[iTrack++];
+        if (!skimmedTrack.filteringTag) {
+          continue;
+        }
+        // create the track tables
+        trackBasic(event.lastIndex(), skimmedTrack.filteringTag, track.pt(), track.eta(), track.phi(), track.sign(), skimmedTrack.isAmbiguous);
+        trackBarrel(track.tpcInnerParam(), track.flags(), track.itsClusterMap(), track.itsChi2NCl(),
+                    track.tpcNClsFindable(), track.tpcNClsFindableMinusFound(), track.tpcNClsFindableMinusCrossedRows(),
+                    track.tpcNClsShared(), track.tpcChi2NCl(),
+                    track.trdChi2(), track.trdPattern(), track.tofChi2(),
+                    track.length(), track.dcaXY(), track.dcaZ(),
+                    track.trackTime(), track.trackTimeRes(), track.tofExpMom(),
+                    track.detectorMap());
+        if constexpr (static_cast<bool>(TTrackFillMap & VarManager::ObjTypes::TrackCov)) {
+          trackBarrelCov(track.x(), track.alpha(), track.y(), track.z(), track.snp(), track.tgl(), track.signed1Pt(),
+                         track.cYY(), track.cZY(), track.cZZ(), track.cSnpY(), track.cSnpZ(),
+                         track.cSnpSnp(), track.cTglY(), track.cTglZ(), track.cTglSnp(), track.cTglTgl(),
+                         track.c1PtY(), track.c1PtZ(), track.c1PtSnp(), track.c1PtTgl(), track.c1Pt21Pt2());
+        }
+        if constexpr (static_cast<bool>(TTrackFillMap & VarManager::ObjTypes::TrackPID)) {
+          trackBarrelPID(track.tpcSignal(),
+                         skimmedTrack.tpcNSigmaEl, track.tpcNSigmaMu(), skimmedTrack.tpcNSigmaPi, track.tpcNSigmaKa(), skimmedTrack.tpcNSigmaPr,
+                         track.beta(),
+                         track.tofNSigmaEl(), track.tofNSigmaMu(), track.tofNSigmaPi(), track.tofNSigmaKa(), track.tofNSigmaPr(),
+                         track.trdSignal());
+        }
+      }
+    } // end if constexpr (TTrackFillMap)
+
+    if constexpr (static_cast<bool>(TMuonFillMap)) {
+      // the match indices are relative to the first muon of the collision
+      const int firstMuonIndex = muonBasic.lastIndex() + 1;
+      int iMuon = 0;
+      for (auto& muon : tracksMuon) {
+        auto const& skimmedMuon = skimmedMuons[iMuon++];
+        if (!skimmedMuon.filteringTag) {
+          continue;
+        }
+        muonBasic(event.lastIndex(), skimmedMuon.filteringTag, muon.pt(), muon.eta(), muon.phi(), muon.sign(), skimmedMuon.isAmbiguous);
         muonExtra(muon.nClusters(), muon.pDca(), muon.rAtAbsorberEnd(),
                   muon.chi2(), muon.chi2MatchMCHMID(), muon.chi2MatchMCHMFT(),
-                  muon.matchScoreMCHMFT(), newMatchIndex.find(muon.index())->second, muon.mchBitMap(), muon.midBitMap(),
+                  muon.matchScoreMCHMFT(), (skimmedMuon.matchIndex == kNoMatch ? -1 : firstMuonIndex + skimmedMuon.matchIndex), muon.mchBitMap(), muon.midBitMap(),
                   muon.midBoards(), muon.trackType(), muon.fwdDcaX(), muon.fwdDcaY(),
                   muon.trackTime(), muon.trackTimeRes());
         if constexpr (static_cast<bool>(TMuonFillMap & VarManager::ObjTypes::MuonCov)) {
@@ -598,7 +760,150 @@ struct TableMaker {
         }
       }
     } // end if constexpr (TMuonFillMap)
-  }   // end fullSkimming()
+  }
+
+  // Templated function instantianed for all of the process functions
+  template <uint32_t TEventFillMap, uint32_t TTrackFillMap, uint32_t TMuonFillMap, typename TEvent, typename TTracks, typename TMuons, typename TAmbiTracks, typename TAmbiMuons>
+  void fullSkimming(TEvent const& collision, aod::BCsWithTimestamps const&, TTracks const& tracksBarrel, TMuons const& tracksMuon, TAmbiTracks const& ambiTracksMid, TAmbiMuons const& ambiTracksFwd)
+  {
+    auto bc = collision.template bc_as<aod::BCsWithTimestamps>();
+    updateTPCPostCalib(bc);
+
+    if constexpr (static_cast<bool>(TTrackFillMap)) {
+      fSkimmedTracks.resize(tracksBarrel.size());
+    }
+    if constexpr (static_cast<bool>(TMuonFillMap)) {
+      fSkimmedMuons.resize(tracksMuon.size());
+    }
+    SkimmedCollision skimmedCollision;
+    skimCollision<TEventFillMap, TTrackFillMap, TMuonFillMap>(collision, bc, tracksBarrel, tracksMuon, ambiTracksMid, ambiTracksFwd,
+                                                              fSkimWorkers[0], skimmedCollision, fSkimmedTracks.data(), fSkimmedMuons.data());
+    flushStats(fSkimWorkers[0].stats);
+    if (!skimmedCollision.selected) {
+      return;
+    }
+
+    if constexpr (static_cast<bool>(TTrackFillMap)) {
+      trackBasic.reserve(tracksBarrel.size());
+      trackBarrel.reserve(tracksBarrel.size());
+      if constexpr (static_cast<bool>(TTrackFillMap & VarManager::ObjTypes::TrackCov)) {
+        trackBarrelCov.reserve(tracksBarrel.size());
+      }
+      trackBarrelPID.reserve(tracksBarrel.size());
+    }
+    if constexpr (static_cast<bool>(TMuonFillMap)) {
+      muonBasic.reserve(tracksMuon.size());
+      muonExtra.reserve(tracksMuon.size());
+      if constexpr (static_cast<bool>(TMuonFillMap & VarManager::ObjTypes::MuonCov)) {
+        muonCov.reserve(tracksMuon.size());
+      }
+    }
+    writeCollision<TEventFillMap, TTrackFillMap, TMuonFillMap>(collision, bc, tracksBarrel, tracksMuon, skimmedCollision, fSkimmedTracks.data(), fSkimmedMuons.data());
+  } // end fullSkimming()
+
+  // Slices a track table by collision. offsets[i] is the position of the first track of collision i in the concatenated slices
+  template <typename TTable, typename TPreslice, typename TEvents>
+  auto sliceByCollision(TTable const& table, TPreslice const& preslice, TEvents const& collisions, std::vector<int64_t>& offsets)
+    -> std::vector<std::decay_t<decltype(table.sliceBy(preslice, 0))>>
+  {
+    std::vector<std::decay_t<decltype(table.sliceBy(preslice, 0))>> slices;
+    slices.reserve(collisions.size());
+    offsets.assign(1, 0);
+    for (auto& collision : collisions) {
+      slices.push_back(table.sliceBy(preslice, collision.globalIndex()));
+      offsets.push_back(offsets.back() + slices.back().size());
+    }
+    return slices;
+  }
+
+  // Overload for the skimming without barrel tracks or without muons
+  template <typename TPreslice, typename TEvents>
+  std::vector<std::nullptr_t> sliceByCollision(std::nullptr_t, TPreslice const&, TEvents const& collisions, std::vector<int64_t>& offsets)
+  {
+    offsets.assign(collisions.size() + 1, 0);
+    return std::vector<std::nullptr_t>(collisions.size(), nullptr);
+  }
+
+  // Skims all the collisions of the time frame on the workers, each with its own value buffer, cuts and statistics.
+  // The workers only store their decisions, the tables are then written in collision order, so that the output
+  // does not depend on the number of threads
+  template <uint32_t TEventFillMap, uint32_t TTrackFillMap, uint32_t TMuonFillMap, typename TEvents, typename TTracks, typename TMuons>
+  void parallelSkimming(TEvents const& collisions, aod::BCsWithTimestamps const&, TTracks const& tracksBarrel, TMuons const& tracksMuon)
+  {
+    const size_t nCollisions = collisions.size();
+    const auto trackSlices = sliceByCollision(tracksBarrel, perCollisionTracks, collisions, fTrackOffsets);
+    const auto muonSlices = sliceByCollision(tracksMuon, perCollisionMuons, collisions, fMuonOffsets);
+    fSkimmedCollisions.resize(nCollisions);
+    fSkimmedTracks.resize(fTrackOffsets.back());
+    fSkimmedMuons.resize(fMuonOffsets.back());
+
+    // the TPC post-calibration maps are statics of the VarManager, shared by the workers: the collisions are skimmed run by run
+    std::vector<int> runNumbers;
+    if (fConfigComputeTPCpostCalib) {
+      runNumbers.reserve(nCollisions);
+      for (auto& collision : collisions) {
+        runNumbers.push_back(collision.template bc_as<aod::BCsWithTimestamps>().runNumber());
+      }
+    }
+    for (size_t first = 0; first < nCollisions;) {
+      size_t last = nCollisions;
+      if (fConfigComputeTPCpostCalib) {
+        updateTPCPostCalib(collisions.iteratorAt(first).template bc_as<aod::BCsWithTimestamps>());
+        for (last = first + 1; last < nCollisions && runNumbers[last] == runNumbers[first]; last++) {
+        }
+      }
+
+      std::atomic<size_t> nextCollision{first};
+      auto work = [&](size_t slot) {
+        for (size_t iCollision = nextCollision++; iCollision < last; iCollision = nextCollision++) {
+          auto collision = collisions.iteratorAt(iCollision);
+          auto bc = collision.template bc_as<aod::BCsWithTimestamps>();
+          skimCollision<TEventFillMap, TTrackFillMap, TMuonFillMap>(collision, bc, trackSlices[iCollision], muonSlices[iCollision], nullptr, nullptr,
+                                                                    fSkimWorkers[slot], fSkimmedCollisions[iCollision],
+                                                                    fSkimmedTracks.data() + fTrackOffsets[iCollision], fSkimmedMuons.data() + fMuonOffsets[iCollision]);
+        }
+      };
+      fSkimPool.run(work);
+      first = last;
+    }
+    for (auto& worker : fSkimWorkers) {
+      flushStats(worker.stats);
+    }
+
+    // reserve the tables for all the selected rows and write them
+    size_t nTracks = 0;
+    for (auto const& skimmedTrack : fSkimmedTracks) {
+      nTracks += (skimmedTrack.filteringTag != 0);
+    }
+    size_t nMuons = 0;
+    for (auto const& skimmedMuon : fSkimmedMuons) {
+      nMuons += (skimmedMuon.filteringTag != 0);
+    }
+    if constexpr (static_cast<bool>(TTrackFillMap)) {
+      trackBasic.reserve(nTracks);
+      trackBarrel.reserve(nTracks);
+      if constexpr (static_cast<bool>(TTrackFillMap & VarManager::ObjTypes::TrackCov)) {
+        trackBarrelCov.reserve(nTracks);
+      }
+      trackBarrelPID.reserve(nTracks);
+    }
+    if constexpr (static_cast<bool>(TMuonFillMap)) {
+      muonBasic.reserve(nMuons);
+      muonExtra.reserve(nMuons);
+      if constexpr (static_cast<bool>(TMuonFillMap & VarManager::ObjTypes::MuonCov)) {
+        muonCov.reserve(nMuons);
+      }
+    }
+    for (size_t iCollision = 0; iCollision < nCollisions; iCollision++) {
+      if (!fSkimmedCollisions[iCollision].selected) {
+        continue;
+      }
+      auto collision = collisions.iteratorAt(iCollision);
+      auto bc = collision.template bc_as<aod::BCsWithTimestamps>();
+      writeCollision<TEventFillMap, TTrackFillMap, TMuonFillMap>(collision, bc, trackSlices[iCollision], muonSlices[iCollision], fSkimmedCollisions[iCollision],
+                                                                 fSkimmedTracks.data() + fTrackOffsets[iCollision], fSkimmedMuons.data() + fMuonOffsets[iCollision]);
+    }
+  } // end parallelSkimming()
 
   void DefineHistograms(TString histClasses)
   {
@@ -863,6 +1168,45 @@ struct TableMaker {
     }
   }
 
+  // Produce barrel + muon tables, skimming the collisions of the time frame in parallel -------------------------------------------------------
+  void processFullParallel(MyEvents const& collisions, aod::BCsWithTimestamps const& bcs,
+                           soa::Filtered<MyBarrelTracks> const& tracksBarrel, soa::Filtered<MyMuons> const& tracksMuon)
+  {
+    parallelSkimming<gkEventFillMap, gkTrackFillMap, gkMuonFillMap>(collisions, bcs, tracksBarrel, tracksMuon);
+  }
+
+  void processFullWithCovParallel(MyEvents const& collisions, aod::BCsWithTimestamps const& bcs,
+                                  soa::Filtered<MyBarrelTracksWithCov> const& tracksBarrel, soa::Filtered<MyMuonsWithCov> const& tracksMuon)
+  {
+    parallelSkimming<gkEventFillMap, gkTrackFillMapWithCov, gkMuonFillMapWithCov>(collisions, bcs, tracksBarrel, tracksMuon);
+  }
+
+  // Produce barrel tables only, skimming the collisions of the time frame in parallel ---------------------------------------------------------
+  void processBarrelOnlyParallel(MyEvents const& collisions, aod::BCsWithTimestamps const& bcs,
+                                 soa::Filtered<MyBarrelTracks> const& tracksBarrel)
+  {
+    parallelSkimming<gkEventFillMap, gkTrackFillMap, 0u>(collisions, bcs, tracksBarrel, nullptr);
+  }
+
+  void processBarrelOnlyWithCovParallel(MyEventsWithMults const& collisions, aod::BCsWithTimestamps const& bcs,
+                                        soa::Filtered<MyBarrelTracksWithCov> const& tracksBarrel)
+  {
+    parallelSkimming<gkEventFillMapWithMult, gkTrackFillMapWithCov, 0u>(collisions, bcs, tracksBarrel, nullptr);
+  }
+
+  // Produce muon tables only, skimming the collisions of the time frame in parallel -----------------------------------------------------------
+  void processMuonOnlyParallel(MyEvents const& collisions, aod::BCsWithTimestamps const& bcs,
+                               soa::Filtered<MyMuons> const& tracksMuon)
+  {
+    parallelSkimming<gkEventFillMap, 0u, gkMuonFillMap>(collisions, bcs, nullptr, tracksMuon);
+  }
+
+  void processMuonOnlyWithCovParallel(MyEvents const& collisions, aod::BCsWithTimestamps const& bcs,
+                                      soa::Filtered<MyMuonsWithCov> const& tracksMuon)
+  {
+    parallelSkimming<gkEventFillMap, 0u, gkMuonFillMapWithCov>(collisions, bcs, nullptr, tracksMuon);
+  }
+
   // Produce muon tables only for ambiguous tracks studies --------------------------------------------------------------------------------------
   void processAmbiguousMuonOnly(MyEvents const& collisions, aod::BCsWithTimestamps const& bcs,
                                 soa::Filtered<MyMuons> const& tracksMuon, aod::AmbiguousTracksFwd const& ambiTracksFwd)
@@ -963,6 +1307,12 @@ struct TableMaker {
   PROCESS_SWITCH(TableMaker, processMuonOnlyWithCov, "Build muon-only DQ skimmed data model, w/ muon cov matrix", false);
   PROCESS_SWITCH(TableMaker, processMuonOnly, "Build muon-only DQ skimmed data model", false);
   PROCESS_SWITCH(TableMaker, processMuonOnlyWithFilter, "Build muon-only DQ skimmed data model, w/ event filter", false);
+  PROCESS_SWITCH(TableMaker, processFullParallel, "Build full DQ skimmed data model, w/o centrality, skimming the collisions in parallel", false);
+  PROCESS_SWITCH(TableMaker, processFullWithCovParallel, "Build full DQ skimmed data model, w/ track and fwdtrack covariance tables, skimming the collisions in parallel", false);
+  PROCESS_SWITCH(TableMaker, processBarrelOnlyParallel, "Build barrel-only DQ skimmed data model, w/o centrality, skimming the collisions in parallel", false);
+  PROCESS_SWITCH(TableMaker, processBarrelOnlyWithCovParallel, "Build barrel-only DQ skimmed data model, w/ track cov matrix, skimming the collisions in parallel", false);
+  PROCESS_SWITCH(TableMaker, processMuonOnlyParallel, "Build muon-only DQ skimmed data model, skimming the collisions in parallel", false);
+  PROCESS_SWITCH(TableMaker, processMuonOnlyWithCovParallel, "Build muon-only DQ skimmed data model, w/ muon cov matrix, skimming the collisions in parallel", false);
   PROCESS_SWITCH(TableMaker, processOnlyBCs, "Analyze the BCs to store sampled lumi", false);
   PROCESS_SWITCH(TableMaker, processAmbiguousMuonOnly, "Build muon-only DQ skimmed data model with QA plots for ambiguous muons", false);
   PROCESS_SWITCH(TableMaker, processAmbiguousMuonOnlyWithCov, "Build muon-only with cov DQ skimmed data model with QA plots for ambiguous muons", false);
@@ -36,6 +36,7 @@
 #include "PWGDQ/Core/HistogramsLibrary.h"
 #include "PWGDQ/Core/CutsLibrary.h"
 #include "PWGDQ/Core/MCSignal.h"
+#include "PWGDQ/Core/MCSignalMatcher.h"
 #include "PWGDQ/Core/MCSignalLibrary.h"
 #include "Common/DataModel/PIDResponse.h"
 #include "Common/DataModel/TrackSelectionTables.h"
@@ -116,6 +117,7 @@ struct TableMakerMC {
 
   // list of MCsignal objects
   std::vector<MCSignal> fMCSignals;
+  MCSignalMatcher fMCSignalMatcher; // precompiled fMCSignals, built once for the MC stack of each time frame
 
   OutputObj<THashList> fOutputList{"output"};
   // TODO: add statistics histograms, similar to table-maker
@@ -269,6 +271,12 @@ struct TableMakerMC {
       }
     }
 
+    std::vector<MCSignal*> signals;
+    for (auto& sig : fMCSignals) {
+      signals.push_back(&sig);
+    }
+    fMCSignalMatcher.Init(signals, true);
+
     DefineHistograms(histClasses);                   // define all histograms
     VarManager::SetUseVars(fHistMan->GetUsedVars()); // provide the list of required variables so that VarManager knows what to fill
     fOutputList.setObject(fHistMan->GetMainHistogramList());
@@ -304,6 +312,8 @@ struct TableMakerMC {
     uint16_t mcflags = 0;
     uint64_t trackFilteringTag = 0;
     uint8_t trackTempFilterMap = 0;
+    // ancestry table of the MC stack, used for all the MC signal decisions of this time frame
+    fMCSignalMatcher.Build(mcTracks);
     // Process orphan tracks
     if constexpr ((TTrackFillMap & VarManager::ObjTypes::AmbiTrack) > 0) {
       if (fDoDetailedQA && fIsAmbiguous) {
@@ -415,14 +425,7 @@ struct TableMakerMC {
       auto groupedMcTracks = mcTracks.sliceBy(perMcCollision, mcCollision.globalIndex());
       for (auto& mctrack : groupedMcTracks) {
         // check all the requested MC signals and fill a decision bit map
-        mcflags = 0;
-        int i = 0;
-        for (auto& sig : fMCSignals) {
-          if (sig.CheckSignal(true, mcTracks, mctrack)) {
-            mcflags |= (uint16_t(1) << i);
-          }
-          i++;
-        }
+        mcflags = fMCSignalMatcher.CheckSignals(mcTracks, mctrack);
         if (mcflags == 0) {
           continue;
         }
@@ -531,9 +534,10 @@ struct TableMakerMC {
           mcflags = 0;
           i = 0;     // runs over the MC signals
           int j = 0; // runs over the track cuts
+          uint64_t signalDecisions = fMCSignalMatcher.CheckSignals(mcTracks, mctrack);
           // check all the specified signals and fill histograms for MC truth matched tracks
           for (auto& sig : fMCSignals) {
-            if (sig.CheckSignal(true, mcTracks, mctrack)) {
+            if (signalDecisions & (uint64_t(1) << i)) {
               mcflags |= (uint16_t(1) << i);
               if (fDoDetailedQA) {
                 j = 0;
@@ -688,9 +692,10 @@ struct TableMakerMC {
           mcflags = 0;
           i = 0;     // runs over the MC signals
           int j = 0; // runs over the track cuts
+          uint64_t signalDecisions = fMCSignalMatcher.CheckSignals(mcTracks, mctrack);
           // check all the specified signals and fill histograms for MC truth matched tracks
           for (auto& sig : fMCSignals) {
-            if (sig.CheckSignal(true, mcTracks, mctrack)) {
+            if (signalDecisions & (uint64_t(1) << i)) {
               mcflags |= (uint16_t(1) << i);
               if (fDoDetailedQA) {
                 fHistMan->FillHistClass(Form("Muons_BeforeCuts_%s", sig.GetName()), VarManager::fgValues); // fill the reconstructed truth BeforeCuts
@@ -31,6 +31,7 @@
 #include "PWGDQ/Core/HistogramsLibrary.h"
 #include "PWGDQ/Core/CutsLibrary.h"
 #include "PWGDQ/Core/MCSignal.h"
+#include "PWGDQ/Core/MCSignalMatcher.h"
 #include "PWGDQ/Core/MCSignalLibrary.h"
 #include "DataFormatsParameters/GRPObject.h"
 #include "CCDB/BasicCCDBManager.h"
@@ -521,6 +522,9 @@ struct AnalysisSameEventPairing {
   std::vector<std::vector<TString>> fBarrelMuonHistNamesMCmatched;
   std::vector<MCSignal> fRecMCSignals;
   std::vector<MCSignal> fGenMCSignals;
+  // precompiled fRecMCSignals and fGenMCSignals, built for the MC stack of each event
+  MCSignalMatcher fRecMCSignalMatcher;
+  MCSignalMatcher fGenMCSignalMatcher;
 
   void init(o2::framework::InitContext& context)
   {
@@ -663,6 +667,17 @@ struct AnalysisSameEventPairing {
       }
     }
 
+    std::vector<MCSignal*> recSignals;
+    for (auto& sig : fRecMCSignals) {
+      recSignals.push_back(&sig);
+    }
+    fRecMCSignalMatcher.Init(recSignals, false);
+    std::vector<MCSignal*> genSignals;
+    for (auto& sig : fGenMCSignals) {
+      genSignals.push_back(&sig);
+    }
+    fGenMCSignalMatcher.Init(genSignals, false);
+
     DefineHistograms(fHistMan, histNames.Data());    // define all histograms
     VarManager::SetUseVars(fHistMan->GetUsedVars()); // provide the list of required variables so that VarManager knows what to fill
     fOutputList.setObject(fHistMan->GetMainHistogramList());
@@ -742,19 +757,12 @@ struct AnalysisSameEventPairing {
 
       // run MC matching for this pair
       uint32_t mcDecision = 0;
-      int isig = 0;
-      for (auto sig = fRecMCSignals.begin(); sig != fRecMCSignals.end(); sig++, isig++) {
-        if constexpr (TTrackFillMap & VarManager::ObjTypes::ReducedTrack || TTrackFillMap & VarManager::ObjTypes::ReducedMuon) { // for skimmed DQ model
-          if ((*sig).CheckSignal(false, tracksMC, t1.reducedMCTrack(), t2.reducedMCTrack())) {
-            mcDecision |= (uint32_t(1) << isig);
-          }
-        }
-        if constexpr (TTrackFillMap & VarManager::ObjTypes::Track || TTrackFillMap & VarManager::ObjTypes::Muon) { // for Framework data model
-          if ((*sig).CheckSignal(false, tracksMC, t1.template mcParticle_as<aod::McParticles_001>(), t2.template mcParticle_as<aod::McParticles_001>())) {
-            mcDecision |= (uint32_t(1) << isig);
-          }
-        }
-      } // end loop over MC signals
+      if constexpr (TTrackFillMap & VarManager::ObjTypes::ReducedTrack || TTrackFillMap & VarManager::ObjTypes::ReducedMuon) { // for skimmed DQ model
+        mcDecision = fRecMCSignalMatcher.CheckSignals(tracksMC, t1.reducedMCTrack(), t2.reducedMCTrack());
+      }
+      if constexpr (TTrackFillMap & VarManager::ObjTypes::Track || TTrackFillMap & VarManager::ObjTypes::Muon) { // for Framework data model
+        mcDecision = fRecMCSignalMatcher.CheckSignals(tracksMC, t1.template mcParticle_as<aod::McParticles_001>(), t2.template mcParticle_as<aod::McParticles_001>());
+      }
 
       dileptonFilterMap = twoTrackFilter;
       dileptonMcDecision = mcDecision;
@@ -801,25 +809,34 @@ struct AnalysisSameEventPairing {
       // NOTE: Signals are checked here mostly based on the skimmed MC stack, so depending on the requested signal, the stack could be incomplete.
       // NOTE: However, the working model is that the decisions on MC signals are precomputed during skimming and are stored in the mcReducedFlags member.
       // TODO:  Use the mcReducedFlags to select signals
-      for (auto& sig : fGenMCSignals) {
-        if (sig.GetNProngs() != 1) { // NOTE: 1-prong signals required
-          continue;
-        }
-        if (sig.CheckSignal(false, groupedMCTracks, mctrack)) {
-          fHistMan->FillHistClass(Form("MCTruthGen_%s", sig.GetName()), VarManager::fgValues);
+      // NOTE: only the 1-prong signals can be matched to a single particle
+      uint64_t mcDecision = fGenMCSignalMatcher.CheckSignals(groupedMCTracks, mctrack);
+      int isig = 0;
+      for (auto sig = fGenMCSignals.begin(); sig != fGenMCSignals.end(); sig++, isig++) {
+        if (mcDecision & (uint64_t(1) << isig)) {
+          fHistMan->FillHistClass(Form("MCTruthGen_%s", (*sig).GetName()), VarManager::fgValues);
         }
       }
     }
 
     //    // loop over mc stack and fill histograms for pure MC truth signals
+    bool hasPairSignals = false;
     for (auto& sig : fGenMCSignals) {
-      if (sig.GetNProngs() != 2) { // NOTE: 2-prong signals required
+      hasPairSignals = hasPairSignals || (sig.GetNProngs() == 2); // NOTE: 2-prong signals required
+    }
+    if (!hasPairSignals) {
+      return;
+    }
+    for (auto& [t1, t2] : combinations(groupedMCTracks, groupedMCTracks)) {
+      uint64_t mcDecision = fGenMCSignalMatcher.CheckSignals(groupedMCTracks, t1, t2);
+      if (!mcDecision) {
         continue;
       }
-      for (auto& [t1, t2] : combinations(groupedMCTracks, groupedMCTracks)) {
-        if (sig.CheckSignal(false, groupedMCTracks, t1, t2)) {
-          VarManager::FillPairMC(t1, t2);
-          fHistMan->FillHistClass(Form("MCTruthGenPair_%s", sig.GetName()), VarManager::fgValues);
+      VarManager::FillPairMC(t1, t2);
+      int isig = 0;
+      for (auto sig = fGenMCSignals.begin(); sig != fGenMCSignals.end(); sig++, isig++) {
+        if (mcDecision & (uint64_t(1) << isig)) {
+          fHistMan->FillHistClass(Form("MCTruthGenPair_%s", (*sig).GetName()), VarManager::fgValues);
         }
       }
     } // end of true pairing loop
@@ -836,9 +853,13 @@ struct AnalysisSameEventPairing {
     VarManager::FillEvent<gkEventFillMap>(event);
     VarManager::FillEvent<gkMCEventFillMap>(event.reducedMCevent());
 
-    runPairing<VarManager::kDecayToEE, gkEventFillMap, gkMCEventFillMap, gkTrackFillMap>(event, tracks, tracks, eventsMC, tracksMC);
     auto groupedMCTracks = tracksMC.sliceBy(perReducedMcEvent, event.reducedMCevent().globalIndex());
     groupedMCTracks.bindInternalIndicesTo(&tracksMC);
+    // ancestry tables of the MC stack of this event, used for all the MC signal decisions
+    fRecMCSignalMatcher.Build(groupedMCTracks);
+    fGenMCSignalMatcher.Build(groupedMCTracks);
+
+    runPairing<VarManager::kDecayToEE, gkEventFillMap, gkMCEventFillMap, gkTrackFillMap>(event, tracks, tracks, eventsMC, tracksMC);
     runMCGen(groupedMCTracks);
   }
 
@@ -851,9 +872,13 @@ struct AnalysisSameEventPairing {
     VarManager::FillEvent<gkEventFillMapWithCov>(event);
     VarManager::FillEvent<gkMCEventFillMap>(event.reducedMCevent());
 
-    runPairing<VarManager::kDecayToEE, gkEventFillMapWithCov, gkMCEventFillMap, gkTrackFillMapWithCov>(event, tracks, tracks, eventsMC, tracksMC);
     auto groupedMCTracks = tracksMC.sliceBy(perReducedMcEvent, event.reducedMCevent().globalIndex());
     groupedMCTracks.bindInternalIndicesTo(&tracksMC);
+    // ancestry tables of the MC stack of this event, used for all the MC signal decisions
+    fRecMCSignalMatcher.Build(groupedMCTracks);
+    fGenMCSignalMatcher.Build(groupedMCTracks);
+
+    runPairing<VarManager::kDecayToEE, gkEventFillMapWithCov, gkMCEventFillMap, gkTrackFillMapWithCov>(event, tracks, tracks, eventsMC, tracksMC);
     runMCGen(groupedMCTracks);
   }
 
@@ -866,9 +891,13 @@ struct AnalysisSameEventPairing {
     VarManager::FillEvent<gkEventFillMap>(event);
     VarManager::FillEvent<gkMCEventFillMap>(event.reducedMCevent());
 
-    runPairing<VarManager::kDecayToMuMu, gkEventFillMap, gkMCEventFillMap, gkMuonFillMap>(event, muons, muons, eventsMC, tracksMC);
     auto groupedMCTracks = tracksMC.sliceBy(perReducedMcEvent, event.reducedMCevent().globalIndex());
     groupedMCTracks.bindInternalIndicesTo(&tracksMC);
+    // ancestry tables of the MC stack of this event, used for all the MC signal decisions
+    fRecMCSignalMatcher.Build(groupedMCTracks);
+    fGenMCSignalMatcher.Build(groupedMCTracks);
+
+    runPairing<VarManager::kDecayToMuMu, gkEventFillMap, gkMCEventFillMap, gkMuonFillMap>(event, muons, muons, eventsMC, tracksMC);
     runMCGen(groupedMCTracks);
   }
 
@@ -881,9 +910,13 @@ struct AnalysisSameEventPairing {
     VarManager::FillEvent<gkEventFillMap>(event);
     VarManager::FillEvent<gkMCEventFillMap>(event.reducedMCevent());
 
-    runPairing<VarManager::kDecayToMuMu, gkEventFillMapWithCov, gkMCEventFillMap, gkMuonFillMapWithCov>(event, muons, muons, eventsMC, tracksMC);
     auto groupedMCTracks = tracksMC.sliceBy(perReducedMcEvent, event.reducedMCevent().globalIndex());
     groupedMCTracks.bindInternalIndicesTo(&tracksMC);
+    // ancestry tables of the MC stack of this event, used for all the MC signal decisions
+    fRecMCSignalMatcher.Build(groupedMCTracks);
+    fGenMCSignalMatcher.Build(groupedMCTracks);
+
+    runPairing<VarManager::kDecayToMuMu, gkEventFillMapWithCov, gkMCEventFillMap, gkMuonFillMapWithCov>(event, muons, muons, eventsMC, tracksMC);
     runMCGen(groupedMCTracks);
   }
 
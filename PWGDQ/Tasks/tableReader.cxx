@@ -11,6 +11,7 @@
 //
 // Contact: iarsene@cern.ch, i.c.arsene@fys.uio.no
 //
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include <algorithm>
@@ -34,6 +35,7 @@
 #include "PWGDQ/Core/HistogramsLibrary.h"
 #include "PWGDQ/Core/CutsLibrary.h"
 #include "PWGDQ/Core/MixingLibrary.h"
+#include "Common/Core/EventMixingPool.h"
 #include "DataFormatsParameters/GRPMagField.h"
 #include "Field/MagneticField.h"
 #include "TGeoGlobalMagField.h"
@@ -107,6 +109,32 @@ constexpr static int pairTypeEE = VarManager::kDecayToEE;
 constexpr static int pairTypeMuMu = VarManager::kDecayToMuMu;
 constexpr static int pairTypeEMu = VarManager::kElectronMuon;
 
+// Track snapshot stored in the mixing pools of AnalysisEventMixing, with the 4-momentum precomputed for the pairing
+struct DQPooledTrack : eventmixing::PoolRow<double, double, double, double, float, float, float, int8_t, uint32_t> {
+  using PoolRow::PoolRow;
+  double px() const { return get<0>(); }
+  double py() const { return get<1>(); }
+  double pz() const { return get<2>(); }
+  double e() const { return get<3>(); }
+  float pt() const { return get<4>(); }
+  float eta() const { return get<5>(); }
+  float phi() const { return get<6>(); }
+  int sign() const { return get<7>(); }
+  uint32_t filter() const { return get<8>(); }
+
+  Snapshot snapshot() const { return Snapshot{px(), py(), pz(), e(), pt(), eta(), phi(), get<7>(), filter()}; }
+
+  static Snapshot make(float pt, float eta, float phi, int sign, uint32_t filter, float mass)
+  {
+    const double px = pt * std::cos(phi);
+    const double py = pt * std::sin(phi);
+    const double pz = pt * std::sinh(eta);
+    const double e = std::sqrt(px * px + py * py + pz * pz + double(mass) * mass);
+    return Snapshot{px, py, pz, e, pt, eta, phi, static_cast<int8_t>(sign), filter};
+  }
+};
+using DQPooledTracks = eventmixing::PoolEventView<DQPooledTrack>;
+
 // Global function used to define needed histogram classes
 void DefineHistograms(HistogramManager* histMan, TString histClasses, Configurable<std::string> configVar); // defines histograms for all tasks
 
@@ -495,6 +523,7 @@ struct AnalysisEventMixing {
   Configurable<string> fConfigMuonCuts{"cfgMuonCuts", "", "Comma separated list of muon cuts"};
   Configurable<int> fConfigMixingDepth{"cfgMixingDepth", 100, "Number of Events stored for event mixing"};
   Configurable<std::string> fConfigAddEventMixingHistogram{"cfgAddEventMixingHistogram", "", "Comma separated list of histograms"};
+  Configurable<bool> fConfigUseMixingPools{"cfgUseMixingPools", false, "Mix each event with the previous cfgMixingDepth events of its category, kept in pools across time frames"};
 
   Filter filterEventSelected = aod::dqanalysisflags::isEventSelected == 1;
   Filter filterTrackSelected = aod::dqanalysisflags::isBarrelSelected > 0;
@@ -510,8 +539,50 @@ struct AnalysisEventMixing {
 
   NoBinningPolicy<aod::dqanalysisflags::MixingHash> hashBin;
 
+  // pool of one process function, with the run of its events
+  struct RunMixingPool {
+    eventmixing::MixingPool<DQPooledTrack> pool;
+    int run = -1;
+  };
+
+  // pairs of one pooled track with all the tracks of an event
+  struct MixedPairs {
+    std::vector<uint32_t> filter;
+    std::vector<float> mass;
+    std::vector<float> pt;
+    std::vector<float> eta;
+    std::vector<float> phi;
+    std::vector<float> rap;
+
+    size_t size() const { return filter.size(); }
+    void resize(size_t n)
+    {
+      filter.resize(n);
+      mass.resize(n);
+      pt.resize(n);
+      eta.resize(n);
+      phi.resize(n);
+      rap.resize(n);
+    }
+  };
+
+  // one pool for each of the process functions, which can be enabled together
+  // NOTE: the barrel-muon pool stores the barrel tracks, which are paired with the muons of the new event
+  RunMixingPool fBarrelPool;
+  RunMixingPool fMuonPool;
+  RunMixingPool fBarrelMuonPool;
+  RunMixingPool fBarrelVnPool;
+  RunMixingPool fMuonVnPool;
+  DQPooledTrack::Event fCurrentTracks; // snapshot of the event being processed
+  DQPooledTrack::Event fCurrentMuons;
+  MixedPairs fMixingPairs;
+
   void init(o2::framework::InitContext& context)
   {
+    for (auto* pool : {&fBarrelPool, &fMuonPool, &fBarrelMuonPool, &fBarrelVnPool, &fMuonVnPool}) {
+      pool->pool.init(fConfigMixingDepth.value, -1);
+    }
+
     VarManager::SetDefaultVarNames();
     fHistMan = new HistogramManager("analysisHistos", "aa", VarManager::kNVars);
     fHistMan->SetUseDefaultVariableNames(kTRUE);
@@ -670,28 +741,202 @@ struct AnalysisEventMixing {
     } // end event loop
   }
 
+  // fills the snapshot with the selected tracks of the event with index eventIdx
+  // NOTE: the tables are sorted by event, so that the iterator runs only once over the tracks of the time frame
+  template <bool TMuons, typename TIterator, typename TTracks>
+  void fillSnapshot(TIterator& track, TTracks const& tracks, int64_t eventIdx, DQPooledTrack::Event& snapshot)
+  {
+    snapshot.clear();
+    for (; track != tracks.end() && track.reducedeventId() < eventIdx; ++track) {
+    }
+    for (; track != tracks.end() && track.reducedeventId() == eventIdx; ++track) {
+      if constexpr (TMuons) {
+        snapshot.push_back(DQPooledTrack::make(track.pt(), track.eta(), track.phi(), track.sign(), uint32_t(track.isMuonSelected()), o2::constants::physics::MassMuon));
+      } else {
+        snapshot.push_back(DQPooledTrack::make(track.pt(), track.eta(), track.phi(), track.sign(), uint32_t(track.isBarrelSelected()), o2::constants::physics::MassElectron));
+      }
+    }
+  }
+
+  // the pools are emptied at each change of run, so that only events with the same magnetic field are mixed
+  template <typename TEvent>
+  void checkPoolRun(TEvent const& event, RunMixingPool& pool)
+  {
+    if (event.runNumber() != pool.run) {
+      pool.pool.clear();
+      pool.run = event.runNumber();
+    }
+  }
+
+  // computes the filter bits (filter of track1 & filter of track j & mask) and the kinematics of the pairs
+  //   of track1 with all the tracks of tracks2
+  void computePairs(DQPooledTrack const& track1, DQPooledTracks const& tracks2, uint32_t mask)
+  {
+    fMixingPairs.resize(tracks2.size());
+    const uint32_t filter1 = track1.filter() & mask;
+    size_t j = 0;
+    for (auto const& track2 : tracks2) {
+      fMixingPairs.filter[j++] = filter1 & track2.filter();
+    }
+
+    j = 0;
+    for (auto const& track2 : tracks2) {
+      const double px = track1.px() + track2.px();
+      const double py = track1.py() + track2.py();
+      const double pz = track1.pz() + track2.pz();
+      const double e = track1.e() + track2.e();
+      const double pt2 = px * px + py * py;
+      const double m2 = e * e - pt2 - pz * pz;
+      const double pt = std::sqrt(pt2);
+      fMixingPairs.mass[j] = (m2 >= 0. ? std::sqrt(m2) : -std::sqrt(-m2));
+      fMixingPairs.pt[j] = pt;
+      fMixingPairs.eta[j] = (pt > 0. ? std::asinh(pz / pt) : 0.);
+      fMixingPairs.phi[j] = std::atan2(py, px);
+      fMixingPairs.rap[j] = 0.5 * std::log((e + pz) / (e - pz));
+      j++;
+    }
+  }
+
+  // pairing of the track snapshots of two events, equivalent to runMixedPairing()
+  template <int TPairType, uint32_t TEventFillMap>
+  void runPooledPairing(DQPooledTracks const& tracks1, DQPooledTracks const& tracks2)
+  {
+    const std::vector<std::vector<TString>>* histNames = &fTrackHistNames;
+    uint32_t filterMask = fTwoTrackFilterMask;
+    if constexpr (TPairType == pairTypeMuMu) {
+      histNames = &fMuonHistNames;
+      filterMask = fTwoMuonFilterMask;
+    }
+    if constexpr (TPairType == pairTypeEMu) {
+      histNames = &fTrackMuonHistNames;
+    }
+    const unsigned int ncuts = histNames->size();
+
+    for (auto const& track1 : tracks1) {
+      computePairs(track1, tracks2, filterMask);
+      for (size_t j = 0; j < fMixingPairs.size(); j++) {
+        const uint32_t twoTrackFilter = fMixingPairs.filter[j];
+        if (!twoTrackFilter) { // the tracks must have at least one filter bit in common to continue
+          continue;
+        }
+        VarManager::fgValues[VarManager::kMass] = fMixingPairs.mass[j];
+        VarManager::fgValues[VarManager::kPt] = fMixingPairs.pt[j];
+        VarManager::fgValues[VarManager::kEta] = fMixingPairs.eta[j];
+        VarManager::fgValues[VarManager::kPhi] = fMixingPairs.phi[j];
+        VarManager::fgValues[VarManager::kRap] = -fMixingPairs.rap[j]; // same convention as VarManager::FillPairME()
+        auto track2 = tracks2.iteratorAt(j);
+        if constexpr ((TEventFillMap & VarManager::ObjTypes::ReducedEventQvector) > 0) {
+          VarManager::FillPairVn<TPairType>(track1, track2);
+        }
+
+        for (unsigned int icut = 0; icut < ncuts; icut++) {
+          if (twoTrackFilter & (uint32_t(1) << icut)) {
+            if (track1.sign() * track2.sign() < 0) {
+              fHistMan->FillHistClass((*histNames)[icut][0].Data(), VarManager::fgValues);
+            } else {
+              if (track1.sign() > 0) {
+                fHistMan->FillHistClass((*histNames)[icut][1].Data(), VarManager::fgValues);
+              } else {
+                fHistMan->FillHistClass((*histNames)[icut][2].Data(), VarManager::fgValues);
+              }
+            }
+          } // end if (filter bits)
+        }   // end for (cuts)
+      }     // end for (track2)
+    }       // end for (track1)
+  }
+
+  // event mixing with the pools: each event is paired with the events of its category already in the pool,
+  //   using the event variables of the new event, and then added to the pool
+  template <int TPairType, uint32_t TEventFillMap, typename TEvents, typename TTracks>
+  void runSameSidePooled(TEvents const& events, TTracks const& tracks, RunMixingPool& pool)
+  {
+    auto track = tracks.begin();
+    for (auto& event : events) {
+      checkPoolRun(event, pool);
+      fillSnapshot<TPairType == pairTypeMuMu>(track, tracks, event.globalIndex(), fCurrentTracks);
+      const int bin = event.mixingHash();
+      if (bin < 0) { // event outside the mixing categories
+        continue;
+      }
+
+      VarManager::ResetValues(0, VarManager::kNVars);
+      VarManager::FillEvent<TEventFillMap>(event, VarManager::fgValues);
+      DQPooledTracks current(&fCurrentTracks);
+      for (int i = 0; i < pool.pool.size(bin); i++) {
+        runPooledPairing<TPairType, TEventFillMap>(pool.pool.event(bin, i), current);
+      }
+      pool.pool.addEvent(bin, current, [](DQPooledTrack const& t) { return t.snapshot(); });
+    }
+  }
+
+  // barrel-muon event mixing with the pools, the barrel tracks of the pooled events are paired with the muons of the new event
+  template <uint32_t TEventFillMap, typename TEvents, typename TTracks, typename TMuons>
+  void runBarrelMuonPooled(TEvents const& events, TTracks const& tracks, TMuons const& muons, RunMixingPool& pool)
+  {
+    auto track = tracks.begin();
+    auto muon = muons.begin();
+    for (auto& event : events) {
+      checkPoolRun(event, pool);
+      fillSnapshot<false>(track, tracks, event.globalIndex(), fCurrentTracks);
+      fillSnapshot<true>(muon, muons, event.globalIndex(), fCurrentMuons);
+      const int bin = event.mixingHash();
+      if (bin < 0) { // event outside the mixing categories
+        continue;
+      }
+
+      VarManager::ResetValues(0, VarManager::kNVars);
+      VarManager::FillEvent<TEventFillMap>(event, VarManager::fgValues);
+      DQPooledTracks currentMuons(&fCurrentMuons);
+      for (int i = 0; i < pool.pool.size(bin); i++) {
+        runPooledPairing<pairTypeEMu, TEventFillMap>(pool.pool.event(bin, i), currentMuons);
+      }
+      pool.pool.addEvent(bin, DQPooledTracks(&fCurrentTracks), [](DQPooledTrack const& t) { return t.snapshot(); });
+    }
+  }
+
   Preslice<soa::Filtered<MyBarrelTracksSelected>> perEventsSelectedT = aod::reducedtrack::reducedeventId;
   Preslice<soa::Filtered<MyMuonTracksSelected>> perEventsSelectedM = aod::reducedmuon::reducedeventId;
 
   void processBarrelSkimmed(soa::Filtered<MyEventsHashSelected>& events, soa::Filtered<MyBarrelTracksSelected> const& tracks)
   {
-    runSameSide<pairTypeEE, gkEventFillMap>(events, tracks, perEventsSelectedT);
+    if (fConfigUseMixingPools) {
+      runSameSidePooled<pairTypeEE, gkEventFillMap>(events, tracks, fBarrelPool);
+    } else {
+      runSameSide<pairTypeEE, gkEventFillMap>(events, tracks, perEventsSelectedT);
+    }
   }
   void processMuonSkimmed(soa::Filtered<MyEventsHashSelected>& events, soa::Filtered<MyMuonTracksSelected> const& muons)
   {
-    runSameSide<pairTypeMuMu, gkEventFillMap>(events, muons, perEventsSelectedM);
+    if (fConfigUseMixingPools) {
+      runSameSidePooled<pairTypeMuMu, gkEventFillMap>(events, muons, fMuonPool);
+    } else {
+      runSameSide<pairTypeMuMu, gkEventFillMap>(events, muons, perEventsSelectedM);
+    }
   }
   void processBarrelMuonSkimmed(soa::Filtered<MyEventsHashSelected>& events, soa::Filtered<MyBarrelTracksSelected> const& tracks, soa::Filtered<MyMuonTracksSelected> const& muons)
   {
-    runBarrelMuon<gkEventFillMap>(events, tracks, muons);
+    if (fConfigUseMixingPools) {
+      runBarrelMuonPooled<gkEventFillMap>(events, tracks, muons, fBarrelMuonPool);
+    } else {
+      runBarrelMuon<gkEventFillMap>(events, tracks, muons);
+    }
   }
   void processBarrelVnSkimmed(soa::Filtered<MyEventsHashSelectedQvector>& events, soa::Filtered<MyBarrelTracksSelected> const& tracks)
   {
-    runSameSide<pairTypeEE, gkEventFillMapWithQvector>(events, tracks, perEventsSelectedT);
+    if (fConfigUseMixingPools) {
+      runSameSidePooled<pairTypeEE, gkEventFillMapWithQvector>(events, tracks, fBarrelVnPool);
+    } else {
+      runSameSide<pairTypeEE, gkEventFillMapWithQvector>(events, tracks, perEventsSelectedT);
+    }
   }
   void processMuonVnSkimmed(soa::Filtered<MyEventsHashSelectedQvector>& events, soa::Filtered<MyMuonTracksSelected> const& muons)
   {
-    runSameSide<pairTypeMuMu, gkEventFillMapWithQvector>(events, muons, perEventsSelectedM);
+    if (fConfigUseMixingPools) {
+      runSameSidePooled<pairTypeMuMu, gkEventFillMapWithQvector>(events, muons, fMuonVnPool);
+    } else {
+      runSameSide<pairTypeMuMu, gkEventFillMapWithQvector>(events, muons, perEventsSelectedM);
+    }
   }
   // TODO: This is a dummy process function for the case when the user does not want to run any of the process functions (no event mixing)
   //    If there is no process function enabled, the workflow hangs
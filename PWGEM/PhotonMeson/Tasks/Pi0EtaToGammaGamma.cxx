@@ -15,6 +15,7 @@
 //    Please write to: daiki.sekihata@cern.ch
 
 #include <cstring>
+#include <unordered_map>
 
 #include "TString.h"
 #include "Math/Vector4D.h"
@@ -35,6 +36,7 @@
 #include "Common/DataModel/PIDResponse.h"
 #include "Common/Core/RecoDecay.h"
 #include "PWGEM/PhotonMeson/Utils/PCMUtilities.h"
+#include "PWGEM/PhotonMeson/Utils/PairUtilities.h"
 #include "PWGEM/PhotonMeson/DataModel/gammaTables.h"
 #include "PWGEM/PhotonMeson/Core/V0PhotonCut.h"
 #include "PWGEM/PhotonMeson/Core/EMCPhotonCut.h"
@@ -45,6 +47,7 @@ using namespace o2;
 using namespace o2::framework;
 using namespace o2::framework::expressions;
 using namespace o2::soa;
+using namespace o2::aod::photonpair;
 
 // namespace o2::aod
 //{
@@ -131,6 +134,14 @@ struct Pi0EtaToGammaGamma {
 
   std::vector<EMCPhotonCut> fEMCCuts;
 
+  // per-collision photon four-momenta and pair buffer, reused between collisions
+  PhotonCache fPhotonCache1;
+  PhotonCache fPhotonCache2;
+  PhotonCache fRotatedPhotons;
+  PairBuffer fPairBuffer;
+  std::unordered_map<int, PhotonCache> fMixingCache1;
+  std::unordered_map<int, PhotonCache> fMixingCache2;
+
   void init(InitContext& context)
   {
     addhistograms();
@@ -220,26 +231,15 @@ struct Pi0EtaToGammaGamma {
       registry.fill(HIST(pairnames[itmp]) + HIST("/hNgamma2"), photons2_coll.size());
       // LOGF(info, "Number of photon candidates in a collision: %d", photons1_coll.size());
 
-      if (pairtype == PairType::kPCMPCM || pairtype == PairType::kPHOSPHOS || pairtype == PairType::kEMCEMC) {
-        for (auto& [g1, g2] : combinations(CombinationsStrictlyUpperIndexPolicy(photons1_coll, photons2_coll))) {
-
-          ROOT::Math::PtEtaPhiMVector v1(g1.pt(), g1.eta(), g1.phi(), 0.);
-          ROOT::Math::PtEtaPhiMVector v2(g2.pt(), g2.eta(), g2.phi(), 0.);
-          ROOT::Math::PtEtaPhiMVector v12 = v1 + v2;
-          registry.fill(HIST(pairnames[itmp]) + HIST("/h2MggPt_Same"), v12.M(), v12.Pt());
-
-        } // end of combination
-
+      constexpr bool sameDetector = pairtype == PairType::kPCMPCM || pairtype == PairType::kPHOSPHOS || pairtype == PairType::kEMCEMC;
+      fPhotonCache1.fill(photons1_coll);
+      if constexpr (sameDetector) {
+        computePairs(fPhotonCache1, fPhotonCache1, true, fPairBuffer);
       } else {
-        for (auto& [g1, g2] : combinations(CombinationsFullIndexPolicy(photons1_coll, photons2_coll))) {
-
-          ROOT::Math::PtEtaPhiMVector v1(g1.pt(), g1.eta(), g1.phi(), 0.);
-          ROOT::Math::PtEtaPhiMVector v2(g2.pt(), g2.eta(), g2.phi(), 0.);
-          ROOT::Math::PtEtaPhiMVector v12 = v1 + v2;
-          registry.fill(HIST(pairnames[itmp]) + HIST("/h2MggPt_Same"), v12.M(), v12.Pt());
-
-        } // end of combination
+        fPhotonCache2.fill(photons2_coll);
+        computePairs(fPhotonCache1, fPhotonCache2, false, fPairBuffer);
       }
+      fillPairs(registry.get<TH2>(HIST(pairnames[itmp]) + HIST("/h2MggPt_Same")).get(), fPairBuffer);
 
     } // end of collision loop
   }
@@ -269,16 +269,22 @@ struct Pi0EtaToGammaGamma {
       registry.fill(HIST("EMCEMC/hNgamma2"), photons_coll.size());
       // LOGF(info, "Number of photon candidates in a collision: %d", photons_coll.size());
 
-      for (auto& [g1, g2] : combinations(CombinationsStrictlyUpperIndexPolicy(photons_coll, photons_coll))) {
-
-        ROOT::Math::PtEtaPhiMVector v1(g1.pt(), g1.eta(), g1.phi(), 0.);
-        ROOT::Math::PtEtaPhiMVector v2(g2.pt(), g2.eta(), g2.phi(), 0.);
-        ROOT::Math::PtEtaPhiMVector v12 = v1 + v2;
-        registry.fill(HIST("EMCEMC/h2MggPt_Same"), v12.M(), v12.Pt());
+      fPhotonCache1.fill(photons_coll);
+      computePairs(fPhotonCache1, fPhotonCache1, true, fPairBuffer);
+      fillPairs(registry.get<TH2>(HIST("EMCEMC/h2MggPt_Same")).get(), fPairBuffer);
 
-        RotationBackground<aod::SkimEMCClusters, aod::EMReducedEvent>(v12, v1, v2, photons_coll, collision, g1.globalIndex(), g2.globalIndex());
-      } // end of combination
-    }   // end of collision loop
+      // if less than 3 clusters are present skip event since we need at least 3 clusters
+      if (fPhotonCache1.size() < 3) {
+        continue;
+      }
+      fPairBuffer.clear();
+      for (size_t i1 = 0; i1 < fPhotonCache1.size(); i1++) {
+        for (size_t i2 = i1 + 1; i2 < fPhotonCache1.size(); i2++) {
+          RotationBackground(fPhotonCache1, i1, i2, fPairBuffer);
+        } // end of combination
+      }
+      fillPairs(registry.get<TH2>(HIST("EMCEMC/h2MggPt_Rotated")).get(), fPairBuffer);
+    } // end of collision loop
   }
 
   Configurable<int> ndepth{"ndepth", 10, "depth for event mixing"};
@@ -291,79 +297,69 @@ struct Pi0EtaToGammaGamma {
   {
     constexpr int itmp = pairtype;
     // LOGF(info, "Number of collisions after filtering: %d", collisions.size());
+    // every collision enters up to ndepth pairs, hence the photons are converted once per collision
+    // for the same detector both photons come from the same table and share the cache
+    constexpr bool sameDetector = pairtype == PairType::kPCMPCM || pairtype == PairType::kPHOSPHOS || pairtype == PairType::kEMCEMC;
+    fMixingCache1.clear();
+    fMixingCache2.clear();
+    auto getPhotons = [](auto& cache, auto const& photons, auto const& perCollision, int collisionId) -> PhotonCache const& {
+      auto [it, inserted] = cache.try_emplace(collisionId);
+      if (inserted) {
+        it->second.fill(photons.sliceBy(perCollision, collisionId));
+      }
+      return it->second;
+    };
+
+    auto hMixed = registry.get<TH2>(HIST(pairnames[itmp]) + HIST("/h2MggPt_Mixed"));
     for (auto& [collision1, collision2] : soa::selfCombinations(colBinning, ndepth, -1, collisions, collisions)) {
       // LOGF(info, "Mixed event collisionId: (%d, %d)", collision1.collisionId(), collision2.collisionId());
-      auto photons_coll1 = photons1.sliceBy(perCollision1, collision1.collisionId());
-      auto photons_coll2 = photons2.sliceBy(perCollision2, collision2.collisionId());
+      auto const& photons_coll1 = getPhotons(fMixingCache1, photons1, perCollision1, collision1.collisionId());
+      auto const& photons_coll2 = getPhotons(sameDetector ? fMixingCache1 : fMixingCache2, photons2, perCollision2, collision2.collisionId());
       // LOGF(info, "collision1: posZ = %f, numContrib = %d , sel8 = %d, ngpcm = %d , ngphos = %d , ngemc = %d", collision1.posZ(), collision1.numContrib(), collision1.sel8(), collision1.ngpcm(), collision1.ngphos(), collision1.ngemc());
 
-      for (auto& [g1, g2] : combinations(soa::CombinationsFullIndexPolicy(photons_coll1, photons_coll2))) {
-        // LOGF(info, "Mixed event photon pair: (%d, %d) from events (%d, %d), photon event: (%d, %d)", g1.index(), g2.index(), collision1.index(), collision2.index(), g1.collisionId(), g2.collisionId());
-
-        ROOT::Math::PtEtaPhiMVector v1(g1.pt(), g1.eta(), g1.phi(), 0.);
-        ROOT::Math::PtEtaPhiMVector v2(g2.pt(), g2.eta(), g2.phi(), 0.);
-        ROOT::Math::PtEtaPhiMVector v12 = v1 + v2;
-        registry.fill(HIST(pairnames[itmp]) + HIST("/h2MggPt_Mixed"), v12.M(), v12.Pt());
-
-      } // end of different photon combinations
-
+      computePairs(photons_coll1, photons_coll2, false, fPairBuffer);
+      fillPairs(hMixed.get(), fPairBuffer);
     } // end of different collision combinations
   }
 
-  /// \brief Calculate background (using rotation background method only for EMCal!)
-  template <typename TPhotons, typename TEvent>
-  void RotationBackground(const ROOT::Math::PtEtaPhiMVector& meson, ROOT::Math::PtEtaPhiMVector photon1, ROOT::Math::PtEtaPhiMVector photon2, TPhotons const& photons_coll, TEvent const& collision, unsigned int ig1, unsigned int ig2)
+  /// \brief Fill the mass and pT of the buffered pairs in one go
+  void fillPairs(TH2* hist, PairBuffer const& pairs)
   {
-    // if less than 3 clusters are present skip event since we need at least 3 clusters
-    if (photons_coll.size() < 3) {
-      return;
+    if (pairs.size() > 0) {
+      hist->FillN(pairs.size(), pairs.mass.data(), pairs.pt.data(), nullptr);
     }
+  }
+
+  /// \brief Calculate background (using rotation background method only for EMCal!)
+  /// The photons i1 and i2 are rotated by 90 degrees around their pair momentum and combined with the other photons of the collision
+  void RotationBackground(PhotonCache const& photons, size_t i1, size_t i2, PairBuffer& pairs)
+  {
     const double rotationAngle = M_PI / 2.0; // rotaion angle 90°
-    // ROOT::Math::XYZVector meson3D(meson.Px(), meson.Py(), meson.Pz());
+    ROOT::Math::PxPyPzEVector photon1(photons.px[i1], photons.py[i1], photons.pz[i1], photons.e[i1]);
+    ROOT::Math::PxPyPzEVector photon2(photons.px[i2], photons.py[i2], photons.pz[i2], photons.e[i2]);
+    ROOT::Math::PxPyPzEVector meson = photon1 + photon2;
     ROOT::Math::AxisAngle rotationAxis(meson.Vect(), rotationAngle);
-    // LOG(info) << "rotationAxis.Angle() = " << rotationAxis.Angle();
     ROOT::Math::Rotation3D rotationMatrix(rotationAxis);
-    // ROOT::Math::XYZVector test(photon1.Px(), photon1.Py(), photon1.Pz());
-    // ROOT::Math::XYZVector photon1_3D(photon1.Px(), photon1.Py(), photon1.Pz());
-    // ROOT::Math::XYZVector photon2_3D(photon2.Px(), photon2.Py(), photon2.Pz());
-
-    // float openingAngleTest = std::acos(photon1_3D.Dot(test) / (std::sqrt(photon1_3D.Mag2()) * std::sqrt(test.Mag2())));
-    // LOG(info) << "openingAngleTest before rotation = " << openingAngleTest;
     photon1 = rotationMatrix * photon1;
     photon2 = rotationMatrix * photon2;
 
-    // openingAngleTest = std::acos(photon1_3D.Dot(test) / (std::sqrt(photon1_3D.Mag2()) * std::sqrt(test.Mag2())));
-    // LOG(info) << "openingAngleTest = " << openingAngleTest;
+    auto& rotated = fRotatedPhotons;
+    rotated.px = {static_cast<float>(photon1.Px()), static_cast<float>(photon2.Px())};
+    rotated.py = {static_cast<float>(photon1.Py()), static_cast<float>(photon2.Py())};
+    rotated.pz = {static_cast<float>(photon1.Pz()), static_cast<float>(photon2.Pz())};
+    rotated.e = {static_cast<float>(photon1.E()), static_cast<float>(photon2.E())};
 
-    for (auto& photon : photons_coll) {
-      if (photon.globalIndex() == ig1 || photon.globalIndex() == ig2) {
+    for (size_t i3 = 0; i3 < photons.size(); i3++) {
+      if (i3 == i1 || i3 == i2) {
         // only combine rotated photons with other photons
         continue;
       }
-      ROOT::Math::PtEtaPhiMVector photon3;
-      photon3.SetPt(photon.pt());
-      photon3.SetEta(photon.eta());
-      photon3.SetPhi(photon.phi());
-      photon3.SetM(0.);
-      // ROOT::Math::XYZVector photon3_3D(photon3.Px(), photon3.Py(), photon3.Pz());
-      ROOT::Math::PtEtaPhiMVector mother1 = photon1 + photon3;
-      ROOT::Math::PtEtaPhiMVector mother2 = photon2 + photon3;
-
-      float openingAngle1 = std::acos(photon1.Vect().Dot(photon3.Vect()) / (photon1.P() * photon3.P()));
-      float openingAngle2 = std::acos(photon2.Vect().Dot(photon3.Vect()) / (photon2.P() * photon3.P()));
-      // float openingAngle1_1 = std::acos(photon1_3D.Dot(photon3_3D) / (std::sqrt(photon1_3D.Mag2()) * std::sqrt(photon3_3D.Mag2())));
-      // float openingAngle2_2 = std::acos(photon2_3D.Dot(photon3_3D) / (std::sqrt(photon2_3D.Mag2()) * std::sqrt(photon3_3D.Mag2())));
-      // LOG(info) << "openingAngle1 = " << openingAngle1;
-      // LOG(info) << "openingAngle2 = " << openingAngle2;
-      // LOG(info) << "openingAngle1_1 = " << openingAngle1_1;
-      // LOG(info) << "openingAngle2_2 = " << openingAngle2_2;
-
-      // Fill histograms
-      if (openingAngle1 > minOpenAngle) {
-        registry.fill(HIST("EMCEMC/h2MggPt_Rotated"), mother1.M(), mother1.Pt());
-      }
-      if (openingAngle2 > minOpenAngle) {
-        registry.fill(HIST("EMCEMC/h2MggPt_Rotated"), mother2.M(), mother2.Pt());
+      // photons are massless, hence |p| = E
+      for (size_t iRotated = 0; iRotated < 2; iRotated++) {
+        const float cosOpeningAngle = (rotated.px[iRotated] * photons.px[i3] + rotated.py[iRotated] * photons.py[i3] + rotated.pz[iRotated] * photons.pz[i3]) / (rotated.e[iRotated] * photons.e[i3]);
+        if (std::acos(cosOpeningAngle) > minOpenAngle) {
+          addPair(rotated, iRotated, photons, i3, pairs);
+        }
       }
     }
   }
@@ -0,0 +1,101 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \commonly used for photon pairing in neutral meson analyses.
+
+#ifndef PWGEM_PHOTONMESON_UTILS_PAIRUTILITIES_H_
+#define PWGEM_PHOTONMESON_UTILS_PAIRUTILITIES_H_
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace o2::aod::photonpair
+{
+//_______________________________________________________________________
+/// Cartesian four-momenta of the (massless) photons of one collision,
+/// so that the trigonometric functions are evaluated once per photon and not once per pair.
+struct PhotonCache {
+  std::vector<float> px;
+  std::vector<float> py;
+  std::vector<float> pz;
+  std::vector<float> e;
+
+  size_t size() const { return e.size(); }
+
+  template <typename TPhotons>
+  void fill(TPhotons const& photons)
+  {
+    const size_t n = photons.size();
+    px.resize(n);
+    py.resize(n);
+    pz.resize(n);
+    e.resize(n);
+    size_t i = 0;
+    for (auto& photon : photons) {
+      const float pt = photon.pt();
+      const float eta = photon.eta();
+      const float phi = photon.phi();
+      px[i] = pt * std::cos(phi);
+      py[i] = pt * std::sin(phi);
+      pz[i] = pt * std::sinh(eta);
+      e[i] = pt * std::cosh(eta);
+      i++;
+    }
+  }
+};
+
+//_______________________________________________________________________
+/// Invariant mass and transverse momentum of the pairs of one slice, ready for TH2::FillN
+struct PairBuffer {
+  std::vector<double> mass;
+  std::vector<double> pt;
+
+  size_t size() const { return mass.size(); }
+  void clear()
+  {
+    mass.clear();
+    pt.clear();
+  }
+};
+
+//_______________________________________________________________________
+/// Appends mass and pT of the pair (i, j) to the buffer
+inline void addPair(PhotonCache const& photons1, size_t i, PhotonCache const& photons2, size_t j, PairBuffer& pairs)
+{
+  const float px = photons1.px[i] + photons2.px[j];
+  const float py = photons1.py[i] + photons2.py[j];
+  // for massless photons M^2 = 2 (E1 E2 - p1.p2), which avoids the cancellation in E^2 - p^2
+  const float m2 = 2.f * (photons1.e[i] * photons2.e[j] - photons1.px[i] * photons2.px[j] - photons1.py[i] * photons2.py[j] - photons1.pz[i] * photons2.pz[j]);
+  pairs.mass.push_back(m2 > 0.f ? std::sqrt(m2) : -std::sqrt(-m2));
+  pairs.pt.push_back(std::sqrt(px * px + py * py));
+}
+
+//_______________________________________________________________________
+/// Computes mass and pT of all photon pairs between two slices.
+/// If strictlyUpper is set, both caches are the same slice and only pairs i < j are built.
+inline void computePairs(PhotonCache const& photons1, PhotonCache const& photons2, bool strictlyUpper, PairBuffer& pairs)
+{
+  pairs.clear();
+  const size_t n1 = photons1.size();
+  const size_t n2 = photons2.size();
+  const size_t nPairs = strictlyUpper ? (n1 > 1 ? n1 * (n1 - 1) / 2 : 0) : n1 * n2;
+  pairs.mass.reserve(nPairs);
+  pairs.pt.reserve(nPairs);
+  for (size_t i = 0; i < n1; i++) {
+    for (size_t j = strictlyUpper ? i + 1 : 0; j < n2; j++) {
+      addPair(photons1, i, photons2, j, pairs);
+    }
+  }
+}
+} // namespace o2::aod::photonpair
+
+#endif // PWGEM_PHOTONMESON_UTILS_PAIRUTILITIES_H_
@@ -18,6 +18,8 @@
 #ifndef PWGHF_DATAMODEL_CANDIDATERECONSTRUCTIONTABLES_H_
 #define PWGHF_DATAMODEL_CANDIDATERECONSTRUCTIONTABLES_H_
 
+#include <cstring>
+
 #include <Math/Vector4D.h>
 #include <Math/GenVector/Boost.h>
 
@@ -238,6 +240,119 @@ DECLARE_SOA_TABLE(HfPvRefit3Prong, "AOD", "HFPVREFIT3PRONG", //!
                   hf_pv_refit_cand_3prong::PvRefitSigmaYZ,
                   hf_pv_refit_cand_3prong::PvRefitSigmaZ2);
 
+namespace hf_skim_vertex
+{
+DECLARE_SOA_COLUMN(FitterConfigHash, fitterConfigHash, uint32_t);        //! hash of the vertex-fitter configuration, see getFitterConfigHash
+DECLARE_SOA_COLUMN(XSecondaryVertex, xSecondaryVertex, float);           //!
+DECLARE_SOA_COLUMN(YSecondaryVertex, ySecondaryVertex, float);           //!
+DECLARE_SOA_COLUMN(ZSecondaryVertex, zSecondaryVertex, float);           //!
+DECLARE_SOA_COLUMN(Chi2PCA, chi2PCA, float);                             //!
+DECLARE_SOA_COLUMN(CovSvXX, covSvXX, float);                             //! covariance matrix of the secondary vertex
+DECLARE_SOA_COLUMN(CovSvXY, covSvXY, float);                             //!
+DECLARE_SOA_COLUMN(CovSvYY, covSvYY, float);                             //!
+DECLARE_SOA_COLUMN(CovSvXZ, covSvXZ, float);                             //!
+DECLARE_SOA_COLUMN(CovSvYZ, covSvYZ, float);                             //!
+DECLARE_SOA_COLUMN(CovSvZZ, covSvZZ, float);                             //!
+DECLARE_SOA_COLUMN(PxProng0, pxProng0, float);                           //! momentum of the prong at the PCA
+DECLARE_SOA_COLUMN(PyProng0, pyProng0, float);                           //!
+DECLARE_SOA_COLUMN(PzProng0, pzProng0, float);                           //!
+DECLARE_SOA_COLUMN(ImpactParameter0, impactParameter0, float);           //! impact parameter of the prong in xy
+DECLARE_SOA_COLUMN(ImpactParameterZ0, impactParameterZ0, float);         //! impact parameter of the prong in z
+DECLARE_SOA_COLUMN(ImpactParameterCovYY0, impactParameterCovYY0, float); //! variance of the impact parameter in xy
+DECLARE_SOA_COLUMN(PxProng1, pxProng1, float);                           //! momentum of the prong at the PCA
+DECLARE_SOA_COLUMN(PyProng1, pyProng1, float);                           //!
+DECLARE_SOA_COLUMN(PzProng1, pzProng1, float);                           //!
+DECLARE_SOA_COLUMN(ImpactParameter1, impactParameter1, float);           //! impact parameter of the prong in xy
+DECLARE_SOA_COLUMN(ImpactParameterZ1, impactParameterZ1, float);         //! impact parameter of the prong in z
+DECLARE_SOA_COLUMN(ImpactParameterCovYY1, impactParameterCovYY1, float); //! variance of the impact parameter in xy
+DECLARE_SOA_COLUMN(PxProng2, pxProng2, float);                           //! momentum of the prong at the PCA
+DECLARE_SOA_COLUMN(PyProng2, pyProng2, float);                           //!
+DECLARE_SOA_COLUMN(PzProng2, pzProng2, float);                           //!
+DECLARE_SOA_COLUMN(ImpactParameter2, impactParameter2, float);           //! impact parameter of the prong in xy
+DECLARE_SOA_COLUMN(ImpactParameterZ2, impactParameterZ2, float);         //! impact parameter of the prong in z
+DECLARE_SOA_COLUMN(ImpactParameterCovYY2, impactParameterCovYY2, float); //! variance of the impact parameter in xy
+
+/// Hash of the settings which determine the result of the vertex fit and of the impact parameters of the prongs,
+/// used by the candidate creators to check that the vertices fitted in the skimming can be reused
+inline uint32_t getFitterConfigHash(bool propagateToPCA, bool useAbsDCA, bool useWeightedFinalPCA, double maxR, double maxDZIni,
+                                    double minParamChange, double minRelChi2Change, bool doPvRefit)
+{
+  uint32_t hash = 2166136261u; // FNV-1a
+  auto add = [&hash](auto value) {
+    unsigned char bytes[sizeof(value)];
+    std::memcpy(bytes, &value, sizeof(value));
+    for (const auto byte : bytes) {
+      hash = (hash ^ byte) * 16777619u;
+    }
+  };
+  add(propagateToPCA);
+  add(useAbsDCA);
+  add(useWeightedFinalPCA);
+  add(maxR);
+  add(maxDZIni);
+  add(minParamChange);
+  add(minRelChi2Change);
+  add(doPvRefit);
+  return hash;
+}
+} // namespace hf_skim_vertex
+
+DECLARE_SOA_TABLE(HfSkimVtx2Prong, "AOD", "HFSKIMVTX2PRONG", //! Vertex fit of the HF 2-prong candidates, joinable with Hf2Prongs
+                  hf_skim_vertex::FitterConfigHash,
+                  hf_skim_vertex::XSecondaryVertex,
+                  hf_skim_vertex::YSecondaryVertex,
+                  hf_skim_vertex::ZSecondaryVertex,
+                  hf_skim_vertex::Chi2PCA,
+                  hf_skim_vertex::CovSvXX,
+                  hf_skim_vertex::CovSvXY,
+                  hf_skim_vertex::CovSvYY,
+                  hf_skim_vertex::CovSvXZ,
+                  hf_skim_vertex::CovSvYZ,
+                  hf_skim_vertex::CovSvZZ,
+                  hf_skim_vertex::PxProng0,
+                  hf_skim_vertex::PyProng0,
+                  hf_skim_vertex::PzProng0,
+                  hf_skim_vertex::ImpactParameter0,
+                  hf_skim_vertex::ImpactParameterZ0,
+                  hf_skim_vertex::ImpactParameterCovYY0,
+                  hf_skim_vertex::PxProng1,
+                  hf_skim_vertex::PyProng1,
+                  hf_skim_vertex::PzProng1,
+                  hf_skim_vertex::ImpactParameter1,
+                  hf_skim_vertex::ImpactParameterZ1,
+                  hf_skim_vertex::ImpactParameterCovYY1);
+
+DECLARE_SOA_TABLE(HfSkimVtx3Prong, "AOD", "HFSKIMVTX3PRONG", //! Vertex fit of the HF 3-prong candidates, joinable with Hf3Prongs
+                  hf_skim_vertex::FitterConfigHash,
+                  hf_skim_vertex::XSecondaryVertex,
+                  hf_skim_vertex::YSecondaryVertex,
+                  hf_skim_vertex::ZSecondaryVertex,
+                  hf_skim_vertex::Chi2PCA,
+                  hf_skim_vertex::CovSvXX,
+                  hf_skim_vertex::CovSvXY,
+                  hf_skim_vertex::CovSvYY,
+                  hf_skim_vertex::CovSvXZ,
+                  hf_skim_vertex::CovSvYZ,
+                  hf_skim_vertex::CovSvZZ,
+                  hf_skim_vertex::PxProng0,
+                  hf_skim_vertex::PyProng0,
+                  hf_skim_vertex::PzProng0,
+                  hf_skim_vertex::ImpactParameter0,
+                  hf_skim_vertex::ImpactParameterZ0,
+                  hf_skim_vertex::ImpactParameterCovYY0,
+                  hf_skim_vertex::PxProng1,
+                  hf_skim_vertex::PyProng1,
+                  hf_skim_vertex::PzProng1,
+                  hf_skim_vertex::ImpactParameter1,
+                  hf_skim_vertex::ImpactParameterZ1,
+                  hf_skim_vertex::ImpactParameterCovYY1,
+                  hf_skim_vertex::PxProng2,
+                  hf_skim_vertex::PyProng2,
+                  hf_skim_vertex::PzProng2,
+                  hf_skim_vertex::ImpactParameter2,
+                  hf_skim_vertex::ImpactParameterZ2,
+                  hf_skim_vertex::ImpactParameterCovYY2);
+
 // general decay properties
 namespace hf_cand
 {
@@ -16,6 +16,7 @@
 /// \author Vít Kučera <vit.kucera@cern.ch>, CERN
 
 #include "Framework/AnalysisTask.h"
+#include "Framework/RunningWorkflowInfo.h"
 #include "DCAFitter/DCAFitterN.h"
 #include "PWGHF/DataModel/CandidateReconstructionTables.h"
 #include "PWGHF/Utils/utilsBfieldCCDB.h"
@@ -64,6 +65,8 @@ struct HfCandidateCreator2Prong {
   double massPiK{0.};
   double massKPi{0.};
   double bz = 0.;
+  uint32_t vertexFitterConfigHash = 0; // to be compared with the one of the vertex fits of the skimming
+  bool hasWarnedAboutConfigHash = false;
 
   OutputObj<TH1F> hMass2{TH1F("hMass2", "2-prong candidates;inv. mass (#pi K) (GeV/#it{c}^{2});entries", 500, 0., 5.)};
   OutputObj<TH1F> hCovPVXX{TH1F("hCovPVXX", "2-prong candidates;XX element of cov. matrix of prim. vtx. position (cm^{2});entries", 100, 0., 1.e-4)};
@@ -77,7 +80,7 @@ struct HfCandidateCreator2Prong {
   OutputObj<TH2F> hDcaXYProngs{TH2F("hDcaXYProngs", "DCAxy of 2-prong candidates;#it{p}_{T} (GeV/#it{c};#it{d}_{xy}) (#mum);entries", 100, 0., 20., 200, -500., 500.)};
   OutputObj<TH2F> hDcaZProngs{TH2F("hDcaZProngs", "DCAz of 2-prong candidates;#it{p}_{T} (GeV/#it{c};#it{d}_{z}) (#mum);entries", 100, 0., 20., 200, -500., 500.)};
 
-  void init(InitContext const&)
+  void init(InitContext& initContext)
   {
     ccdb->setURL(ccdbUrl);
     ccdb->setCaching(true);
@@ -87,12 +90,36 @@ struct HfCandidateCreator2Prong {
       ccdb->get<TGeoManager>(ccdbPathGeo);
     }
     runNumber = 0;
+
+    if (doprocessRefit == doprocessSkimVertexFit) {
+      LOGP(fatal, "Exactly one of processRefit and processSkimVertexFit has to be enabled");
+    }
+    if (doprocessSkimVertexFit) {
+      // without fillVertexFit the skimming produces an empty HfSkimVtx2Prong table, which cannot be joined with the candidates
+      bool isSkimInWorkflow = false;
+      auto& workflows = initContext.services().get<RunningWorkflowInfo const>();
+      for (const DeviceSpec& device : workflows.devices) {
+        if (device.name != "hf-track-index-skim-creator") {
+          continue;
+        }
+        isSkimInWorkflow = true;
+        for (const auto& option : device.options) {
+          if (option.name == "fillVertexFit" && !option.defaultValue.get<bool>()) {
+            LOGP(fatal, "processSkimVertexFit needs the HfSkimVtx2Prong table: enable fillVertexFit in hf-track-index-skim-creator, or use processRefit");
+          }
+        }
+      }
+      if (!isSkimInWorkflow) {
+        LOGP(info, "hf-track-index-skim-creator is not in the workflow: the input HfSkimVtx2Prong table must have been produced with fillVertexFit enabled");
+      }
+    }
+    vertexFitterConfigHash = aod::hf_skim_vertex::getFitterConfigHash(propagateToPCA, useAbsDCA, useWeightedFinalPCA, maxR, maxDZIni, minParamChange, minRelChi2Change, doPvRefit);
   }
 
-  void process(aod::Collisions const& collisions,
-               soa::Join<aod::Hf2Prongs, aod::HfPvRefit2Prong> const& rowsTrackIndexProng2,
-               aod::BigTracks const& tracks,
-               aod::BCsWithTimestamps const& bcWithTimeStamps)
+  /// Reconstructs the candidates, with the vertex fit of the skimming if available and done with the same settings
+  /// \tparam useSkimVertexFit whether the table with the vertex fits of the skimming is joined with the candidate indices
+  template <bool useSkimVertexFit, typename TRows>
+  void runCreator2Prong(TRows const& rowsTrackIndexProng2)
   {
     // 2-prong vertex fitter
     o2::vertexing::DCAFitterN<2> df;
@@ -107,16 +134,14 @@ struct HfCandidateCreator2Prong {
 
     // loop over pairs of track indices
     for (const auto& rowTrackIndexProng2 : rowsTrackIndexProng2) {
-      auto track0 = rowTrackIndexProng2.prong0_as<aod::BigTracks>();
-      auto track1 = rowTrackIndexProng2.prong1_as<aod::BigTracks>();
-      auto trackParVarPos1 = getTrackParCov(track0);
-      auto trackParVarNeg1 = getTrackParCov(track1);
+      auto track0 = rowTrackIndexProng2.template prong0_as<aod::BigTracks>();
+      auto track1 = rowTrackIndexProng2.template prong1_as<aod::BigTracks>();
       auto collision = rowTrackIndexProng2.collision();
 
       /// Set the magnetic field from ccdb.
       /// The static instance of the propagator was already modified in the HFTrackIndexSkimCreator,
       /// but this is not true when running on Run2 data/MC already converted into AO2Ds.
-      auto bc = collision.bc_as<aod::BCsWithTimestamps>();
+      auto bc = collision.template bc_as<aod::BCsWithTimestamps>();
       if (runNumber != bc.runNumber()) {
         LOG(info) << ">>>>>>>>>>>> Current run number: " << runNumber;
         initCCDB(bc, runNumber, ccdb, isRun2 ? ccdbPathGrp : ccdbPathGrpMag, lut, isRun2);
@@ -127,28 +152,6 @@ struct HfCandidateCreator2Prong {
       }
       df.setBz(bz);
 
-      // reconstruct the 2-prong secondary vertex
-      if (df.process(trackParVarPos1, trackParVarNeg1) == 0) {
-        continue;
-      }
-      const auto& secondaryVertex = df.getPCACandidate();
-      auto chi2PCA = df.getChi2AtPCACandidate();
-      auto covMatrixPCA = df.calcPCACovMatrixFlat();
-      hCovSVXX->Fill(covMatrixPCA[0]); // FIXME: Calculation of errorDecayLength(XY) gives wrong values without this line.
-      hCovSVYY->Fill(covMatrixPCA[2]);
-      hCovSVXZ->Fill(covMatrixPCA[3]);
-      hCovSVZZ->Fill(covMatrixPCA[5]);
-      auto trackParVar0 = df.getTrack(0);
-      auto trackParVar1 = df.getTrack(1);
-
-      // get track momenta
-      array<float, 3> pvec0;
-      array<float, 3> pvec1;
-      trackParVar0.getPxPyPzGlo(pvec0);
-      trackParVar1.getPxPyPzGlo(pvec1);
-
-      // get track impact parameters
-      // This modifies track momenta!
       auto primaryVertex = getPrimaryVertex(collision);
       auto covMatrixPV = primaryVertex.getCov();
       if (doPvRefit) {
@@ -167,14 +170,65 @@ struct HfCandidateCreator2Prong {
         primaryVertex.setSigmaZ2(rowTrackIndexProng2.pvRefitSigmaZ2());
         covMatrixPV = primaryVertex.getCov();
       }
+
+      array<double, 3> secondaryVertex;
+      float chi2PCA;
+      array<float, 6> covMatrixPCA;
+      array<float, 3> pvec0;
+      array<float, 3> pvec1;
+      o2::dataformats::DCA impactParameter0;
+      o2::dataformats::DCA impactParameter1;
+
+      bool hasVertexFit = false;
+      if constexpr (useSkimVertexFit) {
+        // the skimming fitted the vertex with the same settings, nothing to redo
+        if (rowTrackIndexProng2.fitterConfigHash() == vertexFitterConfigHash) {
+          hasVertexFit = true;
+          secondaryVertex = {rowTrackIndexProng2.xSecondaryVertex(), rowTrackIndexProng2.ySecondaryVertex(), rowTrackIndexProng2.zSecondaryVertex()};
+          chi2PCA = rowTrackIndexProng2.chi2PCA();
+          covMatrixPCA = {rowTrackIndexProng2.covSvXX(), rowTrackIndexProng2.covSvXY(), rowTrackIndexProng2.covSvYY(), rowTrackIndexProng2.covSvXZ(), rowTrackIndexProng2.covSvYZ(), rowTrackIndexProng2.covSvZZ()};
+          pvec0 = {rowTrackIndexProng2.pxProng0(), rowTrackIndexProng2.pyProng0(), rowTrackIndexProng2.pzProng0()};
+          pvec1 = {rowTrackIndexProng2.pxProng1(), rowTrackIndexProng2.pyProng1(), rowTrackIndexProng2.pzProng1()};
+          impactParameter0.set(rowTrackIndexProng2.impactParameter0(), rowTrackIndexProng2.impactParameterZ0(), rowTrackIndexProng2.impactParameterCovYY0(), 0.f, 0.f);
+          impactParameter1.set(rowTrackIndexProng2.impactParameter1(), rowTrackIndexProng2.impactParameterZ1(), rowTrackIndexProng2.impactParameterCovYY1(), 0.f, 0.f);
+        } else if (!hasWarnedAboutConfigHash) {
+          LOG(warning) << "Vertex fits of the skimming were done with different settings, the vertices are fitted again";
+          hasWarnedAboutConfigHash = true;
+        }
+      }
+
+      if (!hasVertexFit) {
+        auto trackParVarPos1 = getTrackParCov(track0);
+        auto trackParVarNeg1 = getTrackParCov(track1);
+
+        // reconstruct the 2-prong secondary vertex
+        if (df.process(trackParVarPos1, trackParVarNeg1) == 0) {
+          continue;
+        }
+        const auto& vertexPCA = df.getPCACandidate();
+        secondaryVertex = {vertexPCA[0], vertexPCA[1], vertexPCA[2]};
+        chi2PCA = df.getChi2AtPCACandidate();
+        covMatrixPCA = df.calcPCACovMatrixFlat();
+        auto trackParVar0 = df.getTrack(0);
+        auto trackParVar1 = df.getTrack(1);
+
+        // get track momenta
+        trackParVar0.getPxPyPzGlo(pvec0);
+        trackParVar1.getPxPyPzGlo(pvec1);
+
+        // get track impact parameters
+        // This modifies track momenta!
+        trackParVar0.propagateToDCA(primaryVertex, bz, &impactParameter0);
+        trackParVar1.propagateToDCA(primaryVertex, bz, &impactParameter1);
+      }
+      hCovSVXX->Fill(covMatrixPCA[0]); // FIXME: Calculation of errorDecayLength(XY) gives wrong values without this line.
+      hCovSVYY->Fill(covMatrixPCA[2]);
+      hCovSVXZ->Fill(covMatrixPCA[3]);
+      hCovSVZZ->Fill(covMatrixPCA[5]);
       hCovPVXX->Fill(covMatrixPV[0]);
       hCovPVYY->Fill(covMatrixPV[2]);
       hCovPVXZ->Fill(covMatrixPV[3]);
       hCovPVZZ->Fill(covMatrixPV[5]);
-      o2::dataformats::DCA impactParameter0;
-      o2::dataformats::DCA impactParameter1;
-      trackParVar0.propagateToDCA(primaryVertex, bz, &impactParameter0);
-      trackParVar1.propagateToDCA(primaryVertex, bz, &impactParameter1);
       hDcaXYProngs->Fill(track0.pt(), impactParameter0.getY() * toMicrometers);
       hDcaXYProngs->Fill(track1.pt(), impactParameter1.getY() * toMicrometers);
       hDcaZProngs->Fill(track0.pt(), impactParameter0.getZ() * toMicrometers);
@@ -210,6 +264,26 @@ struct HfCandidateCreator2Prong {
       }
     }
   }
+
+  void processRefit(aod::Collisions const& collisions,
+                    soa::Join<aod::Hf2Prongs, aod::HfPvRefit2Prong> const& rowsTrackIndexProng2,
+                    aod::BigTracks const& tracks,
+                    aod::BCsWithTimestamps const& bcWithTimeStamps)
+  {
+    runCreator2Prong<false>(rowsTrackIndexProng2);
+  }
+
+  PROCESS_SWITCH(HfCandidateCreator2Prong, processRefit, "Fit the secondary vertices of the candidates", true);
+
+  void processSkimVertexFit(aod::Collisions const& collisions,
+                            soa::Join<aod::Hf2Prongs, aod::HfPvRefit2Prong, aod::HfSkimVtx2Prong> const& rowsTrackIndexProng2,
+                            aod::BigTracks const& tracks,
+                            aod::BCsWithTimestamps const& bcWithTimeStamps)
+  {
+    runCreator2Prong<true>(rowsTrackIndexProng2);
+  }
+
+  PROCESS_SWITCH(HfCandidateCreator2Prong, processSkimVertexFit, "Use the vertex fits of the skimming (fillVertexFit in hf-track-index-skim-creator), fitting again only if the settings differ", false);
 };
 
 /// Extends the base table with expression columns.
@@ -218,6 +292,8 @@ struct HfCandidateCreator2ProngExpressions {
   Produces<aod::HfCand2ProngMcRec> rowMcMatchRec;
   Produces<aod::HfCand2ProngMcGen> rowMcMatchGen;
 
+  RecoDecay::McIndex mcIndex; // index of the MC particles, built once per time frame for the MC matching
+
   void init(InitContext const&) {}
 
   /// Performs MC matching.
@@ -225,6 +301,7 @@ struct HfCandidateCreator2ProngExpressions {
                  aod::McParticles const& particlesMC)
   {
     rowCandidateProng2->bindExternalIndices(&tracks);
+    mcIndex.build(particlesMC);
 
     int indexRec = -1;
     int8_t sign = 0;
@@ -241,7 +318,7 @@ struct HfCandidateCreator2ProngExpressions {
 
       // D0(bar) → π± K∓
       // Printf("Checking D0(bar) → π± K∓");
-      indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kD0, array{+kPiPlus, -kKPlus}, true, &sign);
+      indexRec = RecoDecay::getMatchedMCRec(mcIndex, arrayDaughters, pdg::Code::kD0, array{+kPiPlus, -kKPlus}, true, &sign);
       if (indexRec > -1) {
         flag = sign * (1 << DecayType::D0ToPiK);
       }
@@ -249,7 +326,7 @@ struct HfCandidateCreator2ProngExpressions {
       // J/ψ → e+ e−
       if (flag == 0) {
         // Printf("Checking J/ψ → e+ e−");
-        indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kJPsi, array{+kElectron, -kElectron}, true);
+        indexRec = RecoDecay::getMatchedMCRec(mcIndex, arrayDaughters, pdg::Code::kJPsi, array{+kElectron, -kElectron}, true);
         if (indexRec > -1) {
           flag = 1 << DecayType::JpsiToEE;
         }
@@ -258,7 +335,7 @@ struct HfCandidateCreator2ProngExpressions {
       // J/ψ → μ+ μ−
       if (flag == 0) {
         // Printf("Checking J/ψ → μ+ μ−");
-        indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kJPsi, array{+kMuonPlus, -kMuonPlus}, true);
+        indexRec = RecoDecay::getMatchedMCRec(mcIndex, arrayDaughters, pdg::Code::kJPsi, array{+kMuonPlus, -kMuonPlus}, true);
         if (indexRec > -1) {
           flag = 1 << DecayType::JpsiToMuMu;
         }
@@ -267,7 +344,7 @@ struct HfCandidateCreator2ProngExpressions {
       // Check whether the particle is non-prompt (from a b quark).
       if (flag != 0) {
         auto particle = particlesMC.rawIteratorAt(indexRec);
-        origin = RecoDecay::getCharmHadronOrigin(particlesMC, particle);
+        origin = RecoDecay::getCharmHadronOrigin(mcIndex, particle);
       }
 
       rowMcMatchRec(flag, origin);
@@ -281,14 +358,14 @@ struct HfCandidateCreator2ProngExpressions {
 
       // D0(bar) → π± K∓
       // Printf("Checking D0(bar) → π± K∓");
-      if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kD0, array{+kPiPlus, -kKPlus}, true, &sign)) {
+      if (RecoDecay::isMatchedMCGen(mcIndex, particle, pdg::Code::kD0, array{+kPiPlus, -kKPlus}, true, &sign)) {
         flag = sign * (1 << DecayType::D0ToPiK);
       }
 
       // J/ψ → e+ e−
       if (flag == 0) {
         // Printf("Checking J/ψ → e+ e−");
-        if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kJPsi, array{+kElectron, -kElectron}, true)) {
+        if (RecoDecay::isMatchedMCGen(mcIndex, particle, pdg::Code::kJPsi, array{+kElectron, -kElectron}, true)) {
           flag = 1 << DecayType::JpsiToEE;
         }
       }
@@ -296,14 +373,14 @@ struct HfCandidateCreator2ProngExpressions {
       // J/ψ → μ+ μ−
       if (flag == 0) {
         // Printf("Checking J/ψ → μ+ μ−");
-        if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kJPsi, array{+kMuonPlus, -kMuonPlus}, true)) {
+        if (RecoDecay::isMatchedMCGen(mcIndex, particle, pdg::Code::kJPsi, array{+kMuonPlus, -kMuonPlus}, true)) {
           flag = 1 << DecayType::JpsiToMuMu;
         }
       }
 
       // Check whether the particle is non-prompt (from a b quark).
       if (flag != 0) {
-        origin = RecoDecay::getCharmHadronOrigin(particlesMC, particle);
+        origin = RecoDecay::getCharmHadronOrigin(mcIndex, particle);
       }
 
       rowMcMatchGen(flag, origin);
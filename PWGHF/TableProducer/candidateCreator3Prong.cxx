@@ -16,6 +16,7 @@
 /// \author Vít Kučera <vit.kucera@cern.ch>, CERN
 
 #include "Framework/AnalysisTask.h"
+#include "Framework/RunningWorkflowInfo.h"
 #include "DCAFitter/DCAFitterN.h"
 #include "PWGHF/DataModel/CandidateReconstructionTables.h"
 #include "PWGHF/Utils/utilsBfieldCCDB.h"
@@ -69,6 +70,8 @@ struct HfCandidateCreator3Prong {
   double massK = RecoDecay::getMassPDG(kKPlus);
   double massPiKPi{0.};
   double bz = 0.;
+  uint32_t vertexFitterConfigHash = 0; // to be compared with the one of the vertex fits of the skimming
+  bool hasWarnedAboutConfigHash = false;
 
   OutputObj<TH1F> hMass3{TH1F("hMass3", "3-prong candidates;inv. mass (#pi K #pi) (GeV/#it{c}^{2});entries", 500, 1.6, 2.1)};
   OutputObj<TH1F> hCovPVXX{TH1F("hCovPVXX", "3-prong candidates;XX element of cov. matrix of prim. vtx. position (cm^{2});entries", 100, 0., 1.e-4)};
@@ -82,7 +85,7 @@ struct HfCandidateCreator3Prong {
   OutputObj<TH2F> hDcaXYProngs{TH2F("hDcaXYProngs", "DCAxy of 3-prong candidates;#it{p}_{T} (GeV/#it{c};#it{d}_{xy}) (#mum);entries", 100, 0., 20., 200, -500., 500.)};
   OutputObj<TH2F> hDcaZProngs{TH2F("hDcaZProngs", "DCAz of 3-prong candidates;#it{p}_{T} (GeV/#it{c};#it{d}_{z}) (#mum);entries", 100, 0., 20., 200, -500., 500.)};
 
-  void init(InitContext const&)
+  void init(InitContext& initContext)
   {
     ccdb->setURL(ccdbUrl);
     ccdb->setCaching(true);
@@ -92,12 +95,36 @@ struct HfCandidateCreator3Prong {
       ccdb->get<TGeoManager>(ccdbPathGeo);
     }
     runNumber = 0;
+
+    if (doprocessRefit == doprocessSkimVertexFit) {
+      LOGP(fatal, "Exactly one of processRefit and processSkimVertexFit has to be enabled");
+    }
+    if (doprocessSkimVertexFit) {
+      // without fillVertexFit the skimming produces an empty HfSkimVtx3Prong table, which cannot be joined with the candidates
+      bool isSkimInWorkflow = false;
+      auto& workflows = initContext.services().get<RunningWorkflowInfo const>();
+      for (const DeviceSpec& device : workflows.devices) {
+        if (device.name != "hf-track-index-skim-creator") {
+          continue;
+        }
+        isSkimInWorkflow = true;
+        for (const auto& option : device.options) {
+          if (option.name == "fillVertexFit" && !option.defaultValue.get<bool>()) {
+            LOGP(fatal, "processSkimVertexFit needs the HfSkimVtx3Prong table: enable fillVertexFit in hf-track-index-skim-creator, or use processRefit");
+          }
+        }
+      }
+      if (!isSkimInWorkflow) {
+        LOGP(info, "hf-track-index-skim-creator is not in the workflow: the input HfSkimVtx3Prong table must have been produced with fillVertexFit enabled");
+      }
+    }
+    vertexFitterConfigHash = aod::hf_skim_vertex::getFitterConfigHash(propagateToPCA, useAbsDCA, useWeightedFinalPCA, maxR, maxDZIni, minParamChange, minRelChi2Change, doPvRefit);
   }
 
-  void process(aod::Collisions const& collisions,
-               soa::Join<aod::Hf3Prongs, aod::HfPvRefit3Prong> const& rowsTrackIndexProng3,
-               aod::BigTracks const& tracks,
-               aod::BCsWithTimestamps const& bcWithTimeStamps)
+  /// Reconstructs the candidates, with the vertex fit of the skimming if available and done with the same settings
+  /// \tparam useSkimVertexFit whether the table with the vertex fits of the skimming is joined with the candidate indices
+  template <bool useSkimVertexFit, typename TRows>
+  void runCreator3Prong(TRows const& rowsTrackIndexProng3)
   {
     // 3-prong vertex fitter
     o2::vertexing::DCAFitterN<3> df;
@@ -112,18 +139,15 @@ struct HfCandidateCreator3Prong {
 
     // loop over triplets of track indices
     for (const auto& rowTrackIndexProng3 : rowsTrackIndexProng3) {
-      auto track0 = rowTrackIndexProng3.prong0_as<aod::BigTracks>();
-      auto track1 = rowTrackIndexProng3.prong1_as<aod::BigTracks>();
-      auto track2 = rowTrackIndexProng3.prong2_as<aod::BigTracks>();
-      auto trackParVar0 = getTrackParCov(track0);
-      auto trackParVar1 = getTrackParCov(track1);
-      auto trackParVar2 = getTrackParCov(track2);
+      auto track0 = rowTrackIndexProng3.template prong0_as<aod::BigTracks>();
+      auto track1 = rowTrackIndexProng3.template prong1_as<aod::BigTracks>();
+      auto track2 = rowTrackIndexProng3.template prong2_as<aod::BigTracks>();
       auto collision = rowTrackIndexProng3.collision();
 
       /// Set the magnetic field from ccdb.
       /// The static instance of the propagator was already modified in the HFTrackIndexSkimCreator,
       /// but this is not true when running on Run2 data/MC already converted into AO2Ds.
-      auto bc = collision.bc_as<aod::BCsWithTimestamps>();
+      auto bc = collision.template bc_as<aod::BCsWithTimestamps>();
       if (runNumber != bc.runNumber()) {
         LOG(info) << ">>>>>>>>>>>> Current run number: " << runNumber;
         initCCDB(bc, runNumber, ccdb, isRun2 ? ccdbPathGrp : ccdbPathGrpMag, lut, isRun2);
@@ -134,31 +158,6 @@ struct HfCandidateCreator3Prong {
       }
       df.setBz(bz);
 
-      // reconstruct the 3-prong secondary vertex
-      if (df.process(trackParVar0, trackParVar1, trackParVar2) == 0) {
-        continue;
-      }
-      const auto& secondaryVertex = df.getPCACandidate();
-      auto chi2PCA = df.getChi2AtPCACandidate();
-      auto covMatrixPCA = df.calcPCACovMatrixFlat();
-      hCovSVXX->Fill(covMatrixPCA[0]); // FIXME: Calculation of errorDecayLength(XY) gives wrong values without this line.
-      hCovSVYY->Fill(covMatrixPCA[2]);
-      hCovSVXZ->Fill(covMatrixPCA[3]);
-      hCovSVZZ->Fill(covMatrixPCA[5]);
-      trackParVar0 = df.getTrack(0);
-      trackParVar1 = df.getTrack(1);
-      trackParVar2 = df.getTrack(2);
-
-      // get track momenta
-      array<float, 3> pvec0;
-      array<float, 3> pvec1;
-      array<float, 3> pvec2;
-      trackParVar0.getPxPyPzGlo(pvec0);
-      trackParVar1.getPxPyPzGlo(pvec1);
-      trackParVar2.getPxPyPzGlo(pvec2);
-
-      // get track impact parameters
-      // This modifies track momenta!
       auto primaryVertex = getPrimaryVertex(collision);
       auto covMatrixPV = primaryVertex.getCov();
       if (doPvRefit) {
@@ -177,16 +176,73 @@ struct HfCandidateCreator3Prong {
         primaryVertex.setSigmaZ2(rowTrackIndexProng3.pvRefitSigmaZ2());
         covMatrixPV = primaryVertex.getCov();
       }
+
+      array<double, 3> secondaryVertex;
+      float chi2PCA;
+      array<float, 6> covMatrixPCA;
+      array<float, 3> pvec0;
+      array<float, 3> pvec1;
+      array<float, 3> pvec2;
+      o2::dataformats::DCA impactParameter0;
+      o2::dataformats::DCA impactParameter1;
+      o2::dataformats::DCA impactParameter2;
+
+      bool hasVertexFit = false;
+      if constexpr (useSkimVertexFit) {
+        // the skimming fitted the vertex with the same settings, nothing to redo
+        if (rowTrackIndexProng3.fitterConfigHash() == vertexFitterConfigHash) {
+          hasVertexFit = true;
+          secondaryVertex = {rowTrackIndexProng3.xSecondaryVertex(), rowTrackIndexProng3.ySecondaryVertex(), rowTrackIndexProng3.zSecondaryVertex()};
+          chi2PCA = rowTrackIndexProng3.chi2PCA();
+          covMatrixPCA = {rowTrackIndexProng3.covSvXX(), rowTrackIndexProng3.covSvXY(), rowTrackIndexProng3.covSvYY(), rowTrackIndexProng3.covSvXZ(), rowTrackIndexProng3.covSvYZ(), rowTrackIndexProng3.covSvZZ()};
+          pvec0 = {rowTrackIndexProng3.pxProng0(), rowTrackIndexProng3.pyProng0(), rowTrackIndexProng3.pzProng0()};
+          pvec1 = {rowTrackIndexProng3.pxProng1(), rowTrackIndexProng3.pyProng1(), rowTrackIndexProng3.pzProng1()};
+          pvec2 = {rowTrackIndexProng3.pxProng2(), rowTrackIndexProng3.pyProng2(), rowTrackIndexProng3.pzProng2()};
+          impactParameter0.set(rowTrackIndexProng3.impactParameter0(), rowTrackIndexProng3.impactParameterZ0(), rowTrackIndexProng3.impactParameterCovYY0(), 0.f, 0.f);
+          impactParameter1.set(rowTrackIndexProng3.impactParameter1(), rowTrackIndexProng3.impactParameterZ1(), rowTrackIndexProng3.impactParameterCovYY1(), 0.f, 0.f);
+          impactParameter2.set(rowTrackIndexProng3.impactParameter2(), rowTrackIndexProng3.impactParameterZ2(), rowTrackIndexProng3.impactParameterCovYY2(), 0.f, 0.f);
+        } else if (!hasWarnedAboutConfigHash) {
+          LOG(warning) << "Vertex fits of the skimming were done with different settings, the vertices are fitted again";
+          hasWarnedAboutConfigHash = true;
+        }
+      }
+
+      if (!hasVertexFit) {
+        auto trackParVar0 = getTrackParCov(track0);
+        auto trackParVar1 = getTrackParCov(track1);
+        auto trackParVar2 = getTrackParCov(track2);
+
+        // reconstruct the 3-prong secondary vertex
+        if (df.process(trackParVar0, trackParVar1, trackParVar2) == 0) {
+          continue;
+        }
+        const auto& vertexPCA = df.getPCACandidate();
+        secondaryVertex = {vertexPCA[0], vertexPCA[1], vertexPCA[2]};
+        chi2PCA = df.getChi2AtPCACandidate();
+        covMatrixPCA = df.calcPCACovMatrixFlat();
+        trackParVar0 = df.getTrack(0);
+        trackParVar1 = df.getTrack(1);
+        trackParVar2 = df.getTrack(2);
+
+        // get track momenta
+        trackParVar0.getPxPyPzGlo(pvec0);
+        trackParVar1.getPxPyPzGlo(pvec1);
+        trackParVar2.getPxPyPzGlo(pvec2);
+
+        // get track impact parameters
+        // This modifies track momenta!
+        trackParVar0.propagateToDCA(primaryVertex, bz, &impactParameter0);
+        trackParVar1.propagateToDCA(primaryVertex, bz, &impactParameter1);
+        trackParVar2.propagateToDCA(primaryVertex, bz, &impactParameter2);
+      }
+      hCovSVXX->Fill(covMatrixPCA[0]); // FIXME: Calculation of errorDecayLength(XY) gives wrong values without this line.
+      hCovSVYY->Fill(covMatrixPCA[2]);
+      hCovSVXZ->Fill(covMatrixPCA[3]);
+      hCovSVZZ->Fill(covMatrixPCA[5]);
       hCovPVXX->Fill(covMatrixPV[0]);
       hCovPVYY->Fill(covMatrixPV[2]);
       hCovPVXZ->Fill(covMatrixPV[3]);
       hCovPVZZ->Fill(covMatrixPV[5]);
-      o2::dataformats::DCA impactParameter0;
-      o2::dataformats::DCA impactParameter1;
-      o2::dataformats::DCA impactParameter2;
-      trackParVar0.propagateToDCA(primaryVertex, bz, &impactParameter0);
-      trackParVar1.propagateToDCA(primaryVertex, bz, &impactParameter1);
-      trackParVar2.propagateToDCA(primaryVertex, bz, &impactParameter2);
       hDcaXYProngs->Fill(track0.pt(), impactParameter0.getY() * toMicrometers);
       hDcaXYProngs->Fill(track1.pt(), impactParameter1.getY() * toMicrometers);
       hDcaXYProngs->Fill(track2.pt(), impactParameter2.getY() * toMicrometers);
@@ -223,6 +279,26 @@ struct HfCandidateCreator3Prong {
       }
     }
   }
+
+  void processRefit(aod::Collisions const& collisions,
+                    soa::Join<aod::Hf3Prongs, aod::HfPvRefit3Prong> const& rowsTrackIndexProng3,
+                    aod::BigTracks const& tracks,
+                    aod::BCsWithTimestamps const& bcWithTimeStamps)
+  {
+    runCreator3Prong<false>(rowsTrackIndexProng3);
+  }
+
+  PROCESS_SWITCH(HfCandidateCreator3Prong, processRefit, "Fit the secondary vertices of the candidates", true);
+
+  void processSkimVertexFit(aod::Collisions const& collisions,
+                            soa::Join<aod::Hf3Prongs, aod::HfPvRefit3Prong, aod::HfSkimVtx3Prong> const& rowsTrackIndexProng3,
+                            aod::BigTracks const& tracks,
+                            aod::BCsWithTimestamps const& bcWithTimeStamps)
+  {
+    runCreator3Prong<true>(rowsTrackIndexProng3);
+  }
+
+  PROCESS_SWITCH(HfCandidateCreator3Prong, processSkimVertexFit, "Use the vertex fits of the skimming (fillVertexFit in hf-track-index-skim-creator), fitting again only if the settings differ", false);
 };
 
 /// Extends the base table with expression columns.
@@ -231,6 +307,8 @@ struct HfCandidateCreator3ProngExpressions {
   Produces<aod::HfCand3ProngMcRec> rowMcMatchRec;
   Produces<aod::HfCand3ProngMcGen> rowMcMatchGen;
 
+  RecoDecay::McIndex mcIndex; // index of the MC particles, built once per time frame for the MC matching
+
   void init(InitContext const&) {}
 
   /// Performs MC matching.
@@ -238,6 +316,7 @@ struct HfCandidateCreator3ProngExpressions {
                  aod::McParticles const& particlesMC)
   {
     rowCandidateProng3->bindExternalIndices(&tracks);
+    mcIndex.build(particlesMC);
 
     int indexRec = -1;
     int8_t sign = 0;
@@ -264,7 +343,7 @@ struct HfCandidateCreator3ProngExpressions {
 
       // D± → π± K∓ π±
       // Printf("Checking D± → π± K∓ π±");
-      indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kDPlus, array{+kPiPlus, -kKPlus, +kPiPlus}, true, &sign, 2);
+      indexRec = RecoDecay::getMatchedMCRec(mcIndex, arrayDaughters, pdg::Code::kDPlus, array{+kPiPlus, -kKPlus, +kPiPlus}, true, &sign, 2);
       if (indexRec > -1) {
         flag = sign * (1 << DecayType::DplusToPiKPi);
       }
@@ -272,7 +351,7 @@ struct HfCandidateCreator3ProngExpressions {
       // Ds± → K± K∓ π±
       if (flag == 0) {
         // Printf("Checking Ds± → K± K∓ π±");
-        indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kDS, array{+kKPlus, -kKPlus, +kPiPlus}, true, &sign, 2);
+        indexRec = RecoDecay::getMatchedMCRec(mcIndex, arrayDaughters, pdg::Code::kDS, array{+kKPlus, -kKPlus, +kPiPlus}, true, &sign, 2);
         if (indexRec > -1) {
           flag = sign * (1 << DecayType::DsToKKPi);
         }
@@ -281,7 +360,7 @@ struct HfCandidateCreator3ProngExpressions {
       // Λc± → p± K∓ π±
       if (flag == 0) {
         // Printf("Checking Λc± → p± K∓ π±");
-        indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kLambdaCPlus, array{+kProton, -kKPlus, +kPiPlus}, true, &sign, 2);
+        indexRec = RecoDecay::getMatchedMCRec(mcIndex, arrayDaughters, pdg::Code::kLambdaCPlus, array{+kProton, -kKPlus, +kPiPlus}, true, &sign, 2);
         if (indexRec > -1) {
           flag = sign * (1 << DecayType::LcToPKPi);
 
@@ -289,11 +368,10 @@ struct HfCandidateCreator3ProngExpressions {
           if (arrayDaughters[0].has_mcParticle()) {
             swapping = int8_t(std::abs(arrayDaughters[0].mcParticle().pdgCode()) == kPiPlus);
           }
-          RecoDecay::getDaughters(particlesMC.rawIteratorAt(indexRec), &arrDaughIndex, array{0}, 1);
+          RecoDecay::getDaughters(mcIndex, indexRec, &arrDaughIndex, array{0}, 1);
           if (arrDaughIndex.size() == 2) {
             for (auto iProng = 0u; iProng < arrDaughIndex.size(); ++iProng) {
-              auto daughI = particlesMC.rawIteratorAt(arrDaughIndex[iProng]);
-              arrPDGDaugh[iProng] = std::abs(daughI.pdgCode());
+              arrPDGDaugh[iProng] = std::abs(mcIndex.pdgCode(arrDaughIndex[iProng]));
             }
             if ((arrPDGDaugh[0] == arrPDGResonant1[0] && arrPDGDaugh[1] == arrPDGResonant1[1]) || (arrPDGDaugh[0] == arrPDGResonant1[1] && arrPDGDaugh[1] == arrPDGResonant1[0])) {
               channel = 1;
@@ -309,7 +387,7 @@ struct HfCandidateCreator3ProngExpressions {
       // Ξc± → p± K∓ π±
       if (flag == 0) {
         // Printf("Checking Ξc± → p± K∓ π±");
-        indexRec = RecoDecay::getMatchedMCRec(particlesMC, arrayDaughters, pdg::Code::kXiCPlus, array{+kProton, -kKPlus, +kPiPlus}, true, &sign, 2);
+        indexRec = RecoDecay::getMatchedMCRec(mcIndex, arrayDaughters, pdg::Code::kXiCPlus, array{+kProton, -kKPlus, +kPiPlus}, true, &sign, 2);
         if (indexRec > -1) {
           flag = sign * (1 << DecayType::XicToPKPi);
         }
@@ -318,7 +396,7 @@ struct HfCandidateCreator3ProngExpressions {
       // Check whether the particle is non-prompt (from a b quark).
       if (flag != 0) {
         auto particle = particlesMC.rawIteratorAt(indexRec);
-        origin = RecoDecay::getCharmHadronOrigin(particlesMC, particle);
+        origin = RecoDecay::getCharmHadronOrigin(mcIndex, particle);
       }
 
       rowMcMatchRec(flag, origin, swapping, channel);
@@ -334,14 +412,14 @@ struct HfCandidateCreator3ProngExpressions {
 
       // D± → π± K∓ π±
       // Printf("Checking D± → π± K∓ π±");
-      if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kDPlus, array{+kPiPlus, -kKPlus, +kPiPlus}, true, &sign, 2)) {
+      if (RecoDecay::isMatchedMCGen(mcIndex, particle, pdg::Code::kDPlus, array{+kPiPlus, -kKPlus, +kPiPlus}, true, &sign, 2)) {
         flag = sign * (1 << DecayType::DplusToPiKPi);
       }
 
       // Ds± → K± K∓ π±
       if (flag == 0) {
         // Printf("Checking Ds± → K± K∓ π±");
-        if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kDS, array{+kKPlus, -kKPlus, +kPiPlus}, true, &sign, 2)) {
+        if (RecoDecay::isMatchedMCGen(mcIndex, particle, pdg::Code::kDS, array{+kKPlus, -kKPlus, +kPiPlus}, true, &sign, 2)) {
           flag = sign * (1 << DecayType::DsToKKPi);
         }
       }
@@ -349,15 +427,14 @@ struct HfCandidateCreator3ProngExpressions {
       // Λc± → p± K∓ π±
       if (flag == 0) {
         // Printf("Checking Λc± → p± K∓ π±");
-        if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kLambdaCPlus, array{+kProton, -kKPlus, +kPiPlus}, true, &sign, 2)) {
+        if (RecoDecay::isMatchedMCGen(mcIndex, particle, pdg::Code::kLambdaCPlus, array{+kProton, -kKPlus, +kPiPlus}, true, &sign, 2)) {
           flag = sign * (1 << DecayType::LcToPKPi);
 
           // Printf("Flagging the different Λc± → p± K∓ π± decay channels");
-          RecoDecay::getDaughters(particle, &arrDaughIndex, array{0}, 1);
+          RecoDecay::getDaughters(mcIndex, particle.globalIndex(), &arrDaughIndex, array{0}, 1);
           if (arrDaughIndex.size() == 2) {
             for (auto jProng = 0u; jProng < arrDaughIndex.size(); ++jProng) {
-              auto daughJ = particlesMC.rawIteratorAt(arrDaughIndex[jProng]);
-              arrPDGDaugh[jProng] = std::abs(daughJ.pdgCode());
+              arrPDGDaugh[jProng] = std::abs(mcIndex.pdgCode(arrDaughIndex[jProng]));
             }
             if ((arrPDGDaugh[0] == arrPDGResonant1[0] && arrPDGDaugh[1] == arrPDGResonant1[1]) || (arrPDGDaugh[0] == arrPDGResonant1[1] && arrPDGDaugh[1] == arrPDGResonant1[0])) {
               channel = 1;
@@ -373,14 +450,14 @@ struct HfCandidateCreator3ProngExpressions {
       // Ξc± → p± K∓ π±
       if (flag == 0) {
         // Printf("Checking Ξc± → p± K∓ π±");
-        if (RecoDecay::isMatchedMCGen(particlesMC, particle, pdg::Code::kXiCPlus, array{+kProton, -kKPlus, +kPiPlus}, true, &sign, 2)) {
+        if (RecoDecay::isMatchedMCGen(mcIndex, particle, pdg::Code::kXiCPlus, array{+kProton, -kKPlus, +kPiPlus}, true, &sign, 2)) {
           flag = sign * (1 << DecayType::XicToPKPi);
         }
       }
 
       // Check whether the particle is non-prompt (from a b quark).
       if (flag != 0) {
-        origin = RecoDecay::getCharmHadronOrigin(particlesMC, particle);
+        origin = RecoDecay::getCharmHadronOrigin(mcIndex, particle);
       }
 
       rowMcMatchGen(flag, origin, channel);
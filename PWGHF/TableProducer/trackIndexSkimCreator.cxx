@@ -39,6 +39,7 @@
 #include "PWGHF/Utils/utilsBfieldCCDB.h"
 #include "PWGHF/Utils/utilsDebugLcToK0sP.h"
 #include "PWGLF/DataModel/LFStrangenessTables.h"
+#include "ReconstructionDataFormats/DCA.h"
 #include "ReconstructionDataFormats/V0.h"
 #include "ReconstructionDataFormats/Vertex.h" // for PV refit
 
@@ -879,10 +880,13 @@ struct HfTrackIndexSkimCreator {
   Produces<aod::Hf3Prongs> rowTrackIndexProng3;
   Produces<aod::HfCutStatus3Prong> rowProng3CutStatus;
   Produces<aod::HfPvRefit3Prong> rowProng3PVrefit;
+  Produces<aod::HfSkimVtx2Prong> rowProng2VertexFit;
+  Produces<aod::HfSkimVtx3Prong> rowProng3VertexFit;
 
   Configurable<bool> isRun2{"isRun2", false, "enable Run 2 or Run 3 GRP objects for magnetic field"};
   Configurable<int> do3Prong{"do3Prong", 0, "do 3 prong"};
   Configurable<bool> doPvRefit{"doPvRefit", false, "do PV refit excluding the considered track"};
+  Configurable<bool> fillVertexFit{"fillVertexFit", false, "fill the tables with the vertex fits of the candidates, to be reused by the candidate creators"};
   Configurable<bool> debug{"debug", false, "debug mode"};
   Configurable<bool> fillHistograms{"fillHistograms", true, "fill histograms"};
   ConfigurableAxis axisNumTracks{"axisNumTracks", {250, -0.5f, 249.5f}, "Number of tracks"};
@@ -933,6 +937,8 @@ struct HfTrackIndexSkimCreator {
   o2::base::Propagator::MatCorrType noMatCorr = o2::base::Propagator::MatCorrType::USEMatCorrNONE;
   int runNumber;
 
+  uint32_t vertexFitterConfigHash{0}; // stored with the vertex fits, see hf_skim_vertex::getFitterConfigHash
+
   // int nColls{0}; //can be added to run over limited collisions per file - for tesing purposes
 
   static constexpr int kN2ProngDecays = hf_cand_2prong::DecayType::N2ProngDecays; // number of 2-prong hadron types
@@ -1058,6 +1064,8 @@ struct HfTrackIndexSkimCreator {
     ccdb->setLocalObjectValidityChecking();
     lut = o2::base::MatLayerCylSet::rectifyPtrFromFile(ccdb->get<o2::base::MatLayerCylSet>(ccdbPathLut));
     runNumber = 0;
+
+    vertexFitterConfigHash = hf_skim_vertex::getFitterConfigHash(propagateToPCA, useAbsDCA, useWeightedFinalPCA, maxR, maxDZIni, minParamChange, minRelChi2Change, doPvRefit);
   }
 
   /// Method to perform selections for 2-prong candidates before vertex reconstruction
@@ -1315,6 +1323,58 @@ struct HfTrackIndexSkimCreator {
     }
   }
 
+  /// Method to fill the table with the vertex fit of a candidate, used by the candidate creators instead of fitting the vertex again
+  /// \param rowVertexFit is the table cursor
+  /// \param df is the vertex fitter, after the fit of the candidate
+  /// \param collision is the collision of the candidate
+  /// \param pvRefitCoord are the coordinates of the PV refit, used for the impact parameters if doPvRefit is enabled
+  /// \param pvRefitCovMatrix is the covariance matrix of the PV refit, used for the impact parameters if doPvRefit is enabled
+  template <int nProngs, typename TCursor, typename TCollision>
+  void fillVertexFitRow(TCursor& rowVertexFit, o2::vertexing::DCAFitterN<nProngs>& df, const TCollision& collision, const array<float, 3>& pvRefitCoord, const array<float, 6>& pvRefitCovMatrix)
+  {
+    // same primary vertex as in the candidate creators
+    auto primaryVertex = getPrimaryVertex(collision);
+    if (doPvRefit) {
+      primaryVertex.setX(pvRefitCoord[0]);
+      primaryVertex.setY(pvRefitCoord[1]);
+      primaryVertex.setZ(pvRefitCoord[2]);
+      primaryVertex.setSigmaX2(pvRefitCovMatrix[0]);
+      primaryVertex.setSigmaXY(pvRefitCovMatrix[1]);
+      primaryVertex.setSigmaY2(pvRefitCovMatrix[2]);
+      primaryVertex.setSigmaXZ(pvRefitCovMatrix[3]);
+      primaryVertex.setSigmaYZ(pvRefitCovMatrix[4]);
+      primaryVertex.setSigmaZ2(pvRefitCovMatrix[5]);
+    }
+
+    const auto& secondaryVertex = df.getPCACandidate();
+    auto covMatrixPCA = df.calcPCACovMatrixFlat();
+    float bz = o2::base::Propagator::Instance()->getNominalBz();
+    array<array<float, 3>, nProngs> pVecProngs;
+    array<o2::dataformats::DCA, nProngs> impactParameters;
+    for (int iProng = 0; iProng < nProngs; iProng++) {
+      auto trackParVar = df.getTrack(iProng);
+      trackParVar.getPxPyPzGlo(pVecProngs[iProng]);
+      trackParVar.propagateToDCA(primaryVertex, bz, &impactParameters[iProng]);
+    }
+
+    if constexpr (nProngs == 2) {
+      rowVertexFit(vertexFitterConfigHash,
+                   secondaryVertex[0], secondaryVertex[1], secondaryVertex[2],
+                   df.getChi2AtPCACandidate(),
+                   covMatrixPCA[0], covMatrixPCA[1], covMatrixPCA[2], covMatrixPCA[3], covMatrixPCA[4], covMatrixPCA[5],
+                   pVecProngs[0][0], pVecProngs[0][1], pVecProngs[0][2], impactParameters[0].getY(), impactParameters[0].getZ(), impactParameters[0].getSigmaY2(),
+                   pVecProngs[1][0], pVecProngs[1][1], pVecProngs[1][2], impactParameters[1].getY(), impactParameters[1].getZ(), impactParameters[1].getSigmaY2());
+    } else {
+      rowVertexFit(vertexFitterConfigHash,
+                   secondaryVertex[0], secondaryVertex[1], secondaryVertex[2],
+                   df.getChi2AtPCACandidate(),
+                   covMatrixPCA[0], covMatrixPCA[1], covMatrixPCA[2], covMatrixPCA[3], covMatrixPCA[4], covMatrixPCA[5],
+                   pVecProngs[0][0], pVecProngs[0][1], pVecProngs[0][2], impactParameters[0].getY(), impactParameters[0].getZ(), impactParameters[0].getSigmaY2(),
+                   pVecProngs[1][0], pVecProngs[1][1], pVecProngs[1][2], impactParameters[1].getY(), impactParameters[1].getZ(), impactParameters[1].getSigmaY2(),
+                   pVecProngs[2][0], pVecProngs[2][1], pVecProngs[2][2], impactParameters[2].getY(), impactParameters[2].getZ(), impactParameters[2].getSigmaY2());
+    }
+  }
+
   /// Method for the PV refit excluding the candidate daughters
   /// \param collision is a collision
   /// \param bcWithTimeStamps is a table of bunch crossing joined with timestamps used to query the CCDB for B and material budget
@@ -1721,6 +1781,10 @@ struct HfTrackIndexSkimCreator {
                 // fill table row with coordinates of PV refit
                 rowProng2PVrefit(pvRefitCoord2Prong[0], pvRefitCoord2Prong[1], pvRefitCoord2Prong[2],
                                  pvRefitCovMatrix2Prong[0], pvRefitCovMatrix2Prong[1], pvRefitCovMatrix2Prong[2], pvRefitCovMatrix2Prong[3], pvRefitCovMatrix2Prong[4], pvRefitCovMatrix2Prong[5]);
+                // fill table row with the vertex fit
+                if (fillVertexFit) {
+                  fillVertexFitRow<2>(rowProng2VertexFit, df2, collision, pvRefitCoord2Prong, pvRefitCovMatrix2Prong);
+                }
 
                 if (debug) {
                   int Prong2CutStatus[kN2ProngDecays];
@@ -1938,6 +2002,10 @@ struct HfTrackIndexSkimCreator {
               // fill table row of coordinates of PV refit
               rowProng3PVrefit(pvRefitCoord3Prong2Pos1Neg[0], pvRefitCoord3Prong2Pos1Neg[1], pvRefitCoord3Prong2Pos1Neg[2],
                                pvRefitCovMatrix3Prong2Pos1Neg[0], pvRefitCovMatrix3Prong2Pos1Neg[1], pvRefitCovMatrix3Prong2Pos1Neg[2], pvRefitCovMatrix3Prong2Pos1Neg[3], pvRefitCovMatrix3Prong2Pos1Neg[4], pvRefitCovMatrix3Prong2Pos1Neg[5]);
+              // fill table row with the vertex fit
+              if (fillVertexFit) {
+                fillVertexFitRow<3>(rowProng3VertexFit, df3, collision, pvRefitCoord3Prong2Pos1Neg, pvRefitCovMatrix3Prong2Pos1Neg);
+              }
 
               if (debug) {
                 int Prong3CutStatus[kN3ProngDecays];
@@ -2156,6 +2224,10 @@ struct HfTrackIndexSkimCreator {
               // fill table row of coordinates of PV refit
               rowProng3PVrefit(pvRefitCoord3Prong1Pos2Neg[0], pvRefitCoord3Prong1Pos2Neg[1], pvRefitCoord3Prong1Pos2Neg[2],
                                pvRefitCovMatrix3Prong1Pos2Neg[0], pvRefitCovMatrix3Prong1Pos2Neg[1], pvRefitCovMatrix3Prong1Pos2Neg[2], pvRefitCovMatrix3Prong1Pos2Neg[3], pvRefitCovMatrix3Prong1Pos2Neg[4], pvRefitCovMatrix3Prong1Pos2Neg[5]);
+              // fill table row with the vertex fit
+              if (fillVertexFit) {
+                fillVertexFitRow<3>(rowProng3VertexFit, df3, collision, pvRefitCoord3Prong1Pos2Neg, pvRefitCovMatrix3Prong1Pos2Neg);
+              }
 
               if (debug) {
                 int Prong3CutStatus[kN3ProngDecays];
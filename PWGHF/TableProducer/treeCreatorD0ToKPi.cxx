@@ -21,12 +21,14 @@
 #include "Framework/AnalysisTask.h"
 #include "PWGHF/DataModel/CandidateReconstructionTables.h"
 #include "PWGHF/DataModel/CandidateSelectionTables.h"
+#include "PWGHF/Utils/utilsTreeCreator.h"
 #include "Common/Core/trackUtilities.h"
 #include "ReconstructionDataFormats/DCA.h"
 
 using namespace o2;
 using namespace o2::framework;
 using namespace o2::aod::hf_cand_2prong;
+using namespace o2::analysis::hf_tree_creator;
 
 namespace o2::aod
 {
@@ -155,6 +157,20 @@ struct HfTreeCreatorD0ToKPi {
   Produces<o2::aod::HfCand2ProngFullEvents> rowCandidateFullEvents;
   Produces<o2::aod::HfCand2ProngFullParticles> rowCandidateFullParticles;
 
+  Configurable<double> downSampleBkgFactor{"downSampleBkgFactor", 1., "Fraction of background candidates to keep"};
+  Configurable<double> ptMaxForDownSample{"ptMaxForDownSample", 1000., "Maximum candidate pT for the downsampling of the background"};
+
+  // daughter values: TPC and TOF n sigma of the pion and kaon hypotheses
+  enum DaughterValues {
+    kTpcNSigmaPi = 0,
+    kTpcNSigmaKa,
+    kTofNSigmaPi,
+    kTofNSigmaKa,
+    kNDaughterValues
+  };
+  CollisionCache collisionCache;
+  DaughterCache<kNDaughterValues> daughterCache;
+
   void init(InitContext const&)
   {
   }
@@ -162,6 +178,7 @@ struct HfTreeCreatorD0ToKPi {
   template <typename T>
   void fillEvent(const T& collision, int isEventReject, int runNumber)
   {
+    collisionCache.fill(collision);
     rowCandidateFullEvents(
       collision.bcId(),
       collision.numContrib(),
@@ -178,8 +195,8 @@ struct HfTreeCreatorD0ToKPi {
   {
     if (selection >= 1) {
       rowCandidateFull(
-        prong0.collision().bcId(),
-        prong0.collision().numContrib(),
+        collisionCache.bcId(prong0.collisionId),
+        collisionCache.numContrib(prong0.collisionId),
         candidate.posX(),
         candidate.posY(),
         candidate.posZ(),
@@ -210,14 +227,14 @@ struct HfTreeCreatorD0ToKPi {
         candidate.impactParameter1(),
         candidate.errorImpactParameter0(),
         candidate.errorImpactParameter1(),
-        prong0.tpcNSigmaPi(),
-        prong0.tpcNSigmaKa(),
-        prong0.tofNSigmaPi(),
-        prong0.tofNSigmaKa(),
-        prong1.tpcNSigmaPi(),
-        prong1.tpcNSigmaKa(),
-        prong1.tofNSigmaPi(),
-        prong1.tofNSigmaKa(),
+        prong0.values[kTpcNSigmaPi],
+        prong0.values[kTpcNSigmaKa],
+        prong0.values[kTofNSigmaPi],
+        prong0.values[kTofNSigmaKa],
+        prong1.values[kTpcNSigmaPi],
+        prong1.values[kTpcNSigmaKa],
+        prong1.values[kTofNSigmaPi],
+        prong1.values[kTofNSigmaKa],
         1 << candFlag,
         invMass,
         candidate.impactParameterProduct(),
@@ -236,26 +253,48 @@ struct HfTreeCreatorD0ToKPi {
     }
   }
 
+  template <typename T>
+  void fillDaughterValues(const T& track, std::array<float, kNDaughterValues>& values)
+  {
+    values[kTpcNSigmaPi] = track.tpcNSigmaPi();
+    values[kTpcNSigmaKa] = track.tpcNSigmaKa();
+    values[kTofNSigmaPi] = track.tofNSigmaPi();
+    values[kTofNSigmaKa] = track.tofNSigmaKa();
+  }
+
+  /// Fills the rows of the two mass hypotheses of a candidate
+  template <typename T, typename U>
+  void fillCandidate(const T& candidate, const U& tracks, int8_t flagMc, int8_t origin)
+  {
+    if (!keepCandidate(flagMc != 0, candidate.pt(), candidate.ptProng0(), downSampleBkgFactor, ptMaxForDownSample)) {
+      return;
+    }
+    auto fillValues = [this](const auto& track, auto& values) { fillDaughterValues(track, values); };
+    const auto& prong0 = daughterCache.get(tracks, candidate.prong0Id(), fillValues);
+    const auto& prong1 = daughterCache.get(tracks, candidate.prong1Id(), fillValues);
+    double yD = yD0(candidate);
+    double eD = eD0(candidate);
+    double ctD = ctD0(candidate);
+    fillTable(candidate, prong0, prong1, 0, candidate.isSelD0(), invMassD0ToPiK(candidate), cosThetaStarD0(candidate), ctD, yD, eD, flagMc, origin);
+    fillTable(candidate, prong0, prong1, 1, candidate.isSelD0bar(), invMassD0barToKPi(candidate), cosThetaStarD0bar(candidate), ctD, yD, eD, flagMc, origin);
+  }
+
   void processData(aod::Collisions const& collisions,
                    soa::Join<aod::HfCand2Prong, aod::HfSelD0> const& candidates,
-                   aod::BigTracksPID const&)
+                   aod::BigTracksPID const& tracks)
   {
     // Filling event properties
+    collisionCache.reset(collisions);
     rowCandidateFullEvents.reserve(collisions.size());
     for (auto const& collision : collisions) {
       fillEvent(collision, 0, 1);
     }
 
     // Filling candidate properties
+    daughterCache.reset(tracks);
     rowCandidateFull.reserve(candidates.size());
     for (auto const& candidate : candidates) {
-      auto prong0 = candidate.prong0_as<aod::BigTracksPID>();
-      auto prong1 = candidate.prong1_as<aod::BigTracksPID>();
-      double yD = yD0(candidate);
-      double eD = eD0(candidate);
-      double ctD = ctD0(candidate);
-      fillTable(candidate, prong0, prong1, 0, candidate.isSelD0(), invMassD0ToPiK(candidate), cosThetaStarD0(candidate), ctD, yD, eD, 0, 0);
-      fillTable(candidate, prong0, prong1, 1, candidate.isSelD0bar(), invMassD0barToKPi(candidate), cosThetaStarD0bar(candidate), ctD, yD, eD, 0, 0);
+      fillCandidate(candidate, tracks, 0, 0);
     }
   }
 
@@ -265,24 +304,20 @@ struct HfTreeCreatorD0ToKPi {
                  aod::McCollisions const&,
                  soa::Join<aod::HfCand2Prong, aod::HfCand2ProngMcRec, aod::HfSelD0> const& candidates,
                  soa::Join<aod::McParticles, aod::HfCand2ProngMcGen> const& particles,
-                 aod::BigTracksPID const&)
+                 aod::BigTracksPID const& tracks)
   {
     // Filling event properties
+    collisionCache.reset(collisions);
     rowCandidateFullEvents.reserve(collisions.size());
     for (auto const& collision : collisions) {
       fillEvent(collision, 0, 1);
     }
 
     // Filling candidate properties
+    daughterCache.reset(tracks);
     rowCandidateFull.reserve(candidates.size());
     for (auto const& candidate : candidates) {
-      auto prong0 = candidate.prong0_as<aod::BigTracksPID>();
-      auto prong1 = candidate.prong0_as<aod::BigTracksPID>();
-      double yD = yD0(candidate);
-      double eD = eD0(candidate);
-      double ctD = ctD0(candidate);
-      fillTable(candidate, prong0, prong1, 0, candidate.isSelD0(), invMassD0ToPiK(candidate), cosThetaStarD0(candidate), ctD, yD, eD, candidate.flagMcMatchRec(), candidate.originMcRec());
-      fillTable(candidate, prong0, prong1, 1, candidate.isSelD0bar(), invMassD0barToKPi(candidate), cosThetaStarD0bar(candidate), ctD, yD, eD, candidate.flagMcMatchRec(), candidate.originMcRec());
+      fillCandidate(candidate, tracks, candidate.flagMcMatchRec(), candidate.originMcRec());
     }
 
     // Filling particle properties
@@ -23,9 +23,11 @@
 #include "ReconstructionDataFormats/DCA.h"
 #include "PWGHF/DataModel/CandidateReconstructionTables.h"
 #include "PWGHF/DataModel/CandidateSelectionTables.h"
+#include "PWGHF/Utils/utilsTreeCreator.h"
 
 using namespace o2;
 using namespace o2::framework;
+using namespace o2::analysis::hf_tree_creator;
 
 namespace o2::aod
 {
@@ -161,7 +163,18 @@ struct HfTreeCreatorLcToK0sP {
   Produces<o2::aod::HfCandCascFullEvents> rowCandidateFullEvents;
   Produces<o2::aod::HfCandCascFullParticles> rowCandidateFullParticles;
 
-  Configurable<double> downSampleBkgFactor{"downSampleBkgFactor", 1., "Fraction of candidates to store in the tree"};
+  Configurable<double> downSampleBkgFactor{"downSampleBkgFactor", 1., "Fraction of background candidates to store in the tree"};
+  Configurable<double> ptMaxForDownSample{"ptMaxForDownSample", 1000., "Maximum candidate pT for the downsampling of the background"};
+
+  // bachelor values: pT and TPC and TOF n sigma of the proton hypothesis
+  enum BachelorValues {
+    kPt = 0,
+    kTpcNSigmaPr,
+    kTofNSigmaPr,
+    kNBachelorValues
+  };
+  CollisionCache collisionCache;
+  DaughterCache<kNBachelorValues> bachelorCache;
 
   void init(InitContext const&)
   {
@@ -171,8 +184,8 @@ struct HfTreeCreatorLcToK0sP {
   void fillCandidate(const T& candidate, const U& bach, int8_t flagMc)
   {
     rowCandidateFull(
-      bach.collision().bcId(),
-      bach.collision().numContrib(),
+      collisionCache.bcId(bach.collisionId),
+      collisionCache.numContrib(bach.collisionId),
       candidate.posX(),
       candidate.posY(),
       candidate.posZ(),
@@ -223,8 +236,8 @@ struct HfTreeCreatorLcToK0sP {
       candidate.pzneg(),
       candidate.ptV0Neg(),
       candidate.dcanegtopv(),
-      bach.tpcNSigmaPr(),
-      bach.tofNSigmaPr(),
+      bach.values[kTpcNSigmaPr],
+      bach.values[kTofNSigmaPr],
       o2::aod::hf_cand_casc::invMassLcToK0sP(candidate),
       candidate.pt(),
       candidate.p(),
@@ -241,6 +254,7 @@ struct HfTreeCreatorLcToK0sP {
   template <typename T>
   void fillEvent(const T& collision)
   {
+    collisionCache.fill(collision);
     rowCandidateFullEvents(
       collision.bcId(),
       collision.numContrib(),
@@ -249,6 +263,23 @@ struct HfTreeCreatorLcToK0sP {
       collision.posZ());
   }
 
+  /// Writes the candidate if selected, the background is downsampled
+  template <typename T, typename U>
+  void fillSelectedCandidate(const T& candidate, const U& tracks, int8_t flagMc)
+  {
+    if (candidate.isSelLcToK0sP() < 1) {
+      return;
+    }
+    const auto& bach = bachelorCache.get(tracks, candidate.prong0Id(), [](const auto& track, auto& values) {
+      values[kPt] = track.pt();
+      values[kTpcNSigmaPr] = track.tpcNSigmaPr();
+      values[kTofNSigmaPr] = track.tofNSigmaPr();
+    });
+    if (keepCandidate(flagMc != 0, candidate.pt(), bach.values[kPt], downSampleBkgFactor, ptMaxForDownSample)) {
+      fillCandidate(candidate, bach, flagMc);
+    }
+  }
+
   void processMc(aod::Collisions const& collisions,
                  aod::McCollisions const& mccollisions,
                  soa::Join<aod::HfCandCascade, aod::HfCandCascadeMcRec, aod::HfSelLcToK0sP> const& candidates,
@@ -257,19 +288,17 @@ struct HfTreeCreatorLcToK0sP {
   {
 
     // Filling event properties
+    collisionCache.reset(collisions);
     rowCandidateFullEvents.reserve(collisions.size());
     for (auto const& collision : collisions) {
       fillEvent(collision);
     }
 
     // Filling candidate properties
+    bachelorCache.reset(tracks);
     rowCandidateFull.reserve(candidates.size());
     for (auto const& candidate : candidates) {
-      auto bach = candidate.prong0_as<aod::BigTracksPID>(); // bachelor
-      double pseudoRndm = bach.pt() * 1000. - (int16_t)(bach.pt() * 1000);
-      if (candidate.isSelLcToK0sP() >= 1 && pseudoRndm < downSampleBkgFactor) {
-        fillCandidate(candidate, bach, candidate.flagMcMatchRec());
-      }
+      fillSelectedCandidate(candidate, tracks, candidate.flagMcMatchRec());
     }
 
     // Filling particle properties
@@ -294,19 +323,17 @@ struct HfTreeCreatorLcToK0sP {
   {
 
     // Filling event properties
+    collisionCache.reset(collisions);
     rowCandidateFullEvents.reserve(collisions.size());
     for (auto const& collision : collisions) {
       fillEvent(collision);
     }
 
     // Filling candidate properties
+    bachelorCache.reset(tracks);
     rowCandidateFull.reserve(candidates.size());
     for (auto const& candidate : candidates) {
-      auto bach = candidate.prong0_as<aod::BigTracksPID>(); // bachelor
-      double pseudoRndm = bach.pt() * 1000. - (int16_t)(bach.pt() * 1000);
-      if (candidate.isSelLcToK0sP() >= 1 && pseudoRndm < downSampleBkgFactor) {
-        fillCandidate(candidate, bach, 0);
-      }
+      fillSelectedCandidate(candidate, tracks, 0);
     }
   }
   PROCESS_SWITCH(HfTreeCreatorLcToK0sP, processData, "Process data tree writer", false);
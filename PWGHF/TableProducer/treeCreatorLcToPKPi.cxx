@@ -20,12 +20,14 @@
 #include "Framework/AnalysisTask.h"
 #include "PWGHF/DataModel/CandidateReconstructionTables.h"
 #include "PWGHF/DataModel/CandidateSelectionTables.h"
+#include "PWGHF/Utils/utilsTreeCreator.h"
 #include "Common/Core/trackUtilities.h"
 #include "ReconstructionDataFormats/DCA.h"
 
 using namespace o2;
 using namespace o2::framework;
 using namespace o2::aod::hf_cand_3prong;
+using namespace o2::analysis::hf_tree_creator;
 
 namespace o2::aod
 {
@@ -181,10 +183,152 @@ struct HfTreeCreatorLcToPKPi {
 
   Configurable<double> downSampleBkgFactor{"downSampleBkgFactor", 1., "Fraction of candidates to store in the tree"};
 
+  // daughter values: pT and TPC and TOF n sigma of the pion, kaon and proton hypotheses
+  enum DaughterValues {
+    kPt = 0,
+    kTpcNSigmaPi,
+    kTpcNSigmaKa,
+    kTpcNSigmaPr,
+    kTofNSigmaPi,
+    kTofNSigmaKa,
+    kTofNSigmaPr,
+    kNDaughterValues
+  };
+  CollisionCache collisionCache;
+  DaughterCache<kNDaughterValues> daughterCache;
+
   void init(InitContext const&)
   {
   }
 
+  template <typename T>
+  void fillEvent(const T& collision)
+  {
+    collisionCache.fill(collision);
+    rowCandidateFullEvents(
+      collision.bcId(),
+      collision.numContrib(),
+      collision.posX(),
+      collision.posY(),
+      collision.posZ(),
+      0,
+      1);
+  }
+
+  template <typename T>
+  void fillDaughterValues(const T& track, std::array<float, kNDaughterValues>& values)
+  {
+    values[kPt] = track.pt();
+    values[kTpcNSigmaPi] = track.tpcNSigmaPi();
+    values[kTpcNSigmaKa] = track.tpcNSigmaKa();
+    values[kTpcNSigmaPr] = track.tpcNSigmaPr();
+    values[kTofNSigmaPi] = track.tofNSigmaPi();
+    values[kTofNSigmaKa] = track.tofNSigmaKa();
+    values[kTofNSigmaPr] = track.tofNSigmaPr();
+  }
+
+  /// Fills the rows of the two mass hypotheses of a candidate
+  /// \param onlySignal only the candidates matched to a Lc -> p K pi decay are written (MC)
+  template <typename T, typename U>
+  void fillCandidate(const T& candidate, const U& tracks, bool onlySignal, int8_t flagMc, int8_t isCandidateSwapped)
+  {
+    if (onlySignal && std::abs(flagMc) != 1 << DecayType::LcToPKPi) {
+      return;
+    }
+    auto fillValues = [this](const auto& track, auto& values) { fillDaughterValues(track, values); };
+    const auto& trackPos1 = daughterCache.get(tracks, candidate.prong0Id(), fillValues); // positive daughter (negative for the antiparticles)
+    const auto& trackNeg = daughterCache.get(tracks, candidate.prong1Id(), fillValues);  // negative daughter (positive for the antiparticles)
+    const auto& trackPos2 = daughterCache.get(tracks, candidate.prong2Id(), fillValues); // positive daughter (negative for the antiparticles)
+    if (pseudoRandom(trackPos1.values[kPt]) >= downSampleBkgFactor) {
+      return;
+    }
+    float ct = ctLc(candidate);
+    float y = yLc(candidate);
+    float e = eLc(candidate);
+
+    auto fillTable = [&](int CandFlag,
+                         int FunctionSelection,
+                         float FunctionInvMass) {
+      if (FunctionSelection >= 1) {
+        rowCandidateFull(
+          collisionCache.bcId(trackPos1.collisionId),
+          collisionCache.numContrib(trackPos1.collisionId),
+          candidate.posX(),
+          candidate.posY(),
+          candidate.posZ(),
+          candidate.xSecondaryVertex(),
+          candidate.ySecondaryVertex(),
+          candidate.zSecondaryVertex(),
+          candidate.errorDecayLength(),
+          candidate.errorDecayLengthXY(),
+          candidate.chi2PCA(),
+          candidate.rSecondaryVertex(),
+          candidate.decayLength(),
+          candidate.decayLengthXY(),
+          candidate.decayLengthNormalised(),
+          candidate.decayLengthXYNormalised(),
+          candidate.impactParameterNormalised0(),
+          candidate.ptProng0(),
+          RecoDecay::p(candidate.pxProng0(), candidate.pyProng0(), candidate.pzProng0()),
+          candidate.impactParameterNormalised1(),
+          candidate.ptProng1(),
+          RecoDecay::p(candidate.pxProng1(), candidate.pyProng1(), candidate.pzProng1()),
+          candidate.impactParameterNormalised2(),
+          candidate.ptProng2(),
+          RecoDecay::p(candidate.pxProng2(), candidate.pyProng2(), candidate.pzProng2()),
+          candidate.pxProng0(),
+          candidate.pyProng0(),
+          candidate.pzProng0(),
+          candidate.pxProng1(),
+          candidate.pyProng1(),
+          candidate.pzProng1(),
+          candidate.pxProng2(),
+          candidate.pyProng2(),
+          candidate.pzProng2(),
+          candidate.impactParameter0(),
+          candidate.impactParameter1(),
+          candidate.impactParameter2(),
+          candidate.errorImpactParameter0(),
+          candidate.errorImpactParameter1(),
+          candidate.errorImpactParameter2(),
+          trackPos1.values[kTpcNSigmaPi],
+          trackPos1.values[kTpcNSigmaKa],
+          trackPos1.values[kTpcNSigmaPr],
+          trackPos1.values[kTofNSigmaPi],
+          trackPos1.values[kTofNSigmaKa],
+          trackPos1.values[kTofNSigmaPr],
+          trackNeg.values[kTpcNSigmaPi],
+          trackNeg.values[kTpcNSigmaKa],
+          trackNeg.values[kTpcNSigmaPr],
+          trackNeg.values[kTofNSigmaPi],
+          trackNeg.values[kTofNSigmaKa],
+          trackNeg.values[kTofNSigmaPr],
+          trackPos2.values[kTpcNSigmaPi],
+          trackPos2.values[kTpcNSigmaKa],
+          trackPos2.values[kTpcNSigmaPr],
+          trackPos2.values[kTofNSigmaPi],
+          trackPos2.values[kTofNSigmaKa],
+          trackPos2.values[kTofNSigmaPr],
+          1 << CandFlag,
+          FunctionInvMass,
+          candidate.pt(),
+          candidate.p(),
+          candidate.cpa(),
+          candidate.cpaXY(),
+          ct,
+          candidate.eta(),
+          candidate.phi(),
+          y,
+          e,
+          flagMc,
+          isCandidateSwapped);
+      }
+    };
+
+    fillTable(0, candidate.isSelLcToPKPi(), invMassLcToPKPi(candidate));
+    fillTable(1, candidate.isSelLcToPiKP(), invMassLcToPiKP(candidate));
+  }
+
   void processMc(aod::Collisions const& collisions,
                  aod::McCollisions const& mccollisions,
                  soa::Join<aod::HfCand3Prong, aod::HfCand3ProngMcRec, aod::HfSelLc> const& candidates,
@@ -193,109 +337,17 @@ struct HfTreeCreatorLcToPKPi {
   {
 
     // Filling event properties
+    collisionCache.reset(collisions);
     rowCandidateFullEvents.reserve(collisions.size());
     for (auto& collision : collisions) {
-      rowCandidateFullEvents(
-        collision.bcId(),
-        collision.numContrib(),
-        collision.posX(),
-        collision.posY(),
-        collision.posZ(),
-        0,
-        1);
+      fillEvent(collision);
     }
 
     // Filling candidate properties
+    daughterCache.reset(tracks);
     rowCandidateFull.reserve(candidates.size());
     for (auto& candidate : candidates) {
-      auto trackPos1 = candidate.prong0_as<aod::BigTracksPID>(); // positive daughter (negative for the antiparticles)
-      auto trackNeg = candidate.prong1_as<aod::BigTracksPID>();  // negative daughter (positive for the antiparticles)
-      auto trackPos2 = candidate.prong2_as<aod::BigTracksPID>(); // positive daughter (negative for the antiparticles)
-      auto fillTable = [&](int CandFlag,
-                           int FunctionSelection,
-                           float FunctionInvMass,
-                           float FunctionCt,
-                           float FunctionY,
-                           float FunctionE) {
-        double pseudoRndm = trackPos1.pt() * 1000. - (long)(trackPos1.pt() * 1000);
-        if (FunctionSelection >= 1 && std::abs(candidate.flagMcMatchRec()) == 1 << DecayType::LcToPKPi && pseudoRndm < downSampleBkgFactor) {
-          rowCandidateFull(
-            trackPos1.collision().bcId(),
-            trackPos1.collision().numContrib(),
-            candidate.posX(),
-            candidate.posY(),
-            candidate.posZ(),
-            candidate.xSecondaryVertex(),
-            candidate.ySecondaryVertex(),
-            candidate.zSecondaryVertex(),
-            candidate.errorDecayLength(),
-            candidate.errorDecayLengthXY(),
-            candidate.chi2PCA(),
-            candidate.rSecondaryVertex(),
-            candidate.decayLength(),
-            candidate.decayLengthXY(),
-            candidate.decayLengthNormalised(),
-            candidate.decayLengthXYNormalised(),
-            candidate.impactParameterNormalised0(),
-            candidate.ptProng0(),
-            RecoDecay::p(candidate.pxProng0(), candidate.pyProng0(), candidate.pzProng0()),
-            candidate.impactParameterNormalised1(),
-            candidate.ptProng1(),
-            RecoDecay::p(candidate.pxProng1(), candidate.pyProng1(), candidate.pzProng1()),
-            candidate.impactParameterNormalised2(),
-            candidate.ptProng2(),
-            RecoDecay::p(candidate.pxProng2(), candidate.pyProng2(), candidate.pzProng2()),
-            candidate.pxProng0(),
-            candidate.pyProng0(),
-            candidate.pzProng0(),
-            candidate.pxProng1(),
-            candidate.pyProng1(),
-            candidate.pzProng1(),
-            candidate.pxProng2(),
-            candidate.pyProng2(),
-            candidate.pzProng2(),
-            candidate.impactParameter0(),
-            candidate.impactParameter1(),
-            candidate.impactParameter2(),
-            candidate.errorImpactParameter0(),
-            candidate.errorImpactParameter1(),
-            candidate.errorImpactParameter2(),
-            trackPos1.tpcNSigmaPi(),
-            trackPos1.tpcNSigmaKa(),
-            trackPos1.tpcNSigmaPr(),
-            trackPos1.tofNSigmaPi(),
-            trackPos1.tofNSigmaKa(),
-            trackPos1.tofNSigmaPr(),
-            trackNeg.tpcNSigmaPi(),
-            trackNeg.tpcNSigmaKa(),
-            trackNeg.tpcNSigmaPr(),
-            trackNeg.tofNSigmaPi(),
-            trackNeg.tofNSigmaKa(),
-            trackNeg.tofNSigmaPr(),
-            trackPos2.tpcNSigmaPi(),
-            trackPos2.tpcNSigmaKa(),
-            trackPos2.tpcNSigmaPr(),
-            trackPos2.tofNSigmaPi(),
-            trackPos2.tofNSigmaKa(),
-            trackPos2.tofNSigmaPr(),
-            1 << CandFlag,
-            FunctionInvMass,
-            candidate.pt(),
-            candidate.p(),
-            candidate.cpa(),
-            candidate.cpaXY(),
-            FunctionCt,
-            candidate.eta(),
-            candidate.phi(),
-            FunctionY,
-            FunctionE,
-            candidate.flagMcMatchRec(),
-            candidate.isCandidateSwapped());
-        }
-      };
-
-      fillTable(0, candidate.isSelLcToPKPi(), invMassLcToPKPi(candidate), ctLc(candidate), yLc(candidate), eLc(candidate));
-      fillTable(1, candidate.isSelLcToPiKP(), invMassLcToPiKP(candidate), ctLc(candidate), yLc(candidate), eLc(candidate));
+      fillCandidate(candidate, tracks, true, candidate.flagMcMatchRec(), candidate.isCandidateSwapped());
     }
 
     // Filling particle properties
@@ -320,109 +372,17 @@ struct HfTreeCreatorLcToPKPi {
   {
 
     // Filling event properties
+    collisionCache.reset(collisions);
     rowCandidateFullEvents.reserve(collisions.size());
     for (auto& collision : collisions) {
-      rowCandidateFullEvents(
-        collision.bcId(),
-        collision.numContrib(),
-        collision.posX(),
-        collision.posY(),
-        collision.posZ(),
-        0,
-        1);
+      fillEvent(collision);
     }
 
     // Filling candidate properties
+    daughterCache.reset(tracks);
     rowCandidateFull.reserve(candidates.size());
     for (auto& candidate : candidates) {
-      auto trackPos1 = candidate.prong0_as<aod::BigTracksPID>(); // positive daughter (negative for the antiparticles)
-      auto trackNeg = candidate.prong1_as<aod::BigTracksPID>();  // negative daughter (positive for the antiparticles)
-      auto trackPos2 = candidate.prong2_as<aod::BigTracksPID>(); // positive daughter (negative for the antiparticles)
-      auto fillTable = [&](int CandFlag,
-                           int FunctionSelection,
-                           float FunctionInvMass,
-                           float FunctionCt,
-                           float FunctionY,
-                           float FunctionE) {
-        double pseudoRndm = trackPos1.pt() * 1000. - (long)(trackPos1.pt() * 1000);
-        if (FunctionSelection >= 1 && pseudoRndm < downSampleBkgFactor) {
-          rowCandidateFull(
-            trackPos1.collision().bcId(),
-            trackPos1.collision().numContrib(),
-            candidate.posX(),
-            candidate.posY(),
-            candidate.posZ(),
-            candidate.xSecondaryVertex(),
-            candidate.ySecondaryVertex(),
-            candidate.zSecondaryVertex(),
-            candidate.errorDecayLength(),
-            candidate.errorDecayLengthXY(),
-            candidate.chi2PCA(),
-            candidate.rSecondaryVertex(),
-            candidate.decayLength(),
-            candidate.decayLengthXY(),
-            candidate.decayLengthNormalised(),
-            candidate.decayLengthXYNormalised(),
-            candidate.impactParameterNormalised0(),
-            candidate.ptProng0(),
-            RecoDecay::p(candidate.pxProng0(), candidate.pyProng0(), candidate.pzProng0()),
-            candidate.impactParameterNormalised1(),
-            candidate.ptProng1(),
-            RecoDecay::p(candidate.pxProng1(), candidate.pyProng1(), candidate.pzProng1()),
-            candidate.impactParameterNormalised2(),
-            candidate.ptProng2(),
-            RecoDecay::p(candidate.pxProng2(), candidate.pyProng2(), candidate.pzProng2()),
-            candidate.pxProng0(),
-            candidate.pyProng0(),
-            candidate.pzProng0(),
-            candidate.pxProng1(),
-            candidate.pyProng1(),
-            candidate.pzProng1(),
-            candidate.pxProng2(),
-            candidate.pyProng2(),
-            candidate.pzProng2(),
-            candidate.impactParameter0(),
-            candidate.impactParameter1(),
-            candidate.impactParameter2(),
-            candidate.errorImpactParameter0(),
-            candidate.errorImpactParameter1(),
-            candidate.errorImpactParameter2(),
-            trackPos1.tpcNSigmaPi(),
-            trackPos1.tpcNSigmaKa(),
-            trackPos1.tpcNSigmaPr(),
-            trackPos1.tofNSigmaPi(),
-            trackPos1.tofNSigmaKa(),
-            trackPos1.tofNSigmaPr(),
-            trackNeg.tpcNSigmaPi(),
-            trackNeg.tpcNSigmaKa(),
-            trackNeg.tpcNSigmaPr(),
-            trackNeg.tofNSigmaPi(),
-            trackNeg.tofNSigmaKa(),
-            trackNeg.tofNSigmaPr(),
-            trackPos2.tpcNSigmaPi(),
-            trackPos2.tpcNSigmaKa(),
-            trackPos2.tpcNSigmaPr(),
-            trackPos2.tofNSigmaPi(),
-            trackPos2.tofNSigmaKa(),
-            trackPos2.tofNSigmaPr(),
-            1 << CandFlag,
-            FunctionInvMass,
-            candidate.pt(),
-            candidate.p(),
-            candidate.cpa(),
-            candidate.cpaXY(),
-            FunctionCt,
-            candidate.eta(),
-            candidate.phi(),
-            FunctionY,
-            FunctionE,
-            0.,
-            0.);
-        }
-      };
-
-      fillTable(0, candidate.isSelLcToPKPi(), invMassLcToPKPi(candidate), ctLc(candidate), yLc(candidate), eLc(candidate));
-      fillTable(1, candidate.isSelLcToPiKP(), invMassLcToPiKP(candidate), ctLc(candidate), yLc(candidate), eLc(candidate));
+      fillCandidate(candidate, tracks, false, 0, 0);
     }
   }
   PROCESS_SWITCH(HfTreeCreatorLcToPKPi, processData, "Process data tree writer", false);
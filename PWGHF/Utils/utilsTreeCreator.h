@@ -0,0 +1,117 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file utilsTreeCreator.h
+/// \brief Utilities shared by the HF tree creators to export the candidates of a time frame
+///
+/// The daughter tracks and their collisions are shared by many candidates (and by the two mass hypotheses
+/// of each candidate). The caches below read the needed columns of each track and collision once per time frame,
+/// the candidate rows are then filled from contiguous arrays indexed by the track and collision indices.
+
+#ifndef PWGHF_UTILS_UTILSTREECREATOR_H_
+#define PWGHF_UTILS_UTILSTREECREATOR_H_
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace o2::analysis::hf_tree_creator
+{
+
+/// \brief Pseudo-random number in [0, 1) built from the sub-MeV digits of a daughter pT,
+///        so that the downsampling is reproducible and does not depend on the order of the candidates
+inline double pseudoRandom(float pt)
+{
+  double value = pt * 1000.;
+  return value - std::floor(value);
+}
+
+/// \brief Whether a candidate is written to the tree
+/// \param isSignal signal candidates (MC matched) are always kept
+/// \param ptCandidate candidates above ptMaxForDownSample are always kept
+/// \param ptDaughter pT of a daughter, used as source of the pseudo-random number
+/// \param downSampleBkgFactor fraction of the background candidates to keep
+inline bool keepCandidate(bool isSignal, float ptCandidate, float ptDaughter, double downSampleBkgFactor, double ptMaxForDownSample)
+{
+  if (isSignal || downSampleBkgFactor >= 1. || ptCandidate >= ptMaxForDownSample) {
+    return true;
+  }
+  return pseudoRandom(ptDaughter) < downSampleBkgFactor;
+}
+
+/// \brief Event columns repeated in each candidate row, stored by collision index when the events are written
+class CollisionCache
+{
+ public:
+  template <typename TCollisions>
+  void reset(TCollisions const& collisions)
+  {
+    mBcIds.resize(collisions.size());
+    mNumContribs.resize(collisions.size());
+  }
+
+  template <typename TCollision>
+  void fill(TCollision const& collision)
+  {
+    mBcIds[collision.globalIndex()] = collision.bcId();
+    mNumContribs[collision.globalIndex()] = collision.numContrib();
+  }
+
+  /// tracks not assigned to a collision get -1
+  int bcId(int64_t collisionId) const { return collisionId >= 0 ? mBcIds[collisionId] : -1; }
+  int numContrib(int64_t collisionId) const { return collisionId >= 0 ? mNumContribs[collisionId] : -1; }
+
+ private:
+  std::vector<int> mBcIds;
+  std::vector<int> mNumContribs;
+};
+
+/// \brief Columns of the daughter tracks, read the first time a track is used by a candidate of the time frame
+/// \tparam NValues number of float values stored per track, filled by the function passed to get()
+template <int NValues>
+class DaughterCache
+{
+ public:
+  struct Entry {
+    int64_t collisionId;
+    std::array<float, NValues> values;
+  };
+
+  template <typename TTracks>
+  void reset(TTracks const& tracks)
+  {
+    mFilled.assign(tracks.size(), 0);
+    mEntries.resize(tracks.size());
+  }
+
+  /// \param fill function (track, std::array<float, NValues>&) writing the values of a track
+  template <typename TTracks, typename TFill>
+  const Entry& get(TTracks const& tracks, int64_t trackId, TFill const& fill)
+  {
+    Entry& entry = mEntries[trackId];
+    if (!mFilled[trackId]) {
+      auto track = tracks.iteratorAt(trackId);
+      entry.collisionId = track.collisionId();
+      fill(track, entry.values);
+      mFilled[trackId] = 1;
+    }
+    return entry;
+  }
+
+ private:
+  std::vector<uint8_t> mFilled;
+  std::vector<Entry> mEntries;
+};
+
+} // namespace o2::analysis::hf_tree_creator
+
+#endif // PWGHF_UTILS_UTILSTREECREATOR_H_
@@ -17,211 +17,181 @@
 #ifndef PWGJE_CORE_JETUTILITIES_H_
 #define PWGJE_CORE_JETUTILITIES_H_
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <numeric>
+#include <stdexcept>
 #include <tuple>
 #include <vector>
 
-#include <TKDTree.h>
-
 #include "Framework/Logger.h"
 
 namespace JetUtilities
 {
 /**
- * Duplicates jets around the phi boundary which are within the matching distance.
+ * Cell grid in (eta, phi) for geometrical nearest neighbour matching.
  *
- * NOTE: Assumes, but does not validate, that 0 <= phi < 2pi.
+ * The points are sorted into cells which are at least as large as the maximum matching distance,
+ * such that all candidates for a match are contained in the 3x3 cells around the query point.
+ * Phi is treated as periodic, so there is no need to duplicate points around the phi boundary.
+ * The storage is kept between calls to build(), such that the grid can be reused without
+ * reallocating for every collision.
  *
- * @param jetsPhi Jets phi
- * @param jetsEta Jets eta
- * @param maxMatchingDistance Maximum matching distance. Only duplicate jets within this distance of the boundary.
+ * NOTE: Assumes, but does not validate, that 0 <= phi < 2pi.
  */
 template <typename T>
-std::tuple<std::vector<std::size_t>, std::vector<T>, std::vector<T>> DuplicateJetsAroundPhiBoundary(
-  std::vector<T>& jetsPhi,
-  std::vector<T>& jetsEta,
-  double maxMatchingDistance,
-  // TODO: Remove additional margin after additional testing.
-  double additionalMargin = 0.05)
+class EtaPhiGridMatcher
 {
-  const std::size_t nJets = jetsPhi.size();
-  std::vector<std::size_t> jetsMapToJetIndex(nJets);
-  // We need to keep track of the map from the duplicated vector to the existing jets.
-  // To start, we fill this map (practically, it maps from vector index to an index, so we
-  // just use a standard vector) with the existing jet indices, which range from 0..nJets.
-  std::iota(jetsMapToJetIndex.begin(), jetsMapToJetIndex.end(), 0);
-
-  // The full duplicated jets will be stored in a new vector to avoid disturbing the input data.
-  std::vector<T> jetsPhiComparison(jetsPhi);
-  std::vector<T> jetsEtaComparison(jetsEta);
-
-  // Duplicate the jets
-  // When a jet is outside of the desired phi range, we make a copy of the jet, shifting it by 2pi
-  // as necessary. The eta value is copied directly, as is the index of the original jet, so we can
-  // map from index in duplicated data -> index in original collection.
-  // NOTE: Assumes, but does not validate, that 0 <= phi < 2pi.
-  for (std::size_t i = 0; i < nJets; i++) {
-    // Handle lower edge
-    if (jetsPhi[i] <= (maxMatchingDistance + additionalMargin)) {
-      jetsPhiComparison.emplace_back(jetsPhi[i] + 2 * M_PI);
-      jetsEtaComparison.emplace_back(jetsEta[i]);
-      jetsMapToJetIndex.emplace_back(jetsMapToJetIndex[i]);
+ public:
+  /**
+   * Sort the points into the grid.
+   *
+   * @param eta Points eta
+   * @param phi Points phi
+   * @param maxMatchingDistance Maximum matching distance which will be used in the queries.
+   */
+  void build(const std::vector<T>& eta, const std::vector<T>& phi, double maxMatchingDistance)
+  {
+    if (eta.size() != phi.size()) {
+      throw std::invalid_argument("Grid eta and phi sizes don't match. Check the inputs.");
     }
-    // Handle upper edge
-    if (jetsPhi[i] >= (2 * M_PI - (maxMatchingDistance + additionalMargin))) {
-      jetsPhiComparison.emplace_back(jetsPhi[i] - 2 * M_PI);
-      jetsEtaComparison.emplace_back(jetsEta[i]);
-      jetsMapToJetIndex.emplace_back(jetsMapToJetIndex[i]);
+    const std::size_t nPoints = eta.size();
+    mCellSize = std::max(maxMatchingDistance > 0. ? maxMatchingDistance : 2 * M_PI, kMinCellSize);
+    mNPhiCells = std::max(1, static_cast<int>(2 * M_PI / mCellSize));
+    mPhiCellSize = 2 * M_PI / mNPhiCells;
+    mEtaMin = 0.;
+    mEtaCellSize = mCellSize;
+    mNEtaCells = 1;
+    if (nPoints) {
+      auto [etaMin, etaMax] = std::minmax_element(eta.begin(), eta.end());
+      mEtaMin = *etaMin;
+      // For a wide eta range, the eta cells are enlarged such that there are at most kMaxCells cells
+      const int maxEtaCells = std::max(1, static_cast<int>(kMaxCells / mNPhiCells));
+      const double etaRange = *etaMax - *etaMin;
+      mEtaCellSize = std::max(mCellSize, etaRange / maxEtaCells);
+      mNEtaCells = static_cast<int>(std::min(etaRange / mEtaCellSize, maxEtaCells - 1.)) + 1;
     }
-  }
-
-  return {jetsMapToJetIndex, jetsPhiComparison, jetsEtaComparison};
-}
-
-/**
- * Implementation of geometrical jet matching.
- *
- * Jets are required to match uniquely - namely: base <-> tag. Only one direction of matching isn't enough.
- * Unless special conditions are required, it's better to use `MatchJetsGeometrically`, which has an
- * easier to use interface.
- *
- * NOTE: The vectors for matching could all be const, except that SetData() doesn't take a const.
- *
- * @param jetsBasePhi Base jet collection phi.
- * @param jetsBaseEta Base jet collection eta.
- * @param jetsBasePhiForMatching Base jet collection phi to use for matching.
- * @param jetsBaseEtaForMatching Base jet collection eta to use for matching.
- * @param jetMapBaseToJetIndex Base jet collection index map from duplicated jets to original jets.
- * @param jetsTagPhi Tag jet collection phi.
- * @param jetsTagEta Tag jet collection eta.
- * @param jetsTagPhiForMatching Tag jet collection phi to use for matching.
- * @param jetsTagEtaForMatching Tag jet collection eta to use for matching.
- * @param jetMapTagToJetIndex Tag jet collection index map from duplicated jets to original jets.
- * @param maxMatchingDistance Maximum matching distance.
- *
- * @returns (Base to tag index map, tag to base index map) for uniquely matched jets.
- */
-template <typename T>
-std::tuple<std::vector<int>, std::vector<int>> MatchJetsGeometricallyImpl(
-  const std::vector<T>& jetsBasePhi,
-  const std::vector<T>& jetsBaseEta,
-  std::vector<T> jetsBasePhiForMatching,
-  std::vector<T> jetsBaseEtaForMatching,
-  const std::vector<std::size_t> jetMapBaseToJetIndex,
-  const std::vector<T>& jetsTagPhi,
-  const std::vector<T>& jetsTagEta,
-  std::vector<T> jetsTagPhiForMatching,
-  std::vector<T> jetsTagEtaForMatching,
-  const std::vector<std::size_t> jetMapTagToJetIndex,
-  double maxMatchingDistance)
-{
-  // Validation
-  // If no jets in either collection, then return immediately.
-  const std::size_t nJetsBase = jetsBaseEta.size();
-  const std::size_t nJetsTag = jetsTagEta.size();
-  if (!(nJetsBase && nJetsTag)) {
-    return std::make_tuple(std::vector<int>(nJetsBase), std::vector<int>(nJetsTag));
-  }
-  // Require that the comparison vectors are greater than or equal to the standard collections.
-  if (jetsBasePhiForMatching.size() < jetsBasePhi.size()) {
-    throw std::invalid_argument("Base collection phi for matching is smaller than the input base collection.");
-  }
-  if (jetsBaseEtaForMatching.size() < jetsBaseEta.size()) {
-    throw std::invalid_argument("Base collection eta for matching is smaller than the input base collection.");
-  }
-  if (jetsTagPhiForMatching.size() < jetsTagPhi.size()) {
-    throw std::invalid_argument("Tag collection phi for matching is smaller than the input tag collection.");
-  }
-  if (jetsTagEtaForMatching.size() < jetsTagEta.size()) {
-    throw std::invalid_argument("Tag collection eta for matching is smaller than the input tag collection.");
-  }
-
-  // Build the KD-trees using vectors
-  // We build two trees:
-  // treeBase, which contains the base collection.
-  // treeTag, which contains the tag collection.
-  // The trees are built to match in two dimensions (eta, phi)
-  TKDTree<int, T> treeBase(jetsBaseEtaForMatching.size(), 2, 1), treeTag(jetsTagEtaForMatching.size(), 2, 1);
-  // By utilizing SetData, we can avoid having to copy the data again.
-  treeBase.SetData(0, jetsBaseEtaForMatching.data());
-  treeBase.SetData(1, jetsBasePhiForMatching.data());
-  treeBase.Build();
-  treeTag.SetData(0, jetsTagEtaForMatching.data());
-  treeTag.SetData(1, jetsTagPhiForMatching.data());
-  treeTag.Build();
 
-  // Storage for the jet matching indices.
-  // matchIndexTag maps from the base index to the tag index.
-  // matchBaseTag maps from the tag index to the base index.
-  std::vector<int> matchIndexTag(nJetsBase, -1), matchIndexBase(nJetsTag, -1);
-
-  // Find the tag jet closest to each base jet.
-  for (std::size_t iBase = 0; iBase < nJetsBase; iBase++) {
-    Double_t point[2] = {jetsBaseEta[iBase], jetsBasePhi[iBase]};
-    Int_t index(-1);
-    Double_t distance(-1);
-    treeTag.FindNearestNeighbors(point, 1, &index, &distance);
-    // test whether indices are matching:
-    if (index >= 0 && distance < maxMatchingDistance) {
-      LOG(debug) << "Found closest tag jet for " << iBase << " with match index " << index << " and distance " << distance << "\n";
-      matchIndexTag[iBase] = index;
-    } else {
-      LOG(debug) << "Closest tag jet not found for " << iBase << ", distance to closest " << distance << "\n";
+    // Counting sort of the points into the cells, with offsets stored CSR-like
+    mCellOffsets.assign(static_cast<std::size_t>(mNEtaCells) * static_cast<std::size_t>(mNPhiCells) + 1, 0);
+    mPointCells.resize(nPoints);
+    for (std::size_t i = 0; i < nPoints; i++) {
+      mPointCells[i] = cellIndex(etaCell(eta[i]), phiCell(phi[i]));
+      mCellOffsets[mPointCells[i] + 1]++;
     }
-  }
-
-  // Find the base jet closest to each tag jet
-  for (std::size_t iTag = 0; iTag < nJetsTag; iTag++) {
-    Double_t point[2] = {jetsTagEta[iTag], jetsTagPhi[iTag]};
-    Int_t index(-1);
-    Double_t distance(-1);
-    treeBase.FindNearestNeighbors(point, 1, &index, &distance);
-    if (index >= 0 && distance < maxMatchingDistance) {
-      LOG(debug) << "Found closest base jet for " << iTag << " with match index " << index << " and distance " << distance << std::endl;
-      matchIndexBase[iTag] = index;
-    } else {
-      LOG(debug) << "Closest tag jet not found for " << iTag << ", distance to closest " << distance << "\n";
+    std::partial_sum(mCellOffsets.begin(), mCellOffsets.end(), mCellOffsets.begin());
+    mCellCursors.assign(mCellOffsets.begin(), mCellOffsets.end() - 1);
+    mSortedEta.resize(nPoints);
+    mSortedPhi.resize(nPoints);
+    mSortedIndices.resize(nPoints);
+    for (std::size_t i = 0; i < nPoints; i++) {
+      int position = mCellCursors[mPointCells[i]]++;
+      mSortedEta[position] = eta[i];
+      mSortedPhi[position] = phi[i];
+      mSortedIndices[position] = i;
     }
   }
 
-  // Convert indices in the duplicated jet vectors into the original jet indices.
-  // First for the base -> tag map.
-  for (auto& v : matchIndexTag) {
-    // If it's -1, it means that it didn't find a matching jet.
-    // We have to explicitly check for it here because it would be an invalid index.
-    if (v != -1) {
-      v = jetMapTagToJetIndex[v];
+  /**
+   * Find the closest points to the given position.
+   *
+   * @param eta Query eta
+   * @param phi Query phi
+   * @param maxNumberMatches Maximum number of matches.
+   * @param maxMatchingDistance Maximum matching distance. Must not be larger than the one used to build the grid.
+   * @param indices Indices of the matched points, ordered by increasing distance. Must hold maxNumberMatches entries.
+   * @param distances Distances of the matched points. Must hold maxNumberMatches entries.
+   *
+   * @returns Number of matches found.
+   */
+  int findNearestNeighbors(T eta, T phi, int maxNumberMatches, double maxMatchingDistance, int* indices, T* distances) const
+  {
+    int nFound = 0;
+    if (mSortedIndices.empty() || maxNumberMatches <= 0) {
+      return nFound;
     }
-  }
-  // Then for the index -> base map.
-  for (auto& v : matchIndexBase) {
-    if (v != -1) {
-      v = jetMapBaseToJetIndex[v];
+    const int etaCellQuery = static_cast<int>(std::clamp(std::floor((eta - mEtaMin) / mEtaCellSize), -2., static_cast<double>(mNEtaCells + 1)));
+    const int phiCellQuery = phiCell(phi);
+    const int etaCellFirst = std::max(etaCellQuery - 1, 0);
+    const int etaCellLast = std::min(etaCellQuery + 1, mNEtaCells - 1);
+    // With less than three cells in phi, the neighbouring cells would be visited twice.
+    const int nPhiCellsToVisit = std::min(mNPhiCells, 3);
+    const int phiCellFirst = mNPhiCells < 3 ? 0 : phiCellQuery - 1;
+    for (int iEta = etaCellFirst; iEta <= etaCellLast; iEta++) {
+      for (int iPhiOffset = 0; iPhiOffset < nPhiCellsToVisit; iPhiOffset++) {
+        const int iPhi = (phiCellFirst + iPhiOffset + mNPhiCells) % mNPhiCells;
+        const int cell = cellIndex(iEta, iPhi);
+        for (int iPoint = mCellOffsets[cell]; iPoint < mCellOffsets[cell + 1]; iPoint++) {
+          const T dEta = mSortedEta[iPoint] - eta;
+          T dPhi = std::abs(mSortedPhi[iPoint] - phi);
+          if (dPhi > M_PI) {
+            dPhi = 2 * M_PI - dPhi;
+          }
+          const T distance = std::sqrt(dEta * dEta + dPhi * dPhi);
+          if (!(distance < maxMatchingDistance)) {
+            continue;
+          }
+          // Insert into the list of closest points, ordered by increasing distance
+          int position = nFound < maxNumberMatches ? nFound++ : maxNumberMatches;
+          while (position > 0 && distances[position - 1] > distance) {
+            if (position < maxNumberMatches) {
+              distances[position] = distances[position - 1];
+              indices[position] = indices[position - 1];
+            }
+            position--;
+          }
+          if (position < maxNumberMatches) {
+            distances[position] = distance;
+            indices[position] = mSortedIndices[iPoint];
+          }
+        }
+      }
     }
+    return nFound;
   }
 
-  // Finally, we'll check for true matches, which are pairs where the base jet is the
-  // closest to the tag jet and vice versa
-  // As the lists are linear a loop over the outer base jet is sufficient.
-  std::vector<int> baseToTagMap(nJetsBase, -1);
-  std::vector<int> tagToBaseMap(nJetsTag, -1);
-  LOG(debug) << "Starting true jet loop: nbase(" << nJetsBase << "), ntag(" << nJetsTag << ")\n";
-  for (std::size_t iBase = 0; iBase < nJetsBase; iBase++) {
-    LOG(debug) << "base jet " << iBase << ": match index in tag jet container " << matchIndexTag[iBase] << "\n";
-    if (matchIndexTag[iBase] > -1) {
-      LOG(debug) << "tag jet " << matchIndexTag[iBase] << ": matched base jet " << matchIndexBase[matchIndexTag[iBase]] << "\n";
-    }
-    if (matchIndexTag[iBase] > -1 && matchIndexBase[matchIndexTag[iBase]] == static_cast<int>(iBase)) {
-      LOG(debug) << "True match! base index: " << iBase << ", tag index: " << matchIndexTag[iBase] << "\n";
-      baseToTagMap[iBase] = matchIndexTag[iBase];
-      tagToBaseMap[matchIndexTag[iBase]] = iBase;
+  /**
+   * Find the closest points for a batch of positions.
+   *
+   * @param eta Query eta
+   * @param phi Query phi
+   * @param maxNumberMatches Maximum number of matches per query.
+   * @param maxMatchingDistance Maximum matching distance. Must not be larger than the one used to build the grid.
+   * @param indices Flat map from query to matched indices, with maxNumberMatches entries per query, filled with -1 if there is no (further) match.
+   */
+  void findNearestNeighbors(const std::vector<T>& eta, const std::vector<T>& phi, int maxNumberMatches, double maxMatchingDistance, std::vector<int>& indices)
+  {
+    const std::size_t nQueries = eta.size();
+    indices.assign(nQueries * maxNumberMatches, -1);
+    mDistances.resize(maxNumberMatches);
+    for (std::size_t i = 0; i < nQueries; i++) {
+      findNearestNeighbors(eta[i], phi[i], maxNumberMatches, maxMatchingDistance, indices.data() + i * maxNumberMatches, mDistances.data());
     }
   }
 
-  return std::make_tuple(baseToTagMap, tagToBaseMap);
-}
+ private:
+  int etaCell(T eta) const { return static_cast<int>(std::clamp((eta - mEtaMin) / mEtaCellSize, 0., mNEtaCells - 1.)); }
+  int phiCell(T phi) const { return std::clamp(static_cast<int>(phi / mPhiCellSize), 0, mNPhiCells - 1); }
+  int cellIndex(int iEta, int iPhi) const { return iEta * mNPhiCells + iPhi; }
+
+  static constexpr double kMinCellSize = 0.01;        // Lower limit of the cell size, for very small matching distances
+  static constexpr std::size_t kMaxCells = 1u << 20; // Upper limit of the number of cells
+
+  double mCellSize = 1.;
+  double mEtaCellSize = 1.;
+  double mPhiCellSize = 2 * M_PI;
+  double mEtaMin = 0.;
+  int mNEtaCells = 1;
+  int mNPhiCells = 1;
+  std::vector<int> mCellOffsets;
+  std::vector<int> mCellCursors;
+  std::vector<int> mPointCells;
+  std::vector<T> mSortedEta;
+  std::vector<T> mSortedPhi;
+  std::vector<int> mSortedIndices;
+  std::vector<T> mDistances;
+};
 
 /**
  * Geometrical jet matching.
@@ -263,21 +233,70 @@ std::tuple<std::vector<int>, std::vector<int>> MatchJetsGeometrically(
     throw std::invalid_argument("Tag collection eta and phi sizes don't match. Check the inputs.");
   }
 
-  // To perform matching with periodic boundary conditions (ie. phi) with a KDTree, we need
-  // to duplicate data up to maxMatchingDistance in phi because phi is periodic.
-  // NOTE: vectors are modified in place to avoid copies.
-  auto&& [jetMapBaseToJetIndex, jetsBasePhiComparison, jetsBaseEtaComparison] = DuplicateJetsAroundPhiBoundary(jetsBasePhi, jetsBaseEta, maxMatchingDistance);
-  auto&& [jetMapTagToJetIndex, jetsTagPhiComparison, jetsTagEtaComparison] = DuplicateJetsAroundPhiBoundary(jetsTagPhi, jetsTagEta, maxMatchingDistance);
+  // Sort both collections into eta-phi grids. The grids handle the periodic boundary in phi,
+  // so the jets don't need to be duplicated around the boundary as for the KD-tree based matching.
+  EtaPhiGridMatcher<T> gridBase, gridTag;
+  gridBase.build(jetsBaseEta, jetsBasePhi, maxMatchingDistance);
+  gridTag.build(jetsTagEta, jetsTagPhi, maxMatchingDistance);
+
+  // Storage for the jet matching indices.
+  // matchIndexTag maps from the base index to the tag index.
+  // matchBaseTag maps from the tag index to the base index.
+  std::vector<int> matchIndexTag, matchIndexBase;
+  gridTag.findNearestNeighbors(jetsBaseEta, jetsBasePhi, 1, maxMatchingDistance, matchIndexTag);
+  gridBase.findNearestNeighbors(jetsTagEta, jetsTagPhi, 1, maxMatchingDistance, matchIndexBase);
 
-  // Finally, perform the actual matching.
-  auto&& [baseToTagMap, tagToBaseMap] = MatchJetsGeometricallyImpl(
-    jetsBasePhi, jetsBaseEta, jetsBasePhiComparison, jetsBaseEtaComparison, jetMapBaseToJetIndex,
-    jetsTagPhi, jetsTagEta, jetsTagPhiComparison, jetsTagEtaComparison, jetMapTagToJetIndex,
-    maxMatchingDistance);
+  // Finally, we'll check for true matches, which are pairs where the base jet is the
+  // closest to the tag jet and vice versa
+  std::vector<int> baseToTagMap(nJetsBase, -1);
+  std::vector<int> tagToBaseMap(nJetsTag, -1);
+  for (std::size_t iBase = 0; iBase < nJetsBase; iBase++) {
+    if (matchIndexTag[iBase] > -1 && matchIndexBase[matchIndexTag[iBase]] == static_cast<int>(iBase)) {
+      LOG(debug) << "True match! base index: " << iBase << ", tag index: " << matchIndexTag[iBase] << "\n";
+      baseToTagMap[iBase] = matchIndexTag[iBase];
+      tagToBaseMap[matchIndexTag[iBase]] = iBase;
+    }
+  }
 
   return std::make_tuple(baseToTagMap, tagToBaseMap);
 }
 
+/**
+ * Match clusters and tracks, reusing the grids and output storage between calls.
+ *
+ * Same as the MatchClustersAndTracks below, but the matches are stored in flat maps with maxNumberMatches entries per
+ * cluster (track), filled with -1 if no (further) match was found.
+ *
+ * @param clusterPhi cluster collection phi.
+ * @param clusterEta cluster collection eta.
+ * @param trackPhi track collection phi.
+ * @param trackEta track collection eta.
+ * @param maxMatchingDistance Maximum matching distance.
+ * @param maxNumberMatches Maximum number of matches (e.g. 5 closest).
+ * @param gridCluster Grid used to store the clusters.
+ * @param gridTrack Grid used to store the tracks.
+ * @param clusterToTrack Flat cluster to track index map.
+ * @param trackToCluster Flat track to cluster index map.
+ */
+template <typename T>
+void MatchClustersAndTracks(
+  const std::vector<T>& clusterPhi,
+  const std::vector<T>& clusterEta,
+  const std::vector<T>& trackPhi,
+  const std::vector<T>& trackEta,
+  double maxMatchingDistance,
+  int maxNumberMatches,
+  EtaPhiGridMatcher<T>& gridCluster,
+  EtaPhiGridMatcher<T>& gridTrack,
+  std::vector<int>& clusterToTrack,
+  std::vector<int>& trackToCluster)
+{
+  gridCluster.build(clusterEta, clusterPhi, maxMatchingDistance);
+  gridTrack.build(trackEta, trackPhi, maxMatchingDistance);
+  gridTrack.findNearestNeighbors(clusterEta, clusterPhi, maxNumberMatches, maxMatchingDistance, clusterToTrack);
+  gridCluster.findNearestNeighbors(trackEta, trackPhi, maxNumberMatches, maxMatchingDistance, trackToCluster);
+}
+
 /**
  * Match clusters and tracks.
  *
@@ -319,67 +338,20 @@ std::tuple<std::vector<std::vector<int>>, std::vector<std::vector<int>>> MatchCl
     throw std::invalid_argument("track collection eta and phi sizes don't match. Check the inputs.");
   }
 
-  // for (std::size_t iTrack = 0; iTrack < nTracks; iTrack++) {
-  //   if (trackEta[iTrack] == 0)
-  //     LOG(warning) << "Track eta is 0!";
-  // }
-
-  // Build the KD-trees using vectors
-  // We build two trees:
-  // treeBase, which contains the base collection.
-  // treeTag, which contains the tag collection.
-  // The trees are built to match in two dimensions (eta, phi)
-  TKDTree<int, T> treeCluster(clusterEta.size(), 2, 1), treeTrack(trackEta.size(), 2, 1);
-  // By utilizing SetData, we can avoid having to copy the data again.
-  treeCluster.SetData(0, clusterEta.data());
-  treeCluster.SetData(1, clusterPhi.data());
-  treeCluster.Build();
-  treeTrack.SetData(0, trackEta.data());
-  treeTrack.SetData(1, trackPhi.data());
-  treeTrack.Build();
+  EtaPhiGridMatcher<T> gridCluster, gridTrack;
+  std::vector<int> clusterToTrack, trackToCluster;
+  MatchClustersAndTracks(clusterPhi, clusterEta, trackPhi, trackEta, maxMatchingDistance, maxNumberMatches, gridCluster, gridTrack, clusterToTrack, trackToCluster);
 
-  // Storage for the cluster matching indices.
-  std::vector<std::vector<int>> matchIndexTrack(nClusters, std::vector<int>(maxNumberMatches, -1));
-  std::vector<std::vector<int>> matchIndexCluster(nTracks, std::vector<int>(maxNumberMatches, -1));
-
-  // Find the track closest to each cluster.
+  // Convert the flat maps into the per cluster (track) vectors.
+  std::vector<std::vector<int>> matchIndexTrack(nClusters);
+  std::vector<std::vector<int>> matchIndexCluster(nTracks);
   for (std::size_t iCluster = 0; iCluster < nClusters; iCluster++) {
-    T point[2] = {clusterEta[iCluster], clusterPhi[iCluster]};
-    int index[50];  // size 50 for safety
-    T distance[50]; // size 50 for safery
-    std::fill_n(index, 50, -1);
-    std::fill_n(distance, 50, std::numeric_limits<T>::max());
-    treeTrack.FindNearestNeighbors(point, maxNumberMatches, index, distance);
-    // test whether indices are matching:
-    matchIndexTrack[iCluster] = std::vector<int>(maxNumberMatches);
-    for (int m = 0; m < maxNumberMatches; m++) {
-      if (index[m] >= 0 && distance[m] < maxMatchingDistance) {
-        matchIndexTrack[iCluster][m] = index[m];
-      } else {
-        // no match or no more matches found, fill -1
-        matchIndexTrack[iCluster][m] = -1;
-      }
-    }
+    auto first = clusterToTrack.begin() + iCluster * maxNumberMatches;
+    matchIndexTrack[iCluster].assign(first, first + maxNumberMatches);
   }
-
-  // Find the base jet closest to each tag jet
   for (std::size_t iTrack = 0; iTrack < nTracks; iTrack++) {
-    T point[2] = {trackEta[iTrack], trackPhi[iTrack]};
-    int index[50];  // size 50 for safety
-    T distance[50]; // size 50 for safery
-    std::fill_n(index, 50, -1);
-    std::fill_n(distance, 50, std::numeric_limits<T>::max());
-    treeCluster.FindNearestNeighbors(point, maxNumberMatches, index, distance);
-    matchIndexCluster[iTrack] = std::vector<int>(maxNumberMatches);
-    // loop over maxNumberMatches closest matches
-    for (int m = 0; m < maxNumberMatches; m++) {
-      if (index[m] >= 0 && distance[m] < maxMatchingDistance) {
-        matchIndexCluster[iTrack][m] = index[m];
-      } else {
-        // no match jet or no more matches found, fill -1
-        matchIndexCluster[iTrack][m] = -1;
-      }
-    }
+    auto first = trackToCluster.begin() + iTrack * maxNumberMatches;
+    matchIndexCluster[iTrack].assign(first, first + maxNumberMatches);
   }
   return std::make_tuple(matchIndexTrack, matchIndexCluster);
 }
@@ -59,20 +59,32 @@
                     _name_##matching::_jet_type_##Id,                      \
                     _name_##matching::MatchedJetIndex);
 
-// Defines the jet constituent table
-#define JET_CONSTITUENTS_TABLE_DEF(_jet_type_, _name_, _Description_, _track_type_)    \
-  namespace _name_##constituents                                                       \
-  {                                                                                    \
-    DECLARE_SOA_INDEX_COLUMN(_jet_type_, jet);                                         \
-    DECLARE_SOA_INDEX_COLUMN(_track_type_, track);                                     \
-    DECLARE_SOA_INDEX_COLUMN(EMCALCluster, cluster);                                   \
-  }                                                                                    \
-  DECLARE_SOA_TABLE(_jet_type_##TrackConstituents, "AOD", _Description_ "TRKCONSTS",   \
-                    _name_##constituents::_jet_type_##Id,                              \
-                    _name_##constituents::_track_type_##Id);                           \
-  DECLARE_SOA_TABLE(_jet_type_##ClusterConstituents, "AOD", _Description_ "CLSCONSTS", \
-                    _name_##constituents::_jet_type_##Id,                              \
-                    _name_##constituents::EMCALClusterId);
+// Defines the flat jet constituent tables
+// Each row holds a single constituent, and the jets reference their rows via slice indices,
+// avoiding the per-jet array columns of the standard constituents table.
+#define JET_CONSTITUENTS_TABLE_DEF(_jet_type_, _name_, _Description_, _track_type_)                                                        \
+  namespace _name_##flatconstituents                                                                                                       \
+  {                                                                                                                                        \
+    DECLARE_SOA_INDEX_COLUMN(_jet_type_, jet);                                                                                             \
+    DECLARE_SOA_INDEX_COLUMN(_track_type_, track);                                                                                         \
+    DECLARE_SOA_INDEX_COLUMN(EMCALCluster, cluster);                                                                                       \
+  }                                                                                                                                        \
+  DECLARE_SOA_TABLE(_jet_type_##TrackConstituents, "AOD", _Description_ "TRKCONSTS",                                                       \
+                    _name_##flatconstituents::_jet_type_##Id,                                                                              \
+                    _name_##flatconstituents::_track_type_##Id);                                                                           \
+  DECLARE_SOA_TABLE(_jet_type_##ClusterConstituents, "AOD", _Description_ "CLSCONSTS",                                                     \
+                    _name_##flatconstituents::_jet_type_##Id,                                                                              \
+                    _name_##flatconstituents::EMCALClusterId);                                                                             \
+  namespace _name_##constituentslices                                                                                                      \
+  {                                                                                                                                        \
+    DECLARE_SOA_INDEX_COLUMN(_jet_type_, jet);                                                                                             \
+    DECLARE_SOA_SLICE_INDEX_COLUMN_FULL(TrackConstituents, trackConstituents, int32_t, _jet_type_##TrackConstituents, "_trkconsts");       \
+    DECLARE_SOA_SLICE_INDEX_COLUMN_FULL(ClusterConstituents, clusterConstituents, int32_t, _jet_type_##ClusterConstituents, "_clsconsts"); \
+  }                                                                                                                                        \
+  DECLARE_SOA_TABLE(_jet_type_##ConstituentSlices, "AOD", _Description_ "CSLICES",                                                         \
+                    _name_##constituentslices::_jet_type_##Id,                                                                             \
+                    _name_##constituentslices::TrackConstituentsIdSlice,                                                                   \
+                    _name_##constituentslices::ClusterConstituentsIdSlice);
 
 #define JET_CONSTITUENTS_ARRAY_TABLE_DEF(_jet_type_, _name_, _Description_, _track_type_, _cand_type_) \
   namespace _name_##constituents                                                                       \
@@ -236,6 +248,8 @@ using Jet = Jets::iterator;
 using MatchedJet = MatchedJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(Jet, jet, "JET", Track, HfCand2Prong);
 using JetConstituent = JetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(Jet, jet, "JET", Track);
+using JetConstituentSlice = JetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(Jet, jet, "JET");
 using JetConstituentSub = JetConstituentsSub::iterator;
 
@@ -245,6 +259,8 @@ using FullJet = FullJets::iterator;
 using MatchedFullJet = MatchedFullJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(FullJet, fulljet, "JETF", Track, HfCand2Prong);
 using FullJetConstituent = FullJetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(FullJet, fulljet, "JETF", Track);
+using FullJetConstituentSlice = FullJetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(FullJet, fulljet, "JETF");
 using FullJetConstituentSub = FullJetConstituentsSub::iterator;
 
@@ -254,6 +270,8 @@ using NeutralJet = NeutralJets::iterator;
 using MatchedNeutralJet = MatchedNeutralJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(NeutralJet, neutraljet, "JETN", Track, HfCand2Prong);
 using NeutralJetConstituent = NeutralJetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(NeutralJet, neutraljet, "JETN", Track);
+using NeutralJetConstituentSlice = NeutralJetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(NeutralJet, neutraljet, "JETN");
 using NeutralJetConstituentSub = NeutralJetConstituentsSub::iterator;
 
@@ -266,6 +284,8 @@ using MCDetectorLevelJet = MCDetectorLevelJets::iterator;
 using MatchedMCDetectorLevelJet = MatchedMCDetectorLevelJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(MCDetectorLevelJet, mcdetectorleveljet, "MCD", Track, HfCand2Prong);
 using MCDetectorLevelJetConstituent = MCDetectorLevelJetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(MCDetectorLevelJet, mcdetectorleveljet, "MCD", Track);
+using MCDetectorLevelJetConstituentSlice = MCDetectorLevelJetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(MCDetectorLevelJet, mcdetectorleveljet, "MCD");
 using MCDetectorLevelJetConstituentSub = MCDetectorLevelJetConstituentsSub::iterator;
 
@@ -275,6 +295,8 @@ using MCDetectorLevelFullJet = MCDetectorLevelFullJets::iterator;
 using MatchedMCDetectorLevelFullJet = MatchedMCDetectorLevelFullJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(MCDetectorLevelFullJet, mcdetectorlevelfulljet, "MCDF", Track, HfCand2Prong);
 using MCDetectorLevelFullJetConstituent = MCDetectorLevelFullJetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(MCDetectorLevelFullJet, mcdetectorlevelfulljet, "MCDF", Track);
+using MCDetectorLevelFullJetConstituentSlice = MCDetectorLevelFullJetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(MCDetectorLevelFullJet, mcdetectorlevelfulljet, "MCDF");
 using MCDetectorLevelFullJetConstituentSub = MCDetectorLevelFullJetConstituentsSub::iterator;
 
@@ -284,6 +306,8 @@ using MCDetectorLevelNeutralJet = MCDetectorLevelNeutralJets::iterator;
 using MatchedMCDetectorLevelNeutralJet = MatchedMCDetectorLevelNeutralJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(MCDetectorLevelNeutralJet, mcdetectorlevelneutraljet, "MCDN", Track, HfCand2Prong);
 using MCDetectorLevelNeutralJetConstituent = MCDetectorLevelNeutralJetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(MCDetectorLevelNeutralJet, mcdetectorlevelneutraljet, "MCDN", Track);
+using MCDetectorLevelNeutralJetConstituentSlice = MCDetectorLevelNeutralJetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(MCDetectorLevelNeutralJet, mcdetectorlevelneutraljet, "MCDN");
 using MCDetectorLevelNeutralJetConstituentSub = MCDetectorLevelNeutralJetConstituentsSub::iterator;
 
@@ -301,6 +325,8 @@ using MCParticleLevelJet = MCParticleLevelJets::iterator;
 using MatchedMCParticleLevelJet = MatchedMCParticleLevelJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(MCParticleLevelJet, mcparticleleveljet, "MCP", McParticle, McParticles);
 using MCParticleLevelJetConstituent = MCParticleLevelJetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(MCParticleLevelJet, mcparticleleveljet, "MCP", McParticle);
+using MCParticleLevelJetConstituentSlice = MCParticleLevelJetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(MCParticleLevelJet, mcparticleleveljet, "MCP");
 using MCParticleLevelJetConstituentSub = MCParticleLevelJetConstituentsSub::iterator;
 
@@ -310,6 +336,8 @@ using MCParticleLevelFullJet = MCParticleLevelFullJets::iterator;
 using MatchedMCParticleLevelFullJet = MatchedMCParticleLevelFullJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(MCParticleLevelFullJet, mcparticlelevelfulljet, "MCPF", McParticle, McParticles);
 using MCParticleLevelFullJetConstituent = MCParticleLevelFullJetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(MCParticleLevelFullJet, mcparticlelevelfulljet, "MCPF", McParticle);
+using MCParticleLevelFullJetConstituentSlice = MCParticleLevelFullJetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(MCParticleLevelFullJet, mcparticlelevelfulljet, "MCPF");
 using MCParticleLevelFullJetConstituentSub = MCParticleLevelFullJetConstituentsSub::iterator;
 
@@ -319,6 +347,8 @@ using MCParticleLevelNeutralJet = MCParticleLevelNeutralJets::iterator;
 using MatchedMCParticleLevelNeutralJet = MatchedMCParticleLevelNeutralJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(MCParticleLevelNeutralJet, mcparticlelevelneutraljet, "MCPN", McParticle, McParticles);
 using MCParticleLevelNeutralJetConstituent = MCParticleLevelNeutralJetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(MCParticleLevelNeutralJet, mcparticlelevelneutraljet, "MCPN", McParticle);
+using MCParticleLevelNeutralJetConstituentSlice = MCParticleLevelNeutralJetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(MCParticleLevelNeutralJet, mcparticlelevelneutraljet, "MCPN");
 using MCParticleLevelNeutralJetConstituentSub = MCParticleLevelNeutralJetConstituentsSub::iterator;
 
@@ -328,6 +358,8 @@ using HybridIntermediateJet = HybridIntermediateJets::iterator;
 using MatchedHybridIntermediateJet = MatchedHybridIntermediateJets::iterator;
 JET_CONSTITUENTS_ARRAY_TABLE_DEF(HybridIntermediateJet, hybridintermediate, "HYBINT", Track, HfCand2Prong);
 using HybridIntermediateJetConstituent = HybridIntermediateJetConstituents::iterator;
+JET_CONSTITUENTS_TABLE_DEF(HybridIntermediateJet, hybridintermediate, "HYBINT", Track);
+using HybridIntermediateJetConstituentSlice = HybridIntermediateJetConstituentSlices::iterator;
 JET_CONSTITUENTS_SUB_TABLE_DEF(HybridIntermediateJet, hybridintermediate, "HYBINT");
 using HybridIntermediateJetConstituentSub = HybridIntermediateJetConstituentsSub::iterator;
 
@@ -14,6 +14,7 @@
 // Author: Raymond Ehlers & Florian Jonas
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <unordered_map>
@@ -29,6 +30,7 @@
 
 #include "PWGJE/DataModel/EMCALClusters.h"
 
+#include "Common/Core/WorkerPool.h"
 #include "Common/DataModel/EventSelection.h"
 #include "Common/DataModel/TrackSelectionTables.h"
 #include "DataFormatsEMCAL/Cell.h"
@@ -77,6 +79,7 @@ struct EmcalCorrectionTask {
   Configurable<float> exoticCellMinAmplitude{"exoticCellMinAmplitude", 4, "Check for exotic only if amplitud is larger than this value"};
   Configurable<float> exoticCellInCrossMinAmplitude{"exoticCellInCrossMinAmplitude", 0.1, "Minimum energy of cells in cross, if lower not considered in cross"};
   Configurable<bool> useWeightExotic{"useWeightExotic", false, "States if weights should be used for exotic cell cut"};
+  Configurable<int> nClusterizerThreads{"nClusterizerThreads", 1, "Number of threads running the clusterizers in processFullParallel, limited to the number of hardware threads. All BCs of the dataframe are clusterized in parallel before the tables are filled in BC order"};
 
   // Require EMCAL cells (CALO type 1)
   Filter emccellfilter = aod::calo::caloType == selectedCellType;
@@ -92,6 +95,29 @@ struct EmcalCorrectionTask {
   o2::emcal::NonlinearityHandler mNonlinearityHandler;
   // Cells and clusters
   std::vector<o2::emcal::AnalysisCluster> mAnalysisClusters;
+  // Per-thread copies of the clusterizers and the cluster factory for the parallel clusterization
+  struct ClusterizerWorker {
+    std::vector<std::unique_ptr<o2::emcal::Clusterizer<o2::emcal::Cell>>> clusterizers;
+    o2::emcal::ClusterFactory<o2::emcal::Cell> clusterFactory;
+  };
+  std::vector<std::unique_ptr<ClusterizerWorker>> mClusterizerWorkers;
+  o2::analysis::WorkerPool mWorkerPool; // one thread per entry of mClusterizerWorkers, reused for each dataframe
+  // Cells of all BCs of the dataframe, stored contiguously with per-BC offsets. Storage is kept between dataframes
+  std::vector<o2::emcal::Cell> mCellArena;
+  std::vector<int64_t> mCellIndexArena;
+  std::vector<size_t> mBCCellOffsets;
+  std::vector<int64_t> mBCIndices;
+  // Analysis clusters per (BC, clusterizer), filled by the workers
+  std::vector<std::vector<o2::emcal::AnalysisCluster>> mBCAnalysisClusters;
+  // Track matching, storage is kept between collisions
+  static constexpr int kMaxNumberMatches = 20;
+  JetUtilities::EtaPhiGridMatcher<double> mTrackGrid;
+  std::vector<double> mTrackPhi;
+  std::vector<double> mTrackEta;
+  std::vector<int64_t> mTrackGlobalIndex;
+  std::vector<double> mClusterPhi;
+  std::vector<double> mClusterEta;
+  std::vector<int> mClusterToTrackIndexMap;
 
   std::vector<o2::aod::EMCALClusterDefinition> mClusterDefinitions;
   // QA
@@ -128,15 +154,9 @@ struct EmcalCorrectionTask {
         mClusterDefinitions.push_back(clusDef);
       }
     }
-    mClusterFactories.setGeometry(geometry);
-    mClusterFactories.SetECALogWeight(logWeight);
-    mClusterFactories.setExoticCellFraction(exoticCellFraction);
-    mClusterFactories.setExoticCellDiffTime(exoticCellDiffTime);
-    mClusterFactories.setExoticCellMinAmplitude(exoticCellMinAmplitude);
-    mClusterFactories.setExoticCellInCrossMinAmplitude(exoticCellInCrossMinAmplitude);
-    mClusterFactories.setUseWeightExotic(useWeightExotic);
+    setupClusterFactory(mClusterFactories, geometry);
     for (auto& clusterDefinition : mClusterDefinitions) {
-      mClusterizers.emplace_back(std::make_unique<o2::emcal::Clusterizer<o2::emcal::Cell>>(1E9, clusterDefinition.timeMin, clusterDefinition.timeMax, clusterDefinition.gradientCut, clusterDefinition.doGradientCut, clusterDefinition.seedEnergy, clusterDefinition.minCellEnergy));
+      mClusterizers.emplace_back(makeClusterizer(clusterDefinition));
       LOG(info) << "Cluster definition initialized: " << clusterDefinition.toString();
       LOG(info) << "timeMin: " << clusterDefinition.timeMin;
       LOG(info) << "timeMax: " << clusterDefinition.timeMax;
@@ -153,6 +173,27 @@ struct EmcalCorrectionTask {
       LOG(error) << "No cluster definitions specified!";
     }
 
+    if (doprocessFullParallel) {
+      // The geometry is a singleton shared by all workers, and it fills the super-module matrices lazily from
+      // gGeoManager at the first access. Fill them all here, before the workers start, so that the workers
+      // only read the geometry.
+      if (geometry) {
+        for (int iSM = 0; iSM < geometry->GetNumberOfSuperModules(); iSM++) {
+          geometry->GetMatrixForSuperModule(iSM);
+        }
+      }
+      const int nThreads = mWorkerPool.init(nClusterizerThreads.value);
+      for (int iThread = 0; iThread < nThreads; iThread++) {
+        auto& worker = mClusterizerWorkers.emplace_back(std::make_unique<ClusterizerWorker>());
+        setupClusterFactory(worker->clusterFactory, geometry);
+        for (auto& clusterDefinition : mClusterDefinitions) {
+          worker->clusterizers.emplace_back(makeClusterizer(clusterDefinition));
+          worker->clusterizers.back()->setGeometry(geometry);
+        }
+      }
+      LOG(info) << "Running the clusterizers with " << nThreads << " threads (requested " << nClusterizerThreads.value << ")";
+    }
+
     mNonlinearityHandler = o2::emcal::NonlinearityFactory::getInstance().getNonlinearity(static_cast<std::string>(nonlinearityFunction));
     LOG(info) << "Using nonlinearity parameterisation: " << nonlinearityFunction.value;
     LOG(info) << "Apply shaper saturation correction:  " << (hasShaperCorrection.value ? "yes" : "no");
@@ -198,6 +239,22 @@ struct EmcalCorrectionTask {
     hBC->GetXaxis()->SetBinLabel(8, "all BC");
   }
 
+  std::unique_ptr<o2::emcal::Clusterizer<o2::emcal::Cell>> makeClusterizer(o2::aod::EMCALClusterDefinition const& clusterDefinition)
+  {
+    return std::make_unique<o2::emcal::Clusterizer<o2::emcal::Cell>>(1E9, clusterDefinition.timeMin, clusterDefinition.timeMax, clusterDefinition.gradientCut, clusterDefinition.doGradientCut, clusterDefinition.seedEnergy, clusterDefinition.minCellEnergy);
+  }
+
+  void setupClusterFactory(o2::emcal::ClusterFactory<o2::emcal::Cell>& clusterFactory, o2::emcal::Geometry* geometry)
+  {
+    clusterFactory.setGeometry(geometry);
+    clusterFactory.SetECALogWeight(logWeight);
+    clusterFactory.setExoticCellFraction(exoticCellFraction);
+    clusterFactory.setExoticCellDiffTime(exoticCellDiffTime);
+    clusterFactory.setExoticCellMinAmplitude(exoticCellMinAmplitude);
+    clusterFactory.setExoticCellInCrossMinAmplitude(exoticCellInCrossMinAmplitude);
+    clusterFactory.setUseWeightExotic(useWeightExotic);
+  }
+
   // void process(aod::Collision const& collision, soa::Filtered<aod::Tracks> const& fullTracks, aod::Calos const& cells)
   // void process(aod::Collision const& collision, aod::Tracks const& tracks, aod::Calos const& cells)
   // void process(aod::BCs const& bcs, aod::Collision const& collision, aod::Calos const& cells)
@@ -253,39 +310,15 @@ struct EmcalCorrectionTask {
       //  this is a test
       //  Run the clusterizers
       LOG(debug) << "Running clusterizers";
-      for (size_t iClusterizer = 0; iClusterizer < mClusterizers.size(); iClusterizer++) {
-        cellsToCluster(iClusterizer, cellsBC);
-
-        if (collisionsInFoundBC.size() == 1) {
-          // dummy loop to get the first collision
-          for (const auto& col : collisionsInFoundBC) {
-            mHistManager.fill(HIST("hCollPerBC"), 1);
-            mHistManager.fill(HIST("hCollisionType"), 1);
-            math_utils::Point3D<float> vertex_pos = {col.posX(), col.posY(), col.posZ()};
-
-            std::vector<std::vector<int>> clusterToTrackIndexMap;
-            std::vector<std::vector<int>> trackToClusterIndexMap;
-            std::tuple<std::vector<std::vector<int>>, std::vector<std::vector<int>>> IndexMapPair{clusterToTrackIndexMap, trackToClusterIndexMap};
-            std::vector<int64_t> trackGlobalIndex;
-            doTrackMatching<collEventSels::iterator>(col, tracks, IndexMapPair, vertex_pos, trackGlobalIndex);
-
-            // Store the clusters in the table where a matching collision could
-            // be identified.
-            FillClusterTable<collEventSels::iterator>(col, vertex_pos, iClusterizer, cellIndicesBC, IndexMapPair, trackGlobalIndex);
-          }
-        } else { // ambiguous
-          // LOG(warning) << "No vertex found for event. Assuming (0,0,0).";
-          bool hasCollision = false;
-          mHistManager.fill(HIST("hCollPerBC"), collisionsInFoundBC.size());
-          if (collisionsInFoundBC.size() == 0) {
-            mHistManager.fill(HIST("hCollisionType"), 0);
-          } else {
-            hasCollision = true;
-            mHistManager.fill(HIST("hCollisionType"), 2);
-          }
-          FillAmbigousClusterTable<bcEvSels::iterator>(bc, iClusterizer, cellIndicesBC, hasCollision);
+      // The tracks only depend on the collision, so they are sorted into the matching grid once for all clusterizers
+      if (collisionsInFoundBC.size() == 1) {
+        for (const auto& col : collisionsInFoundBC) {
+          prepareTrackMatching(col, tracks);
         }
-
+      }
+      for (size_t iClusterizer = 0; iClusterizer < mClusterizers.size(); iClusterizer++) {
+        cellsToCluster(*mClusterizers.at(iClusterizer), mClusterFactories, cellsBC, mAnalysisClusters);
+        fillClustersFull(bc, collisionsInFoundBC, iClusterizer, cellIndicesBC);
         LOG(debug) << "Cluster loop done for clusterizer " << iClusterizer;
       } // end of clusterizer loop
       LOG(debug) << "Done with process BC.";
@@ -295,6 +328,112 @@ struct EmcalCorrectionTask {
   }
   PROCESS_SWITCH(EmcalCorrectionTask, processFull, "run full analysis", true);
 
+  void processFullParallel(bcEvSels const& bcs, collEventSels const& collisions, myGlobTracks const& tracks, filteredCells const& cells)
+  {
+    LOG(debug) << "Starting process full (parallel).";
+
+    // First pass: collect the cells of all BCs into the arena
+    mCellArena.clear();
+    mCellIndexArena.clear();
+    mBCCellOffsets.clear();
+    mBCIndices.clear();
+    mBCCellOffsets.push_back(0);
+    for (auto bc : bcs) {
+      auto collisionsInFoundBC = collisions.sliceBy(collisionsPerFoundBC, bc.globalIndex());
+      auto cellsInBC = cells.sliceBy(cellsPerFoundBC, bc.globalIndex());
+      if (!cellsInBC.size()) {
+        countBC(collisionsInFoundBC.size(), false);
+        continue;
+      }
+      countBC(collisionsInFoundBC.size(), true);
+      for (auto& cell : cellsInBC) {
+        auto amplitude = cell.amplitude();
+        if (static_cast<bool>(hasShaperCorrection)) {
+          amplitude = o2::emcal::NonlinearityHandler::evaluateShaperCorrectionCellEnergy(amplitude);
+        }
+        mCellArena.emplace_back(cell.cellNumber(),
+                                amplitude,
+                                cell.time(),
+                                o2::emcal::intToChannelType(cell.cellType()));
+        mCellIndexArena.emplace_back(cell.globalIndex());
+      }
+      fillQAHistogram(gsl::span<o2::emcal::Cell>(mCellArena.data() + mBCCellOffsets.back(), mCellArena.size() - mBCCellOffsets.back()));
+      mBCCellOffsets.push_back(mCellArena.size());
+      mBCIndices.push_back(bc.globalIndex());
+    }
+    const size_t nBCs = mBCIndices.size();
+    LOG(detail) << "Collected " << mCellArena.size() << " cells in " << nBCs << " BCs";
+
+    // Second pass: run all (BC, clusterizer) combinations on the worker threads
+    runClusterizersParallel(nBCs);
+
+    // Third pass: match tracks and fill the tables in BC order, so that the output is identical to the serial processing
+    const size_t nClusterizers = mClusterizers.size();
+    for (size_t iBC = 0; iBC < nBCs; iBC++) {
+      auto bc = bcs.iteratorAt(mBCIndices[iBC]);
+      auto collisionsInFoundBC = collisions.sliceBy(collisionsPerFoundBC, bc.globalIndex());
+      gsl::span<int64_t> cellIndicesBC(mCellIndexArena.data() + mBCCellOffsets[iBC], mBCCellOffsets[iBC + 1] - mBCCellOffsets[iBC]);
+      if (collisionsInFoundBC.size() == 1) {
+        for (const auto& col : collisionsInFoundBC) {
+          prepareTrackMatching(col, tracks);
+        }
+      }
+      for (size_t iClusterizer = 0; iClusterizer < nClusterizers; iClusterizer++) {
+        std::swap(mAnalysisClusters, mBCAnalysisClusters[iBC * nClusterizers + iClusterizer]);
+        fillClustersFull(bc, collisionsInFoundBC, iClusterizer, cellIndicesBC);
+      }
+    }
+    LOG(detail) << "Processed " << nBCs << " BCs with " << mCellArena.size() << " cells";
+  }
+  PROCESS_SWITCH(EmcalCorrectionTask, processFullParallel, "run full analysis with the clusterizers running in parallel (see nClusterizerThreads)", false);
+
+  void runClusterizersParallel(size_t nBCs)
+  {
+    const size_t nClusterizers = mClusterizers.size();
+    const size_t nJobs = nBCs * nClusterizers;
+    mBCAnalysisClusters.resize(std::max(nJobs, mBCAnalysisClusters.size()));
+    std::atomic<size_t> nextJob{0};
+    mWorkerPool.run([&](size_t iThread) {
+      auto& worker = *mClusterizerWorkers[iThread];
+      for (size_t iJob = nextJob++; iJob < nJobs; iJob = nextJob++) {
+        const size_t iBC = iJob / nClusterizers;
+        const size_t iClusterizer = iJob % nClusterizers;
+        gsl::span<o2::emcal::Cell> cellsBC(mCellArena.data() + mBCCellOffsets[iBC], mBCCellOffsets[iBC + 1] - mBCCellOffsets[iBC]);
+        cellsToCluster(*worker.clusterizers[iClusterizer], worker.clusterFactory, cellsBC, mBCAnalysisClusters[iJob]);
+      }
+    });
+  }
+
+  template <typename BC, typename Collisions>
+  void fillClustersFull(BC const& bc, Collisions const& collisionsInFoundBC, size_t iClusterizer, const gsl::span<int64_t> cellIndicesBC)
+  {
+    if (collisionsInFoundBC.size() == 1) {
+      // dummy loop to get the first collision
+      for (const auto& col : collisionsInFoundBC) {
+        mHistManager.fill(HIST("hCollPerBC"), 1);
+        mHistManager.fill(HIST("hCollisionType"), 1);
+        math_utils::Point3D<float> vertex_pos = {col.posX(), col.posY(), col.posZ()};
+
+        doTrackMatching(vertex_pos);
+
+        // Store the clusters in the table where a matching collision could
+        // be identified.
+        FillClusterTable<collEventSels::iterator>(col, vertex_pos, iClusterizer, cellIndicesBC, mClusterToTrackIndexMap, mTrackGlobalIndex);
+      }
+    } else { // ambiguous
+      // LOG(warning) << "No vertex found for event. Assuming (0,0,0).";
+      bool hasCollision = false;
+      mHistManager.fill(HIST("hCollPerBC"), collisionsInFoundBC.size());
+      if (collisionsInFoundBC.size() == 0) {
+        mHistManager.fill(HIST("hCollisionType"), 0);
+      } else {
+        hasCollision = true;
+        mHistManager.fill(HIST("hCollisionType"), 2);
+      }
+      FillAmbigousClusterTable<bcEvSels::iterator>(bc, iClusterizer, cellIndicesBC, hasCollision);
+    }
+  }
+
   void processStandalone(aod::BCs const& bcs, aod::Collisions const& collisions, filteredCells const& cells)
   {
     LOG(debug) << "Starting process standalone.";
@@ -343,7 +482,7 @@ struct EmcalCorrectionTask {
       //  Run the clusterizers
       LOG(debug) << "Running clusterizers";
       for (size_t iClusterizer = 0; iClusterizer < mClusterizers.size(); iClusterizer++) {
-        cellsToCluster(iClusterizer, cellsBC);
+        cellsToCluster(*mClusterizers.at(iClusterizer), mClusterFactories, cellsBC, mAnalysisClusters);
 
         if (collisionsInBC.size() == 1) {
           // dummy loop to get the first collision
@@ -378,29 +517,29 @@ struct EmcalCorrectionTask {
   }
   PROCESS_SWITCH(EmcalCorrectionTask, processStandalone, "run stand alone analysis", false);
 
-  void cellsToCluster(size_t iClusterizer, const gsl::span<o2::emcal::Cell> cellsBC)
+  void cellsToCluster(o2::emcal::Clusterizer<o2::emcal::Cell>& clusterizer, o2::emcal::ClusterFactory<o2::emcal::Cell>& clusterFactory, const gsl::span<o2::emcal::Cell> cellsBC, std::vector<o2::emcal::AnalysisCluster>& analysisClusters)
   {
-    mClusterizers.at(iClusterizer)->findClusters(cellsBC);
+    clusterizer.findClusters(cellsBC);
 
-    auto emcalClusters = mClusterizers.at(iClusterizer)->getFoundClusters();
-    auto emcalClustersInputIndices = mClusterizers.at(iClusterizer)->getFoundClustersInputIndices();
+    auto emcalClusters = clusterizer.getFoundClusters();
+    auto emcalClustersInputIndices = clusterizer.getFoundClustersInputIndices();
     LOG(debug) << "Retrieved results. About to setup cluster factory.";
 
     // Convert to analysis clusters.
     // First, the cluster factory requires cluster and cell information in order
     // to build the clusters.
-    mAnalysisClusters.clear();
-    mClusterFactories.reset();
-    mClusterFactories.setClustersContainer(*emcalClusters);
-    mClusterFactories.setCellsContainer(cellsBC);
-    mClusterFactories.setCellsIndicesContainer(*emcalClustersInputIndices);
+    analysisClusters.clear();
+    clusterFactory.reset();
+    clusterFactory.setClustersContainer(*emcalClusters);
+    clusterFactory.setCellsContainer(cellsBC);
+    clusterFactory.setCellsIndicesContainer(*emcalClustersInputIndices);
 
     LOG(debug) << "Cluster factory set up.";
     // Convert to analysis clusters.
-    for (int icl = 0; icl < mClusterFactories.getNumberOfClusters();
+    for (int icl = 0; icl < clusterFactory.getNumberOfClusters();
          icl++) {
-      auto analysisCluster = mClusterFactories.buildCluster(icl);
-      mAnalysisClusters.emplace_back(analysisCluster);
+      auto analysisCluster = clusterFactory.buildCluster(icl);
+      analysisClusters.emplace_back(analysisCluster);
       LOG(debug) << "Cluster " << icl << ": E: " << analysisCluster.E()
                  << ", NCells " << analysisCluster.getNCells();
     }
@@ -408,7 +547,7 @@ struct EmcalCorrectionTask {
   }
 
   template <typename Collision>
-  void FillClusterTable(Collision const& col, math_utils::Point3D<float> const& vertex_pos, size_t iClusterizer, const gsl::span<int64_t> cellIndicesBC, std::optional<std::tuple<std::vector<std::vector<int>>, std::vector<std::vector<int>>>> const& IndexMapPair = std::nullopt, std::optional<std::vector<int64_t>> const& trackGlobalIndex = std::nullopt)
+  void FillClusterTable(Collision const& col, math_utils::Point3D<float> const& vertex_pos, size_t iClusterizer, const gsl::span<int64_t> cellIndicesBC, const gsl::span<const int> clusterToTrackIndexMap = {}, const gsl::span<const int64_t> trackGlobalIndex = {})
   {
     // we found a collision, put the clusters into the none ambiguous table
     clusters.reserve(mAnalysisClusters.size());
@@ -453,13 +592,14 @@ struct EmcalCorrectionTask {
       // fill histograms
       mHistManager.fill(HIST("hClusterE"), cluster.E());
       mHistManager.fill(HIST("hClusterEtaPhi"), pos.Eta(), TVector2::Phi_0_2pi(pos.Phi()));
-      if (IndexMapPair && trackGlobalIndex) {
-        for (unsigned int iTrack = 0;
-             iTrack < std::get<0>(*IndexMapPair)[iCluster].size(); iTrack++) {
-          if (std::get<0>(*IndexMapPair)[iCluster][iTrack] >= 0) {
-            LOG(debug) << "Found track " << (*trackGlobalIndex)[std::get<0>(*IndexMapPair)[iCluster][iTrack]] << " in cluster " << cluster.getID();
-            matchedTracks(clusters.lastIndex(), (*trackGlobalIndex)[std::get<0>(*IndexMapPair)[iCluster][iTrack]]);
+      if (!clusterToTrackIndexMap.empty()) {
+        for (int iTrack = 0; iTrack < kMaxNumberMatches; iTrack++) {
+          auto trackIndex = clusterToTrackIndexMap[iCluster * kMaxNumberMatches + iTrack];
+          if (trackIndex < 0) {
+            break; // matches are ordered by distance, so there are no further matches
           }
+          LOG(debug) << "Found track " << trackGlobalIndex[trackIndex] << " in cluster " << cluster.getID();
+          matchedTracks(clusters.lastIndex(), trackGlobalIndex[trackIndex]);
         }
       }
       iCluster++;
@@ -509,26 +649,20 @@ struct EmcalCorrectionTask {
   }
 
   template <typename Collision>
-  void doTrackMatching(Collision const& col, myGlobTracks const& tracks, std::tuple<std::vector<std::vector<int>>, std::vector<std::vector<int>>>& IndexMapPair, math_utils::Point3D<float>& vertex_pos, std::vector<int64_t>& trackGlobalIndex)
+  void prepareTrackMatching(Collision const& col, myGlobTracks const& tracks)
   {
     auto groupedTracks = tracks.sliceBy(perCollision, col.globalIndex());
-    int NTracksInCol = groupedTracks.size();
-    std::vector<double> trackPhi;
-    std::vector<double> trackEta;
-    // reserve memory to reduce on the fly memory allocation
-    trackPhi.reserve(NTracksInCol);
-    trackEta.reserve(NTracksInCol);
-    trackGlobalIndex.reserve(NTracksInCol);
-    FillTrackInfo<decltype(groupedTracks)>(groupedTracks, trackPhi, trackEta, trackGlobalIndex);
-
-    int NClusterInCol = mAnalysisClusters.size();
-    std::vector<double> clusterPhi;
-    std::vector<double> clusterEta;
-    clusterPhi.reserve(NClusterInCol);
-    clusterEta.reserve(NClusterInCol);
-
-    // TODO one loop that could in principle be combined with the other
-    // loop to improve performance
+    mTrackPhi.clear();
+    mTrackEta.clear();
+    mTrackGlobalIndex.clear();
+    FillTrackInfo<decltype(groupedTracks)>(groupedTracks, mTrackPhi, mTrackEta, mTrackGlobalIndex);
+    mTrackGrid.build(mTrackEta, mTrackPhi, maxMatchingDistance);
+  }
+
+  void doTrackMatching(math_utils::Point3D<float> const& vertex_pos)
+  {
+    mClusterPhi.clear();
+    mClusterEta.clear();
     for (const auto& cluster : mAnalysisClusters) {
       // Determine the cluster eta, phi, correcting for the vertex
       // position.
@@ -536,13 +670,11 @@ struct EmcalCorrectionTask {
       pos = pos - vertex_pos;
       // Normalize the vector and rescale by energy.
       pos *= (cluster.E() / std::sqrt(pos.Mag2()));
-      clusterPhi.emplace_back(TVector2::Phi_0_2pi(pos.Phi()));
-      clusterEta.emplace_back(pos.Eta());
+      mClusterPhi.emplace_back(TVector2::Phi_0_2pi(pos.Phi()));
+      mClusterEta.emplace_back(pos.Eta());
     }
-    IndexMapPair =
-      JetUtilities::MatchClustersAndTracks(clusterPhi, clusterEta,
-                                           trackPhi, trackEta,
-                                           maxMatchingDistance, 20);
+    // Only the cluster to track direction is stored, so the inverse matching is not needed
+    mTrackGrid.findNearestNeighbors(mClusterEta, mClusterPhi, kMaxNumberMatches, maxMatchingDistance, mClusterToTrackIndexMap);
   }
 
   template <typename Tracks>
@@ -13,6 +13,9 @@
 //
 // Author: Jochen Klein, Nima Zardoshti, Raymond Ehlers
 
+#include <algorithm>
+#include <vector>
+
 #include "Framework/AnalysisTask.h"
 #include "Framework/AnalysisDataModel.h"
 #include "Framework/ASoA.h"
@@ -35,11 +38,14 @@ using namespace o2::framework::expressions;
 
 #include "Framework/runDataProcessing.h"
 
-template <typename JetTable, typename ConstituentTable, typename ConstituentSubTable>
+template <typename JetTable, typename ConstituentTable, typename ConstituentSubTable, typename TrackConstituentTable, typename ClusterConstituentTable, typename ConstituentSliceTable>
 struct JetFinderTask {
   Produces<JetTable> jetsTable;
   Produces<ConstituentTable> constituentsTable;
   Produces<ConstituentSubTable> constituentsSubTable;
+  Produces<TrackConstituentTable> trackConstituentsTable;
+  Produces<ClusterConstituentTable> clusterConstituentsTable;
+  Produces<ConstituentSliceTable> constituentSlicesTable;
   OutputObj<TH2F> h2JetPt{"h2_jet_pt"};
   OutputObj<TH2F> h2JetPhi{"h2_jet_phi"};
   OutputObj<TH2F> h2JetEta{"h2_jet_eta"};
@@ -56,6 +62,29 @@ struct JetFinderTask {
   std::vector<fastjet::PseudoJet> inputParticles;
   JetFinder jetFinder;
 
+  // constituent index buffers, reused for every jet to avoid per-jet allocations
+  std::vector<int> trackconst;
+  std::vector<int> clusterconst;
+  std::vector<int> candconst; // always empty for inclusive jets
+
+  // jet QA quantities, buffered per event and filled into the histograms in one go
+  struct JetQABuffer {
+    std::vector<double> pt;
+    std::vector<double> phi;
+    std::vector<double> rap;
+    std::vector<double> nConstituents;
+    std::vector<double> r;
+
+    void clear()
+    {
+      pt.clear();
+      phi.clear();
+      rap.clear();
+      nConstituents.clear();
+      r.clear();
+    }
+  } jetQABuffer;
+
   // event level configurables
   Configurable<float> vertexZCut{"vertexZCut", 10.0f, "Accepted z-vertex range"};
 
@@ -91,6 +120,8 @@ struct JetFinderTask {
   Configurable<bool> DoTriggering{"DoTriggering", false, "used for the charged jet trigger to remove the eta constraint on the jet axis"};
   Configurable<bool> DoRhoAreaSub{"DoRhoAreaSub", false, "do rho area subtraction"};
   Configurable<bool> DoConstSub{"DoConstSub", false, "do constituent subtraction"};
+  Configurable<bool> fillConstituentArrays{"fillConstituentArrays", true, "fill the constituents table with per-jet index arrays"};
+  Configurable<bool> fillConstituentSlices{"fillConstituentSlices", false, "fill the flat constituent tables, referenced from the jets via slice indices"};
 
   void init(InitContext const&)
   {
@@ -180,6 +211,24 @@ struct JetFinderTask {
     }
   }
 
+  // function that fills the buffered jet QA histograms
+  void fillJetQAHistograms()
+  {
+    auto nJets = static_cast<int>(jetQABuffer.pt.size());
+    if (nJets == 0) {
+      return;
+    }
+    h2JetPt->FillN(nJets, jetQABuffer.pt.data(), jetQABuffer.r.data(), nullptr);
+    h2JetPhi->FillN(nJets, jetQABuffer.phi.data(), jetQABuffer.r.data(), nullptr);
+    h2JetEta->FillN(nJets, jetQABuffer.rap.data(), jetQABuffer.r.data(), nullptr);
+    h2JetNTracks->FillN(nJets, jetQABuffer.nConstituents.data(), jetQABuffer.r.data(), nullptr);
+    hJetPt->FillN(nJets, jetQABuffer.pt.data(), nullptr);
+    hJetPhi->FillN(nJets, jetQABuffer.phi.data(), nullptr);
+    hJetEta->FillN(nJets, jetQABuffer.rap.data(), nullptr);
+    hJetNTracks->FillN(nJets, jetQABuffer.nConstituents.data(), nullptr);
+    jetQABuffer.clear();
+  }
+
   // function that calls the jet finding and fills the relevant tables
   template <typename T>
   void jetFinding(T const& collision)
@@ -190,35 +239,57 @@ struct JetFinderTask {
       jets.clear();
       fastjet::ClusterSequenceArea clusterSeq(jetFinder.findJets(inputParticles, jets));
       for (const auto& jet : jets) {
-        std::vector<int> trackconst;
-        std::vector<int> clusterconst;
+        trackconst.clear();
+        clusterconst.clear();
         jetsTable(collision, jet.pt(), jet.eta(), jet.phi(),
                   jet.E(), jet.m(), jet.area(), std::round(R * 100));
-        for (const auto& constituent : sorted_by_pt(jet.constituents())) {
+        // jet.constituents() returns a copy, so it is sorted in place instead of copying it again with sorted_by_pt
+        auto constituents = jet.constituents();
+        std::sort(constituents.begin(), constituents.end(), [](const fastjet::PseudoJet& a, const fastjet::PseudoJet& b) { return a.perp2() > b.perp2(); });
+        for (const auto& constituent : constituents) {
           // need to add seperate thing for constituent subtraction
           if (DoConstSub) { // FIXME: needs to be addressed in Haadi's PR
             constituentsSubTable(jetsTable.lastIndex(), constituent.pt(), constituent.eta(), constituent.phi(),
                                  constituent.E(), constituent.m(), constituent.user_index());
           }
 
-          if (constituent.template user_info<FastJetUtilities::fastjet_user_info>().getStatus() == static_cast<int>(JetConstituentStatus::track)) {
-            trackconst.push_back(constituent.template user_info<FastJetUtilities::fastjet_user_info>().getIndex());
+          const auto& userInfo = constituent.template user_info<FastJetUtilities::fastjet_user_info>();
+          if (userInfo.getStatus() == static_cast<int>(JetConstituentStatus::track)) {
+            trackconst.push_back(userInfo.getIndex());
+          } else if (userInfo.getStatus() == static_cast<int>(JetConstituentStatus::cluster)) {
+            clusterconst.push_back(userInfo.getIndex());
+          }
+        }
+        if (fillConstituentArrays) {
+          constituentsTable(jetsTable.lastIndex(), trackconst, clusterconst, candconst);
+        }
+        if (fillConstituentSlices) {
+          int trackSlice[2] = {-1, -1};
+          int clusterSlice[2] = {-1, -1};
+          if (!trackconst.empty()) {
+            trackSlice[0] = trackConstituentsTable.lastIndex() + 1;
+            for (auto index : trackconst) {
+              trackConstituentsTable(jetsTable.lastIndex(), index);
+            }
+            trackSlice[1] = trackConstituentsTable.lastIndex();
           }
-          if (constituent.template user_info<FastJetUtilities::fastjet_user_info>().getStatus() == static_cast<int>(JetConstituentStatus::cluster)) {
-            clusterconst.push_back(constituent.template user_info<FastJetUtilities::fastjet_user_info>().getIndex());
+          if (!clusterconst.empty()) {
+            clusterSlice[0] = clusterConstituentsTable.lastIndex() + 1;
+            for (auto index : clusterconst) {
+              clusterConstituentsTable(jetsTable.lastIndex(), index);
+            }
+            clusterSlice[1] = clusterConstituentsTable.lastIndex();
           }
+          constituentSlicesTable(jetsTable.lastIndex(), trackSlice, clusterSlice);
         }
-        constituentsTable(jetsTable.lastIndex(), trackconst, clusterconst, std::vector<int>());
-        h2JetPt->Fill(jet.pt(), R);
-        h2JetPhi->Fill(jet.phi(), R);
-        h2JetEta->Fill(jet.rap(), R);
-        h2JetNTracks->Fill(jet.constituents().size(), R);
-        hJetPt->Fill(jet.pt());
-        hJetPhi->Fill(jet.phi());
-        hJetEta->Fill(jet.rap());
-        hJetNTracks->Fill(jet.constituents().size());
+        jetQABuffer.pt.push_back(jet.pt());
+        jetQABuffer.phi.push_back(jet.phi());
+        jetQABuffer.rap.push_back(jet.rap());
+        jetQABuffer.nConstituents.push_back(constituents.size());
+        jetQABuffer.r.push_back(R);
       }
     }
+    fillJetQAHistograms();
   }
 
   void processDummy(aod::Collisions const& collision)
@@ -294,16 +365,16 @@ struct JetFinderTask {
   PROCESS_SWITCH(JetFinderTask, processParticleLevel, "Particle level jet finding", false);
 };
 
-using JetFinderData = JetFinderTask<o2::aod::Jets, o2::aod::JetConstituents, o2::aod::JetConstituentsSub>;
-using JetFinderDataFull = JetFinderTask<o2::aod::FullJets, o2::aod::FullJetConstituents, o2::aod::FullJetConstituentsSub>;
-using JetFinderDataNeutral = JetFinderTask<o2::aod::NeutralJets, o2::aod::NeutralJetConstituents, o2::aod::NeutralJetConstituentsSub>;
-using JetFinderMCDetectorLevel = JetFinderTask<o2::aod::MCDetectorLevelJets, o2::aod::MCDetectorLevelJetConstituents, o2::aod::MCDetectorLevelJetConstituentsSub>;
-using JetFinderMCDetectorLevelFull = JetFinderTask<o2::aod::MCDetectorLevelFullJets, o2::aod::MCDetectorLevelFullJetConstituents, o2::aod::MCDetectorLevelFullJetConstituentsSub>;
-using JetFinderMCDetectorLevelNeutral = JetFinderTask<o2::aod::MCDetectorLevelNeutralJets, o2::aod::MCDetectorLevelNeutralJetConstituents, o2::aod::MCDetectorLevelNeutralJetConstituentsSub>;
-using JetFinderMCParticleLevel = JetFinderTask<o2::aod::MCParticleLevelJets, o2::aod::MCParticleLevelJetConstituents, o2::aod::MCParticleLevelJetConstituentsSub>;
-using JetFinderMCParticleLevelFull = JetFinderTask<o2::aod::MCParticleLevelFullJets, o2::aod::MCParticleLevelFullJetConstituents, o2::aod::MCParticleLevelFullJetConstituentsSub>;
-using JetFinderMCParticleLevelNeutral = JetFinderTask<o2::aod::MCParticleLevelNeutralJets, o2::aod::MCParticleLevelNeutralJetConstituents, o2::aod::MCParticleLevelNeutralJetConstituentsSub>;
-using JetFinderHybridIntermediate = JetFinderTask<o2::aod::HybridIntermediateJets, o2::aod::HybridIntermediateJetConstituents, o2::aod::HybridIntermediateJetConstituentsSub>;
+using JetFinderData = JetFinderTask<o2::aod::Jets, o2::aod::JetConstituents, o2::aod::JetConstituentsSub, o2::aod::JetTrackConstituents, o2::aod::JetClusterConstituents, o2::aod::JetConstituentSlices>;
+using JetFinderDataFull = JetFinderTask<o2::aod::FullJets, o2::aod::FullJetConstituents, o2::aod::FullJetConstituentsSub, o2::aod::FullJetTrackConstituents, o2::aod::FullJetClusterConstituents, o2::aod::FullJetConstituentSlices>;
+using JetFinderDataNeutral = JetFinderTask<o2::aod::NeutralJets, o2::aod::NeutralJetConstituents, o2::aod::NeutralJetConstituentsSub, o2::aod::NeutralJetTrackConstituents, o2::aod::NeutralJetClusterConstituents, o2::aod::NeutralJetConstituentSlices>;
+using JetFinderMCDetectorLevel = JetFinderTask<o2::aod::MCDetectorLevelJets, o2::aod::MCDetectorLevelJetConstituents, o2::aod::MCDetectorLevelJetConstituentsSub, o2::aod::MCDetectorLevelJetTrackConstituents, o2::aod::MCDetectorLevelJetClusterConstituents, o2::aod::MCDetectorLevelJetConstituentSlices>;
+using JetFinderMCDetectorLevelFull = JetFinderTask<o2::aod::MCDetectorLevelFullJets, o2::aod::MCDetectorLevelFullJetConstituents, o2::aod::MCDetectorLevelFullJetConstituentsSub, o2::aod::MCDetectorLevelFullJetTrackConstituents, o2::aod::MCDetectorLevelFullJetClusterConstituents, o2::aod::MCDetectorLevelFullJetConstituentSlices>;
+using JetFinderMCDetectorLevelNeutral = JetFinderTask<o2::aod::MCDetectorLevelNeutralJets, o2::aod::MCDetectorLevelNeutralJetConstituents, o2::aod::MCDetectorLevelNeutralJetConstituentsSub, o2::aod::MCDetectorLevelNeutralJetTrackConstituents, o2::aod::MCDetectorLevelNeutralJetClusterConstituents, o2::aod::MCDetectorLevelNeutralJetConstituentSlices>;
+using JetFinderMCParticleLevel = JetFinderTask<o2::aod::MCParticleLevelJets, o2::aod::MCParticleLevelJetConstituents, o2::aod::MCParticleLevelJetConstituentsSub, o2::aod::MCParticleLevelJetTrackConstituents, o2::aod::MCParticleLevelJetClusterConstituents, o2::aod::MCParticleLevelJetConstituentSlices>;
+using JetFinderMCParticleLevelFull = JetFinderTask<o2::aod::MCParticleLevelFullJets, o2::aod::MCParticleLevelFullJetConstituents, o2::aod::MCParticleLevelFullJetConstituentsSub, o2::aod::MCParticleLevelFullJetTrackConstituents, o2::aod::MCParticleLevelFullJetClusterConstituents, o2::aod::MCParticleLevelFullJetConstituentSlices>;
+using JetFinderMCParticleLevelNeutral = JetFinderTask<o2::aod::MCParticleLevelNeutralJets, o2::aod::MCParticleLevelNeutralJetConstituents, o2::aod::MCParticleLevelNeutralJetConstituentsSub, o2::aod::MCParticleLevelNeutralJetTrackConstituents, o2::aod::MCParticleLevelNeutralJetClusterConstituents, o2::aod::MCParticleLevelNeutralJetConstituentSlices>;
+using JetFinderHybridIntermediate = JetFinderTask<o2::aod::HybridIntermediateJets, o2::aod::HybridIntermediateJetConstituents, o2::aod::HybridIntermediateJetConstituentsSub, o2::aod::HybridIntermediateJetTrackConstituents, o2::aod::HybridIntermediateJetClusterConstituents, o2::aod::HybridIntermediateJetConstituentSlices>;
 
 WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
 {
@@ -0,0 +1,80 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file BCCollisionGrouping.h
+/// \brief Grouping of the collisions by the BC they are assigned to, for event statistics per BC
+///
+/// A collision belongs to its found BC if it has one, otherwise to its BC. The grouping is built with a
+/// counting sort over the BC index and stored as CSR offsets, so that the collisions of a BC are found in
+/// constant time instead of scanning the collision table for every BC. Within a BC the collisions keep
+/// the order of the collision table.
+
+#ifndef PWGMM_MULT_CORE_BCCOLLISIONGROUPING_H_
+#define PWGMM_MULT_CORE_BCCOLLISIONGROUPING_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <gsl/span>
+
+namespace o2::pwgmm::mult
+{
+class BCCollisionGrouping
+{
+ public:
+  /// \param nBCs Size of the BC table the collisions point to
+  /// \param collisions Collision table with the foundBC and bc indices
+  template <typename C>
+  void build(int64_t nBCs, C const& collisions)
+  {
+    mOffsets.assign(nBCs + 1, 0);
+    for (auto const& collision : collisions) {
+      const auto bcId = assignedBC(collision);
+      if (bcId >= 0 && bcId < nBCs) {
+        mOffsets[bcId + 1]++;
+      }
+    }
+    for (int64_t i = 0; i < nBCs; i++) {
+      mOffsets[i + 1] += mOffsets[i];
+    }
+    mCollisionIds.resize(mOffsets[nBCs]);
+    mCursor.assign(mOffsets.begin(), mOffsets.end() - 1);
+    for (auto const& collision : collisions) {
+      const auto bcId = assignedBC(collision);
+      if (bcId >= 0 && bcId < nBCs) {
+        mCollisionIds[mCursor[bcId]++] = collision.globalIndex();
+      }
+    }
+  }
+
+  /// \return indices of the collisions assigned to the BC
+  gsl::span<const int64_t> collisionIds(int64_t bcId) const
+  {
+    if (bcId < 0 || bcId + 1 >= static_cast<int64_t>(mOffsets.size())) {
+      return {};
+    }
+    return {mCollisionIds.data() + mOffsets[bcId], static_cast<size_t>(mOffsets[bcId + 1] - mOffsets[bcId])};
+  }
+
+ private:
+  template <typename Col>
+  static int64_t assignedBC(Col const& collision)
+  {
+    return collision.has_foundBC() ? collision.foundBCId() : collision.bcId();
+  }
+
+  std::vector<int64_t> mOffsets;      // collisions of BC i are at [mOffsets[i], mOffsets[i + 1])
+  std::vector<int64_t> mCollisionIds; // collision indices sorted by BC
+  std::vector<int64_t> mCursor;       // fill position per BC while building
+};
+} // namespace o2::pwgmm::mult
+
+#endif // PWGMM_MULT_CORE_BCCOLLISIONGROUPING_H_
@@ -49,6 +49,7 @@
 #include "PWGHF/DataModel/CandidateReconstructionTables.h"
 #include "PWGHF/DataModel/CandidateSelectionTables.h"
 #include "PWGLF/DataModel/LFStrangenessTables.h"
+#include "PWGMM/Mult/Core/BCCollisionGrouping.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -159,6 +160,8 @@ struct MultiplicityCounter {
   Configurable<float> etadau{"etadau", 4, "Eta Daughters"};
   Configurable<float> rapidity{"v0rapidity", 0.5, "V0 rapidity"};
 
+  o2::pwgmm::mult::BCCollisionGrouping bcCollisions; // collisions of each BC for the event statistics
+
   HistogramRegistry registry{
     "registry",
     {{"Events/Selection", ";status;events", {HistType::kTH1F, {{7, 0.5, 7.5}}}}}};
@@ -219,19 +222,14 @@ struct MultiplicityCounter {
     soa::Join<aod::Collisions, aod::EvSels> const& collisions)
   {
     std::vector<typename std::decay_t<decltype(collisions)>::iterator> cols;
+    bcCollisions.build(bcs.size(), collisions);
     for (auto& bc : bcs) {
       if (!useEvSel || (bc.selection()[kIsBBT0A] &
                         bc.selection()[kIsBBT0C]) != 0) {
         registry.fill(HIST("Events/Selection"), 5.);
         cols.clear();
-        for (auto& collision : collisions) {
-          if (collision.has_foundBC()) {
-            if (collision.foundBCId() == bc.globalIndex()) {
-              cols.emplace_back(collision);
-            }
-          } else if (collision.bcId() == bc.globalIndex()) {
-            cols.emplace_back(collision);
-          }
+        for (auto const& collisionId : bcCollisions.collisionIds(bc.globalIndex())) {
+          cols.emplace_back(collisions.iteratorAt(collisionId));
         }
         LOGP(debug, "BC {} has {} collisions", bc.globalBC(), cols.size());
         if (!cols.empty()) {
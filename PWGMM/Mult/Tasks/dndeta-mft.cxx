@@ -32,6 +32,7 @@
 #include "MathUtils/Utils.h"
 
 #include "bestCollisionTable.h"
+#include "PWGMM/Mult/Core/BCCollisionGrouping.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -82,6 +83,8 @@ struct PseudorapidityDensityMFT {
   int counter = 0;
   //------
 
+  o2::pwgmm::mult::BCCollisionGrouping bcCollisions; // collisions of each BC for the event statistics
+
   HistogramRegistry registry{
     "registry",
     {
@@ -193,18 +196,13 @@ struct PseudorapidityDensityMFT {
   {
 
     std::vector<typename std::decay_t<decltype(collisions)>::iterator> cols;
+    bcCollisions.build(bcs.size(), collisions);
     for (auto& bc : bcs) {
       if (!useEvSel || (useEvSel && ((bc.selection()[evsel::kIsBBT0A] & bc.selection()[evsel::kIsBBT0C]) != 0))) {
         registry.fill(HIST("EventSelection"), 5.);
         cols.clear();
-        for (auto& collision : collisions) {
-          if (collision.has_foundBC()) {
-            if (collision.foundBCId() == bc.globalIndex()) {
-              cols.emplace_back(collision);
-            }
-          } else if (collision.bcId() == bc.globalIndex()) {
-            cols.emplace_back(collision);
-          }
+        for (auto const& collisionId : bcCollisions.collisionIds(bc.globalIndex())) {
+          cols.emplace_back(collisions.iteratorAt(collisionId));
         }
         LOGP(debug, "BC {} has {} collisions", bc.globalBC(), cols.size());
         if (!cols.empty()) {
@@ -24,6 +24,7 @@
 #include "TDatabasePDG.h"
 
 #include "bestCollisionTable.h"
+#include "PWGMM/Mult/Core/BCCollisionGrouping.h"
 
 using namespace o2;
 using namespace o2::framework;
@@ -66,6 +67,8 @@ struct MultiplicityCounter {
   ConfigurableAxis multBinning{"multBinning", {301, -0.5, 300.5}, ""};
   ConfigurableAxis centBinning{"centBinning", {VARIABLE_WIDTH, 0, 10, 20, 30, 40, 50, 60, 70, 80, 100}, ""};
 
+  o2::pwgmm::mult::BCCollisionGrouping bcCollisions; // collisions of each BC for the event statistics
+
   HistogramRegistry registry{
     "registry",
     {
@@ -229,19 +232,14 @@ struct MultiplicityCounter {
   {
     constexpr bool hasCentrality = C::template contains<aod::CentFT0Cs>() || C::template contains<aod::CentFT0Ms>();
     std::vector<typename std::decay_t<decltype(collisions)>::iterator> cols;
+    bcCollisions.build(bcs.size(), collisions);
     for (auto& bc : bcs) {
       if (!useEvSel || (bc.selection()[evsel::kIsBBT0A] &
                         bc.selection()[evsel::kIsBBT0C]) != 0) {
         registry.fill(HIST("Events/BCSelection"), 1.);
         cols.clear();
-        for (auto& collision : collisions) {
-          if (collision.has_foundBC()) {
-            if (collision.foundBCId() == bc.globalIndex()) {
-              cols.emplace_back(collision);
-            }
-          } else if (collision.bcId() == bc.globalIndex()) {
-            cols.emplace_back(collision);
-          }
+        for (auto const& collisionId : bcCollisions.collisionIds(bc.globalIndex())) {
+          cols.emplace_back(collisions.iteratorAt(collisionId));
         }
         LOGP(debug, "BC {} has {} collisions", bc.globalBC(), cols.size());
         if (!cols.empty()) {
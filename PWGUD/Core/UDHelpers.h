@@ -18,6 +18,8 @@
 
 #include <vector>
 #include <bitset>
+#include <algorithm>
+#include <utility>
 #include "Framework/Logger.h"
 #include "DataFormatsFT0/Digit.h"
 #include "CommonConstants/LHCConstants.h"
@@ -215,6 +217,104 @@ T compatibleBCs(uint64_t meanBC, int deltaBC, T const& bcs)
   return compatibleBCs(bcIter, meanBC, deltaBC, bcs);
 }
 
+// -----------------------------------------------------------------------------
+// Index of the global BCs of a BCs table, to look up the slice of BCs within
+// [minBC, maxBC] by binary search instead of walking the table BC by BC.
+// The index must be rebuilt with update(bcs) at the beginning of each process
+// call using it, hence it is meant for process functions which run once per
+// time frame and loop over the collisions or candidates themselves. Lookups with non-decreasing minBC, e.g. for collisions sorted
+// in time, continue from the position of the previous lookup.
+class BCIndex
+{
+ public:
+  // build the index for the BCs table bcs
+  template <typename T>
+  void update(T const& bcs)
+  {
+    mGlobalBCs.clear();
+    mGlobalBCs.reserve(bcs.size());
+    for (auto const& bc : bcs) {
+      mGlobalBCs.push_back(bc.globalBC());
+    }
+    mCursor = 0;
+  }
+
+  // index range [first, last) of the BCs with globalBC in [minBC, maxBC]
+  std::pair<int64_t, int64_t> range(uint64_t minBC, uint64_t maxBC)
+  {
+    const size_t nBCs = mGlobalBCs.size();
+    auto begin = mGlobalBCs.begin();
+    size_t first = 0;
+    if (mCursor <= nBCs && (mCursor == 0 || mGlobalBCs[mCursor - 1] < minBC)) {
+      // all BCs before the cursor are below minBC: galloping search forward from the cursor
+      size_t lo = mCursor;
+      size_t step = 1;
+      while (lo + step < nBCs && mGlobalBCs[lo + step - 1] < minBC) {
+        lo += step;
+        step *= 2;
+      }
+      first = std::lower_bound(begin + lo, begin + std::min(lo + step, nBCs), minBC) - begin;
+    } else {
+      first = std::lower_bound(begin, mGlobalBCs.end(), minBC) - begin;
+    }
+    mCursor = first;
+    size_t last = std::upper_bound(begin + first, mGlobalBCs.end(), maxBC) - begin;
+    return {static_cast<int64_t>(first), static_cast<int64_t>(last)};
+  }
+
+  // slice of bcs with globalBC in [minBC, maxBC], bcs must be the table given to update()
+  template <typename T>
+  T slice(T const& bcs, uint64_t minBC, uint64_t maxBC)
+  {
+    if (static_cast<size_t>(bcs.size()) != mGlobalBCs.size()) {
+      LOGF(fatal, "BCIndex: index built for %d BCs used with a table of %d BCs, call update(bcs) at the beginning of the process function", mGlobalBCs.size(), bcs.size());
+    }
+    auto [minBCId, maxBCIdPlusOne] = range(minBC, maxBC);
+    LOGF(debug, "  BC range: %d - %d", minBCId, maxBCIdPlusOne - 1);
+
+    T slice{{bcs.asArrowTable()->Slice(minBCId, maxBCIdPlusOne - minBCId)}, (uint64_t)minBCId};
+    bcs.copyIndexBindings(slice);
+    return slice;
+  }
+
+ private:
+  std::vector<uint64_t> mGlobalBCs;
+  size_t mCursor = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Same as compatibleBCs(meanBC, deltaBC, bcs) but using the BC index
+template <typename T>
+T compatibleBCs(uint64_t meanBC, int deltaBC, T const& bcs, BCIndex& bcIndex)
+{
+  uint64_t minBC = (uint64_t)deltaBC < meanBC ? meanBC - (uint64_t)deltaBC : 0;
+  uint64_t maxBC = meanBC + (uint64_t)deltaBC;
+  return bcIndex.slice(bcs, minBC, maxBC);
+}
+
+// -----------------------------------------------------------------------------
+// Same as compatibleBCs(collision, ndt, bcs, nMinBCs) but using the BC index
+template <typename TCol, typename T>
+T compatibleBCs(TCol const& collision, int ndt, T const& bcs, int nMinBCs, BCIndex& bcIndex)
+{
+  // return if collisions has no associated BC
+  if (!collision.has_foundBC()) {
+    return T{{bcs.asArrowTable()->Slice(0, 0)}, (uint64_t)0};
+  }
+
+  // due to the filling scheme the most probable BC may not be the one estimated from the collision time
+  uint64_t mostProbableBC = collision.template foundBC_as<T>().globalBC();
+  uint64_t meanBC = mostProbableBC + std::lround(collision.collisionTime() / o2::constants::lhc::LHCBunchSpacingNS);
+
+  // enforce minimum number for deltaBC
+  int deltaBC = std::ceil(collision.collisionTimeRes() / o2::constants::lhc::LHCBunchSpacingNS * ndt);
+  if (deltaBC < nMinBCs) {
+    deltaBC = nMinBCs;
+  }
+
+  return compatibleBCs(meanBC, deltaBC, bcs, bcIndex);
+}
+
 // -----------------------------------------------------------------------------
 // function to check if track provides good PID information
 // Checks the nSigma for any particle assumption to be within limits.
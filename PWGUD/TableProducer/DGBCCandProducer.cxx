@@ -219,6 +219,9 @@ struct DGBCCandProducer {
   // DG selector
   DGSelector dgSelector = DGSelector();
 
+  // global BCs of the current time frame, for the lookup of compatible BCs
+  udhelpers::BCIndex bcIndex;
+
   HistogramRegistry registry{
     "registry",
     {}};
@@ -334,10 +337,10 @@ struct DGBCCandProducer {
         info.triggerMaskFDD = fdd.triggerMask();
       }
 
-      auto bcrange = udhelpers::compatibleBCs(bc, bcnum, 16, bcs);
+      auto bcrange = udhelpers::compatibleBCs(bcnum, 16, bcs, bcIndex);
       fillBGBBFlags(info, minbc, bcrange);
     } else {
-      auto bcrange = udhelpers::compatibleBCs(bcnum, 16, bcs);
+      auto bcrange = udhelpers::compatibleBCs(bcnum, 16, bcs, bcIndex);
       fillBGBBFlags(info, minbc, bcrange);
     }
     return info;
@@ -423,9 +426,10 @@ struct DGBCCandProducer {
     }
   }
 
-  void processTable(TIBC const& tibc, BCs const& bcs, CCs const& collisions,
-                    TCs const& tracks, aod::FwdTracks const& fwdtracks, FTIBCs const& ftibcs,
-                    aod::Zdcs const& zdcs, aod::FT0s const& ft0s, aod::FV0As const& fv0as, aod::FDDs const& fdds)
+  // select the tracks of a TIBC and save them if they are a DG candidate
+  void processTIBC(TIBC const& tibc, BCs const& bcs, CCs const& collisions,
+                   TCs const& tracks, aod::FwdTracks const& fwdtracks, FTIBCs const& ftibcs,
+                   aod::FT0s const& ft0s, aod::FV0As const& fv0as, aod::FDDs const& fdds)
   {
     // fill FITInfo
     auto bcnum = tibc.bcnum();
@@ -452,7 +456,7 @@ struct DGBCCandProducer {
         auto col = colSlize.rawIteratorAt(0);
         auto colTracks = tracks.sliceBy(TCperCollision, col.globalIndex());
         auto colFwdTracks = fwdtracks.sliceBy(FWperCollision, col.globalIndex());
-        auto bcRange = udhelpers::compatibleBCs(col, diffCuts.NDtcoll(), bcs, diffCuts.minNBCs());
+        auto bcRange = udhelpers::compatibleBCs(col, diffCuts.NDtcoll(), bcs, diffCuts.minNBCs(), bcIndex);
         isDG = dgSelector.IsSelected(diffCuts, col, bcRange, colTracks, colFwdTracks);
 
         // update UDTables
@@ -482,7 +486,7 @@ struct DGBCCandProducer {
       } else {
         LOGF(debug, "  2. BC has NO collision");
         auto tracksArray = tibc.track_as<TCs>();
-        auto bcRange = udhelpers::compatibleBCs(bc, bc.globalBC(), diffCuts.minNBCs(), bcs);
+        auto bcRange = udhelpers::compatibleBCs(bc.globalBC(), diffCuts.minNBCs(), bcs, bcIndex);
 
         // does BC have fwdTracks?
         if (ftibcs.size() > 0) {
@@ -529,7 +533,7 @@ struct DGBCCandProducer {
 
       // the BC is not contained in the BCs table
       auto tracksArray = tibc.track_as<TCs>();
-      auto bcRange = udhelpers::compatibleBCs(bcnum, diffCuts.minNBCs(), bcs);
+      auto bcRange = udhelpers::compatibleBCs(bcnum, diffCuts.minNBCs(), bcs, bcIndex);
 
       // does BC have fwdTracks?
       if (ftibcs.size() > 0) {
@@ -575,12 +579,25 @@ struct DGBCCandProducer {
     }
   }
 
+  // all TIBCs of the time frame are processed in one call, so that the BC index is built only once
+  void processTable(TIBCs const& tibcs, BCs const& bcs, CCs const& collisions,
+                    TCs const& tracks, aod::FwdTracks const& fwdtracks, FTIBCs const& ftibcs,
+                    aod::Zdcs const& zdcs, aod::FT0s const& ft0s, aod::FV0As const& fv0as, aod::FDDs const& fdds)
+  {
+    bcIndex.update(bcs);
+    for (auto const& tibc : tibcs) {
+      processTIBC(tibc, bcs, collisions, tracks, fwdtracks, ftibcs, ft0s, fv0as, fdds);
+    }
+  }
+
   PROCESS_SWITCH(DGBCCandProducer, processTable, "Produce UDTables", true);
 
   void processData(BCs const& bcs, CCs const& collisions,
                    TCs const& tracks, FTCs const& fwdtracks, TIBCs const& tibcs, FTIBCs const& ftibcs,
                    aod::Zdcs const& zdcs, aod::FT0s const& ft0s, aod::FV0As const& fv0as, aod::FDDs const& fdds)
   {
+    bcIndex.update(bcs);
+
     int isDG1, isDG2;
     int ntr1, ntr2;
     // flag BCs
@@ -635,7 +652,7 @@ struct DGBCCandProducer {
           ntr1 = col.numContrib();
           auto colTracks = tracks.sliceBy(TCperCollision, col.globalIndex());
           auto colFwdTracks = fwdtracks.sliceBy(FWperCollision, col.globalIndex());
-          auto bcRange = udhelpers::compatibleBCs(col, diffCuts.NDtcoll(), bcs, diffCuts.minNBCs());
+          auto bcRange = udhelpers::compatibleBCs(col, diffCuts.NDtcoll(), bcs, diffCuts.minNBCs(), bcIndex);
           isDG1 = dgSelector.IsSelected(diffCuts, col, bcRange, colTracks, colFwdTracks);
           if (isDG1 == 0) {
             // this is a DG candidate with proper collision vertex
@@ -659,7 +676,7 @@ struct DGBCCandProducer {
         if (tibc.bcnum() == bcnum) {
           SETBIT(bcFlag, 4);
 
-          auto bcRange = udhelpers::compatibleBCs(bc, bcnum, diffCuts.minNBCs(), bcs);
+          auto bcRange = udhelpers::compatibleBCs(bcnum, diffCuts.minNBCs(), bcs, bcIndex);
           auto tracksArray = tibc.track_as<TCs>();
           ntr2 = tracksArray.size();
 
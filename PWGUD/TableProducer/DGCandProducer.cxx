@@ -32,6 +32,9 @@ struct DGCandProducer {
   // DG selector
   DGSelector dgSelector;
 
+  // global BCs of the current time frame, for the lookup of compatible BCs
+  udhelpers::BCIndex bcIndex;
+
   void init(InitContext&)
   {
     diffCuts = (DGCutparHolder)DGCuts;
@@ -287,9 +290,10 @@ struct DGCandProducer {
     }
   }
 
-  // process function for real data
-  void processData(CC const& collision, BCs const& bcs, TCs& tracks, FWs& fwdtracks,
-                   aod::Zdcs& zdcs, aod::FT0s& ft0s, aod::FV0As& fv0as, aod::FDDs& fdds)
+  // select a collision of real data and save it if it is a DG candidate
+  template <typename TTracks, typename TFwdTracks>
+  void processDataCollision(CC const& collision, BCs const& bcs, TTracks const& tracks, TFwdTracks const& fwdtracks,
+                            aod::FT0s const& ft0s, aod::FV0As const& fv0as, aod::FDDs const& fdds)
   {
     // nominal BC
     if (!collision.has_foundBC()) {
@@ -298,7 +302,7 @@ struct DGCandProducer {
     auto bc = collision.foundBC_as<BCs>();
 
     // obtain slice of compatible BCs
-    auto bcRange = udhelpers::compatibleBCs(collision, diffCuts.NDtcoll(), bcs, diffCuts.minNBCs());
+    auto bcRange = udhelpers::compatibleBCs(collision, diffCuts.NDtcoll(), bcs, diffCuts.minNBCs(), bcIndex);
 
     // apply DG selection
     auto isDGEvent = dgSelector.IsSelected(diffCuts, collision, bcRange, tracks, fwdtracks);
@@ -358,22 +362,35 @@ struct DGCandProducer {
       }
     }
   }
-  PROCESS_SWITCH(DGCandProducer, processData, "Process real data", false);
 
+  Preslice<TCs> dataTracksPerCollision = aod::track::collisionId;
   Preslice<MCTCs> tracksPerCollision = aod::track::collisionId;
   Preslice<FWs> fwdTracksPerCollision = aod::fwdtrack::collisionId;
+  Preslice<aod::McParticles> mcPartsPerMcCollision = aod::mcparticle::mcCollisionId;
+  Preslice<MCCCs> collisionsPerMcCollision = aod::mccollisionlabel::mcCollisionId;
 
-  // process function for MC data
-  void processMc(aod::McCollision const& McCol,
-                 aod::McParticles const& McParts,
-                 MCCCs const& collisions,
-                 BCs const& bcs,
-                 MCTCs const& tracks,
-                 FWs const& fwdtracks,
-                 aod::Zdcs const& zdcs,
-                 aod::FT0s const& ft0s,
-                 aod::FV0As const& fv0as,
-                 aod::FDDs const& fdds) //)
+  // process function for real data
+  // all collisions of the time frame are processed in one call, so that the BC index is built only once
+  void processData(CCs const& collisions, BCs const& bcs, TCs const& tracks, FWs const& fwdtracks,
+                   aod::Zdcs const& zdcs, aod::FT0s const& ft0s, aod::FV0As const& fv0as, aod::FDDs const& fdds)
+  {
+    bcIndex.update(bcs);
+    for (auto const& collision : collisions) {
+      auto collisionTracks = tracks.sliceBy(dataTracksPerCollision, collision.globalIndex());
+      auto collisionFwdTracks = fwdtracks.sliceBy(fwdTracksPerCollision, collision.globalIndex());
+      processDataCollision(collision, bcs, collisionTracks, collisionFwdTracks, ft0s, fv0as, fdds);
+    }
+  }
+  PROCESS_SWITCH(DGCandProducer, processData, "Process real data", false);
+
+  // select the reconstructed collisions of a MC collision and save the DG candidates and the MC truth
+  template <typename TMcParticles, typename TCollisions>
+  void processMcCollision(aod::McCollision const& McCol,
+                          TMcParticles const& McParts,
+                          TCollisions const& collisions,
+                          BCs const& bcs,
+                          MCTCs const& tracks,
+                          FWs const& fwdtracks)
   {
     for (auto McPart : McParts) {
       LOGF(debug, "McCol %i McPart %i", McCol.globalIndex(), McPart.globalIndex());
@@ -419,7 +436,7 @@ struct DGCandProducer {
 
       // is this a collision to be saved?
       // obtain slice of compatible BCs
-      auto bcRange = udhelpers::MCcompatibleBCs(collision, diffCuts.NDtcoll(), bcs, diffCuts.minNBCs());
+      auto bcRange = udhelpers::compatibleBCs(collision, diffCuts.NDtcoll(), bcs, diffCuts.minNBCs(), bcIndex);
 
       // apply DG selection
       auto isDGEvent = dgSelector.IsSelected(diffCuts, collision, bcRange, collisionTracks, collisionFwdTracks);
@@ -459,6 +476,27 @@ struct DGCandProducer {
       }
     }
   }
+
+  // process function for MC data
+  // all MC collisions of the time frame are processed in one call, so that the BC index is built only once
+  void processMc(aod::McCollisions const& mcCollisions,
+                 aod::McParticles const& mcParticles,
+                 MCCCs const& collisions,
+                 BCs const& bcs,
+                 MCTCs const& tracks,
+                 FWs const& fwdtracks,
+                 aod::Zdcs const& zdcs,
+                 aod::FT0s const& ft0s,
+                 aod::FV0As const& fv0as,
+                 aod::FDDs const& fdds)
+  {
+    bcIndex.update(bcs);
+    for (auto const& mcCollision : mcCollisions) {
+      auto mcCollisionParticles = mcParticles.sliceBy(mcPartsPerMcCollision, mcCollision.globalIndex());
+      auto mcCollisionCollisions = collisions.sliceBy(collisionsPerMcCollision, mcCollision.globalIndex());
+      processMcCollision(mcCollision, mcCollisionParticles, mcCollisionCollisions, bcs, tracks, fwdtracks);
+    }
+  }
   PROCESS_SWITCH(DGCandProducer, processMc, "Process MC data", false);
 };
 
@@ -9,6 +9,11 @@
 // granted to it by virtue of its status as an Intergovernmental Organization
 // or submit itself to any jurisdiction.
 
+#include <algorithm>
+#include <array>
+#include <unordered_set>
+#include <vector>
+
 #include "Framework/runDataProcessing.h"
 #include "Framework/AnalysisTask.h"
 #include "Framework/AnalysisDataModel.h"
@@ -75,7 +80,84 @@ struct UpcCandProducer {
                                      o2::aod::pidTPCFullEl, o2::aod::pidTPCFullMu, o2::aod::pidTPCFullPi, o2::aod::pidTPCFullKa, o2::aod::pidTPCFullPr,
                                      o2::aod::TOFSignal, o2::aod::pidTOFFullEl, o2::aod::pidTOFFullMu, o2::aod::pidTOFFullPi, o2::aod::pidTOFFullKa, o2::aod::pidTOFFullPr>;
 
-  typedef std::pair<uint64_t, std::vector<int64_t>> BCTracksPair;
+  // track IDs grouped by global BC in CSR layout: group i belongs to the global BC bcs[i]
+  // and holds the tracks ids[offsets[i]], ..., ids[offsets[i + 1] - 1] in the order in which they were added
+  struct BCTrackGroups {
+    std::vector<std::pair<uint64_t, int64_t>> entries; // (global BC, track ID) before grouping
+    std::vector<std::pair<uint64_t, int64_t>> sortBuffer;
+    std::vector<uint64_t> bcs;
+    std::vector<uint32_t> offsets{0};
+    std::vector<int64_t> ids;
+
+    void add(uint64_t bc, int64_t trkId) { entries.emplace_back(bc, trkId); }
+    uint32_t size() const { return bcs.size(); }
+    uint32_t nTracks(uint32_t i) const { return offsets[i + 1] - offsets[i]; }
+    int64_t track(uint32_t i, uint32_t j) const { return ids[offsets[i] + j]; }
+    // index of the first group with global BC >= bc
+    uint32_t lowerBound(uint64_t bc) const { return std::lower_bound(bcs.begin(), bcs.end(), bc) - bcs.begin(); }
+
+    // stable LSD radix sort of the entries on the BC offset wrt the smallest BC,
+    // only as many byte passes as needed for the BC range, then grouping of equal BCs
+    void build()
+    {
+      bcs.clear();
+      offsets.assign(1, 0);
+      ids.clear();
+      if (entries.empty()) {
+        return;
+      }
+      auto [minIt, maxIt] = std::minmax_element(entries.begin(), entries.end(),
+                                                [](const auto& left, const auto& right) { return left.first < right.first; });
+      const uint64_t minBC = minIt->first;
+      const uint64_t rangeBC = maxIt->first - minBC;
+      sortBuffer.resize(entries.size());
+      for (uint32_t shift = 0; shift < 64 && (rangeBC >> shift) != 0; shift += 8) {
+        std::array<uint32_t, 257> counts{};
+        for (const auto& entry : entries) {
+          counts[((entry.first - minBC) >> shift & 0xff) + 1]++;
+        }
+        for (uint32_t digit = 0; digit < 256; ++digit) {
+          counts[digit + 1] += counts[digit];
+        }
+        for (const auto& entry : entries) {
+          sortBuffer[counts[(entry.first - minBC) >> shift & 0xff]++] = entry;
+        }
+        entries.swap(sortBuffer);
+      }
+      ids.reserve(entries.size());
+      for (const auto& [bc, trkId] : entries) {
+        if (bcs.empty() || bcs.back() != bc) {
+          if (!bcs.empty()) {
+            offsets.push_back(ids.size());
+          }
+          bcs.push_back(bc);
+        }
+        ids.push_back(trkId);
+      }
+      offsets.push_back(ids.size());
+      entries.clear();
+    }
+  };
+
+  // ITS-TPC tracks added to the groups of a BCTrackGroups, in the same CSR layout,
+  // and flags for groups rejected because of too many nearby tracks
+  struct AddedTracks {
+    std::vector<uint32_t> offsets;
+    std::vector<int64_t> ids;
+    std::vector<bool> rejected;
+
+    void reset(uint32_t nGroups)
+    {
+      offsets.assign(nGroups + 1, 0);
+      ids.clear();
+      rejected.assign(nGroups, false);
+    }
+    uint32_t nTracks(uint32_t i) const { return offsets[i + 1] - offsets[i]; }
+  };
+
+  // reused buffers for the track IDs of a candidate
+  std::vector<int64_t> fBarrelTrackIDs;
+  std::vector<int64_t> fFwdTrackIDs;
 
   void init(InitContext&)
   {
@@ -342,9 +424,12 @@ struct UpcCandProducer {
     return hasNoFT0;
   }
 
+  // candidates are processed in increasing BC order, hence the search for FIT BCs
+  // continues from the position found for the previous candidate (searchStart)
   void processFITInfo(upchelpers::FITInfo& fitInfo,
                       uint64_t midbc,
                       std::vector<std::pair<uint64_t, int64_t>>& v,
+                      size_t& searchStart,
                       BCsWithBcSels const& bcs,
                       o2::aod::FT0s const& ft0s,
                       o2::aod::FDDs const& fdds,
@@ -355,8 +440,9 @@ struct UpcCandProducer {
     uint64_t right = fMaxBC >= midbc + range ? midbc + range : fMaxBC;
 
     std::pair<uint64_t, int64_t> dummyPair(left, 0);
-    auto curit = std::lower_bound(v.begin(), v.end(), dummyPair,
+    auto curit = std::lower_bound(v.begin() + std::min(searchStart, v.size()), v.end(), dummyPair,
                                   [](const std::pair<uint64_t, int64_t>& left, const std::pair<uint64_t, int64_t>& right) { return left.first < right.first; });
+    searchStart = curit - v.begin();
 
     if (curit == v.end()) // no BCs with FT0 info at all
       return;
@@ -462,18 +548,8 @@ struct UpcCandProducer {
     }
   }
 
-  void addTrack(std::vector<BCTracksPair>& v, uint64_t bc, int64_t trkId)
-  {
-    auto it = std::find_if(v.begin(), v.end(),
-                           [bc](const BCTracksPair& element) { return element.first == bc; });
-    if (it != v.end())
-      it->second.push_back(trkId);
-    else
-      v.emplace_back(std::make_pair(bc, std::vector<int64_t>({trkId})));
-  }
-
-  void collectBarrelTracks(std::vector<BCTracksPair>& bcsMatchedTrIdsA,
-                           std::vector<BCTracksPair>& bcsMatchedTrIdsB,
+  void collectBarrelTracks(BCTrackGroups& bcsMatchedTrIdsA,
+                           BCTrackGroups& bcsMatchedTrIdsB,
                            BCsWithBcSels const& bcs,
                            o2::aod::Collisions const& collisions,
                            BarrelTracks const& barrelTracks,
@@ -506,13 +582,15 @@ struct UpcCandProducer {
       bool needTOFWithITS = !upcCuts.getProduceITSITS() && upcCuts.getRequireITSTPC() && trk.hasTOF() && trk.hasITS() && trk.hasTPC();
       bool addToA = needITSITS || needAllTOF || needTOFWithITS;
       if (addToA)
-        addTrack(bcsMatchedTrIdsA, bc, trkId);
+        bcsMatchedTrIdsA.add(bc, trkId);
       if (fSearchITSTPC == 1 && !trk.hasTOF() && trk.hasITS() && trk.hasTPC())
-        addTrack(bcsMatchedTrIdsB, bc, trkId);
+        bcsMatchedTrIdsB.add(bc, trkId);
     }
+    bcsMatchedTrIdsA.build();
+    bcsMatchedTrIdsB.build();
   }
 
-  void collectForwardTracks(std::vector<BCTracksPair>& bcsMatchedTrIdsMID,
+  void collectForwardTracks(BCTrackGroups& bcsMatchedTrIdsMID,
                             BCsWithBcSels const& bcs,
                             o2::aod::Collisions const& collisions,
                             ForwardTracks const& fwdTracks,
@@ -540,46 +618,46 @@ struct UpcCandProducer {
       if (bc > fMaxBC)
         continue;
       if (nContrib <= upcCuts.getMaxNContrib())
-        addTrack(bcsMatchedTrIdsMID, bc, trkId);
+        bcsMatchedTrIdsMID.add(bc, trkId);
     }
+    bcsMatchedTrIdsMID.build();
   }
 
   int32_t searchTracks(uint64_t midbc, uint64_t range, uint32_t tracksToFind,
                        std::vector<int64_t>& tracks,
-                       std::vector<BCTracksPair>& v,
+                       BCTrackGroups const& v,
                        std::unordered_set<int64_t>& matchedTracks,
                        bool skipMidBC = false)
   {
     uint32_t count = 0;
     uint64_t left = midbc >= range ? midbc - range : 0;
     uint64_t right = fMaxBC >= midbc + range ? midbc + range : fMaxBC;
-    BCTracksPair dummyPair(left, {});
-    auto curit = std::lower_bound(v.begin(), v.end(), dummyPair,
-                                  [](const BCTracksPair& left, const BCTracksPair& right) { return left.first < right.first; });
-    if (curit == v.end()) // no ITS-TPC tracks nearby at all -> near last BCs
+    uint32_t curit = v.lowerBound(left);
+    if (curit == v.size()) // no ITS-TPC tracks nearby at all -> near last BCs
       return -1;
-    uint64_t curbc = curit->first;
+    uint64_t curbc = v.bcs[curit];
     while (curbc <= right) { // moving forward to midbc+range
       if (skipMidBC && curbc == midbc) {
         ++curit;
-        if (curit == v.end())
+        if (curit == v.size())
           break;
-        curbc = curit->first;
+        curbc = v.bcs[curit];
       }
-      uint32_t size = curit->second.size();
+      uint32_t size = v.nTracks(curit);
       if (size > 1) // too many tracks per BC -> possibly another event
         return -2;
       count += size;
       if (count > tracksToFind) // too many tracks nearby
         return -3;
-      if (matchedTracks.find(curit->second[0]) == matchedTracks.end()) {
-        tracks.push_back(curit->second[0]);
-        matchedTracks.insert(curit->second[0]);
+      int64_t trkId = v.track(curit, 0);
+      if (matchedTracks.find(trkId) == matchedTracks.end()) {
+        tracks.push_back(trkId);
+        matchedTracks.insert(trkId);
       }
       ++curit;
-      if (curit == v.end())
+      if (curit == v.size())
         break;
-      curbc = curit->first;
+      curbc = v.bcs[curit];
     }
     if (count != tracksToFind)
       return -4;
@@ -597,9 +675,9 @@ struct UpcCandProducer {
   {
     fMaxBC = bcs.iteratorAt(bcs.size() - 1).globalBC(); // restrict ITS-TPC track search to [0, fMaxBC]
 
-    // pairs of global BCs and vectors of matched track IDs:
-    std::vector<BCTracksPair> bcsMatchedTrIdsTOF;
-    std::vector<BCTracksPair> bcsMatchedTrIdsITSTPC;
+    // global BCs with matched track IDs, sorted by BC:
+    BCTrackGroups bcsMatchedTrIdsTOF;
+    BCTrackGroups bcsMatchedTrIdsITSTPC;
 
     // trackID -> index in amb. track table
     std::unordered_map<int64_t, uint64_t> ambBarrelTrBCs;
@@ -610,43 +688,38 @@ struct UpcCandProducer {
                         barrelTracks, ambBarrelTracks, ambBarrelTrBCs);
 
     uint32_t nBCsWithITSTPC = bcsMatchedTrIdsITSTPC.size();
+    uint32_t nBCsWithTOF = bcsMatchedTrIdsTOF.size();
 
-    std::sort(bcsMatchedTrIdsTOF.begin(), bcsMatchedTrIdsTOF.end(),
-              [](const auto& left, const auto& right) { return left.first < right.first; });
-    std::sort(bcsMatchedTrIdsITSTPC.begin(), bcsMatchedTrIdsITSTPC.end(),
-              [](const auto& left, const auto& right) { return left.first < right.first; });
+    // ITS-TPC tracks added to the TOF tracks of each BC
+    AddedTracks addedTrIdsITSTPC;
+    addedTrIdsITSTPC.reset(nBCsWithTOF);
 
     if (nBCsWithITSTPC > 0 && fSearchITSTPC == 1) {
       std::unordered_set<int64_t> matchedTracks;
-      for (auto& pair : bcsMatchedTrIdsTOF) {
-        uint64_t bc = pair.first;
-        auto& trackIds = pair.second;
-        uint32_t nTOFtracks = trackIds.size();
+      for (uint32_t ibc = 0; ibc < nBCsWithTOF; ++ibc) {
+        addedTrIdsITSTPC.offsets[ibc] = addedTrIdsITSTPC.ids.size();
+        uint64_t bc = bcsMatchedTrIdsTOF.bcs[ibc];
+        uint32_t nTOFtracks = bcsMatchedTrIdsTOF.nTracks(ibc);
         if (nTOFtracks > fNBarProngs) // too many TOF tracks?!
           continue;
         if (nTOFtracks == fNBarProngs) { // check for ITS-TPC tracks
-          std::vector<int64_t> tracks;
-          tracks.reserve(fNBarProngs * 2); // precautions
-          int32_t res = searchTracks(bc, fSearchRangeITSTPC, 0, tracks, bcsMatchedTrIdsITSTPC, matchedTracks, true);
+          int32_t res = searchTracks(bc, fSearchRangeITSTPC, 0, addedTrIdsITSTPC.ids, bcsMatchedTrIdsITSTPC, matchedTracks, true);
           if (res < 0) { // too many tracks nearby -> rejecting
-            trackIds.push_back(0);
+            addedTrIdsITSTPC.ids.resize(addedTrIdsITSTPC.offsets[ibc]);
+            addedTrIdsITSTPC.rejected[ibc] = true;
             continue;
           }
         }
         if (nTOFtracks < fNBarProngs && !upcCuts.getRequireTOF()) { // add ITS-TPC track if needed
           uint32_t tracksToFind = fNBarProngs - nTOFtracks;
-          std::vector<int64_t> tracks;
-          tracks.reserve(fNBarProngs * 2); // precautions
-          int32_t res = searchTracks(bc, fSearchRangeITSTPC, tracksToFind, tracks, bcsMatchedTrIdsITSTPC, matchedTracks, true);
+          int32_t res = searchTracks(bc, fSearchRangeITSTPC, tracksToFind, addedTrIdsITSTPC.ids, bcsMatchedTrIdsITSTPC, matchedTracks, true);
           if (res < 0) // too many or not enough tracks nearby -> rejecting
-            continue;
-          trackIds.insert(trackIds.end(), tracks.begin(), tracks.end());
+            addedTrIdsITSTPC.ids.resize(addedTrIdsITSTPC.offsets[ibc]);
         }
       }
+      addedTrIdsITSTPC.offsets[nBCsWithTOF] = addedTrIdsITSTPC.ids.size();
     }
 
-    bcsMatchedTrIdsITSTPC.clear();
-
     // todo: calculate position of UD collision?
     float dummyX = 0.;
     float dummyY = 0.;
@@ -663,17 +736,20 @@ struct UpcCandProducer {
 
     // storing n-prong matches
     int32_t candID = 0;
-    for (const auto& item : bcsMatchedTrIdsTOF) {
-      auto& barrelTrackIDs = item.second;
-      uint16_t numContrib = barrelTrackIDs.size();
+    size_t fitSearchStart = 0;
+    auto& barrelTrackIDs = fBarrelTrackIDs;
+    for (uint32_t ibc = 0; ibc < nBCsWithTOF; ++ibc) {
+      uint16_t numContrib = bcsMatchedTrIdsTOF.nTracks(ibc) + addedTrIdsITSTPC.nTracks(ibc);
       // sanity check
-      if (numContrib != fNBarProngs)
+      if (addedTrIdsITSTPC.rejected[ibc] || numContrib != fNBarProngs)
         continue;
+      barrelTrackIDs.assign(bcsMatchedTrIdsTOF.ids.begin() + bcsMatchedTrIdsTOF.offsets[ibc], bcsMatchedTrIdsTOF.ids.begin() + bcsMatchedTrIdsTOF.offsets[ibc + 1]);
+      barrelTrackIDs.insert(barrelTrackIDs.end(), addedTrIdsITSTPC.ids.begin() + addedTrIdsITSTPC.offsets[ibc], addedTrIdsITSTPC.ids.begin() + addedTrIdsITSTPC.offsets[ibc + 1]);
       // fetching FT0, FDD, FV0 information
       // if there is no relevant signal, dummy info will be used
-      uint64_t bc = item.first;
+      uint64_t bc = bcsMatchedTrIdsTOF.bcs[ibc];
       upchelpers::FITInfo fitInfo{};
-      processFITInfo(fitInfo, bc, indexBCglId, bcs, ft0s, fdds, fv0as);
+      processFITInfo(fitInfo, bc, indexBCglId, fitSearchStart, bcs, ft0s, fdds, fv0as);
       if (fFilterFT0) {
         if (!checkFT0(fitInfo, true))
           continue;
@@ -702,7 +778,6 @@ struct UpcCandProducer {
 
     indexBCglId.clear();
     ambBarrelTrBCs.clear();
-    bcsMatchedTrIdsTOF.clear();
   }
 
   void createCandidatesSemiFwd(BarrelTracks const& barrelTracks,
@@ -724,10 +799,10 @@ struct UpcCandProducer {
 
     fMaxBC = bcs.iteratorAt(bcs.size() - 1).globalBC(); // restrict ITS-TPC track search to [0, fMaxBC]
 
-    // pairs of global BCs and vectors of matched track IDs:
-    std::vector<BCTracksPair> bcsMatchedTrIdsTOF;
-    std::vector<BCTracksPair> bcsMatchedTrIdsITSTPC;
-    std::vector<BCTracksPair> bcsMatchedTrIdsMID;
+    // global BCs with matched track IDs, sorted by BC:
+    BCTrackGroups bcsMatchedTrIdsTOF;
+    BCTrackGroups bcsMatchedTrIdsITSTPC;
+    BCTrackGroups bcsMatchedTrIdsMID;
 
     // trackID -> index in amb. track table
     std::unordered_map<int64_t, uint64_t> ambBarrelTrBCs;
@@ -749,61 +824,56 @@ struct UpcCandProducer {
 
     uint32_t nBCsWithITSTPC = bcsMatchedTrIdsITSTPC.size();
     uint32_t nBCsWithMID = bcsMatchedTrIdsMID.size();
-
-    std::sort(bcsMatchedTrIdsMID.begin(), bcsMatchedTrIdsMID.end(),
-              [](const auto& left, const auto& right) { return left.first < right.first; });
-
-    std::vector<BCTracksPair> bcsMatchedTrIdsTOFTagged(nBCsWithMID);
-    for (const auto& pair : bcsMatchedTrIdsTOF) {
-      uint64_t bc = pair.first;
-      auto it = std::find_if(bcsMatchedTrIdsMID.begin(), bcsMatchedTrIdsMID.end(),
-                             [bc](const auto& item) { return item.first == bc; });
-      if (it != bcsMatchedTrIdsMID.end()) {
-        uint32_t ibc = it - bcsMatchedTrIdsMID.begin();
-        bcsMatchedTrIdsTOFTagged[ibc].second = pair.second;
+    uint32_t nBCsWithTOF = bcsMatchedTrIdsTOF.size();
+
+    // merge-join of the sorted BCs: TOF group of each MID BC, -1 if there is none
+    std::vector<int32_t> tofGroupForMID(nBCsWithMID, -1);
+    for (uint32_t iMID = 0, iTOF = 0; iMID < nBCsWithMID && iTOF < nBCsWithTOF;) {
+      if (bcsMatchedTrIdsTOF.bcs[iTOF] < bcsMatchedTrIdsMID.bcs[iMID]) {
+        ++iTOF;
+      } else if (bcsMatchedTrIdsMID.bcs[iMID] < bcsMatchedTrIdsTOF.bcs[iTOF]) {
+        ++iMID;
+      } else {
+        tofGroupForMID[iMID] = iTOF;
+        ++iMID;
+        ++iTOF;
       }
     }
+    auto nTOFTracksForMID = [&](uint32_t iMID) -> uint32_t {
+      return tofGroupForMID[iMID] >= 0 ? bcsMatchedTrIdsTOF.nTracks(tofGroupForMID[iMID]) : 0;
+    };
 
-    bcsMatchedTrIdsTOF.clear();
-
-    std::sort(bcsMatchedTrIdsITSTPC.begin(), bcsMatchedTrIdsITSTPC.end(),
-              [](const auto& left, const auto& right) { return left.first < right.first; });
+    // ITS-TPC tracks added to the TOF tracks of each MID BC
+    AddedTracks addedTrIdsITSTPC;
+    addedTrIdsITSTPC.reset(nBCsWithMID);
 
     if (nBCsWithITSTPC > 0 && fSearchITSTPC == 1) {
       std::unordered_set<int64_t> matchedTracks;
       for (uint32_t ibc = 0; ibc < nBCsWithMID; ++ibc) {
-        auto& pairMID = bcsMatchedTrIdsMID[ibc];
-        auto& pairTOF = bcsMatchedTrIdsTOFTagged[ibc];
-        uint64_t bc = pairMID.first;
-        auto& trackIdsMID = pairMID.second;
-        auto& trackIdsTOF = pairTOF.second;
-        uint32_t nMIDtracks = trackIdsMID.size();
-        uint32_t nTOFtracks = trackIdsTOF.size();
+        addedTrIdsITSTPC.offsets[ibc] = addedTrIdsITSTPC.ids.size();
+        uint64_t bc = bcsMatchedTrIdsMID.bcs[ibc];
+        uint32_t nMIDtracks = bcsMatchedTrIdsMID.nTracks(ibc);
+        uint32_t nTOFtracks = nTOFTracksForMID(ibc);
         if (nMIDtracks > fNFwdProngs || nTOFtracks > fNBarProngs) // too many MID and/or TOF tracks?!
           continue;
         if (nMIDtracks == fNFwdProngs && nTOFtracks == fNBarProngs) { // check for ITS-TPC tracks
-          std::vector<int64_t> tracks;
-          tracks.reserve(fNBarProngs * 2); // precautions
-          int32_t res = searchTracks(bc, fSearchRangeITSTPC, 0, tracks, bcsMatchedTrIdsITSTPC, matchedTracks, false);
+          int32_t res = searchTracks(bc, fSearchRangeITSTPC, 0, addedTrIdsITSTPC.ids, bcsMatchedTrIdsITSTPC, matchedTracks, false);
           if (res < 0) { // too many tracks nearby -> rejecting
-            trackIdsTOF.push_back(0);
+            addedTrIdsITSTPC.ids.resize(addedTrIdsITSTPC.offsets[ibc]);
+            addedTrIdsITSTPC.rejected[ibc] = true;
             continue;
           }
         }
         if (nMIDtracks == fNFwdProngs && nTOFtracks < fNBarProngs && !upcCuts.getRequireTOF()) { // add ITS-TPC track if needed
           uint32_t tracksToFind = fNBarProngs - nTOFtracks;
-          std::vector<int64_t> tracks;
-          tracks.reserve(fNBarProngs * 2); // precautions
-          int32_t res = searchTracks(bc, fSearchRangeITSTPC, tracksToFind, tracks, bcsMatchedTrIdsITSTPC, matchedTracks, true);
+          int32_t res = searchTracks(bc, fSearchRangeITSTPC, tracksToFind, addedTrIdsITSTPC.ids, bcsMatchedTrIdsITSTPC, matchedTracks, true);
           if (res < 0) // too many or not enough tracks nearby -> rejecting
-            continue;
-          trackIdsTOF.insert(trackIdsTOF.end(), tracks.begin(), tracks.end());
+            addedTrIdsITSTPC.ids.resize(addedTrIdsITSTPC.offsets[ibc]);
         }
       }
+      addedTrIdsITSTPC.offsets[nBCsWithMID] = addedTrIdsITSTPC.ids.size();
     }
 
-    bcsMatchedTrIdsITSTPC.clear();
-
     // todo: calculate position of UD collision?
     float dummyX = 0.;
     float dummyY = 0.;
@@ -820,22 +890,28 @@ struct UpcCandProducer {
 
     // storing n-prong matches
     int32_t candID = 0;
+    size_t fitSearchStart = 0;
+    auto& fwdTrackIDs = fFwdTrackIDs;
+    auto& barrelTrackIDs = fBarrelTrackIDs;
     for (uint32_t ibc = 0; ibc < nBCsWithMID; ++ibc) {
-      auto& pairMID = bcsMatchedTrIdsMID[ibc];
-      auto& pairTOF = bcsMatchedTrIdsTOFTagged[ibc];
-      auto& fwdTrackIDs = pairMID.second;
-      auto& barrelTrackIDs = pairTOF.second;
-      uint32_t nMIDtracks = fwdTrackIDs.size();
-      uint32_t nBarrelTracks = barrelTrackIDs.size(); // TOF + ITS-TPC tracks
+      uint32_t nMIDtracks = bcsMatchedTrIdsMID.nTracks(ibc);
+      uint32_t nBarrelTracks = nTOFTracksForMID(ibc) + addedTrIdsITSTPC.nTracks(ibc); // TOF + ITS-TPC tracks
       uint16_t numContrib = nBarrelTracks + nMIDtracks;
       // sanity check
-      if (nBarrelTracks != fNBarProngs || nMIDtracks != fNFwdProngs)
+      if (addedTrIdsITSTPC.rejected[ibc] || nBarrelTracks != fNBarProngs || nMIDtracks != fNFwdProngs)
         continue;
+      fwdTrackIDs.assign(bcsMatchedTrIdsMID.ids.begin() + bcsMatchedTrIdsMID.offsets[ibc], bcsMatchedTrIdsMID.ids.begin() + bcsMatchedTrIdsMID.offsets[ibc + 1]);
+      barrelTrackIDs.clear();
+      if (tofGroupForMID[ibc] >= 0) {
+        uint32_t iTOF = tofGroupForMID[ibc];
+        barrelTrackIDs.assign(bcsMatchedTrIdsTOF.ids.begin() + bcsMatchedTrIdsTOF.offsets[iTOF], bcsMatchedTrIdsTOF.ids.begin() + bcsMatchedTrIdsTOF.offsets[iTOF + 1]);
+      }
+      barrelTrackIDs.insert(barrelTrackIDs.end(), addedTrIdsITSTPC.ids.begin() + addedTrIdsITSTPC.offsets[ibc], addedTrIdsITSTPC.ids.begin() + addedTrIdsITSTPC.offsets[ibc + 1]);
       // fetching FT0, FDD, FV0 information
       // if there is no relevant signal, dummy info will be used
-      uint64_t bc = pairMID.first;
+      uint64_t bc = bcsMatchedTrIdsMID.bcs[ibc];
       upchelpers::FITInfo fitInfo{};
-      processFITInfo(fitInfo, bc, indexBCglId, bcs, ft0s, fdds, fv0as);
+      processFITInfo(fitInfo, bc, indexBCglId, fitSearchStart, bcs, ft0s, fdds, fv0as);
       if (fFilterFT0) {
         if (!checkFT0(fitInfo, false))
           continue;
@@ -865,9 +941,7 @@ struct UpcCandProducer {
 
     indexBCglId.clear();
     ambFwdTrBCs.clear();
-    bcsMatchedTrIdsMID.clear();
     ambBarrelTrBCs.clear();
-    bcsMatchedTrIdsTOFTagged.clear();
   }
 
   // data processors
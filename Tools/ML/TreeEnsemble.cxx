@@ -0,0 +1,532 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file     TreeEnsemble.cxx
+///
+/// \brief    Native evaluator of tree-ensemble models (BDTs) exported to ONNX
+///
+
+#include "Tools/ML/TreeEnsemble.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "Framework/Logger.h"
+
+namespace o2
+{
+
+namespace ml
+{
+
+namespace
+{
+
+/// Minimal reader of the protobuf wire format, enough to walk through an ONNX ModelProto
+class ProtoReader
+{
+ public:
+  ProtoReader(const uint8_t* begin, const uint8_t* end) : mPos(begin), mEnd(end) {}
+
+  bool ok() const { return mOk; }
+  bool atEnd() const { return !mOk || mPos >= mEnd; }
+
+  /// reads the key of the next field, false at the end of the message
+  bool nextField(uint32_t& field, uint32_t& wireType)
+  {
+    if (atEnd()) {
+      return false;
+    }
+    const uint64_t key = readVarint();
+    field = key >> 3;
+    wireType = key & 0x7;
+    return mOk;
+  }
+
+  uint64_t readVarint()
+  {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64 && mPos < mEnd; shift += 7) {
+      const uint8_t byte = *mPos++;
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return value;
+      }
+    }
+    mOk = false;
+    return 0;
+  }
+
+  float readFloat()
+  {
+    float value = 0.f;
+    if (mEnd - mPos < 4) {
+      mOk = false;
+      return value;
+    }
+    std::memcpy(&value, mPos, 4);
+    mPos += 4;
+    return value;
+  }
+
+  /// \return reader of the length-delimited field (embedded message, string or packed values)
+  ProtoReader readMessage()
+  {
+    const uint64_t length = readVarint();
+    if (!mOk || length > static_cast<uint64_t>(mEnd - mPos)) {
+      mOk = false;
+      return ProtoReader(mEnd, mEnd);
+    }
+    ProtoReader message(mPos, mPos + length);
+    mPos += length;
+    return message;
+  }
+
+  std::string readString()
+  {
+    ProtoReader message = readMessage();
+    return std::string(reinterpret_cast<const char*>(message.mPos), message.mEnd - message.mPos);
+  }
+
+  void skip(uint32_t wireType)
+  {
+    switch (wireType) {
+      case 0:
+        readVarint();
+        break;
+      case 1:
+        advance(8);
+        break;
+      case 2:
+        readMessage();
+        break;
+      case 5:
+        advance(4);
+        break;
+      default:
+        mOk = false;
+    }
+  }
+
+ private:
+  void advance(size_t n)
+  {
+    if (static_cast<size_t>(mEnd - mPos) < n) {
+      mOk = false;
+      return;
+    }
+    mPos += n;
+  }
+
+  const uint8_t* mPos;
+  const uint8_t* mEnd;
+  bool mOk = true;
+};
+
+/// ONNX AttributeProto, only the fields used by the tree-ensemble operators
+struct Attribute {
+  int64_t i = 0;
+  std::string s;
+  std::vector<float> floats;
+  std::vector<int64_t> ints;
+  std::vector<std::string> strings;
+  bool hasTensor = false;
+};
+
+/// ONNX NodeProto, only the fields used by the tree-ensemble operators
+struct OnnxNode {
+  std::string opType;
+  std::map<std::string, Attribute> attributes;
+};
+
+bool parseAttribute(ProtoReader reader, std::string& name, Attribute& attribute)
+{
+  uint32_t field, wireType;
+  while (reader.nextField(field, wireType)) {
+    if (field == 1 && wireType == 2) {
+      name = reader.readString();
+    } else if (field == 3 && wireType == 0) {
+      attribute.i = static_cast<int64_t>(reader.readVarint());
+    } else if (field == 4 && wireType == 2) {
+      attribute.s = reader.readString();
+    } else if (field == 5 && wireType == 2) {
+      attribute.hasTensor = true;
+      reader.skip(wireType);
+    } else if (field == 7 && wireType == 2) {
+      ProtoReader packed = reader.readMessage();
+      while (!packed.atEnd()) {
+        attribute.floats.push_back(packed.readFloat());
+      }
+    } else if (field == 7 && wireType == 5) {
+      attribute.floats.push_back(reader.readFloat());
+    } else if (field == 8 && wireType == 2) {
+      ProtoReader packed = reader.readMessage();
+      while (!packed.atEnd()) {
+        attribute.ints.push_back(static_cast<int64_t>(packed.readVarint()));
+      }
+    } else if (field == 8 && wireType == 0) {
+      attribute.ints.push_back(static_cast<int64_t>(reader.readVarint()));
+    } else if (field == 9 && wireType == 2) {
+      attribute.strings.push_back(reader.readString());
+    } else {
+      reader.skip(wireType);
+    }
+  }
+  return reader.ok();
+}
+
+bool parseNode(ProtoReader reader, OnnxNode& node)
+{
+  uint32_t field, wireType;
+  while (reader.nextField(field, wireType)) {
+    if (field == 4 && wireType == 2) {
+      node.opType = reader.readString();
+    } else if (field == 5 && wireType == 2) {
+      std::string name;
+      Attribute attribute;
+      if (!parseAttribute(reader.readMessage(), name, attribute)) {
+        return false;
+      }
+      node.attributes[name] = std::move(attribute);
+    } else {
+      reader.skip(wireType);
+    }
+  }
+  return reader.ok();
+}
+
+/// element type of a ValueInfoProto: type (2) -> tensor_type (1) -> elem_type (1)
+int parseElementType(ProtoReader reader)
+{
+  uint32_t field, wireType;
+  for (int level = 0; level < 3; level++) {
+    bool found = false;
+    while (reader.nextField(field, wireType)) {
+      const uint32_t expected = level == 0 ? 2 : 1;
+      if (field == expected && level < 2 && wireType == 2) {
+        reader = reader.readMessage();
+        found = true;
+        break;
+      } else if (field == expected && level == 2 && wireType == 0) {
+        return static_cast<int>(reader.readVarint());
+      }
+      reader.skip(wireType);
+    }
+    if (!found) {
+      return 0;
+    }
+  }
+  return 0;
+}
+
+/// reads the nodes and the element type of the first input of the graph of a ModelProto
+bool parseModel(ProtoReader model, std::vector<OnnxNode>& nodes, int& inputType)
+{
+  uint32_t field, wireType;
+  while (model.nextField(field, wireType)) {
+    if (field != 7 || wireType != 2) { // graph
+      model.skip(wireType);
+      continue;
+    }
+    ProtoReader graph = model.readMessage();
+    while (graph.nextField(field, wireType)) {
+      if (field == 1 && wireType == 2) {
+        nodes.emplace_back();
+        if (!parseNode(graph.readMessage(), nodes.back())) {
+          return false;
+        }
+      } else if (field == 11 && wireType == 2 && inputType == 0) {
+        inputType = parseElementType(graph.readMessage());
+      } else {
+        graph.skip(wireType);
+      }
+    }
+    if (!graph.ok()) {
+      return false;
+    }
+  }
+  return model.ok();
+}
+
+} // namespace
+
+void TreeEnsemble::clear()
+{
+  mNodes.clear();
+  mTreeRoots.clear();
+  mTreeDepths.clear();
+  mLeafOffsets.clear();
+  mLeafTargets.clear();
+  mLeafWeights.clear();
+  mBaseValues.clear();
+  mPostTransform = PostTransform::None;
+  mAverage = false;
+  mNumFeatures = 0;
+  mNumOutputs = 0;
+  mInputType = 1;
+}
+
+bool TreeEnsemble::loadONNX(const std::string& path)
+{
+  clear();
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    LOG(warning) << "TreeEnsemble: cannot open " << path;
+    return false;
+  }
+  const std::vector<uint8_t> buffer{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+  std::vector<OnnxNode> onnxNodes;
+  int inputType = 0;
+  if (!parseModel(ProtoReader(buffer.data(), buffer.data() + buffer.size()), onnxNodes, inputType)) {
+    LOG(warning) << "TreeEnsemble: " << path << " is not a valid ONNX model";
+    return false;
+  }
+  if (onnxNodes.size() != 1 || (onnxNodes[0].opType != "TreeEnsembleClassifier" && onnxNodes[0].opType != "TreeEnsembleRegressor")) {
+    LOG(info) << "TreeEnsemble: " << path << " is not a single TreeEnsembleClassifier/Regressor node, not supported";
+    return false;
+  }
+  if (inputType != 1 && inputType != 11) {
+    LOG(info) << "TreeEnsemble: " << path << " has input element type " << inputType << ", only float and double are supported";
+    return false;
+  }
+
+  auto& attributes = onnxNodes[0].attributes;
+  const bool isClassifier = onnxNodes[0].opType == "TreeEnsembleClassifier";
+  const std::string prefix = isClassifier ? "class_" : "target_";
+  auto unsupported = [&](const std::string& reason) {
+    LOG(info) << "TreeEnsemble: " << path << " not supported, " << reason;
+    clear();
+    return false;
+  };
+
+  if (attributes.count("nodes_values_as_tensor") || attributes.count("base_values_as_tensor") || attributes.count(prefix + "weights_as_tensor")) {
+    return unsupported("double precision tensor attributes");
+  }
+  const auto& treeIds = attributes["nodes_treeids"].ints;
+  const auto& nodeIds = attributes["nodes_nodeids"].ints;
+  const auto& featureIds = attributes["nodes_featureids"].ints;
+  const auto& values = attributes["nodes_values"].floats;
+  const auto& modes = attributes["nodes_modes"].strings;
+  const auto& trueIds = attributes["nodes_truenodeids"].ints;
+  const auto& falseIds = attributes["nodes_falsenodeids"].ints;
+  const auto& missingTrue = attributes["nodes_missing_value_tracks_true"].ints;
+  const size_t nOnnxNodes = treeIds.size();
+  if (nOnnxNodes == 0 || nodeIds.size() != nOnnxNodes || featureIds.size() != nOnnxNodes || values.size() != nOnnxNodes || modes.size() != nOnnxNodes ||
+      trueIds.size() != nOnnxNodes || falseIds.size() != nOnnxNodes || (!missingTrue.empty() && missingTrue.size() != nOnnxNodes)) {
+    return unsupported("inconsistent node attributes");
+  }
+
+  const auto& weightTreeIds = attributes[prefix + "treeids"].ints;
+  const auto& weightNodeIds = attributes[prefix + "nodeids"].ints;
+  const auto& weightTargets = attributes[prefix + "ids"].ints;
+  const auto& weights = attributes[prefix + "weights"].floats;
+  const size_t nWeights = weightTreeIds.size();
+  if (weightNodeIds.size() != nWeights || weightTargets.size() != nWeights || weights.size() != nWeights) {
+    return unsupported("inconsistent leaf attributes");
+  }
+
+  if (isClassifier) {
+    mNumOutputs = std::max(attributes["classlabels_int64s"].ints.size(), attributes["classlabels_strings"].strings.size());
+    // binary classifiers with the weights of one class only get a second, derived, output column in ONNX Runtime
+    if (mNumOutputs == 2 && std::set<int64_t>(weightTargets.begin(), weightTargets.end()).size() < 2) {
+      return unsupported("binary classifier with a single score");
+    }
+  } else {
+    mNumOutputs = attributes["n_targets"].i;
+    const std::string aggregate = attributes.count("aggregate_function") ? attributes["aggregate_function"].s : "SUM";
+    if (aggregate != "SUM" && aggregate != "AVERAGE") {
+      return unsupported("aggregate function " + aggregate);
+    }
+    mAverage = aggregate == "AVERAGE";
+  }
+  if (mNumOutputs <= 0 || mNumOutputs > MaxOutputs) {
+    return unsupported("number of outputs " + std::to_string(mNumOutputs));
+  }
+
+  const std::string postTransform = attributes.count("post_transform") ? attributes["post_transform"].s : "NONE";
+  if (postTransform == "NONE") {
+    mPostTransform = PostTransform::None;
+  } else if (postTransform == "LOGISTIC") {
+    mPostTransform = PostTransform::Logistic;
+  } else if (postTransform == "SOFTMAX") {
+    mPostTransform = PostTransform::Softmax;
+  } else {
+    return unsupported("post transform " + postTransform);
+  }
+
+  const auto& baseValues = attributes["base_values"].floats;
+  if (!baseValues.empty() && baseValues.size() != static_cast<size_t>(mNumOutputs)) {
+    return unsupported("inconsistent base values");
+  }
+  mBaseValues.assign(baseValues.begin(), baseValues.end());
+
+  // ONNX nodes of each tree, by node id
+  std::map<int64_t, std::unordered_map<int64_t, size_t>> trees;
+  for (size_t i = 0; i < nOnnxNodes; i++) {
+    if (!trees[treeIds[i]].emplace(nodeIds[i], i).second) {
+      return unsupported("duplicated node id");
+    }
+  }
+
+  // flatten the trees breadth first, the root is the only node which is not a child
+  std::map<int64_t, std::unordered_map<int64_t, int32_t>> flatIds;
+  for (auto const& [treeId, treeNodes] : trees) {
+    std::set<int64_t> children;
+    for (auto const& [nodeId, i] : treeNodes) {
+      if (modes[i] != "LEAF") {
+        children.insert(trueIds[i]);
+        children.insert(falseIds[i]);
+      }
+    }
+    std::vector<int64_t> roots;
+    for (auto const& [nodeId, i] : treeNodes) {
+      if (!children.count(nodeId)) {
+        roots.push_back(nodeId);
+      }
+    }
+    if (roots.size() != 1) {
+      return unsupported("tree " + std::to_string(treeId) + " without a unique root");
+    }
+
+    auto& treeFlatIds = flatIds[treeId];
+    const int32_t first = mNodes.size();
+    std::vector<size_t> order{treeNodes.at(roots[0])};
+    std::vector<int> levels{0};
+    treeFlatIds[roots[0]] = first;
+    for (size_t k = 0; k < order.size(); k++) {
+      const size_t i = order[k];
+      if (modes[i] == "LEAF") {
+        continue;
+      }
+      for (const int64_t child : {trueIds[i], falseIds[i]}) {
+        if (!treeNodes.count(child) || treeFlatIds.count(child)) {
+          return unsupported("tree " + std::to_string(treeId) + " is not a tree");
+        }
+        treeFlatIds[child] = first + order.size();
+        order.push_back(treeNodes.at(child));
+        levels.push_back(levels[k] + 1);
+      }
+    }
+
+    for (size_t k = 0; k < order.size(); k++) {
+      const size_t i = order[k];
+      Node node;
+      const int32_t self = first + k;
+      if (modes[i] == "LEAF") {
+        node.trueChild = self;
+        node.falseChild = self;
+        mNodes.push_back(node);
+        continue;
+      }
+      if (featureIds[i] < 0) {
+        return unsupported("negative feature id");
+      }
+      node.feature = featureIds[i];
+      node.threshold = values[i];
+      node.trueChild = treeFlatIds[trueIds[i]];
+      node.falseChild = treeFlatIds[falseIds[i]];
+      bool missingGoesTrue = !missingTrue.empty() && missingTrue[i];
+      // all modes are turned into "x < threshold", optionally or "x == threshold", by swapping the children
+      if (modes[i] == "BRANCH_LEQ" || modes[i] == "BRANCH_GT") {
+        node.flags |= EqualGoesTrue;
+      } else if (modes[i] != "BRANCH_LT" && modes[i] != "BRANCH_GTE") {
+        return unsupported("node mode " + modes[i]);
+      }
+      if (modes[i] == "BRANCH_GTE" || modes[i] == "BRANCH_GT") {
+        std::swap(node.trueChild, node.falseChild);
+        // NaN fails the original comparison as well, so it must still end up in the original false child
+        missingGoesTrue = !missingGoesTrue;
+      }
+      if (missingGoesTrue) {
+        node.flags |= MissingGoesTrue;
+      }
+      mNumFeatures = std::max(mNumFeatures, node.feature + 1);
+      mNodes.push_back(node);
+    }
+    mTreeRoots.push_back(first);
+    mTreeDepths.push_back(*std::max_element(levels.begin(), levels.end()));
+  }
+
+  // leaf weights in CSR format, indexed by the flat node id
+  std::vector<std::pair<int32_t, size_t>> leafWeights;
+  leafWeights.reserve(nWeights);
+  for (size_t w = 0; w < nWeights; w++) {
+    auto tree = flatIds.find(weightTreeIds[w]);
+    if (tree == flatIds.end() || !tree->second.count(weightNodeIds[w])) {
+      continue; // unreachable node
+    }
+    const int32_t flatId = tree->second[weightNodeIds[w]];
+    if (mNodes[flatId].trueChild != flatId || weightTargets[w] < 0 || weightTargets[w] >= mNumOutputs) {
+      return unsupported("weight of a split node or of an unknown output");
+    }
+    leafWeights.emplace_back(flatId, w);
+  }
+  std::stable_sort(leafWeights.begin(), leafWeights.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+  mLeafOffsets.assign(mNodes.size() + 1, 0);
+  for (auto const& [flatId, w] : leafWeights) {
+    mLeafOffsets[flatId + 1]++;
+    mLeafTargets.push_back(weightTargets[w]);
+    mLeafWeights.push_back(weights[w]);
+  }
+  for (size_t n = 0; n < mNodes.size(); n++) {
+    mLeafOffsets[n + 1] += mLeafOffsets[n];
+  }
+
+  mInputType = inputType;
+  LOG(info) << "TreeEnsemble: loaded " << path << " with " << mTreeRoots.size() << " trees, " << mNodes.size() << " nodes, "
+            << mNumFeatures << " features and " << mNumOutputs << " outputs";
+  return true;
+}
+
+void TreeEnsemble::finalize(double* values) const
+{
+  for (int i = 0; i < mNumOutputs; i++) {
+    if (mAverage) {
+      values[i] /= mTreeRoots.size();
+    }
+    if (!mBaseValues.empty()) {
+      values[i] += mBaseValues[i];
+    }
+  }
+  switch (mPostTransform) {
+    case PostTransform::None:
+      break;
+    case PostTransform::Logistic:
+      for (int i = 0; i < mNumOutputs; i++) {
+        values[i] = 1. / (1. + std::exp(-values[i]));
+      }
+      break;
+    case PostTransform::Softmax: {
+      const double max = *std::max_element(values, values + mNumOutputs);
+      double sum = 0.;
+      for (int i = 0; i < mNumOutputs; i++) {
+        values[i] = std::exp(values[i] - max);
+        sum += values[i];
+      }
+      for (int i = 0; i < mNumOutputs; i++) {
+        values[i] /= sum;
+      }
+      break;
+    }
+  }
+}
+
+} // namespace ml
+
+} // namespace o2
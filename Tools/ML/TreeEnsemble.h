@@ -0,0 +1,148 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+///
+/// \file     TreeEnsemble.h
+///
+/// \brief    Native evaluator of tree-ensemble models (BDTs) exported to ONNX
+///
+/// The TreeEnsembleClassifier / TreeEnsembleRegressor operator of the ai.onnx.ml domain, which is
+/// what XGBoost and LightGBM models are converted to, is read directly from the ONNX file and
+/// flattened into one node array, with the trees stored breadth first. Leaves point to themselves,
+/// so that every tree is traversed with a fixed number of steps and without data-dependent branches,
+/// and a block of rows is advanced one level at a time in the inner loop.
+///
+/// Only models made of a single tree-ensemble node are supported, loadONNX returns false for
+/// anything else and the model has to be evaluated with ONNX Runtime instead.
+///
+
+#ifndef TOOLS_ML_TREEENSEMBLE_H_
+#define TOOLS_ML_TREEENSEMBLE_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace o2
+{
+
+namespace ml
+{
+
+class TreeEnsemble
+{
+ public:
+  enum class PostTransform { None,
+                             Logistic,
+                             Softmax };
+
+  /// maximum number of outputs (classes or targets) of a model
+  static constexpr int MaxOutputs = 16;
+
+  /// reads the tree-ensemble node of an ONNX model
+  /// \return false (and an empty model) if the file cannot be read or the model is not supported
+  bool loadONNX(const std::string& path);
+  void clear();
+
+  bool isLoaded() const { return !mTreeRoots.empty(); }
+  int getNumFeatures() const { return mNumFeatures; }
+  int getNumOutputs() const { return mNumOutputs; }
+  int getNumTrees() const { return mTreeRoots.size(); }
+  /// ONNX element type of the model input (1 = float, 11 = double)
+  int getInputType() const { return mInputType; }
+
+  /// evaluates a batch of rows
+  /// \param features row-major input, nColumns >= getNumFeatures() values per row
+  /// \param scores output, getNumOutputs() values per row, as the second output of the ONNX model
+  template <typename T>
+  void predict(const T* features, size_t nRows, size_t nColumns, T* scores) const
+  {
+    constexpr size_t BlockSize = 64;
+    std::array<int32_t, BlockSize> nodeIds;
+    std::array<double, BlockSize * MaxOutputs> sums;
+
+    for (size_t first = 0; first < nRows; first += BlockSize) {
+      const size_t nBlock = std::min(BlockSize, nRows - first);
+      const T* block = features + first * nColumns;
+      std::fill_n(sums.begin(), nBlock * mNumOutputs, 0.);
+
+      for (size_t iTree = 0; iTree < mTreeRoots.size(); iTree++) {
+        std::fill_n(nodeIds.begin(), nBlock, mTreeRoots[iTree]);
+        for (int depth = 0; depth < mTreeDepths[iTree]; depth++) {
+          for (size_t iRow = 0; iRow < nBlock; iRow++) {
+            const Node& node = mNodes[nodeIds[iRow]];
+            const T x = block[iRow * nColumns + node.feature];
+            const T threshold = node.threshold;
+            const bool goTrue = (x < threshold) | (((node.flags & EqualGoesTrue) != 0) & (x == threshold)) | (((node.flags & MissingGoesTrue) != 0) & std::isnan(x));
+            nodeIds[iRow] = goTrue ? node.trueChild : node.falseChild;
+          }
+        }
+        for (size_t iRow = 0; iRow < nBlock; iRow++) {
+          double* rowSums = sums.data() + iRow * mNumOutputs;
+          for (int32_t iWeight = mLeafOffsets[nodeIds[iRow]]; iWeight < mLeafOffsets[nodeIds[iRow] + 1]; iWeight++) {
+            rowSums[mLeafTargets[iWeight]] += mLeafWeights[iWeight];
+          }
+        }
+      }
+
+      for (size_t iRow = 0; iRow < nBlock; iRow++) {
+        double* rowSums = sums.data() + iRow * mNumOutputs;
+        finalize(rowSums);
+        T* rowScores = scores + (first + iRow) * mNumOutputs;
+        for (int iOut = 0; iOut < mNumOutputs; iOut++) {
+          rowScores[iOut] = rowSums[iOut];
+        }
+      }
+    }
+  }
+
+ private:
+  enum NodeFlags : uint8_t {
+    EqualGoesTrue = 0x1,  // x == threshold follows the true child
+    MissingGoesTrue = 0x2 // NaN follows the true child
+  };
+
+  /// split node, the true child is followed if x < threshold (see flags);
+  /// leaves have both children pointing to themselves
+  struct Node {
+    float threshold = 0.f;
+    int32_t feature = 0;
+    int32_t trueChild = 0;
+    int32_t falseChild = 0;
+    uint8_t flags = 0;
+  };
+
+  /// adds the base values, averages and applies the post transform to the raw sums of one row
+  void finalize(double* values) const;
+
+  std::vector<Node> mNodes;
+  std::vector<int32_t> mTreeRoots;
+  std::vector<int> mTreeDepths;
+  std::vector<int32_t> mLeafOffsets; // weights of leaf n are [mLeafOffsets[n], mLeafOffsets[n + 1])
+  std::vector<int32_t> mLeafTargets;
+  std::vector<float> mLeafWeights;
+  std::vector<double> mBaseValues;
+  PostTransform mPostTransform = PostTransform::None;
+  bool mAverage = false;
+  int mNumFeatures = 0;
+  int mNumOutputs = 0;
+  int mInputType = 1;
+};
+
+} // namespace ml
+
+} // namespace o2
+
+#endif // TOOLS_ML_TREEENSEMBLE_H_
@@ -23,6 +23,7 @@
 #include <string>
 #include <array>
 #include <set>
+#include <vector>
 
 namespace pidml_pt_cuts
 {
@@ -85,13 +86,11 @@ struct PidONNXInterface {
   template <typename T>
   float applyModel(const T& track, int pid)
   {
-    for (std::size_t i = 0; i < mNPids; i++) {
-      if (mModels[i * kNDetectors].mPid == pid) {
-        for (uint32_t j = 0; j < kNDetectors; j++) {
-          if (track.pt() >= mPTLimits[i][j] && (j == kNDetectors - 1 || track.pt() < mPTLimits[i][j + 1])) {
-            return mModels[i * kNDetectors + j].applyModel(track);
-          }
-        }
+    int i = getPidIndex(pid);
+    if (i >= 0) {
+      uint32_t j = getDetectorIndex(i, track.pt());
+      if (j < kNDetectors) {
+        return mModels[i * kNDetectors + j].applyModel(track);
       }
     }
     LOG(error) << "No suitable PID ML model found for track: " << track.globalIndex() << " from collision: " << track.collision().globalIndex() << " and expected pid: " << pid;
@@ -101,20 +100,97 @@ struct PidONNXInterface {
   template <typename T>
   bool applyModelBoolean(const T& track, int pid)
   {
-    for (std::size_t i = 0; i < mNPids; i++) {
-      if (mModels[i * kNDetectors].mPid == pid) {
-        for (uint32_t j = 0; j < kNDetectors; j++) {
-          if (track.pt() >= mPTLimits[i][j] && (j == kNDetectors - 1 || track.pt() < mPTLimits[i][j + 1])) {
-            return mModels[i * kNDetectors + j].applyModelBoolean(track);
-          }
-        }
+    int i = getPidIndex(pid);
+    if (i >= 0) {
+      uint32_t j = getDetectorIndex(i, track.pt());
+      if (j < kNDetectors) {
+        return mModels[i * kNDetectors + j].applyModelBoolean(track);
       }
     }
     LOG(error) << "No suitable PID ML model found for track: " << track.globalIndex() << " from collision: " << track.collision().globalIndex() << " and expected pid: " << pid;
     return false;
   }
 
+  // Batched version of applyModel(): the tracks are grouped by the detector configuration selected by their pT,
+  // each model is evaluated once on its group and the certainties are scattered back in the order of the tracks
+  template <typename T>
+  void applyModelBatch(const T& tracks, int pid, std::vector<float>& certainties)
+  {
+    certainties.assign(tracks.size(), -1.0f);
+    int i = getPidIndex(pid);
+    if (i < 0) {
+      LOG(error) << "No suitable PID ML model found for expected pid: " << pid;
+      return;
+    }
+
+    for (uint32_t j = 0; j < kNDetectors; j++) {
+      mModels[i * kNDetectors + j].clearBatch();
+      mBatchRows[j].clear();
+    }
+    std::size_t row = 0;
+    std::size_t nUnmatched = 0;
+    for (auto& track : tracks) {
+      uint32_t j = getDetectorIndex(i, track.pt());
+      if (j < kNDetectors) {
+        mModels[i * kNDetectors + j].addToBatch(track);
+        mBatchRows[j].push_back(row);
+      } else {
+        nUnmatched++;
+      }
+      row++;
+    }
+    if (nUnmatched > 0) {
+      LOG(error) << "No suitable PID ML model found for " << nUnmatched << " tracks and expected pid: " << pid;
+    }
+
+    for (uint32_t j = 0; j < kNDetectors; j++) {
+      if (mBatchRows[j].empty()) {
+        continue;
+      }
+      const auto& outputs = mModels[i * kNDetectors + j].evaluateBatch();
+      for (std::size_t k = 0; k < mBatchRows[j].size(); k++) {
+        certainties[mBatchRows[j][k]] = outputs[k];
+      }
+    }
+  }
+
+  template <typename T>
+  void applyModelBooleanBatch(const T& tracks, int pid, std::vector<bool>& accepted)
+  {
+    applyModelBatch(tracks, pid, mBatchCertainties);
+    accepted.assign(mBatchCertainties.size(), false);
+    int i = getPidIndex(pid);
+    if (i < 0) {
+      return;
+    }
+    for (std::size_t k = 0; k < mBatchCertainties.size(); k++) {
+      // tracks without a suitable model are rejected, as in applyModelBoolean()
+      accepted[k] = mBatchCertainties[k] >= 0.0f && mBatchCertainties[k] >= mModels[i * kNDetectors].mMinCertainty;
+    }
+  }
+
  private:
+  int getPidIndex(int pid) const
+  {
+    for (std::size_t i = 0; i < mNPids; i++) {
+      if (mModels[i * kNDetectors].mPid == pid) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  // Index of the detector configuration whose pT range contains pt, kNDetectors if none
+  uint32_t getDetectorIndex(int i, float pt) const
+  {
+    for (uint32_t j = 0; j < kNDetectors; j++) {
+      if (pt >= mPTLimits[i][j] && (j == kNDetectors - 1 || pt < mPTLimits[i][j + 1])) {
+        return j;
+      }
+    }
+    return kNDetectors;
+  }
+
   void fillDefaultConfiguration(std::vector<double>& minCertainties)
   {
     // FIXME: A more sophisticated strategy should be based on pid values as well
@@ -125,5 +201,8 @@ struct PidONNXInterface {
   std::vector<PidONNXModel> mModels;
   std::size_t mNPids;
   LabeledArray<double> mPTLimits;
+
+  std::array<std::vector<std::size_t>, kNDetectors> mBatchRows; // rows of the tracks assigned to each detector configuration
+  std::vector<float> mBatchCertainties;
 };
 #endif // O2_ANALYSIS_PIDONNXINTERFACE_H_
@@ -22,7 +22,9 @@
 #include <onnxruntime/core/session/experimental_onnxruntime_cxx_api.h>
 #include <rapidjson/document.h>
 #include <rapidjson/filereadstream.h>
+#include <array>
 #include <string>
+#include <vector>
 
 enum PidMLDetector {
   kTPCOnly = 0,
@@ -101,6 +103,66 @@ struct PidONNXModel {
     return getModelOutput(track) >= mMinCertainty;
   }
 
+  // Batched inference: the inputs of the tracks are appended to one contiguous matrix with addToBatch(),
+  // evaluateBatch() runs the model on all of them at once and returns the certainties in the order the tracks were added
+  template <typename T>
+  void addToBatch(const T& track)
+  {
+    addInputs(track, mBatchInputs);
+    mBatchSize++;
+  }
+
+  void clearBatch()
+  {
+    mBatchInputs.clear();
+    mBatchSize = 0;
+  }
+
+  std::size_t getBatchSize() const { return mBatchSize; }
+
+  const std::vector<float>& evaluateBatch()
+  {
+    mBatchOutputs.assign(mBatchSize, 0.0f);
+    if (mBatchSize == 0) {
+      return mBatchOutputs;
+    }
+    const std::size_t nInputs = mBatchInputs.size() / mBatchSize;
+    auto input_shape = mInputShapes[0];
+    // Models exported with a dynamic batch dimension are run once on the whole matrix, the others once per track
+    const bool dynamicBatch = input_shape[0] < 0;
+    const std::size_t rowsPerRun = dynamicBatch ? mBatchSize : 1;
+    if (dynamicBatch) {
+      input_shape[0] = rowsPerRun;
+    }
+
+    try {
+      for (std::size_t first = 0; first < mBatchSize; first += rowsPerRun) {
+        std::vector<Ort::Value> inputTensors;
+        inputTensors.emplace_back(Ort::Experimental::Value::CreateTensor<float>(mBatchInputs.data() + first * nInputs, rowsPerRun * nInputs, input_shape));
+        auto outputTensors = mSession->Run(mInputNames, inputTensors, mOutputNames);
+        assert(outputTensors.size() == mOutputNames.size() && outputTensors[0].IsTensor());
+
+        const float* output_values = outputTensors[0].GetTensorData<float>();
+        for (std::size_t i = 0; i < rowsPerRun; i++) {
+          mBatchOutputs[first + i] = sigmoid(output_values[i]); // FIXME: Temporary, sigmoid will be added as network layer
+        }
+      }
+    } catch (const Ort::Exception& exception) {
+      LOG(error) << "Error running batched model inference on " << mBatchSize << " tracks: " << exception.what();
+    }
+    return mBatchOutputs;
+  }
+
+  template <typename T>
+  const std::vector<float>& applyModelBatch(const T& tracks)
+  {
+    clearBatch();
+    for (auto& track : tracks) {
+      addToBatch(track);
+    }
+    return evaluateBatch();
+  }
+
   PidMLDetector mDetector;
   int mPid;
   double mMinCertainty;
@@ -171,39 +233,77 @@ struct PidONNXModel {
         mScalingParams[param[0].GetString()] = std::make_pair(param[1].GetFloat(), param[2].GetFloat());
       }
     }
+    cacheScalingParams();
+  }
+
+  // Scaled inputs, in the order they are passed to the model
+  enum ScaledInput {
+    kX = 0,
+    kY,
+    kZ,
+    kAlpha,
+    kTPCNClsShared,
+    kDcaXY,
+    kDcaZ,
+    kTPCSignal,
+    kTOFSignal,
+    kBeta,
+    kTRDSignal,
+    kTRDPattern,
+    kNScaledInputs
+  };
+
+  // Copies the scaling parameters used by the detector configuration, so that they are not looked up by name for each track
+  void cacheScalingParams()
+  {
+    static const std::array<std::string, kNScaledInputs> names{"fX", "fY", "fZ", "fAlpha", "fTPCNClsShared", "fDcaXY", "fDcaZ", "fTPCSignal", "fTOFSignal", "fBeta", "fTRDSignal", "fTRDPattern"};
+    int nUsed = kTOFSignal;
+    if (mDetector >= kTPCTOF) {
+      nUsed = kTRDSignal;
+    }
+    if (mDetector >= kTPCTOFTRD) {
+      nUsed = kNScaledInputs;
+    }
+    for (int i = 0; i < nUsed; i++) {
+      auto param = mScalingParams.find(names[i]);
+      if (param == mScalingParams.end()) {
+        LOG(fatal) << "PID ML model: missing scaling parameters for input " << names[i];
+      }
+      mScaling[i] = param->second;
+    }
+  }
+
+  float scale(ScaledInput input, float value) const
+  {
+    return (value - mScaling[input].first) / mScaling[input].second;
   }
 
   template <typename T>
-  std::vector<float> createInputsSingle(const T& track)
+  void addInputs(const T& track, std::vector<float>& inputValues)
   {
     // TODO: Hardcoded for now. Planning to implement RowView extension to get runtime access to selected columns
     // sign is short, trackType and tpcNClsShared uint8_t
-    float scaledX = (track.x() - mScalingParams.at("fX").first) / mScalingParams.at("fX").second;
-    float scaledY = (track.y() - mScalingParams.at("fY").first) / mScalingParams.at("fY").second;
-    float scaledZ = (track.z() - mScalingParams.at("fZ").first) / mScalingParams.at("fZ").second;
-    float scaledAlpha = (track.alpha() - mScalingParams.at("fAlpha").first) / mScalingParams.at("fAlpha").second;
-    float scaledTPCNClsShared = ((float)track.tpcNClsShared() - mScalingParams.at("fTPCNClsShared").first) / mScalingParams.at("fTPCNClsShared").second;
-    float scaledDcaXY = (track.dcaXY() - mScalingParams.at("fDcaXY").first) / mScalingParams.at("fDcaXY").second;
-    float scaledDcaZ = (track.dcaZ() - mScalingParams.at("fDcaZ").first) / mScalingParams.at("fDcaZ").second;
-
-    float scaledTPCSignal = (track.tpcSignal() - mScalingParams.at("fTPCSignal").first) / mScalingParams.at("fTPCSignal").second;
-
-    std::vector<float> inputValues{track.px(), track.py(), track.pz(), (float)track.sign(), scaledX, scaledY, scaledZ, scaledAlpha, (float)track.trackType(), scaledTPCNClsShared, scaledDcaXY, scaledDcaZ, track.p(), scaledTPCSignal};
+    inputValues.insert(inputValues.end(), {track.px(), track.py(), track.pz(), (float)track.sign(),
+                                           scale(kX, track.x()), scale(kY, track.y()), scale(kZ, track.z()), scale(kAlpha, track.alpha()),
+                                           (float)track.trackType(), scale(kTPCNClsShared, (float)track.tpcNClsShared()),
+                                           scale(kDcaXY, track.dcaXY()), scale(kDcaZ, track.dcaZ()), track.p(), scale(kTPCSignal, track.tpcSignal())});
 
     if (mDetector >= kTPCTOF) {
-      float scaledTOFSignal = (track.tofSignal() - mScalingParams.at("fTOFSignal").first) / mScalingParams.at("fTOFSignal").second;
-      float scaledBeta = (track.beta() - mScalingParams.at("fBeta").first) / mScalingParams.at("fBeta").second;
-      inputValues.push_back(scaledTOFSignal);
-      inputValues.push_back(scaledBeta);
+      inputValues.push_back(scale(kTOFSignal, track.tofSignal()));
+      inputValues.push_back(scale(kBeta, track.beta()));
     }
 
     if (mDetector >= kTPCTOFTRD) {
-      float scaledTRDSignal = (track.trdSignal() - mScalingParams.at("fTRDSignal").first) / mScalingParams.at("fTRDSignal").second;
-      float scaledTRDPattern = (track.trdPattern() - mScalingParams.at("fTRDPattern").first) / mScalingParams.at("fTRDPattern").second;
-      inputValues.push_back(scaledTRDSignal);
-      inputValues.push_back(scaledTRDPattern);
+      inputValues.push_back(scale(kTRDSignal, track.trdSignal()));
+      inputValues.push_back(scale(kTRDPattern, track.trdPattern()));
     }
+  }
 
+  template <typename T>
+  std::vector<float> createInputsSingle(const T& track)
+  {
+    std::vector<float> inputValues;
+    addInputs(track, inputValues);
     return inputValues;
   }
 
@@ -256,6 +356,11 @@ struct PidONNXModel {
 
   std::vector<std::string> mTrainColumns;
   std::map<std::string, std::pair<float, float>> mScalingParams;
+  std::array<std::pair<float, float>, kNScaledInputs> mScaling;
+
+  std::vector<float> mBatchInputs;  // one row of inputs per track
+  std::vector<float> mBatchOutputs; // one certainty per track
+  std::size_t mBatchSize = 0;
 
   std::shared_ptr<Ort::Env> mEnv = nullptr;
   // No empty constructors for Session, we need a pointer
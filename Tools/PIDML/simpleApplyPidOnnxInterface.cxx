@@ -65,6 +65,27 @@ struct SimpleApplyOnnxInterface {
   // Filter on isGlobalTrack (TracksSelection)
   using BigTracks = soa::Filtered<soa::Join<aod::FullTracks, aod::TracksDCA, aod::pidTOFbeta, aod::TrackSelection, aod::TOFSignal>>;
 
+  std::vector<std::vector<bool>> accepted; // one decision per track for each pid
+
+  // The tracks of the time frame are evaluated with a single inference per pid and detector configuration
+  void fillResults(BigTracks const& tracks)
+  {
+    accepted.resize(cfgPids.value.size());
+    for (std::size_t i = 0; i < cfgPids.value.size(); i++) {
+      pidInterface.applyModelBooleanBatch(tracks, cfgPids.value[i], accepted[i]);
+    }
+    std::size_t row = 0;
+    for (auto& track : tracks) {
+      for (std::size_t i = 0; i < cfgPids.value.size(); i++) {
+        int pid = cfgPids.value[i];
+        LOGF(debug, "collision id: %d track id: %d pid: %d accepted: %d p: %.3f; x: %.3f, y: %.3f, z: %.3f",
+             track.collisionId(), track.index(), pid, (bool)accepted[i][row], track.p(), track.x(), track.y(), track.z());
+        pidMLResults(track.index(), pid, accepted[i][row]);
+      }
+      row++;
+    }
+  }
+
   void init(InitContext const&)
   {
     if (cfgUseCCDB) {
@@ -80,29 +101,16 @@ struct SimpleApplyOnnxInterface {
     if (cfgUseCCDB && bc.runNumber() != currentRunNumber) {
       uint64_t timestamp = cfgUseFixedTimestamp ? cfgTimestamp.value : bc.timestamp();
       pidInterface = PidONNXInterface(cfgPathLocal.value, cfgPathCCDB.value, cfgUseCCDB.value, ccdbApi, timestamp, cfgPids.value, cfgPTCuts.value, cfgCertainties.value, cfgAutoMode.value);
+      currentRunNumber = bc.runNumber();
     }
 
-    for (auto& track : tracks) {
-      for (int pid : cfgPids.value) {
-        bool accepted = pidInterface.applyModelBoolean(track, pid);
-        LOGF(info, "collision id: %d track id: %d pid: %d accepted: %d p: %.3f; x: %.3f, y: %.3f, z: %.3f",
-             track.collisionId(), track.index(), pid, accepted, track.p(), track.x(), track.y(), track.z());
-        pidMLResults(track.index(), pid, accepted);
-      }
-    }
+    fillResults(tracks);
   }
   PROCESS_SWITCH(SimpleApplyOnnxInterface, processCollisions, "Process with collisions and bcs for CCDB", true);
 
   void processTracksOnly(BigTracks const& tracks)
   {
-    for (auto& track : tracks) {
-      for (int pid : cfgPids.value) {
-        bool accepted = pidInterface.applyModelBoolean(track, pid);
-        LOGF(info, "collision id: %d track id: %d pid: %d accepted: %d p: %.3f; x: %.3f, y: %.3f, z: %.3f",
-             track.collisionId(), track.index(), pid, accepted, track.p(), track.x(), track.y(), track.z());
-        pidMLResults(track.index(), pid, accepted);
-      }
-    }
+    fillResults(tracks);
   }
   PROCESS_SWITCH(SimpleApplyOnnxInterface, processTracksOnly, "Process with tracks only -- faster but no CCDB", false);
 };
@@ -63,6 +63,19 @@ struct SimpleApplyOnnxModel {
   // Filter on isGlobalTrack (TracksSelection)
   using BigTracks = soa::Filtered<soa::Join<aod::FullTracks, aod::TracksDCA, aod::pidTOFbeta, aod::TrackSelection, aod::TOFSignal>>;
 
+  // All the tracks of the time frame are evaluated with a single inference
+  void fillResults(BigTracks const& tracks)
+  {
+    const auto& certainties = pidModel.applyModelBatch(tracks);
+    std::size_t row = 0;
+    for (auto& track : tracks) {
+      bool accepted = certainties[row++] >= pidModel.mMinCertainty;
+      LOGF(debug, "collision id: %d track id: %d accepted: %d p: %.3f; x: %.3f, y: %.3f, z: %.3f",
+           track.collisionId(), track.index(), accepted, track.p(), track.x(), track.y(), track.z());
+      pidMLResults(track.index(), cfgPid.value, accepted);
+    }
+  }
+
   void init(InitContext const&)
   {
     if (cfgUseCCDB) {
@@ -78,25 +91,16 @@ struct SimpleApplyOnnxModel {
     if (cfgUseCCDB && bc.runNumber() != currentRunNumber) {
       uint64_t timestamp = cfgUseFixedTimestamp ? cfgTimestamp.value : bc.timestamp();
       pidModel = PidONNXModel(cfgPathLocal.value, cfgPathCCDB.value, cfgUseCCDB.value, ccdbApi, timestamp, cfgPid.value, static_cast<PidMLDetector>(cfgDetector.value), cfgCertainty.value);
+      currentRunNumber = bc.runNumber();
     }
 
-    for (auto& track : tracks) {
-      bool accepted = pidModel.applyModelBoolean(track);
-      LOGF(info, "collision id: %d track id: %d accepted: %d p: %.3f; x: %.3f, y: %.3f, z: %.3f",
-           track.collisionId(), track.index(), accepted, track.p(), track.x(), track.y(), track.z());
-      pidMLResults(track.index(), cfgPid.value, accepted);
-    }
+    fillResults(tracks);
   }
   PROCESS_SWITCH(SimpleApplyOnnxModel, processCollisions, "Process with collisions and bcs for CCDB", true);
 
   void processTracksOnly(BigTracks const& tracks)
   {
-    for (auto& track : tracks) {
-      bool accepted = pidModel.applyModelBoolean(track);
-      LOGF(info, "collision id: %d track id: %d accepted: %d p: %.3f; x: %.3f, y: %.3f, z: %.3f",
-           track.collisionId(), track.index(), accepted, track.p(), track.x(), track.y(), track.z());
-      pidMLResults(track.index(), cfgPid.value, accepted);
-    }
+    fillResults(tracks);
   }
   PROCESS_SWITCH(SimpleApplyOnnxModel, processTracksOnly, "Process with tracks only -- faster but no CCDB", false);
 };